@@ -0,0 +1,31 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+
+#include "WorkerPool.h"
+
+namespace Tools {
+
+// Calls worker() on up to threadCount threads of the shared pool, the calling thread included. Each call must be able
+// to do all the work alone, see WorkerPool::run.
+template<class Worker> void runOnThreads(size_t threadCount, const Worker& worker) {
+  WorkerPool::instance().run(threadCount, std::function<void()>(std::cref(worker)));
+}
+
+// Calls job(i) for each i in [0, count) on up to threadCount threads, the calling thread included
+template<class Job> void parallelFor(size_t count, size_t threadCount, const Job& job) {
+  std::atomic<size_t> next(0);
+  runOnThreads(std::min(threadCount, count), [count, &job, &next] {
+    for (size_t i = next++; i < count; i = next++) {
+      job(i);
+    }
+  });
+}
+
+}
@@ -0,0 +1,85 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "RecursiveSharedMutex.h"
+
+#include <stdexcept>
+
+namespace Tools {
+
+RecursiveSharedMutex::RecursiveSharedMutex() : m_writerDepth(0), m_waitingWriters(0) {
+}
+
+void RecursiveSharedMutex::lock() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  std::thread::id thread = std::this_thread::get_id();
+  if (m_writerDepth != 0 && m_writer == thread) {
+    ++m_writerDepth;
+    return;
+  }
+
+  if (m_readers.count(thread) != 0) {
+    throw std::logic_error("RecursiveSharedMutex: exclusive lock requested while holding shared lock");
+  }
+
+  ++m_waitingWriters;
+  m_released.wait(lock, [this] { return m_writerDepth == 0 && m_readers.empty(); });
+  --m_waitingWriters;
+
+  m_writer = thread;
+  m_writerDepth = 1;
+}
+
+void RecursiveSharedMutex::unlock() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (--m_writerDepth == 0) {
+    m_writer = std::thread::id();
+    m_released.notify_all();
+  }
+}
+
+void RecursiveSharedMutex::lock_shared() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  std::thread::id thread = std::this_thread::get_id();
+  if (m_writerDepth != 0 && m_writer == thread) {
+    ++m_writerDepth;
+    return;
+  }
+
+  auto reader = m_readers.find(thread);
+  if (reader != m_readers.end()) {
+    ++reader->second;
+    return;
+  }
+
+  m_released.wait(lock, [this] { return m_writerDepth == 0 && m_waitingWriters == 0; });
+  m_readers.emplace(thread, 1);
+}
+
+void RecursiveSharedMutex::unlock_shared() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  std::thread::id thread = std::this_thread::get_id();
+  if (m_writerDepth != 0 && m_writer == thread) {
+    --m_writerDepth;
+    return;
+  }
+
+  auto reader = m_readers.find(thread);
+  if (--reader->second == 0) {
+    m_readers.erase(reader);
+    if (m_readers.empty()) {
+      m_released.notify_all();
+    }
+  }
+}
+
+SharedLockGuard::SharedLockGuard(RecursiveSharedMutex& mutex) : m_mutex(mutex) {
+  m_mutex.lock_shared();
+}
+
+SharedLockGuard::~SharedLockGuard() {
+  m_mutex.unlock_shared();
+}
+
+}
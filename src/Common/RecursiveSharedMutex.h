@@ -0,0 +1,50 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace Tools {
+
+// Reader/writer mutex where both kinds of ownership are recursive. The owner of the exclusive lock may also take
+// the shared lock, but a thread holding only the shared lock must not request the exclusive one. Waiting writers
+// block new readers, so writers are not starved by a steady stream of reads.
+class RecursiveSharedMutex {
+public:
+  RecursiveSharedMutex();
+
+  RecursiveSharedMutex(const RecursiveSharedMutex&) = delete;
+  RecursiveSharedMutex& operator=(const RecursiveSharedMutex&) = delete;
+
+  void lock();
+  void unlock();
+  void lock_shared();
+  void unlock_shared();
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_released;
+  std::thread::id m_writer;
+  size_t m_writerDepth;
+  size_t m_waitingWriters;
+  std::map<std::thread::id, size_t> m_readers;
+};
+
+class SharedLockGuard {
+public:
+  explicit SharedLockGuard(RecursiveSharedMutex& mutex);
+  ~SharedLockGuard();
+
+  SharedLockGuard(const SharedLockGuard&) = delete;
+  SharedLockGuard& operator=(const SharedLockGuard&) = delete;
+
+private:
+  RecursiveSharedMutex& m_mutex;
+};
+
+}
@@ -14,6 +14,7 @@
 #include <shlobj.h>
 #include <strsafe.h>
 #else 
+#include <pthread.h>
 #include <sys/utsname.h>
 #endif
 
@@ -381,4 +382,25 @@ std::string get_nix_version_display_string()
     return boost::filesystem::is_directory(path, ec);
   }
 
+  bool setCurrentThreadAffinity(unsigned processor) {
+#if defined(WIN32)
+    if (processor >= sizeof(DWORD_PTR) * 8) {
+      return false;
+    }
+
+    return ::SetThreadAffinityMask(::GetCurrentThread(), static_cast<DWORD_PTR>(1) << processor) != 0;
+#elif defined(__linux__)
+    if (processor >= CPU_SETSIZE) {
+      return false;
+    }
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(processor, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+#else
+    return false;
+#endif
+  }
+
 }
@@ -15,4 +15,6 @@ namespace Tools
   bool create_directories_if_necessary(const std::string& path);
   std::error_code replace_file(const std::string& replacement_name, const std::string& replaced_name);
   bool directoryExists(const std::string& path);
+  // Pins the calling thread to one processor, false where affinity isn't supported
+  bool setCurrentThreadAffinity(unsigned processor);
 }
@@ -0,0 +1,136 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+
+namespace Tools {
+
+namespace {
+
+struct Run {
+  std::mutex mutex;
+  std::condition_variable finished;
+  size_t runningCount = 0;
+  bool closed = false;
+  std::exception_ptr exception;
+};
+
+}
+
+WorkerPool::WorkerPool(size_t threadCount) : m_stopping(false) {
+  for (size_t i = 0; i < threadCount; ++i) {
+    m_threads.emplace_back(&WorkerPool::threadProcedure, this);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+
+  m_haveTasks.notify_all();
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+}
+
+WorkerPool& WorkerPool::instance() {
+  static WorkerPool pool(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+  return pool;
+}
+
+size_t WorkerPool::getThreadCount() const {
+  return m_threads.size();
+}
+
+void WorkerPool::run(size_t threadCount, const std::function<void()>& worker) {
+  auto run = std::make_shared<Run>();
+  size_t helperCount = std::min(threadCount, m_threads.size() + 1);
+  if (helperCount > 0) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (size_t i = 1; i < helperCount; ++i) {
+      // The task may be started after run() returned, it must not touch the worker then
+      m_tasks.emplace_back([run, &worker] {
+        {
+          std::unique_lock<std::mutex> runLock(run->mutex);
+          if (run->closed) {
+            return;
+          }
+
+          ++run->runningCount;
+        }
+
+        std::exception_ptr exception;
+        try {
+          worker();
+        } catch (...) {
+          exception = std::current_exception();
+        }
+
+        std::unique_lock<std::mutex> runLock(run->mutex);
+        if (exception && !run->exception) {
+          run->exception = exception;
+        }
+
+        if (--run->runningCount == 0) {
+          run->finished.notify_one();
+        }
+      });
+    }
+  }
+
+  m_haveTasks.notify_all();
+
+  std::exception_ptr exception;
+  try {
+    worker();
+  } catch (...) {
+    exception = std::current_exception();
+  }
+
+  std::unique_lock<std::mutex> runLock(run->mutex);
+  run->closed = true;
+  run->finished.wait(runLock, [&run] { return run->runningCount == 0; });
+  if (!exception) {
+    exception = run->exception;
+  }
+
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+void WorkerPool::post(std::function<void()> task) {
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_tasks.emplace_back(std::move(task));
+  }
+
+  m_haveTasks.notify_one();
+}
+
+void WorkerPool::threadProcedure() {
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_haveTasks.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+      if (m_tasks.empty()) {
+        return;
+      }
+
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+
+    task();
+  }
+}
+
+}
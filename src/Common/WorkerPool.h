@@ -0,0 +1,49 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Tools {
+
+// Threads started once and shared by the parallel loops and the background tasks of the process, so that they don't
+// start threads of their own
+class WorkerPool {
+public:
+  explicit WorkerPool(size_t threadCount);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  // The shared pool, with a thread less than the processors (one at least) as the thread calling run() works too
+  static WorkerPool& instance();
+
+  size_t getThreadCount() const;
+
+  // Calls worker() on the calling thread and on up to threadCount - 1 idle threads of the pool. The calling thread
+  // doesn't wait for the calls not started yet, so worker() has to be able to do all the work alone, sharing it with
+  // the other calls (e.g. by taking the items from a common counter). This also makes the nested calls safe.
+  // Rethrows the first exception thrown by a call.
+  void run(size_t threadCount, const std::function<void()>& worker);
+  // Calls task() on a thread of the pool once one is idle, without waiting for it. The task must not throw.
+  void post(std::function<void()> task);
+
+private:
+  void threadProcedure();
+
+  std::mutex m_mutex;
+  std::condition_variable m_haveTasks;
+  std::deque<std::function<void()>> m_tasks;
+  std::vector<std::thread> m_threads;
+  bool m_stopping;
+};
+
+}
@@ -57,6 +57,8 @@ const uint64_t CRYPTONOTE_LOCKED_TX_ALLOWED_DELTA_SECONDS    = DIFFICULTY_TARGET
 const uint64_t CRYPTONOTE_MEMPOOL_TX_LIVETIME                = 60 * 60 * 24;     //seconds, one day
 const uint64_t CRYPTONOTE_MEMPOOL_TX_FROM_ALT_BLOCK_LIVETIME = 60 * 60 * 24 * 7; //seconds, one week
 const uint64_t CRYPTONOTE_NUMBER_OF_PERIODS_TO_FORGET_TX_DELETED_FROM_POOL = 7;  // CRYPTONOTE_NUMBER_OF_PERIODS_TO_FORGET_TX_DELETED_FROM_POOL * CRYPTONOTE_MEMPOOL_TX_LIVETIME = time to forget tx
+const size_t   CRYPTONOTE_MEMPOOL_MAX_SIZE                   = 100 * 1024 * 1024; //bytes of transaction blobs
+const size_t   CRYPTONOTE_MEMPOOL_RECENTLY_DELETED_MAX_COUNT = 100000; //ids of deleted transactions remembered at most
 
 const size_t   FUSION_TX_MAX_SIZE                            = CRYPTONOTE_BLOCK_GRANTED_FULL_REWARD_ZONE * 30 / 100;
 const size_t   FUSION_TX_MIN_INPUT_COUNT                     = 12;
@@ -66,6 +68,7 @@ const char     CRYPTONOTE_BLOCKS_FILENAME[]                  = "blocks.dat";
 const char     CRYPTONOTE_BLOCKINDEXES_FILENAME[]            = "blockindexes.dat";
 const char     CRYPTONOTE_BLOCKSCACHE_FILENAME[]             = "blockscache.dat";
 const char     CRYPTONOTE_POOLDATA_FILENAME[]                = "poolstate.bin";
+const char     CRYPTONOTE_POOL_JOURNAL_FILENAME[]            = "pooljournal.dat";
 const char     P2P_NET_DATA_FILENAME[]                       = "p2pstate.bin";
 const char     CRYPTONOTE_BLOCKCHAIN_INDICES_FILENAME[]      = "blockchainindices.dat";
 const char     MINER_CONFIG_FILE_NAME[]                      = "miner_conf.json";
@@ -82,6 +85,15 @@ const uint8_t  BLOCK_MINOR_VERSION_0                         =  0;
 
 const size_t   BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT        =  10000;  //by default, blocks ids count in synchronizing
 const size_t   BLOCKS_SYNCHRONIZING_DEFAULT_COUNT            =  200;    //by default, blocks count in blocks downloading
+const size_t   BLOCKS_SYNCHRONIZING_MIN_COUNT                =  20;     //blocks count requested from the slowest peers
+const size_t   BLOCKS_SYNCHRONIZING_PENDING_MAX_COUNT        =  2000;   //blocks kept ahead of the chain before only the next ones are requested
+const uint32_t BLOCKS_SYNCHRONIZING_RANGE_SECONDS            =  10;     //time a peer should deliver a range of blocks in
+const uint32_t BLOCKS_SYNCHRONIZING_TIMEOUT                  =  60;     //seconds, the range is requested from other peers after
+const size_t   TRANSACTIONS_RELAY_KNOWN_MAX_COUNT            =  20000;  //transaction ids remembered per peer, not to announce them to it
+const size_t   TRANSACTIONS_RELAY_ANNOUNCED_MAX_COUNT        =  50000;  //announced transactions awaited at once
+const size_t   TRANSACTIONS_RELAY_CONNECTION_ANNOUNCED_MAX_COUNT = 5000; //announced transactions awaited at once from a peer
+const size_t   TRANSACTIONS_RELAY_REQUEST_MAX_COUNT          =  TRANSACTIONS_RELAY_CONNECTION_ANNOUNCED_MAX_COUNT; //transactions a peer may request at once
+const uint32_t TRANSACTIONS_RELAY_REQUEST_TIMEOUT            =  10;     //seconds, the transaction is requested from the next peer which announced it after
 const size_t   COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT         =  1000;
 
 
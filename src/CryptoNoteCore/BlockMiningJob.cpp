@@ -0,0 +1,61 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "BlockMiningJob.h"
+
+#include <cassert>
+#include <cstring>
+
+#include "CryptoNoteFormatUtils.h"
+#include "CryptoNoteTools.h"
+
+namespace CryptoNote {
+
+BlockMiningJob::BlockMiningJob() : m_nonceOffset(0) {
+}
+
+// The nonce is the last field of the serialized header, which starts the hashing blob
+bool BlockMiningJob::init(const Block& block) {
+  // The blob is appended to, a job is initialized again for each new template
+  m_hashingBlob.clear();
+
+  size_t headerSize;
+  if (!getObjectBinarySize(static_cast<const BlockHeader&>(block), headerSize) || !get_block_hashing_blob(block, m_hashingBlob)) {
+    m_hashingBlob.clear();
+    return false;
+  }
+
+  assert(headerSize >= sizeof(block.nonce) && headerSize <= m_hashingBlob.size());
+  m_nonceOffset = headerSize - sizeof(block.nonce);
+  return true;
+}
+
+uint32_t BlockMiningJob::nonce() const {
+  assert(m_nonceOffset + sizeof(uint32_t) <= m_hashingBlob.size());
+  uint32_t nonce;
+  memcpy(&nonce, m_hashingBlob.data() + m_nonceOffset, sizeof(nonce));
+  return nonce;
+}
+
+// Matches the binary serialization of the nonce, which copies its bytes
+void BlockMiningJob::setNonce(uint32_t nonce) {
+  assert(m_nonceOffset + sizeof(nonce) <= m_hashingBlob.size());
+  memcpy(m_hashingBlob.data() + m_nonceOffset, &nonce, sizeof(nonce));
+}
+
+const BinaryArray& BlockMiningJob::hashingBlob() const {
+  return m_hashingBlob;
+}
+
+void BlockMiningJob::getLonghash(Crypto::cn_context& context, Crypto::Hash& hash) const {
+  Crypto::cn_slow_hash(context, m_hashingBlob.data(), m_hashingBlob.size(), hash);
+}
+
+void BlockMiningJob::getLonghashes(Crypto::cn_context& context0, Crypto::cn_context& context1, const BlockMiningJob& job0,
+  const BlockMiningJob& job1, Crypto::Hash& hash0, Crypto::Hash& hash1) {
+  Crypto::cn_slow_hash(context0, context1, job0.m_hashingBlob.data(), job0.m_hashingBlob.size(), job1.m_hashingBlob.data(),
+    job1.m_hashingBlob.size(), hash0, hash1);
+}
+
+}
@@ -0,0 +1,37 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "crypto/hash.h"
+#include "CryptoNoteCore/CryptoNoteBasic.h"
+
+namespace CryptoNote {
+
+// The hashing blob of a block template, built once per template. Only the nonce changes between attempts,
+// so it is written in place and the blob is hashed as is.
+class BlockMiningJob {
+public:
+  BlockMiningJob();
+
+  bool init(const Block& block);
+
+  uint32_t nonce() const;
+  void setNonce(uint32_t nonce);
+
+  const BinaryArray& hashingBlob() const;
+  void getLonghash(Crypto::cn_context& context, Crypto::Hash& hash) const;
+  // Hashes two jobs at once, which is faster than one after another with AES-NI
+  static void getLonghashes(Crypto::cn_context& context0, Crypto::cn_context& context1, const BlockMiningJob& job0,
+    const BlockMiningJob& job1, Crypto::Hash& hash0, Crypto::Hash& hash1);
+
+private:
+  BinaryArray m_hashingBlob;
+  size_t m_nonceOffset;
+};
+
+}
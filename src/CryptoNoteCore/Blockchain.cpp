@@ -6,11 +6,21 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <deque>
+#include <future>
+#include <limits>
+#include <set>
+#include <thread>
+#include <unordered_set>
 #include <boost/foreach.hpp>
 #include "Common/Math.h"
+#include "Common/ParallelFor.h"
 #include "Common/ShuffleGenerator.h"
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
+#include "Common/Varint.h"
+#include "Common/VectorOutputStream.h"
+#include "Common/WorkerPool.h"
 #include "Rpc/CoreRpcServerCommandsDefinitions.h"
 #include "Serialization/BinarySerializationTools.h"
 #include "CryptoNoteTools.h"
@@ -20,6 +30,12 @@ using namespace Common;
 
 namespace {
 
+const uint32_t REBUILD_CACHE_BATCH_SIZE = 1000;
+// Proofs of work of blocks that were never added are dropped once there are that many
+const size_t MAX_PRECOMPUTED_PROOFS_OF_WORK = 10000;
+// Transactions with checked ring signatures are forgotten once there are that many
+const size_t MAX_CHECKED_TRANSACTIONS = 50000;
+
 std::string appendPath(const std::string& path, const std::string& fileName) {
   std::string result = path;
   if (!result.empty()) {
@@ -42,12 +58,14 @@ bool operator<(const Crypto::KeyImage& keyImage1, const Crypto::KeyImage& keyIma
 }
 }
 
-#define CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER 1
+#define CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER 3
 #define CURRENT_BLOCKCHAININDICES_STORAGE_ARCHIVE_VER 1
+#define CURRENT_BLOCKCHAIN_SNAPSHOT_ARCHIVE_VER 3
 
 namespace CryptoNote {
 class BlockCacheSerializer;
 class BlockchainIndicesSerializer;
+class BlockchainSnapshotSerializer;
 }
 
 namespace CryptoNote {
@@ -57,33 +75,9 @@ bool serialize(google::sparse_hash_map<K, V, Hash>& value, Common::StringView na
   return serializeMap(value, name, serializer, [&value](size_t size) { value.resize(size); });
 }
 
-template<typename K, typename Hash>
-bool serialize(google::sparse_hash_set<K, Hash>& value, Common::StringView name, CryptoNote::ISerializer& serializer) {
-  size_t size = value.size();
-  if (!serializer.beginArray(size, name)) {
-    return false;
-  }
-
-  if (serializer.type() == ISerializer::OUTPUT) {
-    for (auto& key : value) {
-      serializer(const_cast<K&>(key), "");
-    }
-  } else {
-    value.resize(size);
-    while (size--) {
-      K key;
-      serializer(key, "");
-      value.insert(key);
-    }
-  }
-
-  serializer.endArray();
-  return true;
-}
-
 // custom serialization to speedup cache loading
-bool serialize(std::vector<std::pair<Blockchain::TransactionIndex, uint16_t>>& value, Common::StringView name, CryptoNote::ISerializer& s) {
-  const size_t elementSize = sizeof(std::pair<Blockchain::TransactionIndex, uint16_t>);
+bool serialize(std::vector<Blockchain::OutputEntry>& value, Common::StringView name, CryptoNote::ISerializer& s) {
+  const size_t elementSize = sizeof(Blockchain::OutputEntry);
   size_t size = value.size() * elementSize;
 
   if (!s.beginArray(size, name)) {
@@ -300,17 +294,146 @@ private:
 };
 
 
+// Main chain cut at a checkpointed height: the serialized block entries only. Everything derived from the blocks is
+// rebuilt and checked on import.
+class BlockchainSnapshotSerializer {
+
+public:
+  BlockchainSnapshotSerializer(Blockchain& bs, ILogger& logger) :
+    m_bs(bs), logger(logger, "BlockchainSnapshotSerializer") {
+  }
+
+  bool save(const std::string& filename, uint32_t height) {
+    try {
+      std::ofstream file(filename, std::ios::binary);
+      if (!file) {
+        logger(ERROR) << "failed to create " << filename;
+        return false;
+      }
+
+      StdOutputStream stream(file);
+      BinaryOutputStreamSerializer s(stream);
+      write(s, height);
+
+      file.flush();
+      if (!file) {
+        logger(ERROR) << "failed to write " << filename;
+        return false;
+      }
+    } catch (std::exception& e) {
+      logger(ERROR) << "saving failed: " << e.what();
+      return false;
+    }
+
+    return true;
+  }
+
+  bool load(const std::string& filename) {
+    try {
+      std::ifstream stdStream(filename, std::ios::binary);
+      if (!stdStream) {
+        logger(ERROR) << "failed to open " << filename;
+        return false;
+      }
+
+      StdInputStream stream(stdStream);
+      BinaryInputStreamSerializer s(stream);
+      return read(s);
+    } catch (std::exception& e) {
+      logger(ERROR) << "loading failed: " << e.what();
+      return false;
+    }
+  }
+
+private:
+
+  void write(ISerializer& s, uint32_t height) {
+    auto start = std::chrono::steady_clock::now();
+
+    uint8_t version = CURRENT_BLOCKCHAIN_SNAPSHOT_ARCHIVE_VER;
+    s(version, "version");
+    s(height, "height");
+    Crypto::Hash tailHash = m_bs.m_blockIndex.getBlockId(height - 1);
+    s(tailHash, "tail_block");
+
+    logger(INFO) << "- saving blocks...";
+    size_t size = height;
+    s.beginArray(size, "blocks");
+    std::string blob;
+    for (uint32_t b = 0; b < height; ++b) {
+      Common::ArrayView<uint8_t> data = m_bs.m_blocks.raw(b);
+      blob.assign(reinterpret_cast<const char*>(data.getData()), data.getSize());
+      s.binary(blob, "");
+    }
+
+    s.endArray();
+
+    auto dur = std::chrono::steady_clock::now() - start;
+    logger(INFO) << "Serialization time: " << std::chrono::duration_cast<std::chrono::milliseconds>(dur).count() << "ms";
+  }
+
+  bool read(ISerializer& s) {
+    auto start = std::chrono::steady_clock::now();
+
+    uint8_t version;
+    s(version, "version");
+    if (version != CURRENT_BLOCKCHAIN_SNAPSHOT_ARCHIVE_VER) {
+      logger(ERROR) << "unsupported snapshot version " << static_cast<unsigned>(version);
+      return false;
+    }
+
+    uint32_t height;
+    s(height, "height");
+    Crypto::Hash tailHash;
+    s(tailHash, "tail_block");
+
+    bool isCheckpoint = false;
+    if (height == 0 || !m_bs.m_checkpoints.check_block(height - 1, tailHash, isCheckpoint) || !isCheckpoint) {
+      logger(ERROR) << "snapshot doesn't end at a checkpoint, tail block " << tailHash << " at height " << height - 1;
+      return false;
+    }
+
+    logger(INFO) << "- loading " << height << " blocks...";
+    size_t size;
+    s.beginArray(size, "blocks");
+    if (size != height) {
+      logger(ERROR) << "snapshot has " << size << " blocks, expected " << height;
+      return false;
+    }
+
+    std::string blob;
+    for (uint32_t b = 0; b < height; ++b) {
+      s.binary(blob, "");
+      m_bs.m_blocks.push_back_raw(Common::ArrayView<uint8_t>(reinterpret_cast<const uint8_t*>(blob.data()), blob.size()));
+    }
+
+    s.endArray();
+
+    auto dur = std::chrono::steady_clock::now() - start;
+    logger(INFO) << "Serialization time: " << std::chrono::duration_cast<std::chrono::milliseconds>(dur).count() << "ms";
+    return true;
+  }
+
+  LoggerRef logger;
+  Blockchain& m_bs;
+};
+
+
 Blockchain::Blockchain(const Currency& currency, tx_memory_pool& tx_pool, ILogger& logger) :
 logger(logger, "Blockchain"),
 m_currency(currency),
 m_tx_pool(tx_pool),
 m_current_block_cumul_sz_limit(0),
 m_is_in_checkpoint_zone(false),
-m_checkpoints(logger) {
+m_difficultyWindow(currency),
+m_checkpoints(logger),
+m_workerThreadCount(std::thread::hardware_concurrency()) {
+
+  if (m_workerThreadCount == 0) {
+    m_workerThreadCount = 2;
+  }
 
   m_outputs.set_deleted_key(0);
-  Crypto::KeyImage nullImage = boost::value_initialized<decltype(nullImage)>();
-  m_spent_keys.set_deleted_key(nullImage);
 }
 
 bool Blockchain::addObserver(IBlockchainStorageObserver* observer) {
@@ -383,21 +506,21 @@ bool Blockchain::checkTransactionSize(size_t blobSize) {
 }
 
 bool Blockchain::haveTransaction(const Crypto::Hash &id) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return m_transactionMap.find(id) != m_transactionMap.end();
 }
 
 bool Blockchain::have_tx_keyimg_as_spent(const Crypto::KeyImage &key_im) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  return  m_spent_keys.find(key_im) != m_spent_keys.end();
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  return m_spent_keys.count(key_im) != 0;
 }
 
 uint32_t Blockchain::getCurrentBlockchainHeight() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return static_cast<uint32_t>(m_blocks.size());
 }
 
-bool Blockchain::init(const std::string& config_folder, bool load_existing) {
+bool Blockchain::init(const std::string& config_folder, bool load_existing, const std::string& snapshotFile) {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (!config_folder.empty() && !Tools::create_directories_if_necessary(config_folder)) {
     logger(ERROR, BRIGHT_RED) << "Failed to create data directory: " << m_config_folder;
@@ -405,19 +528,35 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
   }
 
   m_config_folder = config_folder;
+  logger(INFO) << "Proof of work scratchpad uses " << Crypto::cn_page_mode_name(m_cn_context.page_mode());
+  if (!m_cn_context.is_locked()) {
+    logger(WARNING) << "Proof of work scratchpad isn't locked in memory, it may be swapped out";
+  }
 
   if (!m_blocks.open(appendPath(config_folder, m_currency.blocksFileName()), appendPath(config_folder, m_currency.blockIndexesFileName()), 1024)) {
     return false;
   }
 
-  if (load_existing && !m_blocks.empty()) {
+  if (!snapshotFile.empty() && (!load_existing || m_blocks.empty())) {
+    if (!importSnapshot(snapshotFile)) {
+      logger(ERROR, BRIGHT_RED) << "Failed to import blockchain snapshot " << snapshotFile;
+      return false;
+    }
+  } else if (load_existing && !m_blocks.empty()) {
+    if (!snapshotFile.empty()) {
+      logger(WARNING, BRIGHT_YELLOW) << "Blockchain already exists, snapshot " << snapshotFile << " is ignored";
+    }
+
     logger(INFO, BRIGHT_WHITE) << "Loading blockchain...";
     BlockCacheSerializer loader(*this, get_block_hash(m_blocks.back().bl), logger.getLogger());
     loader.load(appendPath(config_folder, m_currency.blocksCacheFileName()));
 
     if (!loader.loaded()) {
       logger(WARNING, BRIGHT_YELLOW) << "No actual blockchain cache found, rebuilding internal structures...";
-      rebuildCache();
+      if (!rebuildCache()) {
+        logger(ERROR, BRIGHT_RED) << "Failed to rebuild internal structures";
+        return false;
+      }
     }
 
     loadBlockchainIndices();
@@ -425,6 +564,9 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
     m_blocks.clear();
   }
 
+  m_difficultyWindow.clear();
+  extendDifficultyWindow(m_difficultyWindow, static_cast<uint32_t>(m_blocks.size()), m_currency.difficultyBlocksCount());
+
   if (m_blocks.empty()) {
     logger(INFO, BRIGHT_WHITE)
       << "Blockchain not loaded, generating genesis block.";
@@ -459,51 +601,113 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
   return true;
 }
 
-void Blockchain::rebuildCache() {
+// Blocks are decoded and hashed by the shared worker threads straight from the mapped storage, one batch ahead of
+// the main thread, which merges them into the indexes in height order and checks them against checkpoints.
+bool Blockchain::rebuildCache() {
   std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
   m_blockIndex.clear();
   m_transactionMap.clear();
   m_spent_keys.clear();
   m_outputs.clear();
   m_multisignatureOutputs.clear();
-  for (uint32_t b = 0; b < m_blocks.size(); ++b) {
-    if (b % 1000 == 0) {
-      logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << m_blocks.size();
-    }
-    const BlockEntry& block = m_blocks[b];
-    Crypto::Hash blockHash = get_block_hash(block.bl);
-    m_blockIndex.push(blockHash);
-    for (uint16_t t = 0; t < block.transactions.size(); ++t) {
-      const TransactionEntry& transaction = block.transactions[t];
-      Crypto::Hash transactionHash = getObjectHash(transaction.tx);
-      TransactionIndex transactionIndex = { b, t };
-      m_transactionMap.insert(std::make_pair(transactionHash, transactionIndex));
-
-      // process inputs
-      for (auto& i : transaction.tx.inputs) {
-        if (i.type() == typeid(KeyInput)) {
-          m_spent_keys.insert(::boost::get<KeyInput>(i).keyImage);
-        } else if (i.type() == typeid(MultisignatureInput)) {
-          auto out = ::boost::get<MultisignatureInput>(i);
-          m_multisignatureOutputs[out.amount][out.outputIndex].isUsed = true;
+
+  uint32_t blockCount = static_cast<uint32_t>(m_blocks.size());
+  logger(INFO, BRIGHT_WHITE) << "Rebuilding internal structures of " << blockCount << " blocks using " << m_workerThreadCount << " threads";
+
+  std::vector<RebuildCacheEntry> entries;
+  std::vector<RebuildCacheEntry> nextEntries;
+  decodeRebuildCacheEntries(0, std::min(REBUILD_CACHE_BATCH_SIZE, blockCount), entries);
+  for (uint32_t batchBegin = 0; batchBegin < blockCount; batchBegin += REBUILD_CACHE_BATCH_SIZE) {
+    uint32_t batchEnd = std::min(batchBegin + REBUILD_CACHE_BATCH_SIZE, blockCount);
+    std::promise<void> nextBatchDecoded;
+    std::future<void> nextBatch;
+    if (batchEnd < blockCount) {
+      uint32_t nextBatchEnd = std::min(batchEnd + REBUILD_CACHE_BATCH_SIZE, blockCount);
+      nextBatch = nextBatchDecoded.get_future();
+      Tools::WorkerPool::instance().post([this, batchEnd, nextBatchEnd, &nextEntries, &nextBatchDecoded] {
+        try {
+          decodeRebuildCacheEntries(batchEnd, nextBatchEnd, nextEntries);
+          nextBatchDecoded.set_value();
+        } catch (...) {
+          nextBatchDecoded.set_exception(std::current_exception());
         }
+      });
+    }
+
+    for (uint32_t b = batchBegin; b < batchEnd; ++b) {
+      const RebuildCacheEntry& entry = entries[b - batchBegin];
+      const BlockEntry& block = entry.block;
+      if (!m_checkpoints.check_block(b, entry.blockHash)) {
+        logger(ERROR, BRIGHT_RED) << "Block " << entry.blockHash << " at height " << b << " doesn't match checkpoint, blockchain storage is corrupted";
+        // The posted task refers to the locals
+        if (nextBatch.valid()) {
+          nextBatch.wait();
+        }
+
+        return false;
       }
 
-      // process outputs
-      for (uint16_t o = 0; o < transaction.tx.outputs.size(); ++o) {
-        const auto& out = transaction.tx.outputs[o];
-        if (out.target.type() == typeid(KeyOutput)) {
-          m_outputs[out.amount].push_back(std::make_pair<>(transactionIndex, o));
-        } else if (out.target.type() == typeid(MultisignatureOutput)) {
-          MultisignatureOutputUsage usage = { transactionIndex, o, false };
-          m_multisignatureOutputs[out.amount].push_back(usage);
+      m_blockIndex.push(entry.blockHash);
+      for (uint16_t t = 0; t < block.transactions.size(); ++t) {
+        const TransactionEntry& transaction = block.transactions[t];
+        TransactionIndex transactionIndex = { b, t };
+        m_transactionMap.insert(std::make_pair(entry.transactionHashes[t], transactionIndex));
+
+        // process inputs
+        for (auto& i : transaction.tx.inputs) {
+          if (i.type() == typeid(KeyInput)) {
+            m_spent_keys.insert(::boost::get<KeyInput>(i).keyImage);
+          } else if (i.type() == typeid(MultisignatureInput)) {
+            auto out = ::boost::get<MultisignatureInput>(i);
+            m_multisignatureOutputs[out.amount][out.outputIndex].isUsed = true;
+          }
+        }
+
+        // process outputs
+        for (uint16_t o = 0; o < transaction.tx.outputs.size(); ++o) {
+          const auto& out = transaction.tx.outputs[o];
+          if (out.target.type() == typeid(KeyOutput)) {
+            OutputEntry output = { transactionIndex, o, transaction.tx.unlockTime, ::boost::get<KeyOutput>(out.target).key };
+            m_outputs[out.amount].push_back(output);
+          } else if (out.target.type() == typeid(MultisignatureOutput)) {
+            MultisignatureOutputUsage usage = { transactionIndex, o, false };
+            m_multisignatureOutputs[out.amount].push_back(usage);
+          }
         }
       }
     }
+
+    if (nextBatch.valid()) {
+      nextBatch.get();
+    }
+
+    std::swap(entries, nextEntries);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - timePoint;
+    logger(INFO, BRIGHT_WHITE) << "Height " << batchEnd << " of " << blockCount << " (" << batchEnd * 100 / blockCount << "%, " <<
+      static_cast<uint64_t>(batchEnd / std::max(elapsed.count(), 0.001)) << " blocks/s)";
   }
 
   std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
   logger(INFO, BRIGHT_WHITE) << "Rebuilding internal structures took: " << duration.count();
+  return true;
+}
+
+void Blockchain::decodeRebuildCacheEntries(uint32_t begin, uint32_t end, std::vector<RebuildCacheEntry>& entries) {
+  entries.resize(end - begin);
+  Tools::parallelFor(entries.size(), m_workerThreadCount, [this, begin, &entries](size_t i) {
+    RebuildCacheEntry& entry = entries[i];
+    Common::ArrayView<uint8_t> data = m_blocks.raw(begin + static_cast<uint32_t>(i));
+    MemoryInputStream stream(data.getData(), data.getSize());
+    BinaryInputStreamSerializer serializer(stream);
+    entry.block.serialize(serializer);
+
+    entry.blockHash = get_block_hash(entry.block.bl);
+    entry.transactionHashes.resize(entry.block.transactions.size());
+    for (size_t t = 0; t < entry.block.transactions.size(); ++t) {
+      entry.transactionHashes[t] = getObjectHash(entry.block.transactions[t].tx);
+    }
+  });
 }
 
 bool Blockchain::storeCache() {
@@ -519,9 +723,159 @@ bool Blockchain::storeCache() {
   return true;
 }
 
+bool Blockchain::exportSnapshot(const std::string& fileName) {
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+
+  uint32_t checkpointHeight;
+  if (!m_checkpoints.get_last_checkpoint_height(getCurrentBlockchainHeight() - 1, checkpointHeight)) {
+    logger(ERROR, BRIGHT_RED) << "Failed to export blockchain snapshot: no checkpoint is reached yet";
+    return false;
+  }
+
+  logger(INFO, BRIGHT_WHITE) << "Exporting blockchain snapshot at height " << checkpointHeight << " to " << fileName << "...";
+  BlockchainSnapshotSerializer ser(*this, logger.getLogger());
+  if (!ser.save(fileName, checkpointHeight + 1)) {
+    logger(ERROR, BRIGHT_RED) << "Failed to export blockchain snapshot";
+    boost::system::error_code ignoredErrorCode;
+    boost::filesystem::remove(fileName, ignoredErrorCode);
+    return false;
+  }
+
+  return true;
+}
+
+// Only the blocks are taken from the snapshot. The indexes are rebuilt from them, every block must reference the
+// previous one and contain the transactions it commits to, which ties the whole chain to the checkpoint the snapshot
+// ends at, and the fields each entry derives from the preceding blocks must be what adding the block would give.
+bool Blockchain::importSnapshot(const std::string& fileName) {
+  std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+  logger(INFO, BRIGHT_WHITE) << "Importing blockchain snapshot " << fileName << "...";
+
+  m_blocks.clear();
+
+  BlockchainSnapshotSerializer loader(*this, logger.getLogger());
+  if (!loader.load(fileName) || !rebuildCache() || !checkSnapshotBlocks() || !checkSnapshotEntries()) {
+    m_blocks.clear();
+    m_blockIndex.clear();
+    m_transactionMap.clear();
+    m_spent_keys.clear();
+    m_outputs.clear();
+    m_multisignatureOutputs.clear();
+    m_paymentIdIndex.clear();
+    m_timestampIndex.clear();
+    m_generatedTransactionsIndex.clear();
+    return false;
+  }
+
+  std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
+  logger(INFO, BRIGHT_WHITE) << "Imported " << m_blocks.size() << " blocks in " << duration.count() << " s";
+  return true;
+}
+
+bool Blockchain::checkSnapshotBlocks() {
+  std::atomic<uint32_t> firstInvalidBlock(std::numeric_limits<uint32_t>::max());
+  Tools::parallelFor(m_blocks.size(), m_workerThreadCount, [this, &firstInvalidBlock](size_t i) {
+    uint32_t height = static_cast<uint32_t>(i);
+    Common::ArrayView<uint8_t> data = m_blocks.raw(height);
+    BlockEntry block;
+    bool valid;
+    try {
+      MemoryInputStream stream(data.getData(), data.getSize());
+      BinaryInputStreamSerializer serializer(stream);
+      block.serialize(serializer);
+
+      valid = get_block_hash(block.bl) == m_blockIndex.getBlockId(height) &&
+        (height == 0 || block.bl.previousBlockHash == m_blockIndex.getBlockId(height - 1)) &&
+        block.transactions.size() == block.bl.transactionHashes.size() + 1;
+      for (size_t t = 0; valid && t < block.transactions.size(); ++t) {
+        Crypto::Hash transactionHash = t == 0 ? getObjectHash(block.bl.baseTransaction) : block.bl.transactionHashes[t - 1];
+        valid = getObjectHash(block.transactions[t].tx) == transactionHash;
+      }
+    } catch (std::exception&) {
+      valid = false;
+    }
+
+    if (!valid) {
+      uint32_t current = firstInvalidBlock;
+      while (height < current && !firstInvalidBlock.compare_exchange_weak(current, height)) {
+      }
+    }
+  });
+
+  if (firstInvalidBlock != std::numeric_limits<uint32_t>::max()) {
+    logger(ERROR, BRIGHT_RED) << "Snapshot block at height " << firstInvalidBlock << " doesn't match the block index";
+    return false;
+  }
+
+  return true;
+}
+
+// Computes the derived fields of the entries as pushBlock does and fills the explorer indices
+bool Blockchain::checkSnapshotEntries() {
+  DifficultyWindow difficultyWindow(m_currency);
+  std::deque<size_t> lastBlockSizes;
+  std::unordered_map<uint64_t, uint32_t> outputCounts;
+  std::unordered_map<uint64_t, uint32_t> multisignatureOutputCounts;
+  difficulty_type cumulativeDifficulty = 0;
+  uint64_t generatedCoins = 0;
+  for (uint32_t height = 0; height < m_blocks.size(); ++height) {
+    const BlockEntry& block = m_blocks[height];
+    size_t blockSize = 0;
+    uint64_t fee = 0;
+    bool valid = block.height == height;
+    for (size_t t = 0; valid && t < block.transactions.size(); ++t) {
+      const TransactionEntry& transaction = block.transactions[t];
+      blockSize += getObjectBinarySize(transaction.tx);
+      if (t != 0) {
+        fee += getInputAmount(transaction.tx) - getOutputAmount(transaction.tx);
+      }
+
+      valid = transaction.m_global_output_indexes.size() == transaction.tx.outputs.size();
+      for (size_t o = 0; valid && o < transaction.tx.outputs.size(); ++o) {
+        const TransactionOutput& output = transaction.tx.outputs[o];
+        if (output.target.type() == typeid(KeyOutput)) {
+          valid = transaction.m_global_output_indexes[o] == outputCounts[output.amount]++;
+        } else if (output.target.type() == typeid(MultisignatureOutput)) {
+          valid = transaction.m_global_output_indexes[o] == multisignatureOutputCounts[output.amount]++;
+        }
+      }
+    }
+
+    cumulativeDifficulty += difficultyWindow.nextDifficulty();
+    std::vector<size_t> blockSizes(lastBlockSizes.begin(), lastBlockSizes.end());
+    uint64_t reward;
+    int64_t emissionChange;
+    if (!valid || block.block_cumulative_size != blockSize || block.cumulative_difficulty != cumulativeDifficulty ||
+      !m_currency.getBlockReward(height, Common::medianValue(blockSizes), blockSize, generatedCoins, fee, reward, emissionChange) ||
+      block.already_generated_coins != generatedCoins + emissionChange) {
+      logger(ERROR, BRIGHT_RED) << "Snapshot block at height " << height << " doesn't match the state derived from the blocks";
+      return false;
+    }
+
+    generatedCoins = block.already_generated_coins;
+    if (height != 0) {
+      difficultyWindow.push_back(block.bl.timestamp, block.cumulative_difficulty);
+    }
+
+    lastBlockSizes.push_back(blockSize);
+    if (lastBlockSizes.size() > m_currency.rewardBlocksWindow()) {
+      lastBlockSizes.pop_front();
+    }
+
+    m_timestampIndex.add(block.bl.timestamp, m_blockIndex.getBlockId(height));
+    m_generatedTransactionsIndex.add(block.bl);
+    for (const TransactionEntry& transaction : block.transactions) {
+      m_paymentIdIndex.add(transaction.tx);
+    }
+  }
+
+  return true;
+}
+
 bool Blockchain::deinit() {
   storeCache();
   storeBlockchainIndices();
+  logger(DEBUGGING) << "Block cache hits: " << m_blocks.getCacheHits() << ", misses: " << m_blocks.getCacheMisses();
   assert(m_messageQueueList.empty());
   return true;
 }
@@ -535,6 +889,7 @@ bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
   m_spent_keys.clear();
   m_alternative_chains.clear();
   m_outputs.clear();
+  m_difficultyWindow.clear();
 
   m_paymentIdIndex.clear();
   m_timestampIndex.clear();
@@ -548,24 +903,24 @@ bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
 
 Crypto::Hash Blockchain::getTailId(uint32_t& height) {
   assert(!m_blocks.empty());
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   height = getCurrentBlockchainHeight() - 1;
   return getTailId();
 }
 
 Crypto::Hash Blockchain::getTailId() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return m_blocks.empty() ? NULL_HASH : m_blockIndex.getTailId();
 }
 
 std::vector<Crypto::Hash> Blockchain::buildSparseChain() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   assert(m_blockIndex.size() != 0);
   return doBuildSparseChain(m_blockIndex.getTailId());
 }
 
 std::vector<Crypto::Hash> Blockchain::buildSparseChain(const Crypto::Hash& startBlockId) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   assert(haveBlock(startBlockId));
   return doBuildSparseChain(startBlockId);
 }
@@ -602,18 +957,18 @@ std::vector<Crypto::Hash> Blockchain::doBuildSparseChain(const Crypto::Hash& sta
 }
 
 Crypto::Hash Blockchain::getBlockIdByHeight(uint32_t height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   assert(height < m_blockIndex.size());
   return m_blockIndex.getBlockId(height);
 }
 
 bool Blockchain::getBlockByHash(const Crypto::Hash& blockHash, Block& b) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
 
   uint32_t height = 0;
 
   if (m_blockIndex.getBlockHeight(blockHash, height)) {
-    b = m_blocks[height].bl;
+    loadBlock(height, b);
     return true;
   }
 
@@ -629,29 +984,17 @@ bool Blockchain::getBlockByHash(const Crypto::Hash& blockHash, Block& b) {
 }
 
 bool Blockchain::getBlockHeight(const Crypto::Hash& blockId, uint32_t& blockHeight) {
-  std::lock_guard<decltype(m_blockchain_lock)> lock(m_blockchain_lock);
+  Tools::SharedLockGuard lock(m_blockchain_lock);
   return m_blockIndex.getBlockHeight(blockId, blockHeight);
 }
 
 difficulty_type Blockchain::getDifficultyForNextBlock() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  std::vector<uint64_t> timestamps;
-  std::vector<difficulty_type> commulative_difficulties;
-  size_t offset = m_blocks.size() - std::min(m_blocks.size(), static_cast<uint64_t>(m_currency.difficultyBlocksCount()));
-  if (offset == 0) {
-    ++offset;
-  }
-
-  for (; offset < m_blocks.size(); offset++) {
-    timestamps.push_back(m_blocks[offset].bl.timestamp);
-    commulative_difficulties.push_back(m_blocks[offset].cumulative_difficulty);
-  }
-
-  return m_currency.nextDifficulty(timestamps, commulative_difficulties);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  return m_difficultyWindow.nextDifficulty();
 }
 
 uint64_t Blockchain::getCoinsInCirculation() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   if (m_blocks.empty()) {
     return 0;
   } else {
@@ -659,19 +1002,16 @@ uint64_t Blockchain::getCoinsInCirculation() {
   }
 }
 
-bool Blockchain::rollback_blockchain_switching(std::list<Block> &original_chain, size_t rollback_height) {
+bool Blockchain::rollback_blockchain_switching(std::list<BlockEntry>& original_chain, size_t rollback_height) {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   // remove failed subchain
   for (size_t i = m_blocks.size() - 1; i >= rollback_height; i--) {
     popBlock(get_block_hash(m_blocks.back().bl));
   }
 
-  // return back original chain
-  for (auto &bl : original_chain) {
-    block_verification_context bvc =
-      boost::value_initialized<block_verification_context>();
-    bool r = pushBlock(bl, bvc);
-    if (!(r && bvc.m_added_to_main_chain)) {
+  // return back original chain, its blocks were already verified
+  for (auto& block : original_chain) {
+    if (!reapplyBlock(block)) {
       logger(ERROR, BRIGHT_RED) << "PANIC!!! failed to add (again) block while "
         "chain switching during the rollback!";
       return false;
@@ -697,13 +1037,11 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::
     return false;
   }
 
-  //disconnecting old chain
-  std::list<Block> disconnected_chain;
+  //disconnecting old chain, the entries keep everything needed to put the blocks back without verifying them again
+  std::list<BlockEntry> disconnected_chain;
   for (size_t i = m_blocks.size() - 1; i >= split_height; i--) {
-    Block b = m_blocks[i].bl;
-    popBlock(get_block_hash(b));
-    //if (!(r)) { logger(ERROR, BRIGHT_RED) << "failed to remove block on chain switching"; return false; }
-    disconnected_chain.push_front(b);
+    disconnected_chain.push_front(m_blocks.back());
+    popBlock(get_block_hash(disconnected_chain.front().bl));
   }
 
   //connecting new alternative chain
@@ -730,19 +1068,6 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::
     }
   }
 
-  if (!discard_disconnected_chain) {
-    //pushing old chain as alternative chain
-    for (auto& old_ch_ent : disconnected_chain) {
-      block_verification_context bvc = boost::value_initialized<block_verification_context>();
-      bool r = handle_alternative_block(old_ch_ent, get_block_hash(old_ch_ent), bvc, false);
-      if (!r) {
-        logger(ERROR, BRIGHT_RED) << ("Failed to push ex-main chain blocks to alternative chain ");
-        rollback_blockchain_switching(disconnected_chain, split_height);
-        return false;
-      }
-    }
-  }
-
   std::vector<Crypto::Hash> blocksFromCommonRoot;
   blocksFromCommonRoot.reserve(alt_chain.size() + 1);
   blocksFromCommonRoot.push_back(alt_chain.front()->second.bl.previousBlockHash);
@@ -754,53 +1079,57 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::
     m_alternative_chains.erase(ch_ent);
   }
 
+  if (!discard_disconnected_chain) {
+    //pushing old chain as alternative chain, its height and cumulative difficulty are already known
+    for (auto& old_ch_ent : disconnected_chain) {
+      Crypto::Hash blockHash = get_block_hash(old_ch_ent.bl);
+      old_ch_ent.transactions.clear();
+      m_orthanBlocksIndex.add(old_ch_ent.bl);
+      m_alternative_chains.emplace(blockHash, std::move(old_ch_ent));
+    }
+  }
+
   sendMessage(BlockchainMessage(ChainSwitchMessage(std::move(blocksFromCommonRoot))));
 
   logger(INFO, BRIGHT_GREEN) << "REORGANIZE SUCCESS! on height: " << split_height << ", new blockchain size: " << m_blocks.size();
   return true;
 }
 
+// The window of the main chain is cut back to the split height and completed with the alternative blocks
 difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std::list<blocks_ext_by_hash::iterator>& alt_chain, BlockEntry& bei) {
-  std::vector<uint64_t> timestamps;
-  std::vector<difficulty_type> commulative_difficulties;
-  if (alt_chain.size() < m_currency.difficultyBlocksCount()) {
-    std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-    size_t main_chain_stop_offset = alt_chain.size() ? alt_chain.front()->second.height : bei.height;
-    size_t main_chain_count = m_currency.difficultyBlocksCount() - std::min(m_currency.difficultyBlocksCount(), alt_chain.size());
-    main_chain_count = std::min(main_chain_count, main_chain_stop_offset);
-    size_t main_chain_start_offset = main_chain_stop_offset - main_chain_count;
-
-    if (!main_chain_start_offset)
-      ++main_chain_start_offset; //skip genesis block
-    for (; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset) {
-      timestamps.push_back(m_blocks[main_chain_start_offset].bl.timestamp);
-      commulative_difficulties.push_back(m_blocks[main_chain_start_offset].cumulative_difficulty);
-    }
-
-    if (!((alt_chain.size() + timestamps.size()) <= m_currency.difficultyBlocksCount())) {
-      logger(ERROR, BRIGHT_RED) << "Internal error, alt_chain.size()[" << alt_chain.size() << "] + timestamps.size()[" << timestamps.size() <<
-        "] NOT <= m_currency.difficultyBlocksCount()[" << m_currency.difficultyBlocksCount() << ']'; return false;
-    }
-    for (auto it : alt_chain) {
-      timestamps.push_back(it->second.bl.timestamp);
-      commulative_difficulties.push_back(it->second.cumulative_difficulty);
-    }
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  size_t blocksCount = m_currency.difficultyBlocksCount();
+  uint32_t splitHeight = alt_chain.size() ? alt_chain.front()->second.height : bei.height;
+  if (!(splitHeight <= m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "Internal error, split height " << splitHeight << " is above the blockchain height " << m_blocks.size(); return 0; }
+
+  DifficultyWindow window(m_difficultyWindow);
+  if (alt_chain.size() >= blocksCount || m_blocks.size() - splitHeight >= window.size()) {
+    window.clear();
   } else {
-    timestamps.resize(std::min(alt_chain.size(), m_currency.difficultyBlocksCount()));
-    commulative_difficulties.resize(std::min(alt_chain.size(), m_currency.difficultyBlocksCount()));
-    size_t count = 0;
-    size_t max_i = timestamps.size() - 1;
-    BOOST_REVERSE_FOREACH(auto it, alt_chain) {
-      timestamps[max_i - count] = it->second.bl.timestamp;
-      commulative_difficulties[max_i - count] = it->second.cumulative_difficulty;
-      count++;
-      if (count >= m_currency.difficultyBlocksCount()) {
-        break;
-      }
+    for (size_t i = splitHeight; i < m_blocks.size(); ++i) {
+      window.pop_back();
     }
   }
 
-  return m_currency.nextDifficulty(timestamps, commulative_difficulties);
+  extendDifficultyWindow(window, splitHeight, blocksCount - std::min(blocksCount, alt_chain.size()));
+
+  auto it = alt_chain.begin();
+  std::advance(it, alt_chain.size() - std::min(alt_chain.size(), blocksCount));
+  for (; it != alt_chain.end(); ++it) {
+    window.push_back((*it)->second.bl.timestamp, (*it)->second.cumulative_difficulty);
+  }
+
+  return window.nextDifficulty();
+}
+
+// Adds main chain blocks in front of a window that ends before the given height, until it holds count blocks
+void Blockchain::extendDifficultyWindow(DifficultyWindow& window, uint32_t height, size_t count) {
+  assert(window.size() <= height);
+  for (uint32_t blockHeight = height - static_cast<uint32_t>(window.size()); window.size() < count && blockHeight > 1;) {
+    --blockHeight;
+    const BlockEntry& block = m_blocks[blockHeight];
+    window.push_front(block.bl.timestamp, block.cumulative_difficulty);
+  }
 }
 
 bool Blockchain::prevalidate_miner_transaction(const Block& b, uint32_t height) {
@@ -870,7 +1199,7 @@ bool Blockchain::validate_miner_transaction(const Block& b, uint32_t height, siz
 }
 
 bool Blockchain::getBackwardBlocksSize(size_t from_height, std::vector<size_t>& sz, size_t count) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   if (!(from_height < m_blocks.size())) {
     logger(ERROR, BRIGHT_RED)
       << "Internal error: get_backward_blocks_sizes called with from_height="
@@ -886,7 +1215,7 @@ bool Blockchain::getBackwardBlocksSize(size_t from_height, std::vector<size_t>&
 }
 
 bool Blockchain::get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   if (!m_blocks.size()) {
     return true;
   }
@@ -902,7 +1231,7 @@ bool Blockchain::complete_timestamps_vector(uint64_t start_top_height, std::vect
   if (timestamps.size() >= m_currency.timestampCheckWindow())
     return true;
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   size_t need_elements = m_currency.timestampCheckWindow() - timestamps.size();
   if (!(start_top_height < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "internal error: passed start_height = " << start_top_height << " not less then m_blocks.size()=" << m_blocks.size(); return false; }
   size_t stop_offset = start_top_height > need_elements ? start_top_height - need_elements : 0;
@@ -1002,7 +1331,7 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
     difficulty_type current_diff = get_next_difficulty_for_alternative_chain(alt_chain, bei);
     if (!(current_diff)) { logger(ERROR, BRIGHT_RED) << "!!!!!!! DIFFICULTY OVERHEAD !!!!!!!"; return false; }
     Crypto::Hash proof_of_work = NULL_HASH;
-    if (!m_currency.checkProofOfWork(m_cn_context, bei.bl, current_diff, proof_of_work)) {
+    if (!checkProofOfWork(bei.bl, id, current_diff, proof_of_work)) {
       logger(INFO, BRIGHT_RED) <<
         "Block with id: " << id
         << ENDL << " for alternative chain, have not enough proof of work: " << proof_of_work
@@ -1026,10 +1355,11 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
     if (!(i_dres == m_alternative_chains.end())) { logger(ERROR, BRIGHT_RED) << "insertion of new alternative block returned as it already exist"; return false; }
 #endif
 
-    auto i_res = m_alternative_chains.insert(blocks_ext_by_hash::value_type(id, bei));
+    auto i_res = m_alternative_chains.emplace(id, std::move(bei));
     if (!(i_res.second)) { logger(ERROR, BRIGHT_RED) << "insertion of new alternative block returned as it already exist"; return false; }
 
-    m_orthanBlocksIndex.add(bei.bl);
+    const BlockEntry& altBlock = i_res.first->second;
+    m_orthanBlocksIndex.add(altBlock.bl);
 
     alt_chain.push_back(i_res.first);
 
@@ -1037,7 +1367,7 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
       //do reorganize!
       logger(INFO, BRIGHT_GREEN) <<
         "###### REORGANIZE on height: " << alt_chain.front()->second.height << " of " << m_blocks.size() - 1 <<
-        ", checkpoint is found in alternative chain on height " << bei.height;
+        ", checkpoint is found in alternative chain on height " << altBlock.height;
       bool r = switch_to_alternative_blockchain(alt_chain, true);
       if (r) {
         bvc.m_added_to_main_chain = true;
@@ -1046,12 +1376,12 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
         bvc.m_verifivation_failed = true;
       }
       return r;
-    } else if (m_blocks.back().cumulative_difficulty < bei.cumulative_difficulty) //check if difficulty bigger then in main chain
+    } else if (m_blocks.back().cumulative_difficulty < altBlock.cumulative_difficulty) //check if difficulty bigger then in main chain
     {
       //do reorganize!
       logger(INFO, BRIGHT_GREEN) <<
         "###### REORGANIZE on height: " << alt_chain.front()->second.height << " of " << m_blocks.size() - 1 << " with cum_difficulty " << m_blocks.back().cumulative_difficulty
-        << ENDL << " alternative blockchain size: " << alt_chain.size() << " with cum_difficulty " << bei.cumulative_difficulty;
+        << ENDL << " alternative blockchain size: " << alt_chain.size() << " with cum_difficulty " << altBlock.cumulative_difficulty;
       bool r = switch_to_alternative_blockchain(alt_chain, false);
       if (r) {
         bvc.m_added_to_main_chain = true;
@@ -1062,7 +1392,7 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
       return r;
     } else {
       logger(INFO, BRIGHT_BLUE) <<
-        "----- BLOCK ADDED AS ALTERNATIVE ON HEIGHT " << bei.height
+        "----- BLOCK ADDED AS ALTERNATIVE ON HEIGHT " << altBlock.height
         << ENDL << "id:\t" << id
         << ENDL << "PoW:\t" << proof_of_work
         << ENDL << "difficulty:\t" << current_diff;
@@ -1082,13 +1412,14 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
 }
 
 bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks, std::list<Transaction>& txs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   if (start_offset >= m_blocks.size())
     return false;
-  for (size_t i = start_offset; i < start_offset + count && i < m_blocks.size(); i++) {
-    blocks.push_back(m_blocks[i].bl);
+  for (uint32_t i = start_offset; i < start_offset + count && i < m_blocks.size(); i++) {
+    blocks.push_back(Block());
+    loadBlock(i, blocks.back());
     std::list<Crypto::Hash> missed_ids;
-    getTransactions(m_blocks[i].bl.transactionHashes, txs, missed_ids);
+    getTransactions(blocks.back().transactionHashes, txs, missed_ids);
     if (!(!missed_ids.size())) { logger(ERROR, BRIGHT_RED) << "have missed transactions in own block in main blockchain"; return false; }
   }
 
@@ -1096,20 +1427,21 @@ bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Bloc
 }
 
 bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   if (start_offset >= m_blocks.size()) {
     return false;
   }
 
   for (uint32_t i = start_offset; i < start_offset + count && i < m_blocks.size(); i++) {
-    blocks.push_back(m_blocks[i].bl);
+    blocks.push_back(Block());
+    loadBlock(i, blocks.back());
   }
 
   return true;
 }
 
 bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_RESPONSE_GET_OBJECTS::request& rsp) { //Deprecated. Should be removed with CryptoNoteProtocolHandler.
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   rsp.current_blockchain_height = getCurrentBlockchainHeight();
   std::list<Block> blocks;
   getBlocks(arg.blocks, blocks, rsp.missed_ids);
@@ -1141,7 +1473,7 @@ bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTI
 }
 
 bool Blockchain::getAlternativeBlocks(std::list<Block>& blocks) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   for (auto& alt_bl : m_alternative_chains) {
     blocks.push_back(alt_bl.second.bl);
   }
@@ -1150,31 +1482,26 @@ bool Blockchain::getAlternativeBlocks(std::list<Block>& blocks) {
 }
 
 uint32_t Blockchain::getAlternativeBlocksCount() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return static_cast<uint32_t>(m_alternative_chains.size());
 }
 
-bool Blockchain::add_out_to_get_random_outs(std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  const Transaction& tx = transactionByIndex(amount_outs[i].first).tx;
-  if (!(tx.outputs.size() > amount_outs[i].second)) {
-    logger(ERROR, BRIGHT_RED) << "internal error: in global outs index, transaction out index="
-      << amount_outs[i].second << " more than transaction outputs = " << tx.outputs.size() << ", for tx id = " << getObjectHash(tx); return false;
-  }
-  if (!(tx.outputs[amount_outs[i].second].target.type() == typeid(KeyOutput))) { logger(ERROR, BRIGHT_RED) << "unknown tx out type"; return false; }
+bool Blockchain::add_out_to_get_random_outs(const std::vector<OutputEntry>& amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i) {
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  const OutputEntry& output = amount_outs[i];
 
   //check if transaction is unlocked
-  if (!is_tx_spendtime_unlocked(tx.unlockTime))
+  if (!is_tx_spendtime_unlocked(output.unlockTime))
     return false;
 
   COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry& oen = *result_outs.outs.insert(result_outs.outs.end(), COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry());
   oen.global_amount_index = static_cast<uint32_t>(i);
-  oen.out_key = boost::get<KeyOutput>(tx.outputs[amount_outs[i].second].target).key;
+  oen.out_key = output.key;
   return true;
 }
 
-size_t Blockchain::find_end_of_allowed_index(const std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+size_t Blockchain::find_end_of_allowed_index(const std::vector<OutputEntry>& amount_outs) {
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   if (amount_outs.empty()) {
     return 0;
   }
@@ -1182,7 +1509,7 @@ size_t Blockchain::find_end_of_allowed_index(const std::vector<std::pair<Transac
   size_t i = amount_outs.size();
   do {
     --i;
-    if (amount_outs[i].first.block + m_currency.minedMoneyUnlockWindow() <= getCurrentBlockchainHeight()) {
+    if (amount_outs[i].transactionIndex.block + m_currency.minedMoneyUnlockWindow() <= getCurrentBlockchainHeight()) {
       return i + 1;
     }
   } while (i != 0);
@@ -1191,7 +1518,7 @@ size_t Blockchain::find_end_of_allowed_index(const std::vector<std::pair<Transac
 }
 
 bool Blockchain::getRandomOutsByAmount(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
 
   for (uint64_t amount : req.amounts) {
     COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs = *res.outs.insert(res.outs.end(), COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount());
@@ -1203,7 +1530,7 @@ bool Blockchain::getRandomOutsByAmount(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_
       continue;//actually this is strange situation, wallet should use some real outs when it lookup for some mix, so, at least one out for this amount should exist
     }
 
-    std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs = it->second;
+    const std::vector<OutputEntry>& amount_outs = it->second;
     //it is not good idea to use top fresh outs, because it increases possibility of transaction canceling on split
     //lets find upper bound of not fresh outs
     size_t up_index_limit = find_end_of_allowed_index(amount_outs);
@@ -1223,7 +1550,7 @@ uint32_t Blockchain::findBlockchainSupplement(const std::vector<Crypto::Hash>& q
   assert(!qblock_ids.empty());
   assert(qblock_ids.back() == m_blockIndex.getBlockId(0));
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   uint32_t blockIndex;
   // assert above guarantees that method returns true
   m_blockIndex.findSupplement(qblock_ids, blockIndex);
@@ -1231,7 +1558,7 @@ uint32_t Blockchain::findBlockchainSupplement(const std::vector<Crypto::Hash>& q
 }
 
 uint64_t Blockchain::blockDifficulty(size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   if (!(i < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "wrong block index i = " << i << " at Blockchain::block_difficulty()"; return false; }
   if (i == 0)
     return m_blocks[i].cumulative_difficulty;
@@ -1241,7 +1568,7 @@ uint64_t Blockchain::blockDifficulty(size_t i) {
 
 void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   if (start_index >= m_blocks.size()) {
     logger(INFO, BRIGHT_WHITE) <<
       "Wrong starter index set: " << start_index << ", expected max index " << m_blocks.size() - 1;
@@ -1261,7 +1588,7 @@ void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
 
 void Blockchain::print_blockchain_index() {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
 
   std::vector<Crypto::Hash> blockIds = m_blockIndex.getBlockIds(0, std::numeric_limits<uint32_t>::max());
   logger(INFO, BRIGHT_WHITE) << "Current blockchain index:";
@@ -1275,13 +1602,13 @@ void Blockchain::print_blockchain_index() {
 
 void Blockchain::print_blockchain_outs(const std::string& file) {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   for (const outputs_container::value_type& v : m_outputs) {
-    const std::vector<std::pair<TransactionIndex, uint16_t>>& vals = v.second;
+    const std::vector<OutputEntry>& vals = v.second;
     if (!vals.empty()) {
       ss << "amount: " << v.first << ENDL;
       for (size_t i = 0; i != vals.size(); i++) {
-        ss << "\t" << getObjectHash(transactionByIndex(vals[i].first).tx) << ": " << vals[i].second << ENDL;
+        ss << "\t" << getObjectHash(transactionByIndex(vals[i].transactionIndex).tx) << ": " << vals[i].outputIndex << ENDL;
       }
     }
   }
@@ -1301,7 +1628,7 @@ std::vector<Crypto::Hash> Blockchain::findBlockchainSupplement(const std::vector
   assert(!remoteBlockIds.empty());
   assert(remoteBlockIds.back() == m_blockIndex.getBlockId(0));
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   totalBlockCount = getCurrentBlockchainHeight();
   startBlockIndex = findBlockchainSupplement(remoteBlockIds);
 
@@ -1309,7 +1636,7 @@ std::vector<Crypto::Hash> Blockchain::findBlockchainSupplement(const std::vector
 }
 
 bool Blockchain::haveBlock(const Crypto::Hash& id) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   if (m_blockIndex.hasBlock(id))
     return true;
 
@@ -1320,12 +1647,12 @@ bool Blockchain::haveBlock(const Crypto::Hash& id) {
 }
 
 size_t Blockchain::getTotalTransactions() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return m_transactionMap.size();
 }
 
 bool Blockchain::getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, std::vector<uint32_t>& indexs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   auto it = m_transactionMap.find(tx_id);
   if (it == m_transactionMap.end()) {
     logger(WARNING, YELLOW) << "warning: get_tx_outputs_gindexs failed to find transaction with id = " << tx_id;
@@ -1343,7 +1670,7 @@ bool Blockchain::getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, st
 }
 
 bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   auto it = m_multisignatureOutputs.find(amount);
   if (it == m_multisignatureOutputs.end()) {
     return false;
@@ -1366,7 +1693,7 @@ bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, Multis
 
 
 bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t& max_used_block_height, Crypto::Hash& max_used_block_id, BlockInfo* tail) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
 
   if (tail)
     tail->id = getTailId(tail->height);
@@ -1395,12 +1722,18 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t* pmax_us
   return checkTransactionInputs(tx, tx_prefix_hash, pmax_used_block_height);
 }
 
-bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height) {
+// Ring signatures are checked after all inputs are resolved, or left to the caller if ringSignatureChecks is given
+bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height, std::vector<RingSignatureCheck>* ringSignatureChecks) {
   size_t inputIndex = 0;
+  uint32_t maxUsedBlockHeight = 0;
   if (pmax_used_block_height) {
     *pmax_used_block_height = 0;
   }
 
+  std::vector<RingSignatureCheck> transactionChecks;
+  std::vector<RingSignatureCheck>& checks = ringSignatureChecks != NULL ? *ringSignatureChecks : transactionChecks;
+  size_t firstCheck = checks.size();
+
   Crypto::Hash transactionHash = getObjectHash(tx);
   for (const auto& txin : tx.inputs) {
     assert(inputIndex < tx.signatures.size());
@@ -1414,7 +1747,7 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Has
         return false;
       }
 
-      if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], pmax_used_block_height)) {
+      if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], checks, &maxUsedBlockHeight)) {
         logger(INFO, BRIGHT_WHITE) <<
           "Failed to check ring signature for tx " << transactionHash;
         return false;
@@ -1434,9 +1767,164 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Has
     }
   }
 
+  if (pmax_used_block_height) {
+    *pmax_used_block_height = maxUsedBlockHeight;
+  }
+
+  if (isTransactionChecked(transactionHash, maxUsedBlockHeight)) {
+    checks.resize(firstCheck);
+    return true;
+  }
+
+  for (size_t i = firstCheck; i < checks.size(); ++i) {
+    checks[i].transactionHash = transactionHash;
+  }
+
+  if (ringSignatureChecks == NULL) {
+    Crypto::Hash failedTransactionHash;
+    if (!checkRingSignatures(transactionChecks, failedTransactionHash)) {
+      logger(INFO, BRIGHT_WHITE) <<
+        "Failed to check ring signature for tx " << transactionHash;
+      return false;
+    }
+
+    addCheckedTransactions({ std::make_pair(transactionHash, maxUsedBlockHeight) });
+  }
+
   return true;
 }
 
+// The inputs of all transactions are resolved first, then all ring signatures are checked in parallel
+void Blockchain::checkTransactionsInputs(const std::vector<const Transaction*>& transactions, std::vector<uint8_t>& results) {
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+
+  results.assign(transactions.size(), 0);
+  std::vector<RingSignatureCheck> checks;
+  std::vector<size_t> checkEnds(transactions.size());
+  std::vector<uint32_t> maxUsedBlockHeights(transactions.size());
+  for (size_t i = 0; i < transactions.size(); ++i) {
+    const Transaction& transaction = *transactions[i];
+    size_t firstCheck = checks.size();
+    results[i] = checkTransactionInputs(transaction, getObjectHash(static_cast<const TransactionPrefix&>(transaction)),
+      &maxUsedBlockHeights[i], &checks);
+    if (!results[i]) {
+      checks.resize(firstCheck);
+    }
+
+    checkEnds[i] = checks.size();
+  }
+
+  std::vector<uint8_t> checkResults;
+  verifyRingSignatures(checks, checkResults);
+
+  std::vector<std::pair<Crypto::Hash, uint32_t>> checkedTransactions;
+  size_t firstCheck = 0;
+  for (size_t i = 0; i < transactions.size(); ++i) {
+    if (results[i]) {
+      results[i] = std::all_of(checkResults.begin() + firstCheck, checkResults.begin() + checkEnds[i], [](uint8_t result) { return result != 0; });
+      if (!results[i]) {
+        logger(INFO, BRIGHT_WHITE) << "Failed to check ring signature for tx " << getObjectHash(*transactions[i]);
+      } else if (checkEnds[i] != firstCheck) {
+        checkedTransactions.emplace_back(checks[firstCheck].transactionHash, maxUsedBlockHeights[i]);
+      }
+    }
+
+    firstCheck = checkEnds[i];
+  }
+
+  addCheckedTransactions(checkedTransactions);
+}
+
+void Blockchain::precheckTransactions(const std::vector<const Transaction*>& transactions) {
+  if (m_is_in_checkpoint_zone) {
+    return;
+  }
+
+  std::vector<const Transaction*> knownInputTransactions;
+  {
+    Tools::SharedLockGuard lk(m_blockchain_lock);
+    for (const Transaction* transaction : transactions) {
+      if (areInputOutputsKnown(*transaction)) {
+        knownInputTransactions.push_back(transaction);
+      }
+    }
+  }
+
+  std::vector<uint8_t> results;
+  checkTransactionsInputs(knownInputTransactions, results);
+}
+
+bool Blockchain::areInputOutputsKnown(const Transaction& transaction) {
+  for (const auto& input : transaction.inputs) {
+    if (input.type() != typeid(KeyInput)) {
+      return false;
+    }
+
+    const KeyInput& keyInput = boost::get<KeyInput>(input);
+    auto it = m_outputs.find(keyInput.amount);
+    if (it == m_outputs.end() || keyInput.outputIndexes.empty()) {
+      return false;
+    }
+
+    std::vector<uint32_t> absoluteOffsets = relative_output_offsets_to_absolute(keyInput.outputIndexes);
+    if (absoluteOffsets.back() >= it->second.size()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// A transaction stays checked while the block of the most recent output it refers to is in the main chain, the
+// outputs it refers to can't change then
+bool Blockchain::isTransactionChecked(const Crypto::Hash& transactionHash, uint32_t maxUsedBlockHeight) {
+  std::lock_guard<std::mutex> lock(m_checkedTransactionsLock);
+  auto it = m_checkedTransactions.find(transactionHash);
+  return it != m_checkedTransactions.end() && it->second.height == maxUsedBlockHeight && maxUsedBlockHeight < m_blockIndex.size() &&
+    m_blockIndex.getBlockId(maxUsedBlockHeight) == it->second.id;
+}
+
+void Blockchain::addCheckedTransactions(const std::vector<std::pair<Crypto::Hash, uint32_t>>& transactions) {
+  std::lock_guard<std::mutex> lock(m_checkedTransactionsLock);
+  if (m_checkedTransactions.size() + transactions.size() > MAX_CHECKED_TRANSACTIONS) {
+    m_checkedTransactions.clear();
+  }
+
+  for (const auto& transaction : transactions) {
+    BlockInfo& maxUsedBlock = m_checkedTransactions[transaction.first];
+    maxUsedBlock.height = transaction.second;
+    maxUsedBlock.id = m_blockIndex.getBlockId(transaction.second);
+  }
+}
+
+// Checks run in parallel, the reported failure is the first one in order of ringSignatureChecks
+bool Blockchain::checkRingSignatures(const std::vector<RingSignatureCheck>& ringSignatureChecks, Crypto::Hash& failedTransactionHash) {
+  std::vector<uint8_t> results;
+  verifyRingSignatures(ringSignatureChecks, results);
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (!results[i]) {
+      failedTransactionHash = ringSignatureChecks[i].transactionHash;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void Blockchain::verifyRingSignatures(const std::vector<RingSignatureCheck>& ringSignatureChecks, std::vector<uint8_t>& results) {
+  results.assign(ringSignatureChecks.size(), 0);
+  Tools::parallelFor(ringSignatureChecks.size(), m_workerThreadCount, [&ringSignatureChecks, &results](size_t i) {
+    const RingSignatureCheck& check = ringSignatureChecks[i];
+    std::vector<const Crypto::PublicKey*> outputKeys;
+    for (const Crypto::PublicKey& key : check.outputKeys) {
+      outputKeys.push_back(&key);
+    }
+
+    results[i] = Crypto::check_ring_signature(check.transactionPrefixHash, check.keyImage, outputKeys, check.signatures.data());
+  });
+}
+
 bool Blockchain::is_tx_spendtime_unlocked(uint64_t unlock_time) {
   if (unlock_time < m_currency.maxBlockHeight()) {
     //interpret as block index
@@ -1456,37 +1944,32 @@ bool Blockchain::is_tx_spendtime_unlocked(uint64_t unlock_time) {
   return false;
 }
 
-bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+// Resolves the output keys of the input and queues its ring signature to ringSignatureChecks
+bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, std::vector<RingSignatureCheck>& ringSignatureChecks, uint32_t* pmax_related_block_height) {
+  Tools::SharedLockGuard lk(m_blockchain_lock);
 
   struct outputs_visitor {
-    std::vector<const Crypto::PublicKey *>& m_results_collector;
+    std::vector<Crypto::PublicKey>& m_results_collector;
     Blockchain& m_bch;
     LoggerRef logger;
-    outputs_visitor(std::vector<const Crypto::PublicKey *>& results_collector, Blockchain& bch, ILogger& logger) :m_results_collector(results_collector), m_bch(bch), logger(logger, "outputs_visitor") {
+    outputs_visitor(std::vector<Crypto::PublicKey>& results_collector, Blockchain& bch, ILogger& logger) :m_results_collector(results_collector), m_bch(bch), logger(logger, "outputs_visitor") {
     }
 
-    bool handle_output(const Transaction& tx, const TransactionOutput& out, size_t transactionOutputIndex) {
+    bool handle_output(const OutputEntry& output) {
       //check tx unlock time
-      if (!m_bch.is_tx_spendtime_unlocked(tx.unlockTime)) {
-        logger(INFO, BRIGHT_WHITE) <<
-          "One of outputs for one of inputs have wrong tx.unlockTime = " << tx.unlockTime;
-        return false;
-      }
-
-      if (out.target.type() != typeid(KeyOutput)) {
+      if (!m_bch.is_tx_spendtime_unlocked(output.unlockTime)) {
         logger(INFO, BRIGHT_WHITE) <<
-          "Output have wrong type id, which=" << out.target.which();
+          "One of outputs for one of inputs have wrong tx.unlockTime = " << output.unlockTime;
         return false;
       }
 
-      m_results_collector.push_back(&boost::get<KeyOutput>(out.target).key);
+      m_results_collector.push_back(output.key);
       return true;
     }
   };
 
   //check ring signature
-  std::vector<const Crypto::PublicKey *> output_keys;
+  std::vector<Crypto::PublicKey> output_keys;
   outputs_visitor vi(output_keys, *this, logger.getLogger());
   if (!scanOutputKeysForIndexes(txin, vi, pmax_related_block_height)) {
     logger(INFO, BRIGHT_WHITE) <<
@@ -1506,7 +1989,13 @@ bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_pre
     return true;
   }
 
-  return Crypto::check_ring_signature(tx_prefix_hash, txin.keyImage, output_keys, sig.data());
+  RingSignatureCheck check;
+  check.transactionPrefixHash = tx_prefix_hash;
+  check.keyImage = txin.keyImage;
+  check.outputKeys = std::move(output_keys);
+  check.signatures = sig;
+  ringSignatureChecks.push_back(std::move(check));
+  return true;
 }
 
 uint64_t Blockchain::get_adjusted_time() {
@@ -1590,16 +2079,19 @@ bool Blockchain::update_next_comulative_size_limit() {
 }
 
 bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc) {
-  //copy block here to let modify block.target
-  Block bl = bl_;
-  Crypto::Hash id;
-  if (!get_block_hash(bl, id)) {
+  return addNewBlock(bl_, toBinaryArray(bl_), bvc);
+}
+
+bool Blockchain::addNewBlock(const Block& bl, const BinaryArray& blockBlob, block_verification_context& bvc) {
+  BlockBlobInfo blobInfo;
+  if (!getBlockBlobInfo(bl, blockBlob, blobInfo)) {
     logger(ERROR, BRIGHT_RED) <<
       "Failed to get block hash, possible block has invalid format";
     bvc.m_verifivation_failed = true;
     return false;
   }
 
+  const Crypto::Hash& id = blobInfo.blockHash;
   bool add_result;
 
   { //to avoid deadlock lets lock tx_pool for whole add/reorganize process
@@ -1618,7 +2110,7 @@ bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc)
       bvc.m_added_to_main_chain = false;
       add_result = handle_alternative_block(bl, id, bvc);
     } else {
-      add_result = pushBlock(bl, bvc);
+      add_result = pushBlock(bl, blockBlob, blobInfo, bvc);
       if (add_result) {
         sendMessage(BlockchainMessage(NewBlockMessage(id)));
       }
@@ -1632,18 +2124,174 @@ bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc)
   return add_result;
 }
 
+// Blocks whose parent is neither known nor earlier in the batch can't be added yet and aren't hashed, nor are those of
+// the checkpoint zone. The long hashes are computed two at a time, each thread with a pair of contexts of its own.
+void Blockchain::computeProofsOfWork(const std::vector<Block>& blocks) {
+  std::vector<const Block*> hashedBlocks;
+  std::vector<Crypto::Hash> blockHashes;
+  {
+    Tools::SharedLockGuard lk(m_blockchain_lock);
+    std::unordered_map<Crypto::Hash, uint32_t> batchHeights;
+    for (const Block& block : blocks) {
+      uint32_t height;
+      auto parentIt = batchHeights.find(block.previousBlockHash);
+      if (parentIt != batchHeights.end()) {
+        height = parentIt->second + 1;
+      } else if (m_blockIndex.getBlockHeight(block.previousBlockHash, height)) {
+        ++height;
+      } else {
+        auto alternativeParentIt = m_alternative_chains.find(block.previousBlockHash);
+        if (alternativeParentIt == m_alternative_chains.end()) {
+          continue;
+        }
+
+        height = alternativeParentIt->second.height + 1;
+      }
+
+      Crypto::Hash blockHash = get_block_hash(block);
+      batchHeights[blockHash] = height;
+      if (!m_checkpoints.is_in_checkpoint_zone(height)) {
+        hashedBlocks.push_back(&block);
+        blockHashes.push_back(blockHash);
+      }
+    }
+  }
+
+  if (hashedBlocks.empty()) {
+    return;
+  }
+
+  std::vector<Crypto::Hash> proofsOfWork(hashedBlocks.size());
+  std::vector<char> computed(hashedBlocks.size(), 0);
+  std::atomic<size_t> next(0);
+  Tools::runOnThreads(std::min(m_workerThreadCount, (hashedBlocks.size() + 1) / 2), [&] {
+    std::unique_ptr<ProofOfWorkContexts> contexts;
+    {
+      std::lock_guard<std::mutex> lock(m_proofsOfWorkLock);
+      if (!m_proofOfWorkContexts.empty()) {
+        contexts = std::move(m_proofOfWorkContexts.back());
+        m_proofOfWorkContexts.pop_back();
+      }
+    }
+
+    if (!contexts) {
+      contexts.reset(new ProofOfWorkContexts());
+    }
+
+    for (size_t i = next.fetch_add(2); i < hashedBlocks.size(); i = next.fetch_add(2)) {
+      if (i + 1 < hashedBlocks.size()) {
+        computed[i] = computed[i + 1] = get_block_longhash(contexts->context0, contexts->context1, *hashedBlocks[i], *hashedBlocks[i + 1],
+          proofsOfWork[i], proofsOfWork[i + 1]);
+      } else {
+        computed[i] = get_block_longhash(contexts->context0, *hashedBlocks[i], proofsOfWork[i]);
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(m_proofsOfWorkLock);
+    m_proofOfWorkContexts.push_back(std::move(contexts));
+  });
+
+  std::lock_guard<std::mutex> lock(m_proofsOfWorkLock);
+  if (m_proofsOfWork.size() + hashedBlocks.size() > MAX_PRECOMPUTED_PROOFS_OF_WORK) {
+    m_proofsOfWork.clear();
+  }
+
+  for (size_t i = 0; i < hashedBlocks.size(); ++i) {
+    if (computed[i]) {
+      m_proofsOfWork[blockHashes[i]] = proofsOfWork[i];
+    }
+  }
+}
+
+// Uses the long hash computed by computeProofsOfWork, if there is one
+bool Blockchain::checkProofOfWork(const Block& block, const Crypto::Hash& blockHash, difficulty_type difficulty, Crypto::Hash& proofOfWork) {
+  {
+    std::lock_guard<std::mutex> lock(m_proofsOfWorkLock);
+    auto it = m_proofsOfWork.find(blockHash);
+    if (it != m_proofsOfWork.end()) {
+      proofOfWork = it->second;
+      m_proofsOfWork.erase(it);
+      return check_hash(proofOfWork, difficulty);
+    }
+  }
+
+  return m_currency.checkProofOfWork(m_cn_context, block, difficulty, proofOfWork);
+}
+
 const Blockchain::TransactionEntry& Blockchain::transactionByIndex(TransactionIndex index) {
   return m_blocks[index.block].transactions[index.transaction];
 }
 
+// BlockEntry is serialized starting with the block itself, so the block can be decoded straight from
+// the mapped entry, without the transactions.
+void Blockchain::loadBlock(uint32_t height, Block& block) {
+  Common::ArrayView<uint8_t> entry = m_blocks.raw(height);
+  MemoryInputStream stream(entry.getData(), entry.getSize());
+  BinaryInputStreamSerializer serializer(stream);
+  CryptoNote::serialize(block, serializer);
+}
+
+// The blob is the block as serialized, since parsing accepts canonical encodings only. The header and the
+// transaction hashes are at its ends, and the miner transaction lies between them. A blob which doesn't match
+// the block is rejected.
+bool Blockchain::getBlockBlobInfo(const Block& block, const BinaryArray& blockBlob, BlockBlobInfo& blobInfo) {
+  BinaryArray hashingBlob;
+  if (!toBinaryArray(static_cast<const BlockHeader&>(block), hashingBlob)) {
+    return false;
+  }
+
+  size_t headerSize = hashingBlob.size();
+  size_t transactionHashesSize = Tools::get_varint_data(block.transactionHashes.size()).size() + block.transactionHashes.size() * sizeof(Crypto::Hash);
+  if (blockBlob.size() < headerSize + transactionHashesSize || !std::equal(hashingBlob.begin(), hashingBlob.end(), blockBlob.begin())) {
+    return false;
+  }
+
+  const uint8_t* transactionHashesData = blockBlob.data() + blockBlob.size() - block.transactionHashes.size() * sizeof(Crypto::Hash);
+  if (!block.transactionHashes.empty() && memcmp(transactionHashesData, block.transactionHashes.data(), block.transactionHashes.size() * sizeof(Crypto::Hash)) != 0) {
+    return false;
+  }
+
+  BinaryArray minerTransactionBlob;
+  blobInfo.minerTransactionSize = blockBlob.size() - headerSize - transactionHashesSize;
+  if (!toBinaryArray(block.baseTransaction, minerTransactionBlob) || minerTransactionBlob.size() != blobInfo.minerTransactionSize ||
+    !std::equal(minerTransactionBlob.begin(), minerTransactionBlob.end(), blockBlob.begin() + headerSize)) {
+    return false;
+  }
+
+  Crypto::cn_fast_hash(minerTransactionBlob.data(), minerTransactionBlob.size(), blobInfo.minerTransactionHash);
+
+  std::vector<Crypto::Hash> transactionHashes;
+  transactionHashes.reserve(block.transactionHashes.size() + 1);
+  transactionHashes.push_back(blobInfo.minerTransactionHash);
+  transactionHashes.insert(transactionHashes.end(), block.transactionHashes.begin(), block.transactionHashes.end());
+  Crypto::Hash treeRootHash = get_tx_tree_hash(transactionHashes);
+  hashingBlob.insert(hashingBlob.end(), treeRootHash.data, treeRootHash.data + sizeof(treeRootHash));
+  auto transactionCount = asBinaryArray(Tools::get_varint_data(transactionHashes.size()));
+  hashingBlob.insert(hashingBlob.end(), transactionCount.begin(), transactionCount.end());
+  return getObjectHash(hashingBlob, blobInfo.blockHash);
+}
+
 bool Blockchain::pushBlock(const Block& blockData, block_verification_context& bvc) {
+  BinaryArray blockBlob = toBinaryArray(blockData);
+  BlockBlobInfo blobInfo;
+  if (!getBlockBlobInfo(blockData, blockBlob, blobInfo)) {
+    logger(ERROR, BRIGHT_RED) << "Failed to get block hash, possible block has invalid format";
+    bvc.m_verifivation_failed = true;
+    return false;
+  }
+
+  return pushBlock(blockData, blockBlob, blobInfo, bvc);
+}
+
+bool Blockchain::pushBlock(const Block& blockData, const BinaryArray& blockBlob, const BlockBlobInfo& blobInfo, block_verification_context& bvc) {
   std::vector<Transaction> transactions;
-  if (!loadTransactions(blockData, transactions)) {
+  std::vector<size_t> transactionSizes;
+  if (!loadTransactions(blockData, transactions, transactionSizes)) {
     bvc.m_verifivation_failed = true;
     return false;
   }
 
-  if (!pushBlock(blockData, transactions, bvc)) {
+  if (!pushBlock(blockData, blockBlob, blobInfo, transactions, transactionSizes, bvc)) {
     saveTransactions(transactions);
     return false;
   }
@@ -1651,12 +2299,13 @@ bool Blockchain::pushBlock(const Block& blockData, block_verification_context& b
   return true;
 }
 
-bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction>& transactions, block_verification_context& bvc) {
+bool Blockchain::pushBlock(const Block& blockData, const BinaryArray& blockBlob, const BlockBlobInfo& blobInfo, const std::vector<Transaction>& transactions,
+  const std::vector<size_t>& transactionSizes, block_verification_context& bvc) {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   auto blockProcessingStart = std::chrono::steady_clock::now();
 
-  Crypto::Hash blockHash = get_block_hash(blockData);
+  const Crypto::Hash& blockHash = blobInfo.blockHash;
 
   if (m_blockIndex.hasBlock(blockHash)) {
     logger(ERROR, BRIGHT_RED) <<
@@ -1699,7 +2348,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
       return false;
     }
   } else {
-    if (!m_currency.checkProofOfWork(m_cn_context, blockData, currentDifficulty, proof_of_work)) {
+    if (!checkProofOfWork(blockData, blockHash, currentDifficulty, proof_of_work)) {
       logger(INFO, BRIGHT_WHITE) <<
         "Block " << blockHash << ", has too weak proof of work: " << proof_of_work << ", expected difficulty: " << currentDifficulty;
       bvc.m_verifivation_failed = true;
@@ -1716,7 +2365,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     return false;
   }
 
-  Crypto::Hash minerTransactionHash = getObjectHash(blockData.baseTransaction);
+  const Crypto::Hash& minerTransactionHash = blobInfo.minerTransactionHash;
 
   BlockEntry block;
   block.bl = blockData;
@@ -1725,9 +2374,10 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   TransactionIndex transactionIndex = { static_cast<uint32_t>(m_blocks.size()), static_cast<uint16_t>(0) };
   pushTransaction(block, minerTransactionHash, transactionIndex);
 
-  size_t coinbase_blob_size = getObjectBinarySize(blockData.baseTransaction);
+  size_t coinbase_blob_size = blobInfo.minerTransactionSize;
   size_t cumulative_block_size = coinbase_blob_size;
   uint64_t fee_summary = 0;
+  std::vector<RingSignatureCheck> ringSignatureChecks;
   for (size_t i = 0; i < transactions.size(); ++i) {
     const Crypto::Hash& tx_id = blockData.transactionHashes[i];
     block.transactions.resize(block.transactions.size() + 1);
@@ -1735,9 +2385,10 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     uint64_t fee = 0;
     block.transactions.back().tx = transactions[i];
 
-    blob_size = toBinaryArray(block.transactions.back().tx).size();
+    blob_size = transactionSizes[i];
     fee = getInputAmount(block.transactions.back().tx) - getOutputAmount(block.transactions.back().tx);
-    if (!checkTransactionInputs(block.transactions.back().tx)) {
+    const Transaction& transaction = block.transactions.back().tx;
+    if (!checkTransactionInputs(transaction, getObjectHash(*static_cast<const TransactionPrefix*>(&transaction)), NULL, &ringSignatureChecks)) {
       logger(INFO, BRIGHT_WHITE) <<
         "Block " << blockHash << " has at least one transaction with wrong inputs: " << tx_id;
       bvc.m_verifivation_failed = true;
@@ -1754,6 +2405,17 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     fee_summary += fee;
   }
 
+  // Ring signatures of the whole block are verified together, once all its inputs have been resolved
+  Crypto::Hash failedTransactionHash;
+  if (!checkRingSignatures(ringSignatureChecks, failedTransactionHash)) {
+    logger(INFO, BRIGHT_WHITE) <<
+      "Block " << blockHash << " has at least one transaction with wrong inputs: " << failedTransactionHash;
+    bvc.m_verifivation_failed = true;
+
+    popTransactions(block, minerTransactionHash);
+    return false;
+  }
+
   if (!checkCumulativeBlockSize(blockHash, cumulative_block_size, m_blocks.size())) {
     bvc.m_verifivation_failed = true;
     return false;
@@ -1777,14 +2439,15 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     block.cumulative_difficulty += m_blocks.back().cumulative_difficulty;
   }
 
-  pushBlock(block);
+  uint32_t height = block.height;
+  pushBlock(std::move(block), blockHash, blockBlob);
 
   auto block_processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - blockProcessingStart).count();
 
   logger(DEBUGGING) <<
     "+++++ BLOCK SUCCESSFULLY ADDED" << ENDL << "id:\t" << blockHash
     << ENDL << "PoW:\t" << proof_of_work
-    << ENDL << "HEIGHT " << block.height << ", difficulty:\t" << currentDifficulty
+    << ENDL << "HEIGHT " << height << ", difficulty:\t" << currentDifficulty
     << ENDL << "block reward: " << m_currency.formatAmount(reward) << ", fee = " << m_currency.formatAmount(fee_summary)
     << ", coinbase_blob_size: " << coinbase_blob_size << ", cumulative size: " << cumulative_block_size
     << ", " << block_processing_time << "(" << target_calculating_time << "/" << longhash_calculating_time << ")ms";
@@ -1796,17 +2459,43 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   return true;
 }
 
-bool Blockchain::pushBlock(BlockEntry& block) {
+bool Blockchain::pushBlock(BlockEntry&& block) {
   Crypto::Hash blockHash = get_block_hash(block.bl);
+  return pushBlock(std::move(block), blockHash, toBinaryArray(block.bl));
+}
 
-  m_blocks.push_back(block);
+// The stored entry starts with the block, so the blob is written as is, followed by the rest of the entry
+bool Blockchain::pushBlock(BlockEntry&& block, const Crypto::Hash& blockHash, const BinaryArray& blockBlob) {
   m_blockIndex.push(blockHash);
 
   m_timestampIndex.add(block.bl.timestamp, blockHash);
   m_generatedTransactionsIndex.add(block.bl);
+  if (block.height != 0) {
+    m_difficultyWindow.push_back(block.bl.timestamp, block.cumulative_difficulty);
+  }
+
+  BinaryArray entry(blockBlob);
+  {
+    Common::VectorOutputStream stream(entry);
+    BinaryOutputStreamSerializer serializer(stream);
+    block.serializeWithoutBlock(serializer);
+  }
+
+  std::vector<Crypto::KeyImage> spentKeyImages;
+  for (size_t i = 1; i < block.transactions.size(); ++i) {
+    for (const auto& input : block.transactions[i].tx.inputs) {
+      if (input.type() == typeid(KeyInput)) {
+        spentKeyImages.push_back(boost::get<KeyInput>(input).keyImage);
+      }
+    }
+  }
+
+  m_blocks.push_back(std::move(block), Common::ArrayView<uint8_t>(entry.data(), entry.size()));
 
   assert(m_blockIndex.size() == m_blocks.size());
 
+  m_tx_pool.on_blockchain_inc(m_blocks.size(), blockHash, spentKeyImages);
+
   return true;
 }
 
@@ -1831,8 +2520,50 @@ void Blockchain::popBlock(const Crypto::Hash& blockHash) {
 
   m_blocks.pop_back();
   m_blockIndex.pop();
+  if (!m_difficultyWindow.empty()) {
+    m_difficultyWindow.pop_back();
+    extendDifficultyWindow(m_difficultyWindow, static_cast<uint32_t>(m_blocks.size()), m_currency.difficultyBlocksCount());
+  }
 
   assert(m_blockIndex.size() == m_blocks.size());
+
+  m_tx_pool.on_blockchain_dec(m_blocks.size(), getTailId());
+}
+
+// Puts back a block that was popped while switching chains. It was verified when it was added first,
+// so only the indices are updated, and its transactions, returned to the pool by popBlock, are taken out again.
+bool Blockchain::reapplyBlock(BlockEntry& block) {
+  if (block.height != m_blocks.size() || block.bl.previousBlockHash != getTailId()) {
+    logger(ERROR, BRIGHT_RED) <<
+      "Block " << get_block_hash(block.bl) << " can't be put back at height " << m_blocks.size();
+    return false;
+  }
+
+  Crypto::Hash minerTransactionHash = getObjectHash(block.bl.baseTransaction);
+  TransactionIndex transactionIndex = { block.height, static_cast<uint16_t>(0) };
+  if (!pushTransaction(block, minerTransactionHash, transactionIndex)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < block.bl.transactionHashes.size(); ++i) {
+    ++transactionIndex.transaction;
+    if (!pushTransaction(block, block.bl.transactionHashes[i], transactionIndex)) {
+      block.transactions.resize(transactionIndex.transaction);
+      popTransactions(block, minerTransactionHash);
+      return false;
+    }
+  }
+
+  Transaction transaction;
+  size_t transactionSize;
+  uint64_t fee;
+  for (const Crypto::Hash& transactionHash : block.bl.transactionHashes) {
+    m_tx_pool.take_tx(transactionHash, transaction, transactionSize, fee);
+  }
+
+  pushBlock(std::move(block));
+  update_next_comulative_size_limit();
+  return true;
 }
 
 bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transactionHash, TransactionIndex transactionIndex) {
@@ -1854,8 +2585,7 @@ bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transact
 
   for (size_t i = 0; i < transaction.tx.inputs.size(); ++i) {
     if (transaction.tx.inputs[i].type() == typeid(KeyInput)) {
-      auto result = m_spent_keys.insert(::boost::get<KeyInput>(transaction.tx.inputs[i]).keyImage);
-      if (!result.second) {
+      if (!m_spent_keys.insert(::boost::get<KeyInput>(transaction.tx.inputs[i]).keyImage)) {
         logger(ERROR, BRIGHT_RED) <<
           "Double spending transaction was pushed to blockchain.";
         for (size_t j = 0; j < i; ++j) {
@@ -1881,7 +2611,8 @@ bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transact
     if (transaction.tx.outputs[output].target.type() == typeid(KeyOutput)) {
       auto& amountOutputs = m_outputs[transaction.tx.outputs[output].amount];
       transaction.m_global_output_indexes[output] = static_cast<uint32_t>(amountOutputs.size());
-      amountOutputs.push_back(std::make_pair<>(transactionIndex, output));
+      OutputEntry outputEntry = { transactionIndex, output, transaction.tx.unlockTime, ::boost::get<KeyOutput>(transaction.tx.outputs[output].target).key };
+      amountOutputs.push_back(outputEntry);
     } else if (transaction.tx.outputs[output].target.type() == typeid(MultisignatureOutput)) {
       auto& amountOutputs = m_multisignatureOutputs[transaction.tx.outputs[output].amount];
       transaction.m_global_output_indexes[output] = static_cast<uint32_t>(amountOutputs.size());
@@ -1913,13 +2644,13 @@ void Blockchain::popTransaction(const Transaction& transaction, const Crypto::Ha
         continue;
       }
 
-      if (amountOutputs->second.back().first.block != transactionIndex.block || amountOutputs->second.back().first.transaction != transactionIndex.transaction) {
+      if (amountOutputs->second.back().transactionIndex.block != transactionIndex.block || amountOutputs->second.back().transactionIndex.transaction != transactionIndex.transaction) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - invalid transaction index.";
         continue;
       }
 
-      if (amountOutputs->second.back().second != transaction.outputs.size() - 1 - outputIndex) {
+      if (amountOutputs->second.back().outputIndex != transaction.outputs.size() - 1 - outputIndex) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - invalid output index.";
         continue;
@@ -2062,7 +2793,7 @@ bool Blockchain::validateInput(const MultisignatureInput& input, const Crypto::H
 }
 
 bool Blockchain::getLowerBound(uint64_t timestamp, uint64_t startOffset, uint32_t& height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
 
   assert(startOffset < m_blocks.size());
 
@@ -2078,12 +2809,12 @@ bool Blockchain::getLowerBound(uint64_t timestamp, uint64_t startOffset, uint32_
 }
 
 std::vector<Crypto::Hash> Blockchain::getBlockIds(uint32_t startHeight, uint32_t maxCount) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return m_blockIndex.getBlockIds(startHeight, maxCount);
 }
 
 bool Blockchain::getBlockContainingTransaction(const Crypto::Hash& txId, Crypto::Hash& blockId, uint32_t& blockHeight) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   auto it = m_transactionMap.find(txId);
   if (it == m_transactionMap.end()) {
     return false;
@@ -2095,7 +2826,7 @@ bool Blockchain::getBlockContainingTransaction(const Crypto::Hash& txId, Crypto:
 }
 
 bool Blockchain::getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& generatedCoins) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
 
   // try to find block in main chain
   uint32_t height = 0;
@@ -2116,7 +2847,7 @@ bool Blockchain::getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& ge
 }
 
 bool Blockchain::getBlockSize(const Crypto::Hash& hash, size_t& size) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
 
   // try to find block in main chain
   uint32_t height = 0;
@@ -2136,8 +2867,25 @@ bool Blockchain::getBlockSize(const Crypto::Hash& hash, size_t& size) {
   return false;
 }
 
+bool Blockchain::getKeyOutputReferences(const KeyInput& txInToKey, std::list<std::pair<Crypto::Hash, size_t>>& outputReferences) {
+  struct outputs_visitor {
+    std::list<std::pair<Crypto::Hash, size_t>>& m_resultsCollector;
+    Blockchain& m_bch;
+    outputs_visitor(std::list<std::pair<Crypto::Hash, size_t>>& resultsCollector, Blockchain& bch) : m_resultsCollector(resultsCollector), m_bch(bch) {
+    }
+
+    bool handle_output(const OutputEntry& output) {
+      m_resultsCollector.push_back(std::make_pair(getObjectHash(m_bch.transactionByIndex(output.transactionIndex).tx), output.outputIndex));
+      return true;
+    }
+  };
+
+  outputs_visitor vi(outputReferences, *this);
+  return scanOutputKeysForIndexes(txInToKey, vi);
+}
+
 bool Blockchain::getMultisigOutputReference(const MultisignatureInput& txInMultisig, std::pair<Crypto::Hash, size_t>& outputReference) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   MultisignatureOutputsContainer::const_iterator amountIter = m_multisignatureOutputs.find(txInMultisig.amount);
   if (amountIter == m_multisignatureOutputs.end()) {
     logger(DEBUGGING) << "Transaction contains multisignature input with invalid amount.";
@@ -2204,31 +2952,31 @@ bool Blockchain::loadBlockchainIndices() {
 }
 
 bool Blockchain::getGeneratedTransactionsNumber(uint32_t height, uint64_t& generatedTransactions) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return m_generatedTransactionsIndex.find(height, generatedTransactions);
 }
 
 bool Blockchain::getOrphanBlockIdsByHeight(uint32_t height, std::vector<Crypto::Hash>& blockHashes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return m_orthanBlocksIndex.find(height, blockHashes);
 }
 
 bool Blockchain::getBlockIdsByTimestamp(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t blocksNumberLimit, std::vector<Crypto::Hash>& hashes, uint32_t& blocksNumberWithinTimestamps) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return m_timestampIndex.find(timestampBegin, timestampEnd, blocksNumberLimit, hashes, blocksNumberWithinTimestamps);
 }
 
 bool Blockchain::getTransactionIdsByPaymentId(const Crypto::Hash& paymentId, std::vector<Crypto::Hash>& transactionHashes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return m_paymentIdIndex.find(paymentId, transactionHashes);
 }
 
-bool Blockchain::loadTransactions(const Block& block, std::vector<Transaction>& transactions) {
+bool Blockchain::loadTransactions(const Block& block, std::vector<Transaction>& transactions, std::vector<size_t>& transactionSizes) {
   transactions.resize(block.transactionHashes.size());
-  size_t transactionSize;
+  transactionSizes.resize(block.transactionHashes.size());
   uint64_t fee;
   for (size_t i = 0; i < block.transactionHashes.size(); ++i) {
-    if (!m_tx_pool.take_tx(block.transactionHashes[i], transactions[i], transactionSize, fee)) {
+    if (!m_tx_pool.take_tx(block.transactionHashes[i], transactions[i], transactionSizes[i], fee)) {
       tx_verification_context context;
       for (size_t j = 0; j < i; ++j) {
         if (!m_tx_pool.add_tx(transactions[i - 1 - j], context, true)) {
@@ -5,18 +5,23 @@
 #pragma once
 
 #include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
-#include "google/sparse_hash_set"
 #include "google/sparse_hash_map"
 
 #include "Common/ObserverManager.h"
+#include "Common/RecursiveSharedMutex.h"
 #include "Common/Util.h"
 #include "CryptoNoteCore/BlockIndex.h"
 #include "CryptoNoteCore/Checkpoints.h"
 #include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/DifficultyWindow.h"
 #include "CryptoNoteCore/IBlockchainStorageObserver.h"
 #include "CryptoNoteCore/ITransactionValidator.h"
-#include "CryptoNoteCore/SwappedVector.h"
+#include "CryptoNoteCore/KeyImageSet.h"
+#include "CryptoNoteCore/MappedVector.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 #include "CryptoNoteCore/TransactionPool.h"
 #include "CryptoNoteCore/BlockchainIndices.h"
@@ -51,13 +56,17 @@ namespace CryptoNote {
     virtual bool checkTransactionSize(size_t blobSize) override;
 
     bool init() { return init(Tools::getDefaultDataDirectory(), true); }
-    bool init(const std::string& config_folder, bool load_existing);
+    // A snapshot file, if given, is imported when there is no blockchain to load yet.
+    bool init(const std::string& config_folder, bool load_existing, const std::string& snapshotFile = std::string());
     bool deinit();
+    // Writes the main chain up to the last checkpoint together with the state derived from it.
+    bool exportSnapshot(const std::string& fileName);
 
     bool getLowerBound(uint64_t timestamp, uint64_t startOffset, uint32_t& height);
     std::vector<Crypto::Hash> getBlockIds(uint32_t startHeight, uint32_t maxCount);
 
     void setCheckpoints(Checkpoints&& chk_pts) { m_checkpoints = chk_pts; }
+    void setWorkerThreadCount(size_t threadCount) { m_workerThreadCount = threadCount; }
     bool getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks, std::list<Transaction>& txs);
     bool getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks);
     bool getAlternativeBlocks(std::list<Block>& blocks);
@@ -77,6 +86,17 @@ namespace CryptoNote {
     difficulty_type getDifficultyForNextBlock();
     uint64_t getCoinsInCirculation();
     bool addNewBlock(const Block& bl_, block_verification_context& bvc);
+    // The blob is the block as received, it must be what the block was parsed from
+    bool addNewBlock(const Block& block, const BinaryArray& blockBlob, block_verification_context& bvc);
+    // Computes the long hashes of downloaded blocks on the worker threads without the blockchain lock, adding
+    // the blocks then only compares them with the difficulty. Blocks in the checkpoint zone are skipped.
+    void computeProofsOfWork(const std::vector<Block>& blocks);
+    // Checks the inputs of transactions about to be added to the pool with the ring signatures of all of them checked
+    // in parallel. Checking a transaction that passed again skips its ring signatures, be it in the pool or in a block.
+    void checkTransactionsInputs(const std::vector<const Transaction*>& transactions, std::vector<uint8_t>& results);
+    // Checks the ring signatures of the transactions of downloaded blocks ahead of adding the blocks. Transactions
+    // referring to outputs of blocks which are not added yet are skipped, they are checked along with their block.
+    void precheckTransactions(const std::vector<const Transaction*>& transactions);
     bool resetAndSetGenesisBlock(const Block& b);
     bool haveBlock(const Crypto::Hash& id);
     size_t getTotalTransactions();
@@ -96,6 +116,7 @@ namespace CryptoNote {
     bool getBlockContainingTransaction(const Crypto::Hash& txId, Crypto::Hash& blockId, uint32_t& blockHeight);
     bool getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& generatedCoins);
     bool getBlockSize(const Crypto::Hash& hash, size_t& size);
+    bool getKeyOutputReferences(const KeyInput& txInToKey, std::list<std::pair<Crypto::Hash, size_t>>& outputReferences);
     bool getMultisigOutputReference(const MultisignatureInput& txInMultisig, std::pair<Crypto::Hash, size_t>& outputReference);
     bool getGeneratedTransactionsNumber(uint32_t height, uint64_t& generatedTransactions);
     bool getOrphanBlockIdsByHeight(uint32_t height, std::vector<Crypto::Hash>& blockHashes);
@@ -110,7 +131,7 @@ namespace CryptoNote {
 
     template<class t_ids_container, class t_blocks_container, class t_missed_container>
     bool getBlocks(const t_ids_container& block_ids, t_blocks_container& blocks, t_missed_container& missed_bs) {
-      std::lock_guard<std::recursive_mutex> lk(m_blockchain_lock);
+      Tools::SharedLockGuard lk(m_blockchain_lock);
 
       for (const auto& bl_id : block_ids) {
         uint32_t height = 0;
@@ -119,7 +140,8 @@ namespace CryptoNote {
         } else {
           if (!(height < m_blocks.size())) { logger(Logging::ERROR, Logging::BRIGHT_RED) << "Internal error: bl_id=" << Common::podToHex(bl_id)
             << " have index record with offset=" << height << ", bigger then m_blocks.size()=" << m_blocks.size(); return false; }
-            blocks.push_back(m_blocks[height].bl);
+            blocks.push_back(Block());
+            loadBlock(height, blocks.back());
         }
       }
 
@@ -128,7 +150,7 @@ namespace CryptoNote {
 
     template<class t_ids_container, class t_tx_container, class t_missed_container>
     void getBlockchainTransactions(const t_ids_container& txs_ids, t_tx_container& txs, t_missed_container& missed_txs) {
-      std::lock_guard<decltype(m_blockchain_lock)> bcLock(m_blockchain_lock);
+      Tools::SharedLockGuard bcLock(m_blockchain_lock);
 
       for (const auto& tx_id : txs_ids) {
         auto it = m_transactionMap.find(tx_id);
@@ -171,6 +193,15 @@ namespace CryptoNote {
       }
     };
 
+    // Key output together with what is needed to use it as a ring member, so that ring members
+    // are resolved without loading the transaction from the block storage
+    struct OutputEntry {
+      TransactionIndex transactionIndex;
+      uint16_t outputIndex;
+      uint64_t unlockTime;
+      Crypto::PublicKey key;
+    };
+
   private:
 
     struct MultisignatureOutputUsage {
@@ -205,6 +236,11 @@ namespace CryptoNote {
 
       void serialize(ISerializer& s) {
         s(bl, "block");
+        serializeWithoutBlock(s);
+      }
+
+      // Fields following the block, which comes first so it can be decoded on its own
+      void serializeWithoutBlock(ISerializer& s) {
         s(height, "height");
         s(block_cumulative_size, "block_cumulative_size");
         s(cumulative_difficulty, "cumulative_difficulty");
@@ -213,15 +249,50 @@ namespace CryptoNote {
       }
     };
 
-    typedef google::sparse_hash_set<Crypto::KeyImage> key_images_container;
+    // Taken once from the blob of a block being added
+    struct BlockBlobInfo {
+      Crypto::Hash blockHash;
+      Crypto::Hash minerTransactionHash;
+      size_t minerTransactionSize;
+    };
+
+    struct RebuildCacheEntry {
+      BlockEntry block;
+      Crypto::Hash blockHash;
+      std::vector<Crypto::Hash> transactionHashes;
+    };
+
+    // A pair of contexts, for the long hashes computed two at a time
+    struct ProofOfWorkContexts {
+      Crypto::cn_context context0;
+      Crypto::cn_context context1;
+    };
+
+    struct RingSignatureCheck {
+      Crypto::Hash transactionHash;
+      Crypto::Hash transactionPrefixHash;
+      Crypto::KeyImage keyImage;
+      std::vector<Crypto::PublicKey> outputKeys;
+      std::vector<Crypto::Signature> signatures;
+    };
+
+    typedef KeyImageSet key_images_container;
     typedef std::unordered_map<Crypto::Hash, BlockEntry> blocks_ext_by_hash;
-    typedef google::sparse_hash_map<uint64_t, std::vector<std::pair<TransactionIndex, uint16_t>>> outputs_container; //Crypto::Hash - tx hash, size_t - index of out in transaction
+    typedef google::sparse_hash_map<uint64_t, std::vector<OutputEntry>> outputs_container; // indexed by global output index of the amount
     typedef google::sparse_hash_map<uint64_t, std::vector<MultisignatureOutputUsage>> MultisignatureOutputsContainer;
 
     const Currency& m_currency;
     tx_memory_pool& m_tx_pool;
-    std::recursive_mutex m_blockchain_lock; // TODO: add here reader/writer lock
+    // Exclusive for changes of the main and alternative chains, shared for queries
+    Tools::RecursiveSharedMutex m_blockchain_lock;
     Crypto::cn_context m_cn_context;
+    std::mutex m_proofsOfWorkLock;
+    std::unordered_map<Crypto::Hash, Crypto::Hash> m_proofsOfWork;
+    // Kept between the batches, so that the scratchpads aren't allocated and locked for each of them
+    std::vector<std::unique_ptr<ProofOfWorkContexts>> m_proofOfWorkContexts;
+    std::mutex m_checkedTransactionsLock;
+    // Transactions with checked ring signatures with the block of the most recent output they refer to
+    std::unordered_map<Crypto::Hash, BlockInfo> m_checkedTransactions;
     Tools::ObserverManager<IBlockchainStorageObserver> m_observerManager;
 
     key_images_container m_spent_keys;
@@ -233,15 +304,17 @@ namespace CryptoNote {
     Checkpoints m_checkpoints;
     std::atomic<bool> m_is_in_checkpoint_zone;
 
-    typedef SwappedVector<BlockEntry> Blocks;
+    typedef MappedVector<BlockEntry> Blocks;
     typedef std::unordered_map<Crypto::Hash, uint32_t> BlockMap;
     typedef std::unordered_map<Crypto::Hash, TransactionIndex> TransactionMap;
 
     friend class BlockCacheSerializer;
     friend class BlockchainIndicesSerializer;
+    friend class BlockchainSnapshotSerializer;
 
     Blocks m_blocks;
     CryptoNote::BlockIndex m_blockIndex;
+    DifficultyWindow m_difficultyWindow;
     TransactionMap m_transactionMap;
     MultisignatureOutputsContainer m_multisignatureOutputs;
 
@@ -253,19 +326,26 @@ namespace CryptoNote {
     IntrusiveLinkedList<MessageQueue<BlockchainMessage>> m_messageQueueList;
 
     Logging::LoggerRef logger;
+    size_t m_workerThreadCount;
 
-    void rebuildCache();
+    bool rebuildCache();
+    void decodeRebuildCacheEntries(uint32_t begin, uint32_t end, std::vector<RebuildCacheEntry>& entries);
     bool storeCache();
+    bool importSnapshot(const std::string& fileName);
+    bool checkSnapshotBlocks();
+    bool checkSnapshotEntries();
     bool switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::iterator>& alt_chain, bool discard_disconnected_chain);
     bool handle_alternative_block(const Block& b, const Crypto::Hash& id, block_verification_context& bvc, bool sendNewAlternativeBlockMessage = true);
     difficulty_type get_next_difficulty_for_alternative_chain(const std::list<blocks_ext_by_hash::iterator>& alt_chain, BlockEntry& bei);
+    void extendDifficultyWindow(DifficultyWindow& window, uint32_t height, size_t count);
+    bool checkProofOfWork(const Block& block, const Crypto::Hash& blockHash, difficulty_type difficulty, Crypto::Hash& proofOfWork);
     bool prevalidate_miner_transaction(const Block& b, uint32_t height);
     bool validate_miner_transaction(const Block& b, uint32_t height, size_t cumulativeBlockSize, uint64_t alreadyGeneratedCoins, uint64_t fee, uint64_t& reward, int64_t& emissionChange);
-    bool rollback_blockchain_switching(std::list<Block>& original_chain, size_t rollback_height);
+    bool rollback_blockchain_switching(std::list<BlockEntry>& original_chain, size_t rollback_height);
     bool get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count);
-    bool add_out_to_get_random_outs(std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_outs_for_amount& result_outs, uint64_t amount, size_t i);
+    bool add_out_to_get_random_outs(const std::vector<OutputEntry>& amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_outs_for_amount& result_outs, uint64_t amount, size_t i);
     bool is_tx_spendtime_unlocked(uint64_t unlock_time);
-    size_t find_end_of_allowed_index(const std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs);
+    size_t find_end_of_allowed_index(const std::vector<OutputEntry>& amount_outs);
     bool check_block_timestamp_main(const Block& b);
     bool check_block_timestamp(std::vector<uint64_t> timestamps, const Block& b);
     uint64_t get_adjusted_time();
@@ -274,15 +354,26 @@ namespace CryptoNote {
     std::vector<Crypto::Hash> doBuildSparseChain(const Crypto::Hash& startBlockId) const;
     bool getBlockCumulativeSize(const Block& block, size_t& cumulativeSize);
     bool update_next_comulative_size_limit();
-    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height = NULL);
-    bool checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height = NULL);
+    bool areInputOutputsKnown(const Transaction& transaction);
+    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, std::vector<RingSignatureCheck>& ringSignatureChecks, uint32_t* pmax_related_block_height = NULL);
+    bool checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height = NULL, std::vector<RingSignatureCheck>* ringSignatureChecks = NULL);
+    bool checkRingSignatures(const std::vector<RingSignatureCheck>& ringSignatureChecks, Crypto::Hash& failedTransactionHash);
+    void verifyRingSignatures(const std::vector<RingSignatureCheck>& ringSignatureChecks, std::vector<uint8_t>& results);
+    bool isTransactionChecked(const Crypto::Hash& transactionHash, uint32_t maxUsedBlockHeight);
+    void addCheckedTransactions(const std::vector<std::pair<Crypto::Hash, uint32_t>>& transactions);
     bool checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height = NULL);
     bool have_tx_keyimg_as_spent(const Crypto::KeyImage &key_im);
     const TransactionEntry& transactionByIndex(TransactionIndex index);
+    void loadBlock(uint32_t height, Block& block);
+    static bool getBlockBlobInfo(const Block& block, const BinaryArray& blockBlob, BlockBlobInfo& blobInfo);
     bool pushBlock(const Block& blockData, block_verification_context& bvc);
-    bool pushBlock(const Block& blockData, const std::vector<Transaction>& transactions, block_verification_context& bvc);
-    bool pushBlock(BlockEntry& block);
+    bool pushBlock(const Block& blockData, const BinaryArray& blockBlob, const BlockBlobInfo& blobInfo, block_verification_context& bvc);
+    bool pushBlock(const Block& blockData, const BinaryArray& blockBlob, const BlockBlobInfo& blobInfo, const std::vector<Transaction>& transactions,
+      const std::vector<size_t>& transactionSizes, block_verification_context& bvc);
+    bool pushBlock(BlockEntry&& block);
+    bool pushBlock(BlockEntry&& block, const Crypto::Hash& blockHash, const BinaryArray& blockBlob);
     void popBlock(const Crypto::Hash& blockHash);
+    bool reapplyBlock(BlockEntry& block);
     bool pushTransaction(BlockEntry& block, const Crypto::Hash& transactionHash, TransactionIndex transactionIndex);
     void popTransaction(const Transaction& transaction, const Crypto::Hash& transactionHash);
     void popTransactions(const BlockEntry& block, const Crypto::Hash& minerTransactionHash);
@@ -291,12 +382,13 @@ namespace CryptoNote {
     bool storeBlockchainIndices();
     bool loadBlockchainIndices();
 
-    bool loadTransactions(const Block& block, std::vector<Transaction>& transactions);
+    bool loadTransactions(const Block& block, std::vector<Transaction>& transactions, std::vector<size_t>& transactionSizes);
     void saveTransactions(const std::vector<Transaction>& transactions);
 
     void sendMessage(const BlockchainMessage& message);
 
     friend class LockedBlockchainStorage;
+    friend class SharedLockedBlockchainStorage;
   };
 
   class LockedBlockchainStorage: boost::noncopyable {
@@ -312,17 +404,34 @@ namespace CryptoNote {
   private:
 
     Blockchain& m_bc;
-    std::lock_guard<std::recursive_mutex> m_lock;
+    std::lock_guard<Tools::RecursiveSharedMutex> m_lock;
+  };
+
+  // Keeps the blockchain unchanged for a sequence of queries, other readers are not blocked
+  class SharedLockedBlockchainStorage: boost::noncopyable {
+  public:
+
+    SharedLockedBlockchainStorage(Blockchain& bc)
+      : m_bc(bc), m_lock(bc.m_blockchain_lock) {}
+
+    Blockchain* operator -> () {
+      return &m_bc;
+    }
+
+  private:
+
+    Blockchain& m_bc;
+    Tools::SharedLockGuard m_lock;
   };
 
   template<class visitor_t> bool Blockchain::scanOutputKeysForIndexes(const KeyInput& tx_in_to_key, visitor_t& vis, uint32_t* pmax_related_block_height) {
-    std::lock_guard<std::recursive_mutex> lk(m_blockchain_lock);
+    Tools::SharedLockGuard lk(m_blockchain_lock);
     auto it = m_outputs.find(tx_in_to_key.amount);
     if (it == m_outputs.end() || !tx_in_to_key.outputIndexes.size())
       return false;
 
     std::vector<uint32_t> absolute_offsets = relative_output_offsets_to_absolute(tx_in_to_key.outputIndexes);
-    std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs_vec = it->second;
+    const std::vector<OutputEntry>& amount_outs_vec = it->second;
     size_t count = 0;
     for (uint64_t i : absolute_offsets) {
       if(i >= amount_outs_vec.size() ) {
@@ -330,27 +439,14 @@ namespace CryptoNote {
         return false;
       }
 
-      //auto tx_it = m_transactionMap.find(amount_outs_vec[i].first);
-      //if (!(tx_it != m_transactionMap.end())) { logger(ERROR, BRIGHT_RED) << "Wrong transaction id in output indexes: " << Common::podToHex(amount_outs_vec[i].first); return false; }
-
-      const TransactionEntry& tx = transactionByIndex(amount_outs_vec[i].first);
-
-      if (!(amount_outs_vec[i].second < tx.tx.outputs.size())) {
-        logger(Logging::ERROR, Logging::BRIGHT_RED)
-            << "Wrong index in transaction outputs: "
-            << amount_outs_vec[i].second << ", expected less then "
-            << tx.tx.outputs.size();
-        return false;
-      }
-
-      if (!vis.handle_output(tx.tx, tx.tx.outputs[amount_outs_vec[i].second], amount_outs_vec[i].second)) {
+      if (!vis.handle_output(amount_outs_vec[i])) {
         logger(Logging::INFO) << "Failed to handle_output for output no = " << count << ", with absolute offset " << i;
         return false;
       }
 
       if(count++ == absolute_offsets.size()-1 && pmax_related_block_height) {
-        if (*pmax_related_block_height < amount_outs_vec[i].first.block) {
-          *pmax_related_block_height = amount_outs_vec[i].first.block;
+        if (*pmax_related_block_height < amount_outs_vec[i].transactionIndex.block) {
+          *pmax_related_block_height = amount_outs_vec[i].transactionIndex.block;
         }
       }
     }
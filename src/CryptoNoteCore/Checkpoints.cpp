@@ -32,6 +32,16 @@ bool Checkpoints::is_in_checkpoint_zone(uint32_t  height) const {
   return !m_points.empty() && (height <= (--m_points.end())->first);
 }
 //---------------------------------------------------------------------------
+bool Checkpoints::get_last_checkpoint_height(uint32_t max_height, uint32_t &height) const {
+  auto it = m_points.upper_bound(max_height);
+  if (it == m_points.begin())
+    return false;
+
+  --it;
+  height = it->first;
+  return true;
+}
+//---------------------------------------------------------------------------
 bool Checkpoints::check_block(uint32_t  height, const Crypto::Hash &h,
                               bool &is_a_checkpoint) const {
   auto it = m_points.find(height);
@@ -16,6 +16,8 @@ namespace CryptoNote
 
     bool add_checkpoint(uint32_t height, const std::string& hash_str);
     bool is_in_checkpoint_zone(uint32_t height) const;
+    // highest checkpoint not above max_height, false if there is none
+    bool get_last_checkpoint_height(uint32_t max_height, uint32_t& height) const;
     bool check_block(uint32_t height, const Crypto::Hash& h) const;
     bool check_block(uint32_t height, const Crypto::Hash& h, bool& is_a_checkpoint) const;
     bool is_alternative_block_allowed(uint32_t blockchain_height, uint32_t block_height) const;
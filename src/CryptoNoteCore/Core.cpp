@@ -8,6 +8,7 @@
 #include <unordered_set>
 #include "../CryptoNoteConfig.h"
 #include "../Common/CommandLine.h"
+#include "../Common/ParallelFor.h"
 #include "../Common/Util.h"
 #include "../Common/StringTools.h"
 #include "../crypto/crypto.h"
@@ -29,6 +30,13 @@ using namespace  Common;
 
 namespace CryptoNote {
 
+namespace {
+
+// A template missing transactions that arrived in the pool meanwhile is still handed out for that many seconds
+const time_t BLOCK_TEMPLATE_REFRESH_INTERVAL = 5;
+
+}
+
 class BlockWithTransactions : public IBlock {
 public:
   virtual const Block& getBlock() const override {
@@ -57,7 +65,9 @@ logger(logger, "core"),
 m_mempool(currency, m_blockchain, m_timeProvider, logger),
 m_blockchain(currency, m_mempool, logger),
 m_miner(new miner(currency, *this, logger)),
-m_starter_message_showed(false) {
+m_starter_message_showed(false),
+m_blockTemplateInvalidated(false) {
+  m_blockTemplate.valid = false;
   set_cryptonote_protocol(pprotocol);
   m_blockchain.addObserver(this);
     m_mempool.addObserver(this);
@@ -116,12 +126,13 @@ size_t core::get_alternative_blocks_count() {
   //-----------------------------------------------------------------------------------------------
   bool core::init(const CoreConfig& config, const MinerConfig& minerConfig, bool load_existing) {
     m_config_folder = config.configFolder;
-    bool r = m_mempool.init(m_config_folder);
-  if (!(r)) { logger(ERROR, BRIGHT_RED) << "Failed to initialize memory pool"; return false; }
-
-  r = m_blockchain.init(m_config_folder, load_existing);
+    // the transactions of the pool are checked against the chain when loaded
+    bool r = m_blockchain.init(m_config_folder, load_existing, config.snapshotFile);
   if (!(r)) { logger(ERROR, BRIGHT_RED) << "Failed to initialize blockchain storage"; return false; }
 
+  r = m_mempool.init(m_config_folder);
+  if (!(r)) { logger(ERROR, BRIGHT_RED) << "Failed to initialize memory pool"; return false; }
+
     r = m_miner->init(minerConfig);
   if (!(r)) { logger(ERROR, BRIGHT_RED) << "Failed to initialize blockchain storage"; return false; }
 
@@ -183,28 +194,99 @@ size_t core::addChain(const std::vector<const IBlock*>& chain) {
   return blocksCounter;
 }
 
+void core::computeProofsOfWork(const std::vector<Block>& blocks) {
+  m_blockchain.computeProofsOfWork(blocks);
+}
+
+// The transactions are parsed on all cores, those which are neither in the pool nor in the chain are checked by the
+// blockchain. Failures are not reported, the transactions are checked again when their block is added.
+void core::precheckTransactions(const std::vector<BinaryArray>& transactionBlobs) {
+  std::vector<Transaction> transactions(transactionBlobs.size());
+  std::vector<Crypto::Hash> transactionHashes(transactionBlobs.size());
+  std::vector<uint8_t> parsed(transactionBlobs.size());
+  Tools::parallelFor(transactionBlobs.size(), std::max(std::thread::hardware_concurrency(), 1u), [&](size_t i) {
+    tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+    parsed[i] = parseIncomingTransaction(transactionBlobs[i], transactions[i], transactionHashes[i], tvc);
+  });
+
+  std::vector<const Transaction*> newTransactions;
+  for (size_t i = 0; i < transactions.size(); ++i) {
+    if (parsed[i] && !m_mempool.have_tx(transactionHashes[i]) && !m_blockchain.haveTransaction(transactionHashes[i])) {
+      newTransactions.push_back(&transactions[i]);
+    }
+  }
+
+  m_blockchain.precheckTransactions(newTransactions);
+}
+
 bool core::handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_context& tvc, bool keeped_by_block) { //Deprecated. Should be removed with CryptoNoteProtocolHandler.
   tvc = boost::value_initialized<tx_verification_context>();
   //want to process all transactions sequentially
 
-  if (tx_blob.size() > m_currency.maxTxSize()) {
-    logger(INFO) << "WRONG TRANSACTION BLOB, too big size " << tx_blob.size() << ", rejected";
-    tvc.m_verifivation_failed = true;
+  Crypto::Hash tx_hash = NULL_HASH;
+  Transaction tx;
+  if (!parseIncomingTransaction(tx_blob, tx, tx_hash, tvc)) {
     return false;
   }
 
-  Crypto::Hash tx_hash = NULL_HASH;
-  Crypto::Hash tx_prefixt_hash = NULL_HASH;
-  Transaction tx;
+  return handleIncomingTransaction(tx, tx_hash, tx_blob.size(), tvc, keeped_by_block);
+}
+
+// The transactions are parsed and checked on all cores, then the inputs of the new ones are resolved and their ring
+// signatures checked in parallel. Adding them to the pool one by one then finds their ring signatures checked.
+void core::handleIncomingTransactions(const std::vector<BinaryArray>& transactionBlobs, std::vector<tx_verification_context>& results) {
+  std::vector<Transaction> transactions(transactionBlobs.size());
+  std::vector<Crypto::Hash> transactionHashes(transactionBlobs.size());
+  std::vector<uint8_t> checked(transactionBlobs.size());
+  results.assign(transactionBlobs.size(), boost::value_initialized<tx_verification_context>());
+
+  Tools::parallelFor(transactionBlobs.size(), std::max(std::thread::hardware_concurrency(), 1u), [&](size_t i) {
+    checked[i] = parseIncomingTransaction(transactionBlobs[i], transactions[i], transactionHashes[i], results[i]) &&
+      checkIncomingTransaction(transactions[i], transactionHashes[i], results[i], false);
+  });
+
+  std::vector<size_t> newTransactionIndexes;
+  std::vector<const Transaction*> newTransactions;
+  for (size_t i = 0; i < transactions.size(); ++i) {
+    if (checked[i] && !m_mempool.have_tx(transactionHashes[i]) && !m_blockchain.haveTransaction(transactionHashes[i])) {
+      newTransactionIndexes.push_back(i);
+      newTransactions.push_back(&transactions[i]);
+    }
+  }
 
-  if (!parse_tx_from_blob(tx, tx_hash, tx_prefixt_hash, tx_blob)) {
+  std::vector<uint8_t> inputsValid;
+  m_blockchain.checkTransactionsInputs(newTransactions, inputsValid);
+  for (size_t i = 0; i < newTransactions.size(); ++i) {
+    if (!inputsValid[i]) {
+      size_t index = newTransactionIndexes[i];
+      logger(INFO) << "Transaction " << transactionHashes[index] << " used wrong inputs, rejected";
+      results[index].m_verifivation_failed = true;
+      checked[index] = false;
+    }
+  }
+
+  for (size_t i = 0; i < transactions.size(); ++i) {
+    if (checked[i]) {
+      addIncomingTransaction(transactions[i], transactionHashes[i], transactionBlobs[i].size(), results[i], false);
+    }
+  }
+}
+
+bool core::parseIncomingTransaction(const BinaryArray& transactionBlob, Transaction& tx, Crypto::Hash& txHash, tx_verification_context& tvc) {
+  if (transactionBlob.size() > m_currency.maxTxSize()) {
+    logger(INFO) << "WRONG TRANSACTION BLOB, too big size " << transactionBlob.size() << ", rejected";
+    tvc.m_verifivation_failed = true;
+    return false;
+  }
+
+  Crypto::Hash txPrefixHash = NULL_HASH;
+  if (!parse_tx_from_blob(tx, txHash, txPrefixHash, transactionBlob)) {
     logger(INFO) << "WRONG TRANSACTION BLOB, Failed to parse, rejected";
     tvc.m_verifivation_failed = true;
     return false;
   }
-  //std::cout << "!"<< tx.inputs.size() << std::endl;
 
-  return handleIncomingTransaction(tx, tx_hash, tx_blob.size(), tvc, keeped_by_block);
+  return true;
 }
 
 bool core::get_stat_info(core_stat_info& st_inf) {
@@ -300,37 +382,105 @@ bool core::add_new_tx(const Transaction& tx, const Crypto::Hash& tx_hash, size_t
   return m_mempool.add_tx(tx, tx_hash, blob_size, tvc, keeped_by_block);
 }
 
-bool core::get_block_template(Block& b, const AccountPublicAddress& adr, difficulty_type& diffic, uint32_t& height, const BinaryArray& ex_nonce) {
-  size_t median_size;
-  uint64_t already_generated_coins;
+bool core::isBlockTemplateUpToDate() {
+  if (m_blockTemplateInvalidated.exchange(false)) {
+    m_blockTemplate.valid = false;
+  }
+
+  if (!m_blockTemplate.valid || m_blockTemplate.block.previousBlockHash != m_blockchain.getTailId()) {
+    return false;
+  }
+
+  return !m_blockTemplate.outdated || time(NULL) - m_blockTemplate.creationTime < BLOCK_TEMPLATE_REFRESH_INTERVAL;
+}
+
+bool core::updateBlockTemplate() {
+  CachedBlockTemplate& t = m_blockTemplate;
+  t.valid = false;
 
   {
-    LockedBlockchainStorage blockchainLock(m_blockchain);
-    height = m_blockchain.getCurrentBlockchainHeight();
-    diffic = m_blockchain.getDifficultyForNextBlock();
-    if (!(diffic)) {
+    SharedLockedBlockchainStorage blockchainLock(m_blockchain);
+    t.height = m_blockchain.getCurrentBlockchainHeight();
+    t.difficulty = m_blockchain.getDifficultyForNextBlock();
+    if (!(t.difficulty)) {
       logger(ERROR, BRIGHT_RED) << "difficulty overhead.";
       return false;
     }
 
-    b = boost::value_initialized<Block>();
-    b.majorVersion = BLOCK_MAJOR_VERSION_1;
-    b.minorVersion = BLOCK_MINOR_VERSION_0;
+    t.block = boost::value_initialized<Block>();
+    t.block.majorVersion = BLOCK_MAJOR_VERSION_1;
+    t.block.minorVersion = BLOCK_MINOR_VERSION_0;
+
+    t.block.previousBlockHash = get_tail_id();
+
+    t.medianSize = m_blockchain.getCurrentCumulativeBlocksizeLimit() / 2;
+    t.alreadyGeneratedCoins = m_blockchain.getCoinsInCirculation();
+  }
 
-    b.previousBlockHash = get_tail_id();
-    b.timestamp = time(NULL);
+  // Same limit as tx_memory_pool::fill_block_template applies to transactions with a fee
+  size_t maxCumulativeSize = m_currency.maxBlockCumulativeSize(t.height);
+  t.maxTransactionsSize = std::min(2 * t.medianSize - m_currency.minerTxBlobReservedSize(), maxCumulativeSize);
+  if (!m_mempool.fill_block_template(t.block, t.medianSize, maxCumulativeSize, t.alreadyGeneratedCoins, t.transactionsSize, t.fee)) {
+    return false;
+  }
 
-    median_size = m_blockchain.getCurrentCumulativeBlocksizeLimit() / 2;
-    already_generated_coins = m_blockchain.getCoinsInCirculation();
+  t.creationTime = time(NULL);
+  t.outdated = false;
+  t.valid = true;
+  return true;
+}
+
+// Transactions accepted by the pool on top of the template's parent don't conflict with the pool and are ready to go,
+// unless they came from an alternative block. Those and fusion transactions, which have a separate size limit, as well
+// as transactions checked against another tail wait for the next rebuild.
+void core::addToBlockTemplate(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, const tx_verification_context& tvc,
+  bool keptByBlock, const Crypto::Hash& tailId) {
+  std::lock_guard<std::mutex> lock(m_blockTemplateLock);
+  if (!m_blockTemplate.valid) {
+    return;
   }
 
+  // The template may have been rebuilt from the pool after the transaction was added
+  auto& txHashes = m_blockTemplate.block.transactionHashes;
+  if (std::find(txHashes.begin(), txHashes.end(), txHash) != txHashes.end()) {
+    return;
+  }
+
+  uint64_t fee = 0;
+  if (keptByBlock || tvc.m_verifivation_impossible || tailId != m_blockTemplate.block.previousBlockHash ||
+    !get_tx_fee(tx, fee) || fee == 0 || m_blockTemplate.transactionsSize + blobSize > m_blockTemplate.maxTransactionsSize) {
+    m_blockTemplate.outdated = true;
+    return;
+  }
+
+  txHashes.push_back(txHash);
+  m_blockTemplate.transactionsSize += blobSize;
+  m_blockTemplate.fee += fee;
+}
+
+bool core::get_block_template(Block& b, const AccountPublicAddress& adr, difficulty_type& diffic, uint32_t& height, const BinaryArray& ex_nonce) {
+  size_t median_size;
+  uint64_t already_generated_coins;
   size_t txs_size;
   uint64_t fee;
-  if (!m_mempool.fill_block_template(b, median_size, m_currency.maxBlockCumulativeSize(height), already_generated_coins,
-    txs_size, fee)) {
-    return false;
+
+  {
+    std::lock_guard<std::mutex> lock(m_blockTemplateLock);
+    if (!isBlockTemplateUpToDate() && !updateBlockTemplate()) {
+      return false;
+    }
+
+    b = m_blockTemplate.block;
+    diffic = m_blockTemplate.difficulty;
+    height = m_blockTemplate.height;
+    median_size = m_blockTemplate.medianSize;
+    already_generated_coins = m_blockTemplate.alreadyGeneratedCoins;
+    txs_size = m_blockTemplate.transactionsSize;
+    fee = m_blockTemplate.fee;
   }
 
+  b.timestamp = time(NULL);
+
   /*
      two-phase miner transaction generation: we don't know exact block size until we prepare block, but we don't know reward until we know
      block size, so first miner transaction generated with fake amount of money, and with phase we know think we know expected block size
@@ -401,6 +551,10 @@ void core::print_blockchain_outs(const std::string& file) {
   m_blockchain.print_blockchain_outs(file);
 }
 
+bool core::export_snapshot(const std::string& file) {
+  return m_blockchain.exportSnapshot(file);
+}
+
 bool core::get_random_outs_for_amounts(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res) {
   return m_blockchain.getRandomOutsByAmount(req, res);
 }
@@ -424,7 +578,7 @@ void core::update_block_template_and_resume_mining() {
 
 bool core::handle_block_found(Block& b) {
   block_verification_context bvc = boost::value_initialized<block_verification_context>();
-  handle_incoming_block(b, bvc, true, true);
+  handle_incoming_block(b, toBinaryArray(b), bvc, true, true);
 
   if (bvc.m_verifivation_failed) {
     logger(ERROR) << "mined block failed verification";
@@ -483,15 +637,15 @@ bool core::handle_incoming_block_blob(const BinaryArray& block_blob, block_verif
     return false;
   }
 
-  return handle_incoming_block(b, bvc, control_miner, relay_block);
+  return handle_incoming_block(b, block_blob, bvc, control_miner, relay_block);
 }
 
-bool core::handle_incoming_block(const Block& b, block_verification_context& bvc, bool control_miner, bool relay_block) {
+bool core::handle_incoming_block(const Block& b, const BinaryArray& blockBlob, block_verification_context& bvc, bool control_miner, bool relay_block) {
   if (control_miner) {
     pause_mining();
   }
 
-  m_blockchain.addNewBlock(b, bvc);
+  m_blockchain.addNewBlock(b, blockBlob, bvc);
 
   if (control_miner) {
     update_block_template_and_resume_mining();
@@ -512,10 +666,7 @@ bool core::handle_incoming_block(const Block& b, block_verification_context& bvc
       NOTIFY_NEW_BLOCK::request arg;
       arg.hop = 0;
       arg.current_blockchain_height = m_blockchain.getCurrentBlockchainHeight();
-      BinaryArray blockBa;
-      bool r = toBinaryArray(b, blockBa);
-      if (!(r)) { logger(ERROR, BRIGHT_RED) << "failed to serialize block"; return false; }
-      arg.b.block = asString(blockBa);
+      arg.b.block = asString(blockBlob);
       for (auto& tx : txs) {
         arg.b.txs.push_back(asString(toBinaryArray(tx)));
       }
@@ -535,10 +686,26 @@ size_t core::get_pool_transactions_count() {
   return m_mempool.get_transactions_count();
 }
 
+size_t core::get_pool_transactions_size() {
+  return m_mempool.getTransactionsSize();
+}
+
+uint64_t core::get_pool_evicted_transactions_count() {
+  return m_mempool.getEvictedTransactionsCount();
+}
+
+uint64_t core::get_pool_minimum_fee() {
+  return m_mempool.getMinimumFee();
+}
+
 bool core::have_block(const Crypto::Hash& id) {
   return m_blockchain.haveBlock(id);
 }
 
+bool core::haveTransaction(const Crypto::Hash& id) {
+  return m_mempool.have_tx(id) || m_blockchain.haveTransaction(id);
+}
+
 bool core::parse_tx_from_blob(Transaction& tx, Crypto::Hash& tx_hash, Crypto::Hash& tx_prefix_hash, const BinaryArray& blob) {
   return parseAndValidateTransactionFromBinaryArray(blob, tx, tx_hash, tx_prefix_hash);
 }
@@ -558,13 +725,17 @@ std::vector<Transaction> core::getPoolTransactions() {
   return result;
 }
 
+void core::getPoolTransactions(const std::vector<Crypto::Hash>& txs_ids, std::vector<Transaction>& txs, std::vector<Crypto::Hash>& missed_txs) {
+  m_mempool.getTransactions(txs_ids, txs, missed_txs);
+}
+
 std::vector<Crypto::Hash> core::buildSparseChain() {
   assert(m_blockchain.getCurrentBlockchainHeight() != 0);
   return m_blockchain.buildSparseChain();
 }
 
 std::vector<Crypto::Hash> core::buildSparseChain(const Crypto::Hash& startBlockId) {
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
   assert(m_blockchain.haveBlock(startBlockId));
   return m_blockchain.buildSparseChain(startBlockId);
 }
@@ -574,7 +745,7 @@ bool core::handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_R
 }
 
 Crypto::Hash core::getBlockIdByHeight(uint32_t height) {
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
   if (height < m_blockchain.getCurrentBlockchainHeight()) {
     return m_blockchain.getBlockIdByHeight(height);
   } else {
@@ -635,6 +806,7 @@ void core::blockchainUpdated() {
 }
 
 void core::txDeletedFromPool() {
+  m_blockTemplateInvalidated = true;
   poolUpdated();
 }
 
@@ -645,7 +817,7 @@ void core::poolUpdated() {
 bool core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
   uint32_t& resStartHeight, uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<BlockFullInfo>& entries) {
 
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
 
   uint32_t currentHeight = lbs->getCurrentBlockchainHeight();
   uint32_t startOffset = 0;
@@ -702,7 +874,7 @@ bool core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t
 }
 
 bool core::findStartAndFullOffsets(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t& startOffset, uint32_t& startFullOffset) {
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
 
   if (knownBlockIds.empty()) {
     logger(ERROR, BRIGHT_RED) << "knownBlockIds is empty";
@@ -725,7 +897,7 @@ bool core::findStartAndFullOffsets(const std::vector<Crypto::Hash>& knownBlockId
 std::vector<Crypto::Hash> core::findIdsForShortBlocks(uint32_t startOffset, uint32_t startFullOffset) {
   assert(startOffset <= startFullOffset);
 
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
 
   std::vector<Crypto::Hash> result;
   if (startOffset < startFullOffset) {
@@ -737,7 +909,7 @@ std::vector<Crypto::Hash> core::findIdsForShortBlocks(uint32_t startOffset, uint
 
 bool core::queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t& resStartHeight,
   uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<BlockShortInfo>& entries) {
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
 
   resCurrentHeight = lbs->getCurrentBlockchainHeight();
   resStartHeight = 0;
@@ -809,20 +981,7 @@ bool core::getBlockReward(uint32_t blockHeight, size_t medianSize, size_t curren
 }
 
 bool core::scanOutputkeysForIndices(const KeyInput& txInToKey, std::list<std::pair<Crypto::Hash, size_t>>& outputReferences) {
-  struct outputs_visitor
-  {
-    std::list<std::pair<Crypto::Hash, size_t>>& m_resultsCollector;
-    outputs_visitor(std::list<std::pair<Crypto::Hash, size_t>>& resultsCollector):m_resultsCollector(resultsCollector){}
-    bool handle_output(const Transaction& tx, const TransactionOutput& out, size_t transactionOutputIndex)
-    {
-      m_resultsCollector.push_back(std::make_pair(getObjectHash(tx), transactionOutputIndex));
-      return true;
-    }
-  };
-    
-  outputs_visitor vi(outputReferences);
-    
-  return m_blockchain.scanOutputKeysForIndexes(txInToKey, vi);
+  return m_blockchain.getKeyOutputReferences(txInToKey, outputReferences);
 }
 
 bool core::getBlockDifficulty(uint32_t height, difficulty_type& difficulty) {
@@ -927,6 +1086,14 @@ uint64_t core::getTotalGeneratedAmount() {
 }
 
 bool core::handleIncomingTransaction(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keptByBlock) {
+  if (!checkIncomingTransaction(tx, txHash, tvc, keptByBlock)) {
+    return false;
+  }
+
+  return addIncomingTransaction(tx, txHash, blobSize, tvc, keptByBlock);
+}
+
+bool core::checkIncomingTransaction(const Transaction& tx, const Crypto::Hash& txHash, tx_verification_context& tvc, bool keptByBlock) {
   if (!check_tx_syntax(tx)) {
     logger(INFO) << "WRONG TRANSACTION BLOB, Failed to check tx " << txHash << " syntax, rejected";
     tvc.m_verifivation_failed = true;
@@ -939,6 +1106,11 @@ bool core::handleIncomingTransaction(const Transaction& tx, const Crypto::Hash&
     return false;
   }
 
+  return true;
+}
+
+bool core::addIncomingTransaction(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keptByBlock) {
+  Crypto::Hash tailId = m_blockchain.getTailId();
   bool r = add_new_tx(tx, txHash, blobSize, tvc, keptByBlock);
   if (tvc.m_verifivation_failed) {
     if (!tvc.m_tx_fee_too_small) {
@@ -952,6 +1124,7 @@ bool core::handleIncomingTransaction(const Transaction& tx, const Crypto::Hash&
 
   if (tvc.m_added_to_pool) {
     logger(DEBUGGING) << "tx added: " << txHash;
+    addToBlockTemplate(tx, txHash, blobSize, tvc, keptByBlock, tailId);
     poolUpdated();
   }
 
@@ -960,7 +1133,7 @@ bool core::handleIncomingTransaction(const Transaction& tx, const Crypto::Hash&
 
 std::unique_ptr<IBlock> core::getBlock(const Crypto::Hash& blockId) {
   std::lock_guard<decltype(m_mempool)> lk(m_mempool);
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
 
   std::unique_ptr<BlockWithTransactions> blockPtr(new BlockWithTransactions());
   if (!lbs->getBlockByHash(blockId, blockPtr->block)) {
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <mutex>
+
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
 
@@ -37,6 +39,7 @@ namespace CryptoNote {
 
      bool on_idle() override;
      virtual bool handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_context& tvc, bool keeped_by_block) override; //Deprecated. Should be removed with CryptoNoteProtocolHandler.
+     virtual void handleIncomingTransactions(const std::vector<BinaryArray>& transactionBlobs, std::vector<tx_verification_context>& results) override;
      bool handle_incoming_block_blob(const BinaryArray& block_blob, block_verification_context& bvc, bool control_miner, bool relay_block) override;
      virtual i_cryptonote_protocol* get_protocol() override {return m_pprotocol;}
      const Currency& currency() const { return m_currency; }
@@ -56,6 +59,8 @@ namespace CryptoNote {
 
      // ICore
      virtual size_t addChain(const std::vector<const IBlock*>& chain) override;
+     virtual void computeProofsOfWork(const std::vector<Block>& blocks) override;
+     virtual void precheckTransactions(const std::vector<BinaryArray>& transactionBlobs) override;
      virtual bool handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS_request& arg, NOTIFY_RESPONSE_GET_OBJECTS_request& rsp) override; //Deprecated. Should be removed with CryptoNoteProtocolHandler.
      virtual bool getBackwardBlocksSizes(uint32_t fromHeight, std::vector<size_t>& sizes, size_t count) override;
      virtual bool getBlockSize(const Crypto::Hash& hash, size_t& size) override;
@@ -81,6 +86,7 @@ namespace CryptoNote {
 
      uint32_t get_current_blockchain_height();
      bool have_block(const Crypto::Hash& id) override;
+     virtual bool haveTransaction(const Crypto::Hash& id) override;
      std::vector<Crypto::Hash> buildSparseChain() override;
      std::vector<Crypto::Hash> buildSparseChain(const Crypto::Hash& startBlockId) override;
      void on_synchronized() override;
@@ -110,7 +116,11 @@ namespace CryptoNote {
      void set_checkpoints(Checkpoints&& chk_pts);
 
      std::vector<Transaction> getPoolTransactions() override;
+     void getPoolTransactions(const std::vector<Crypto::Hash>& txs_ids, std::vector<Transaction>& txs, std::vector<Crypto::Hash>& missed_txs) override;
      size_t get_pool_transactions_count();
+     size_t get_pool_transactions_size();
+     uint64_t get_pool_evicted_transactions_count();
+     uint64_t get_pool_minimum_fee();
      size_t get_blockchain_total_transactions();
      //bool get_outs(uint64_t amount, std::list<Crypto::PublicKey>& pkeys);
      virtual std::vector<Crypto::Hash> findBlockchainSupplement(const std::vector<Crypto::Hash>& remoteBlockIds, size_t maxCount,
@@ -128,6 +138,7 @@ namespace CryptoNote {
      void print_blockchain_index();
      std::string print_pool(bool short_format);
      void print_blockchain_outs(const std::string& file);
+     bool export_snapshot(const std::string& file);
      virtual bool getPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
                                  std::vector<Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) override;
      virtual bool getPoolChangesLite(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
@@ -139,10 +150,34 @@ namespace CryptoNote {
      uint64_t getTotalGeneratedAmount();
 
    private:
+     // The part of a block template shared by all miners, only the timestamp and the base transaction differ
+     struct CachedBlockTemplate {
+       Block block;
+       difficulty_type difficulty;
+       uint32_t height;
+       size_t medianSize;
+       size_t maxTransactionsSize;
+       uint64_t alreadyGeneratedCoins;
+       size_t transactionsSize;
+       uint64_t fee;
+       time_t creationTime;
+       bool valid;
+       // Set when the pool got a transaction that could not be appended, the template is rebuilt after a while
+       bool outdated;
+     };
+
+     bool isBlockTemplateUpToDate();
+     bool updateBlockTemplate();
+     void addToBlockTemplate(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, const tx_verification_context& tvc,
+       bool keptByBlock, const Crypto::Hash& tailId);
+
      bool add_new_tx(const Transaction& tx, const Crypto::Hash& tx_hash, size_t blob_size, tx_verification_context& tvc, bool keeped_by_block);
+     bool parseIncomingTransaction(const BinaryArray& transactionBlob, Transaction& tx, Crypto::Hash& txHash, tx_verification_context& tvc);
+     bool checkIncomingTransaction(const Transaction& tx, const Crypto::Hash& txHash, tx_verification_context& tvc, bool keptByBlock);
+     bool addIncomingTransaction(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keptByBlock);
      bool load_state_data();
      bool parse_tx_from_blob(Transaction& tx, Crypto::Hash& tx_hash, Crypto::Hash& tx_prefix_hash, const BinaryArray& blob);
-     bool handle_incoming_block(const Block& b, block_verification_context& bvc, bool control_miner, bool relay_block);
+     bool handle_incoming_block(const Block& b, const BinaryArray& blockBlob, block_verification_context& bvc, bool control_miner, bool relay_block);
 
      bool check_tx_syntax(const Transaction& tx);
      //check correct values, amounts and all lightweight checks not related with database
@@ -176,5 +211,9 @@ namespace CryptoNote {
      friend class tx_validate_inputs;
      std::atomic<bool> m_starter_message_showed;
      Tools::ObserverManager<ICoreObserver> m_observerManager;
+     std::mutex m_blockTemplateLock;
+     CachedBlockTemplate m_blockTemplate;
+     // Set by the pool observer, which must not wait for m_blockTemplateLock
+     std::atomic<bool> m_blockTemplateInvalidated;
    };
 }
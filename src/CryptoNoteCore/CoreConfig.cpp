@@ -9,6 +9,10 @@
 
 namespace CryptoNote {
 
+namespace {
+const command_line::arg_descriptor<std::string> arg_load_snapshot = {"load-snapshot", "Start from a blockchain snapshot file instead of an empty blockchain and sync only the rest", ""};
+}
+
 CoreConfig::CoreConfig() {
   configFolder = Tools::getDefaultDataDirectory();
 }
@@ -18,8 +22,13 @@ void CoreConfig::init(const boost::program_options::variables_map& options) {
     configFolder = command_line::get_arg(options, command_line::arg_data_dir);
     configFolderDefaulted = options[command_line::arg_data_dir.name].defaulted();
   }
+
+  if (command_line::has_arg(options, arg_load_snapshot)) {
+    snapshotFile = command_line::get_arg(options, arg_load_snapshot);
+  }
 }
 
 void CoreConfig::initOptions(boost::program_options::options_description& desc) {
+  command_line::add_arg(desc, arg_load_snapshot);
 }
 } //namespace CryptoNote
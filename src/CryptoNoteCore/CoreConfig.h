@@ -19,6 +19,7 @@ public:
 
   std::string configFolder;
   bool configFolderDefaulted = true;
+  std::string snapshotFile;
 };
 
 } //namespace CryptoNote
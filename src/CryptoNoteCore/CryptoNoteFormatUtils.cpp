@@ -474,6 +474,17 @@ bool get_block_longhash(cn_context &context, const Block& b, Hash& res) {
   return true;
 }
 
+bool get_block_longhash(cn_context &context0, cn_context &context1, const Block& b0, const Block& b1, Hash& res0, Hash& res1) {
+  BinaryArray bd0;
+  BinaryArray bd1;
+  if (!get_block_hashing_blob(b0, bd0) || !get_block_hashing_blob(b1, bd1)) {
+    return false;
+  }
+
+  cn_slow_hash(context0, context1, bd0.data(), bd0.size(), bd1.data(), bd1.size(), res0, res1);
+  return true;
+}
+
 std::vector<uint32_t> relative_output_offsets_to_absolute(const std::vector<uint32_t>& off) {
   std::vector<uint32_t> res = off;
   for (size_t i = 1; i < res.size(); i++)
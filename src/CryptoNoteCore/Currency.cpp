@@ -62,6 +62,7 @@ bool Currency::init() {
     m_blocksCacheFileName = "testnet_" + m_blocksCacheFileName;
     m_blockIndexesFileName = "testnet_" + m_blockIndexesFileName;
     m_txPoolFileName = "testnet_" + m_txPoolFileName;
+    m_txPoolJournalFileName = "testnet_" + m_txPoolJournalFileName;
     m_blockchinIndicesFileName = "testnet_" + m_blockchinIndicesFileName;
   }
 
@@ -380,6 +381,11 @@ difficulty_type Currency::nextDifficulty(std::vector<uint64_t> timestamps,
   sort(timestamps.begin(), timestamps.end());
 
   size_t cutBegin, cutEnd;
+  getDifficultyCut(length, cutBegin, cutEnd);
+  return nextDifficulty(timestamps[cutEnd - 1] - timestamps[cutBegin], cumulativeDifficulties[cutEnd - 1] - cumulativeDifficulties[cutBegin]);
+}
+
+void Currency::getDifficultyCut(size_t length, size_t& cutBegin, size_t& cutEnd) const {
   assert(2 * m_difficultyCut <= m_difficultyWindow - 2);
   if (length <= m_difficultyWindow - 2 * m_difficultyCut) {
     cutBegin = 0;
@@ -389,12 +395,13 @@ difficulty_type Currency::nextDifficulty(std::vector<uint64_t> timestamps,
     cutEnd = cutBegin + (m_difficultyWindow - 2 * m_difficultyCut);
   }
   assert(/*cut_begin >= 0 &&*/ cutBegin + 2 <= cutEnd && cutEnd <= length);
-  uint64_t timeSpan = timestamps[cutEnd - 1] - timestamps[cutBegin];
+}
+
+difficulty_type Currency::nextDifficulty(uint64_t timeSpan, difficulty_type totalWork) const {
   if (timeSpan == 0) {
     timeSpan = 1;
   }
 
-  difficulty_type totalWork = cumulativeDifficulties[cutEnd - 1] - cumulativeDifficulties[cutBegin];
   assert(totalWork > 0);
 
   uint64_t low, high;
@@ -416,6 +423,16 @@ bool Currency::checkProofOfWork(Crypto::cn_context& context, const Block& block,
   return check_hash(proofOfWork, currentDiffic);
 }
 
+bool Currency::checkProofOfWork(Crypto::cn_context& context0, Crypto::cn_context& context1, const Block& block0, const Block& block1,
+  difficulty_type diffic0, difficulty_type diffic1, Crypto::Hash& proofOfWork0, Crypto::Hash& proofOfWork1) const {
+
+  if (!get_block_longhash(context0, context1, block0, block1, proofOfWork0, proofOfWork1)) {
+    return false;
+  }
+
+  return check_hash(proofOfWork0, diffic0) && check_hash(proofOfWork1, diffic1);
+}
+
 size_t Currency::getApproximateMaximumInputCount(size_t transactionSize, size_t outputCount, size_t mixinCount) const {
   const size_t KEY_IMAGE_SIZE = sizeof(Crypto::KeyImage);
   const size_t OUTPUT_KEY_SIZE = sizeof(decltype(KeyOutput::key));
@@ -476,6 +493,7 @@ CurrencyBuilder::CurrencyBuilder(Logging::ILogger& log) : m_currency(log) {
   mempoolTxLiveTime(parameters::CRYPTONOTE_MEMPOOL_TX_LIVETIME);
   mempoolTxFromAltBlockLiveTime(parameters::CRYPTONOTE_MEMPOOL_TX_FROM_ALT_BLOCK_LIVETIME);
   numberOfPeriodsToForgetTxDeletedFromPool(parameters::CRYPTONOTE_NUMBER_OF_PERIODS_TO_FORGET_TX_DELETED_FROM_POOL);
+  mempoolMaxSize(parameters::CRYPTONOTE_MEMPOOL_MAX_SIZE);
 
   fusionTxMaxSize(parameters::FUSION_TX_MAX_SIZE);
   fusionTxMinInputCount(parameters::FUSION_TX_MIN_INPUT_COUNT);
@@ -485,6 +503,7 @@ CurrencyBuilder::CurrencyBuilder(Logging::ILogger& log) : m_currency(log) {
   blocksCacheFileName(parameters::CRYPTONOTE_BLOCKSCACHE_FILENAME);
   blockIndexesFileName(parameters::CRYPTONOTE_BLOCKINDEXES_FILENAME);
   txPoolFileName(parameters::CRYPTONOTE_POOLDATA_FILENAME);
+  txPoolJournalFileName(parameters::CRYPTONOTE_POOL_JOURNAL_FILENAME);
   blockchinIndicesFileName(parameters::CRYPTONOTE_BLOCKCHAIN_INDICES_FILENAME);
 
   testnet(false);
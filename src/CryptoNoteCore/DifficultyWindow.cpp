@@ -0,0 +1,85 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "DifficultyWindow.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "Currency.h"
+
+namespace CryptoNote {
+
+DifficultyWindow::DifficultyWindow(const Currency& currency) : m_currency(currency) {
+}
+
+size_t DifficultyWindow::size() const {
+  return m_entries.size();
+}
+
+bool DifficultyWindow::empty() const {
+  return m_entries.empty();
+}
+
+void DifficultyWindow::clear() {
+  m_entries.clear();
+  m_sortedTimestamps.clear();
+}
+
+void DifficultyWindow::push_back(uint64_t timestamp, difficulty_type cumulativeDifficulty) {
+  m_entries.push_back({ timestamp, cumulativeDifficulty });
+  if (m_entries.size() <= m_currency.difficultyWindow()) {
+    insertTimestamp(timestamp);
+  }
+
+  if (m_entries.size() > m_currency.difficultyBlocksCount()) {
+    eraseTimestamp(m_entries.front().timestamp);
+    m_entries.pop_front();
+    insertTimestamp(m_entries[m_currency.difficultyWindow() - 1].timestamp);
+  }
+}
+
+void DifficultyWindow::pop_back() {
+  assert(!m_entries.empty());
+  if (m_entries.size() <= m_currency.difficultyWindow()) {
+    eraseTimestamp(m_entries.back().timestamp);
+  }
+
+  m_entries.pop_back();
+}
+
+void DifficultyWindow::push_front(uint64_t timestamp, difficulty_type cumulativeDifficulty) {
+  assert(m_entries.size() < m_currency.difficultyBlocksCount());
+  if (m_entries.size() >= m_currency.difficultyWindow()) {
+    eraseTimestamp(m_entries[m_currency.difficultyWindow() - 1].timestamp);
+  }
+
+  m_entries.push_front({ timestamp, cumulativeDifficulty });
+  insertTimestamp(timestamp);
+}
+
+// Same result as Currency::nextDifficulty for the timestamps and cumulative difficulties of the window
+difficulty_type DifficultyWindow::nextDifficulty() const {
+  size_t length = m_sortedTimestamps.size();
+  if (length <= 1) {
+    return 1;
+  }
+
+  size_t cutBegin, cutEnd;
+  m_currency.getDifficultyCut(length, cutBegin, cutEnd);
+  return m_currency.nextDifficulty(m_sortedTimestamps[cutEnd - 1] - m_sortedTimestamps[cutBegin],
+    m_entries[cutEnd - 1].cumulativeDifficulty - m_entries[cutBegin].cumulativeDifficulty);
+}
+
+void DifficultyWindow::insertTimestamp(uint64_t timestamp) {
+  m_sortedTimestamps.insert(std::upper_bound(m_sortedTimestamps.begin(), m_sortedTimestamps.end(), timestamp), timestamp);
+}
+
+void DifficultyWindow::eraseTimestamp(uint64_t timestamp) {
+  auto it = std::lower_bound(m_sortedTimestamps.begin(), m_sortedTimestamps.end(), timestamp);
+  assert(it != m_sortedTimestamps.end() && *it == timestamp);
+  m_sortedTimestamps.erase(it);
+}
+
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "Difficulty.h"
+
+namespace CryptoNote {
+
+class Currency;
+
+// Timestamps and cumulative difficulties of the last difficultyBlocksCount blocks of a chain, the genesis block
+// excluded, kept up to date as blocks are added and removed. The timestamps of the difficulty window, which are
+// the oldest ones as the lag is left out, are also kept sorted, so the next difficulty needs no pass over the blocks.
+class DifficultyWindow {
+public:
+  explicit DifficultyWindow(const Currency& currency);
+
+  size_t size() const;
+  bool empty() const;
+  void clear();
+
+  // Adds the next block of the chain, the oldest block leaves the window once it is full
+  void push_back(uint64_t timestamp, difficulty_type cumulativeDifficulty);
+  void pop_back();
+  // Adds the block preceding the oldest one, only allowed while the window isn't full
+  void push_front(uint64_t timestamp, difficulty_type cumulativeDifficulty);
+
+  difficulty_type nextDifficulty() const;
+
+private:
+  struct Entry {
+    uint64_t timestamp;
+    difficulty_type cumulativeDifficulty;
+  };
+
+  const Currency& m_currency;
+  std::deque<Entry> m_entries;
+  std::vector<uint64_t> m_sortedTimestamps;
+
+  void insertTimestamp(uint64_t timestamp);
+  void eraseTimestamp(uint64_t timestamp);
+};
+
+}
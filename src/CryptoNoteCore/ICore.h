@@ -46,6 +46,8 @@ public:
   virtual bool removeObserver(ICoreObserver* observer) = 0;
 
   virtual bool have_block(const Crypto::Hash& id) = 0;
+  // The transaction is in the pool or in the main chain
+  virtual bool haveTransaction(const Crypto::Hash& id) = 0;
   virtual std::vector<Crypto::Hash> buildSparseChain() = 0;
   virtual std::vector<Crypto::Hash> buildSparseChain(const Crypto::Hash& startBlockId) = 0;
   virtual bool get_stat_info(CryptoNote::core_stat_info& st_inf) = 0;
@@ -56,6 +58,9 @@ public:
   virtual bool handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS_request& arg, NOTIFY_RESPONSE_GET_OBJECTS_request& rsp) = 0; //Deprecated. Should be removed with CryptoNoteProtocolHandler.
   virtual void on_synchronized() = 0;
   virtual size_t addChain(const std::vector<const IBlock*>& chain) = 0;
+  virtual void computeProofsOfWork(const std::vector<Block>& blocks) = 0;
+  // Checks the ring signatures of the transactions of downloaded blocks ahead, adding the blocks then skips them
+  virtual void precheckTransactions(const std::vector<BinaryArray>& transactionBlobs) = 0;
 
   virtual void get_blockchain_top(uint32_t& height, Crypto::Hash& top_id) = 0;
   virtual std::vector<Crypto::Hash> findBlockchainSupplement(const std::vector<Crypto::Hash>& remoteBlockIds, size_t maxCount,
@@ -65,7 +70,10 @@ public:
   virtual bool getOutByMSigGIndex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out) = 0;
   virtual i_cryptonote_protocol* get_protocol() = 0;
   virtual bool handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_context& tvc, bool keeped_by_block) = 0; //Deprecated. Should be removed with CryptoNoteProtocolHandler.
+  // Handles relayed transactions with the checks that need no lock run in parallel
+  virtual void handleIncomingTransactions(const std::vector<BinaryArray>& transactionBlobs, std::vector<tx_verification_context>& results) = 0;
   virtual std::vector<Transaction> getPoolTransactions() = 0;
+  virtual void getPoolTransactions(const std::vector<Crypto::Hash>& txs_ids, std::vector<Transaction>& txs, std::vector<Crypto::Hash>& missed_txs) = 0;
   virtual bool getPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
                               std::vector<Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) = 0;
   virtual bool getPoolChangesLite(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
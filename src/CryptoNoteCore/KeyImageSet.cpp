@@ -0,0 +1,295 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "KeyImageSet.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include "Serialization/ISerializer.h"
+
+namespace CryptoNote {
+
+namespace {
+
+const size_t MIN_CAPACITY = 32;
+// slots per 512 bit bloom filter block, which gives 16 bits per slot
+const size_t SLOTS_PER_BLOOM_BLOCK = 32;
+const unsigned BLOOM_BITS_PER_KEY = 4;
+
+const Crypto::KeyImage NULL_IMAGE = {};
+
+uint64_t keyWord(const Crypto::KeyImage& keyImage, size_t index) {
+  uint64_t word;
+  memcpy(&word, reinterpret_cast<const uint8_t*>(&keyImage) + index * sizeof(word), sizeof(word));
+  return word;
+}
+
+}
+
+KeyImageSet::const_iterator::const_iterator(const KeyImageSet* set, size_t slot) : m_set(set), m_slot(slot) {
+  skipEmptySlots();
+}
+
+const Crypto::KeyImage& KeyImageSet::const_iterator::operator*() const {
+  return m_slot < m_set->m_slots.size() ? m_set->m_slots[m_slot] : NULL_IMAGE;
+}
+
+const Crypto::KeyImage* KeyImageSet::const_iterator::operator->() const {
+  return &**this;
+}
+
+KeyImageSet::const_iterator& KeyImageSet::const_iterator::operator++() {
+  ++m_slot;
+  skipEmptySlots();
+  return *this;
+}
+
+KeyImageSet::const_iterator KeyImageSet::const_iterator::operator++(int) {
+  const_iterator result = *this;
+  ++*this;
+  return result;
+}
+
+bool KeyImageSet::const_iterator::operator==(const const_iterator& other) const {
+  return m_slot == other.m_slot;
+}
+
+bool KeyImageSet::const_iterator::operator!=(const const_iterator& other) const {
+  return m_slot != other.m_slot;
+}
+
+// The null image, if present, follows the table slots
+void KeyImageSet::const_iterator::skipEmptySlots() {
+  while (m_slot < m_set->m_slots.size() && isNull(m_set->m_slots[m_slot])) {
+    ++m_slot;
+  }
+
+  if (m_slot == m_set->m_slots.size() && !m_set->m_hasNullImage) {
+    ++m_slot;
+  }
+}
+
+KeyImageSet::KeyImageSet() : m_size(0), m_hasNullImage(false) {
+}
+
+size_t KeyImageSet::size() const {
+  return m_size;
+}
+
+bool KeyImageSet::empty() const {
+  return m_size == 0;
+}
+
+void KeyImageSet::clear() {
+  m_slots.clear();
+  m_bloom.clear();
+  m_size = 0;
+  m_hasNullImage = false;
+}
+
+void KeyImageSet::reserve(size_t count) {
+  size_t capacity = MIN_CAPACITY;
+  while (capacity / 4 * 3 < count) {
+    capacity *= 2;
+  }
+
+  if (capacity > m_slots.size()) {
+    rehash(capacity);
+  }
+}
+
+bool KeyImageSet::insert(const Crypto::KeyImage& keyImage) {
+  if (isNull(keyImage)) {
+    if (m_hasNullImage) {
+      return false;
+    }
+
+    m_hasNullImage = true;
+    ++m_size;
+    return true;
+  }
+
+  size_t slot;
+  if (find(keyImage, slot)) {
+    return false;
+  }
+
+  // keep the load factor below 3/4
+  if ((m_size + 1) * 4 > m_slots.size() * 3) {
+    rehash(std::max(MIN_CAPACITY, m_slots.size() * 2));
+    find(keyImage, slot);
+  }
+
+  m_slots[slot] = keyImage;
+  addToBloom(keyImage);
+  ++m_size;
+  return true;
+}
+
+// Backward shift deletion: entries following the erased one in its probe run move back into the hole
+// unless that would put them in front of their home slot
+size_t KeyImageSet::erase(const Crypto::KeyImage& keyImage) {
+  if (isNull(keyImage)) {
+    if (!m_hasNullImage) {
+      return 0;
+    }
+
+    m_hasNullImage = false;
+    --m_size;
+    return 1;
+  }
+
+  size_t hole;
+  if (!find(keyImage, hole)) {
+    return 0;
+  }
+
+  size_t mask = m_slots.size() - 1;
+  for (size_t slot = (hole + 1) & mask; !isNull(m_slots[slot]); slot = (slot + 1) & mask) {
+    size_t home = slotOf(m_slots[slot]);
+    if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+      m_slots[hole] = m_slots[slot];
+      hole = slot;
+    }
+  }
+
+  m_slots[hole] = NULL_IMAGE;
+  --m_size;
+  return 1;
+}
+
+size_t KeyImageSet::count(const Crypto::KeyImage& keyImage) const {
+  if (isNull(keyImage)) {
+    return m_hasNullImage ? 1 : 0;
+  }
+
+  size_t slot;
+  return mayContain(keyImage) && find(keyImage, slot) ? 1 : 0;
+}
+
+KeyImageSet::const_iterator KeyImageSet::begin() const {
+  return const_iterator(this, 0);
+}
+
+KeyImageSet::const_iterator KeyImageSet::end() const {
+  return const_iterator(this, m_slots.size() + 1);
+}
+
+// The table is stored as is, only the bloom filter is rebuilt on loading. A loaded table must hold as many images as
+// its size tells, below the load factor insert keeps, each of them reachable from its home slot, so that probe runs
+// end and lookups find them.
+void KeyImageSet::serialize(ISerializer& s) {
+  uint64_t capacity = m_slots.size();
+  uint64_t size = m_size;
+  s(capacity, "capacity");
+  s(size, "size");
+  s(m_hasNullImage, "has_null_image");
+
+  if (s.type() == ISerializer::INPUT) {
+    if ((capacity != 0 && (capacity < MIN_CAPACITY || (capacity & (capacity - 1)) != 0)) || size > capacity + 1) {
+      throw std::runtime_error("KeyImageSet: invalid capacity");
+    }
+
+    m_slots.resize(static_cast<size_t>(capacity));
+    m_size = static_cast<size_t>(size);
+  }
+
+  if (capacity != 0) {
+    s.binary(m_slots.data(), m_slots.size() * sizeof(Crypto::KeyImage), "slots");
+  }
+
+  if (s.type() == ISerializer::INPUT) {
+    size_t tableCount = static_cast<size_t>(std::count_if(m_slots.begin(), m_slots.end(), [](const Crypto::KeyImage& keyImage) {
+      return !isNull(keyImage);
+    }));
+
+    bool valid = tableCount + (m_hasNullImage ? 1 : 0) == m_size && tableCount * 4 <= m_slots.size() * 3;
+    for (size_t slot = 0; valid && slot < m_slots.size(); ++slot) {
+      size_t foundSlot;
+      valid = isNull(m_slots[slot]) || (find(m_slots[slot], foundSlot) && foundSlot == slot);
+    }
+
+    if (!valid) {
+      clear();
+      throw std::runtime_error("KeyImageSet: invalid table");
+    }
+
+    m_bloom.assign(m_slots.size() / SLOTS_PER_BLOOM_BLOCK, BloomBlock());
+    for (const Crypto::KeyImage& keyImage : m_slots) {
+      if (!isNull(keyImage)) {
+        addToBloom(keyImage);
+      }
+    }
+  }
+}
+
+bool KeyImageSet::isNull(const Crypto::KeyImage& keyImage) {
+  return (keyWord(keyImage, 0) | keyWord(keyImage, 1) | keyWord(keyImage, 2) | keyWord(keyImage, 3)) == 0;
+}
+
+size_t KeyImageSet::slotOf(const Crypto::KeyImage& keyImage) const {
+  return static_cast<size_t>(keyWord(keyImage, 0)) & (m_slots.size() - 1);
+}
+
+// Finds the slot holding the key image or the empty slot that ends its probe run
+bool KeyImageSet::find(const Crypto::KeyImage& keyImage, size_t& slot) const {
+  if (m_slots.empty()) {
+    return false;
+  }
+
+  size_t mask = m_slots.size() - 1;
+  for (slot = slotOf(keyImage); !isNull(m_slots[slot]); slot = (slot + 1) & mask) {
+    if (m_slots[slot] == keyImage) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool KeyImageSet::mayContain(const Crypto::KeyImage& keyImage) const {
+  if (m_bloom.empty()) {
+    return false;
+  }
+
+  const BloomBlock& block = m_bloom[static_cast<size_t>(keyWord(keyImage, 1)) & (m_bloom.size() - 1)];
+  uint64_t bits = keyWord(keyImage, 2);
+  for (unsigned i = 0; i < BLOOM_BITS_PER_KEY; ++i, bits >>= 9) {
+    if ((block.words[(bits >> 6) & 7] & (uint64_t(1) << (bits & 63))) == 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void KeyImageSet::addToBloom(const Crypto::KeyImage& keyImage) {
+  BloomBlock& block = m_bloom[static_cast<size_t>(keyWord(keyImage, 1)) & (m_bloom.size() - 1)];
+  uint64_t bits = keyWord(keyImage, 2);
+  for (unsigned i = 0; i < BLOOM_BITS_PER_KEY; ++i, bits >>= 9) {
+    block.words[(bits >> 6) & 7] |= uint64_t(1) << (bits & 63);
+  }
+}
+
+void KeyImageSet::rehash(size_t capacity) {
+  assert(capacity >= MIN_CAPACITY && (capacity & (capacity - 1)) == 0);
+
+  std::vector<Crypto::KeyImage> slots(capacity, NULL_IMAGE);
+  std::swap(m_slots, slots);
+  m_bloom.assign(capacity / SLOTS_PER_BLOOM_BLOCK, BloomBlock());
+
+  for (const Crypto::KeyImage& keyImage : slots) {
+    if (!isNull(keyImage)) {
+      size_t slot;
+      find(keyImage, slot);
+      m_slots[slot] = keyImage;
+      addToBloom(keyImage);
+    }
+  }
+}
+
+}
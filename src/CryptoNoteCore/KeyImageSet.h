@@ -0,0 +1,82 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "crypto/crypto.h"
+
+namespace CryptoNote {
+
+class ISerializer;
+
+// Set of spent key images. Key images are stored in place in a flat open addressing table with linear probing,
+// their own bytes serve as hash values since they are uniformly distributed. A blocked bloom filter in front
+// of the table answers most lookups of unspent images, the common case, with a single cache line read.
+// Erased images are not removed from the filter, it is rebuilt whenever the table grows.
+class KeyImageSet {
+public:
+  class const_iterator {
+  public:
+    typedef ptrdiff_t difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+    typedef const Crypto::KeyImage* pointer;
+    typedef const Crypto::KeyImage& reference;
+    typedef Crypto::KeyImage value_type;
+
+    const_iterator(const KeyImageSet* set, size_t slot);
+
+    const Crypto::KeyImage& operator*() const;
+    const Crypto::KeyImage* operator->() const;
+    const_iterator& operator++();
+    const_iterator operator++(int);
+    bool operator==(const const_iterator& other) const;
+    bool operator!=(const const_iterator& other) const;
+
+  private:
+    const KeyImageSet* m_set;
+    size_t m_slot;
+
+    void skipEmptySlots();
+  };
+
+  KeyImageSet();
+
+  size_t size() const;
+  bool empty() const;
+  void clear();
+  void reserve(size_t count);
+  // Returns false if the key image is already there
+  bool insert(const Crypto::KeyImage& keyImage);
+  size_t erase(const Crypto::KeyImage& keyImage);
+  size_t count(const Crypto::KeyImage& keyImage) const;
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  void serialize(ISerializer& s);
+
+private:
+  struct BloomBlock {
+    uint64_t words[8];
+  };
+
+  // the all-zero key image marks empty slots and is kept aside
+  std::vector<Crypto::KeyImage> m_slots;
+  std::vector<BloomBlock> m_bloom;
+  size_t m_size;
+  bool m_hasNullImage;
+
+  static bool isNull(const Crypto::KeyImage& keyImage);
+  size_t slotOf(const Crypto::KeyImage& keyImage) const;
+  bool find(const Crypto::KeyImage& keyImage, size_t& slot) const;
+  bool mayContain(const Crypto::KeyImage& keyImage) const;
+  void addToBloom(const Crypto::KeyImage& keyImage);
+  void rehash(size_t capacity);
+};
+
+}
@@ -0,0 +1,625 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "Common/ArrayView.h"
+#include "Common/MemoryInputStream.h"
+#include "Common/VectorOutputStream.h"
+#include "Serialization/BinaryInputStreamSerializer.h"
+#include "Serialization/BinaryOutputStreamSerializer.h"
+
+// Append-only vector of serialized items stored in a memory-mapped segment file.
+//
+// Items file: serialized items laid out back to back, mapped into memory. The file is grown in
+// chunks while the vector is open and truncated to the used size on close.
+// Index file: magic, item count and a fixed-width table of item end offsets.
+//
+// Readers can access the serialized item in place through 'raw' without any stream or copy;
+// operator[] decodes straight from the mapping and keeps a small LRU of decoded items, because
+// callers hold references to them. The LRU is kept per thread, so operator[] and 'raw' may be called
+// from several threads at once as long as no modifying call runs concurrently. Only the LRUs of the
+// MAX_THREAD_CACHES threads which accessed the vector last are kept, threads come and go over time.
+// A returned reference stays valid until its thread accesses poolSize other items, or that many
+// threads access the vector after it.
+template<class T> class MappedVector {
+public:
+  typedef T value_type;
+
+  class const_iterator {
+  public:
+    typedef ptrdiff_t difference_type;
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef const T* pointer;
+    typedef const T& reference;
+    typedef T value_type;
+
+    const_iterator() {
+    }
+
+    const_iterator(MappedVector* mappedVector, size_t index) : m_mappedVector(mappedVector), m_index(index) {
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return m_index != other.m_index;
+    }
+
+    bool operator<(const const_iterator& other) const {
+      return m_index < other.m_index;
+    }
+
+    bool operator<=(const const_iterator& other) const {
+      return m_index <= other.m_index;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return m_index == other.m_index;
+    }
+
+    bool operator>(const const_iterator& other) const {
+      return m_index > other.m_index;
+    }
+
+    bool operator>=(const const_iterator& other) const {
+      return m_index >= other.m_index;
+    }
+
+    const_iterator& operator++() {
+      ++m_index;
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator i = *this;
+      ++m_index;
+      return i;
+    }
+
+    const_iterator& operator--() {
+      --m_index;
+      return *this;
+    }
+
+    const_iterator operator--(int) {
+      const_iterator i = *this;
+      --m_index;
+      return i;
+    }
+
+    const_iterator& operator+=(difference_type n) {
+      m_index += n;
+      return *this;
+    }
+
+    const_iterator& operator-=(difference_type n) {
+      m_index -= n;
+      return *this;
+    }
+
+    const_iterator operator+(difference_type n) const {
+      return const_iterator(m_mappedVector, m_index + n);
+    }
+
+    friend const_iterator operator+(difference_type n, const const_iterator& i) {
+      return const_iterator(i.m_mappedVector, n + i.m_index);
+    }
+
+    difference_type operator-(const const_iterator& other) const {
+      return m_index - other.m_index;
+    }
+
+    const_iterator operator-(difference_type n) const {
+      return const_iterator(m_mappedVector, m_index - n);
+    }
+
+    const T& operator*() const {
+      return (*m_mappedVector)[m_index];
+    }
+
+    const T* operator->() const {
+      return &(*m_mappedVector)[m_index];
+    }
+
+    const T& operator[](difference_type offset) const {
+      return (*m_mappedVector)[m_index + offset];
+    }
+
+    size_t index() const {
+      return m_index;
+    }
+
+  private:
+    MappedVector* m_mappedVector;
+    size_t m_index;
+  };
+
+  MappedVector();
+  MappedVector(const MappedVector&) = delete;
+  ~MappedVector();
+  MappedVector& operator=(const MappedVector&) = delete;
+
+  // Opens existing files or creates empty ones. An index written by SwappedVector (count followed by
+  // 32-bit item sizes) is converted in place, the items file format is the same.
+  bool open(const std::string& itemFileName, const std::string& indexFileName, size_t poolSize);
+  void close();
+
+  bool empty() const;
+  uint64_t size() const;
+  const_iterator begin();
+  const_iterator end();
+  const T& operator[](uint64_t index);
+  const T& front();
+  const T& back();
+  uint64_t getCacheHits() const;
+  uint64_t getCacheMisses() const;
+  // Serialized item as stored in the mapping. The view is valid until the next push_back, pop_back or clear.
+  Common::ArrayView<uint8_t> raw(uint64_t index) const;
+  void clear();
+  void pop_back();
+  void push_back(const T& item);
+  // Appends an already serialized item, the counterpart of raw().
+  void push_back_raw(Common::ArrayView<uint8_t> data);
+  // Appends an item along with its serialized form, which is stored as is. The item goes to the cache.
+  void push_back(T&& item, Common::ArrayView<uint8_t> data);
+
+private:
+  static const uint64_t INDEX_MAGIC = 0x3158454449564d4dULL; // "MMVIDEX1"
+  static const uint64_t INDEX_HEADER_SIZE = 2 * sizeof(uint64_t);
+  static const uint64_t MIN_GROW_SIZE = 16 * 1024 * 1024;
+  static const size_t MAX_THREAD_CACHES = 64;
+
+  struct ItemEntry;
+  struct CacheEntry;
+
+  struct ItemEntry {
+  public:
+    T item;
+    typename std::list<CacheEntry>::iterator cacheIter;
+  };
+
+  struct CacheEntry {
+  public:
+    typename std::map<uint64_t, ItemEntry>::iterator itemIter;
+  };
+
+  struct Cache {
+    std::map<uint64_t, ItemEntry> items;
+    std::list<CacheEntry> entries;
+    uint64_t lastAccess;
+  };
+
+  std::string m_itemsFileName;
+  std::fstream m_indexesFile;
+  boost::interprocess::file_mapping m_itemsMapping;
+  boost::interprocess::mapped_region m_itemsRegion;
+  uint8_t* m_itemsData;
+  uint64_t m_itemsCapacity;
+  size_t m_poolSize;
+  std::vector<uint64_t> m_offsets;
+  uint64_t m_itemsFileSize;
+  std::mutex m_cachesMutex;
+  std::map<std::thread::id, std::shared_ptr<Cache>> m_caches;
+  uint64_t m_cacheAccessCount;
+  std::atomic<uint64_t> m_cacheHits;
+  std::atomic<uint64_t> m_cacheMisses;
+  bool m_opened;
+
+  bool readIndex(const std::string& indexFileName, bool& legacy);
+  bool writeIndex(const std::string& indexFileName);
+  void writeCount(uint64_t count);
+  void map(uint64_t capacity);
+  void unmap();
+  void reserve(uint64_t requiredSize);
+  std::shared_ptr<Cache> threadCache();
+  T* prepare(Cache& cache, uint64_t index);
+  void erase(uint64_t index);
+  void append(const uint8_t* data, size_t size);
+};
+
+template<class T> const uint64_t MappedVector<T>::INDEX_MAGIC;
+template<class T> const uint64_t MappedVector<T>::INDEX_HEADER_SIZE;
+template<class T> const uint64_t MappedVector<T>::MIN_GROW_SIZE;
+template<class T> const size_t MappedVector<T>::MAX_THREAD_CACHES;
+
+template<class T> MappedVector<T>::MappedVector() : m_itemsData(nullptr), m_itemsCapacity(0), m_poolSize(0), m_itemsFileSize(0),
+  m_cacheAccessCount(0), m_cacheHits(0), m_cacheMisses(0), m_opened(false) {
+}
+
+template<class T> MappedVector<T>::~MappedVector() {
+  close();
+}
+
+template<class T> bool MappedVector<T>::open(const std::string& itemFileName, const std::string& indexFileName, size_t poolSize) {
+  if (poolSize == 0) {
+    return false;
+  }
+
+  close();
+
+  boost::system::error_code ec;
+  bool itemsExist = boost::filesystem::exists(itemFileName, ec);
+  bool indexesExist = boost::filesystem::exists(indexFileName, ec);
+  if (itemsExist && indexesExist) {
+    bool legacy;
+    if (!readIndex(indexFileName, legacy)) {
+      return false;
+    }
+
+    uint64_t itemsFileSize = boost::filesystem::file_size(itemFileName, ec);
+    if (ec || itemsFileSize < m_itemsFileSize) {
+      return false;
+    }
+
+    if (legacy && !writeIndex(indexFileName)) {
+      return false;
+    }
+
+    m_itemsCapacity = itemsFileSize;
+  } else {
+    std::ofstream itemsFile(itemFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!itemsFile) {
+      return false;
+    }
+
+    itemsFile.close();
+    m_offsets.clear();
+    m_itemsFileSize = 0;
+    m_itemsCapacity = 0;
+    if (!writeIndex(indexFileName)) {
+      return false;
+    }
+  }
+
+  m_indexesFile.open(indexFileName, std::ios::in | std::ios::out | std::ios::binary);
+  if (!m_indexesFile) {
+    return false;
+  }
+
+  m_itemsFileName = itemFileName;
+  try {
+    map(m_itemsCapacity);
+  } catch (std::exception&) {
+    m_indexesFile.close();
+    return false;
+  }
+
+  m_poolSize = poolSize;
+  m_caches.clear();
+  m_cacheHits = 0;
+  m_cacheMisses = 0;
+  m_opened = true;
+  return true;
+}
+
+template<class T> void MappedVector<T>::close() {
+  if (!m_opened) {
+    return;
+  }
+
+  unmap();
+  m_indexesFile.close();
+
+  // drop the preallocated tail, so the items file only contains valid items
+  boost::system::error_code ec;
+  boost::filesystem::resize_file(m_itemsFileName, m_itemsFileSize, ec);
+
+  m_caches.clear();
+  m_opened = false;
+}
+
+template<class T> bool MappedVector<T>::empty() const {
+  return m_offsets.empty();
+}
+
+template<class T> uint64_t MappedVector<T>::size() const {
+  return m_offsets.size();
+}
+
+template<class T> typename MappedVector<T>::const_iterator MappedVector<T>::begin() {
+  return const_iterator(this, 0);
+}
+
+template<class T> typename MappedVector<T>::const_iterator MappedVector<T>::end() {
+  return const_iterator(this, m_offsets.size());
+}
+
+template<class T> const T& MappedVector<T>::operator[](uint64_t index) {
+  std::shared_ptr<Cache> threadCachePtr = threadCache();
+  Cache& cache = *threadCachePtr;
+  auto itemIter = cache.items.find(index);
+  if (itemIter != cache.items.end()) {
+    if (itemIter->second.cacheIter != --cache.entries.end()) {
+      cache.entries.splice(cache.entries.end(), cache.entries, itemIter->second.cacheIter);
+    }
+
+    ++m_cacheHits;
+    return itemIter->second.item;
+  }
+
+  if (index >= m_offsets.size()) {
+    throw std::runtime_error("MappedVector::operator[]");
+  }
+
+  Common::ArrayView<uint8_t> data = raw(index);
+  T tempItem;
+
+  Common::MemoryInputStream stream(data.getData(), data.getSize());
+  CryptoNote::BinaryInputStreamSerializer archive(stream);
+  serialize(tempItem, archive);
+
+  T* item = prepare(cache, index);
+  std::swap(tempItem, *item);
+  ++m_cacheMisses;
+  return *item;
+}
+
+template<class T> const T& MappedVector<T>::front() {
+  return operator[](0);
+}
+
+template<class T> const T& MappedVector<T>::back() {
+  return operator[](m_offsets.size() - 1);
+}
+
+template<class T> uint64_t MappedVector<T>::getCacheHits() const {
+  return m_cacheHits;
+}
+
+template<class T> uint64_t MappedVector<T>::getCacheMisses() const {
+  return m_cacheMisses;
+}
+
+template<class T> Common::ArrayView<uint8_t> MappedVector<T>::raw(uint64_t index) const {
+  if (index >= m_offsets.size()) {
+    throw std::runtime_error("MappedVector::raw");
+  }
+
+  uint64_t itemEnd = index + 1 < m_offsets.size() ? m_offsets[index + 1] : m_itemsFileSize;
+  return Common::ArrayView<uint8_t>(m_itemsData + m_offsets[index], static_cast<size_t>(itemEnd - m_offsets[index]));
+}
+
+template<class T> void MappedVector<T>::clear() {
+  writeCount(0);
+
+  m_offsets.clear();
+  m_itemsFileSize = 0;
+  m_caches.clear();
+}
+
+template<class T> void MappedVector<T>::pop_back() {
+  writeCount(m_offsets.size() - 1);
+
+  m_itemsFileSize = m_offsets.back();
+  m_offsets.pop_back();
+  erase(m_offsets.size());
+}
+
+template<class T> void MappedVector<T>::push_back(const T& item) {
+  std::vector<uint8_t> blob;
+  {
+    Common::VectorOutputStream stream(blob);
+    CryptoNote::BinaryOutputStreamSerializer archive(stream);
+    serialize(const_cast<T&>(item), archive);
+  }
+
+  append(blob.data(), blob.size());
+
+  T* newItem = prepare(*threadCache(), m_offsets.size() - 1);
+  *newItem = item;
+}
+
+template<class T> void MappedVector<T>::push_back_raw(Common::ArrayView<uint8_t> data) {
+  append(data.getData(), data.getSize());
+}
+
+template<class T> void MappedVector<T>::push_back(T&& item, Common::ArrayView<uint8_t> data) {
+  append(data.getData(), data.getSize());
+
+  T* newItem = prepare(*threadCache(), m_offsets.size() - 1);
+  *newItem = std::move(item);
+}
+
+template<class T> bool MappedVector<T>::readIndex(const std::string& indexFileName, bool& legacy) {
+  std::ifstream indexesFile(indexFileName, std::ios::in | std::ios::binary);
+  uint64_t header;
+  indexesFile.read(reinterpret_cast<char*>(&header), sizeof header);
+  if (!indexesFile) {
+    return false;
+  }
+
+  std::vector<uint64_t> offsets;
+  uint64_t itemsFileSize = 0;
+  legacy = header != INDEX_MAGIC;
+  if (legacy) {
+    uint64_t count = header;
+    for (uint64_t i = 0; i < count; ++i) {
+      uint32_t itemSize;
+      indexesFile.read(reinterpret_cast<char*>(&itemSize), sizeof itemSize);
+      if (!indexesFile) {
+        return false;
+      }
+
+      offsets.emplace_back(itemsFileSize);
+      itemsFileSize += itemSize;
+    }
+  } else {
+    uint64_t count;
+    indexesFile.read(reinterpret_cast<char*>(&count), sizeof count);
+    if (!indexesFile) {
+      return false;
+    }
+
+    std::vector<uint64_t> itemEnds(count);
+    if (count != 0) {
+      indexesFile.read(reinterpret_cast<char*>(itemEnds.data()), count * sizeof(uint64_t));
+      if (!indexesFile) {
+        return false;
+      }
+    }
+
+    offsets.reserve(count);
+    for (uint64_t itemEnd : itemEnds) {
+      if (itemEnd < itemsFileSize) {
+        return false;
+      }
+
+      offsets.emplace_back(itemsFileSize);
+      itemsFileSize = itemEnd;
+    }
+  }
+
+  m_offsets.swap(offsets);
+  m_itemsFileSize = itemsFileSize;
+  return true;
+}
+
+template<class T> bool MappedVector<T>::writeIndex(const std::string& indexFileName) {
+  std::ofstream indexesFile(indexFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+  uint64_t header[2] = { INDEX_MAGIC, m_offsets.size() };
+  indexesFile.write(reinterpret_cast<char*>(header), sizeof header);
+  for (size_t i = 0; i < m_offsets.size(); ++i) {
+    uint64_t itemEnd = i + 1 < m_offsets.size() ? m_offsets[i + 1] : m_itemsFileSize;
+    indexesFile.write(reinterpret_cast<char*>(&itemEnd), sizeof itemEnd);
+  }
+
+  return static_cast<bool>(indexesFile);
+}
+
+template<class T> void MappedVector<T>::writeCount(uint64_t count) {
+  if (!m_indexesFile) {
+    throw std::runtime_error("MappedVector::writeCount");
+  }
+
+  m_indexesFile.seekp(sizeof(uint64_t));
+  m_indexesFile.write(reinterpret_cast<char*>(&count), sizeof count);
+  if (!m_indexesFile) {
+    throw std::runtime_error("MappedVector::writeCount");
+  }
+}
+
+template<class T> void MappedVector<T>::map(uint64_t capacity) {
+  unmap();
+  m_itemsCapacity = capacity;
+  if (capacity == 0) {
+    // empty files cannot be mapped
+    return;
+  }
+
+  m_itemsMapping = boost::interprocess::file_mapping(m_itemsFileName.c_str(), boost::interprocess::read_write);
+  m_itemsRegion = boost::interprocess::mapped_region(m_itemsMapping, boost::interprocess::read_write, 0, static_cast<size_t>(capacity));
+  m_itemsData = static_cast<uint8_t*>(m_itemsRegion.get_address());
+}
+
+template<class T> void MappedVector<T>::unmap() {
+  m_itemsRegion = boost::interprocess::mapped_region();
+  m_itemsMapping = boost::interprocess::file_mapping();
+  m_itemsData = nullptr;
+}
+
+template<class T> void MappedVector<T>::reserve(uint64_t requiredSize) {
+  if (requiredSize <= m_itemsCapacity) {
+    return;
+  }
+
+  uint64_t capacity = std::max(requiredSize, m_itemsCapacity + std::max(m_itemsCapacity / 2, MIN_GROW_SIZE));
+  unmap();
+
+  boost::system::error_code ec;
+  boost::filesystem::resize_file(m_itemsFileName, capacity, ec);
+  if (ec) {
+    map(m_itemsCapacity);
+    throw std::runtime_error("MappedVector::reserve");
+  }
+
+  map(capacity);
+}
+
+// The returned cache is used without the lock by its own thread, and stays alive while it is used even if a new
+// thread takes its place. The thread which accessed the vector least recently is dropped once there are too many caches.
+template<class T> std::shared_ptr<typename MappedVector<T>::Cache> MappedVector<T>::threadCache() {
+  std::lock_guard<std::mutex> lock(m_cachesMutex);
+  auto cacheIter = m_caches.find(std::this_thread::get_id());
+  if (cacheIter == m_caches.end()) {
+    if (m_caches.size() >= MAX_THREAD_CACHES) {
+      m_caches.erase(std::min_element(m_caches.begin(), m_caches.end(), [](const typename std::map<std::thread::id, std::shared_ptr<Cache>>::value_type& left,
+        const typename std::map<std::thread::id, std::shared_ptr<Cache>>::value_type& right) { return left.second->lastAccess < right.second->lastAccess; }));
+    }
+
+    cacheIter = m_caches.emplace(std::this_thread::get_id(), std::make_shared<Cache>()).first;
+  }
+
+  cacheIter->second->lastAccess = ++m_cacheAccessCount;
+  return cacheIter->second;
+}
+
+template<class T> T* MappedVector<T>::prepare(Cache& cache, uint64_t index) {
+  if (cache.items.size() == m_poolSize) {
+    auto cacheIter = cache.entries.begin();
+    cache.items.erase(cacheIter->itemIter);
+    cache.entries.erase(cacheIter);
+  }
+
+  auto itemIter = cache.items.insert(std::make_pair(index, ItemEntry()));
+  CacheEntry cacheEntry = { itemIter.first };
+  auto cacheIter = cache.entries.insert(cache.entries.end(), cacheEntry);
+  itemIter.first->second.cacheIter = cacheIter;
+  return &itemIter.first->second.item;
+}
+
+template<class T> void MappedVector<T>::erase(uint64_t index) {
+  for (auto& threadCache : m_caches) {
+    Cache& cache = *threadCache.second;
+    auto itemIter = cache.items.find(index);
+    if (itemIter != cache.items.end()) {
+      cache.entries.erase(itemIter->second.cacheIter);
+      cache.items.erase(itemIter);
+    }
+  }
+}
+
+template<class T> void MappedVector<T>::append(const uint8_t* data, size_t size) {
+  reserve(m_itemsFileSize + size);
+  if (size != 0) {
+    memcpy(m_itemsData + m_itemsFileSize, data, size);
+  }
+
+  uint64_t itemsFileSize = m_itemsFileSize + size;
+
+  {
+    if (!m_indexesFile) {
+      throw std::runtime_error("MappedVector::append");
+    }
+
+    m_indexesFile.seekp(INDEX_HEADER_SIZE + sizeof(uint64_t) * m_offsets.size());
+    m_indexesFile.write(reinterpret_cast<char*>(&itemsFileSize), sizeof itemsFileSize);
+    if (!m_indexesFile) {
+      throw std::runtime_error("MappedVector::append");
+    }
+
+    writeCount(m_offsets.size() + 1);
+  }
+
+  m_offsets.push_back(m_itemsFileSize);
+  m_itemsFileSize = itemsFileSize;
+}
@@ -19,8 +19,10 @@
 #include "crypto/crypto.h"
 #include "Common/CommandLine.h"
 #include "Common/StringTools.h"
+#include "Common/Util.h"
 #include "Serialization/SerializationTools.h"
 
+#include "BlockMiningJob.h"
 #include "CryptoNoteFormatUtils.h"
 #include "TransactionExtra.h"
 
@@ -44,6 +46,7 @@ namespace CryptoNote
     m_hashes(0),
     m_do_print_hashrate(false),
     m_do_mining(false),
+    m_pin_threads(false),
     m_current_hash_rate(0),
     m_update_block_template_interval(5),
     m_update_merge_hr_interval(2)
@@ -167,6 +170,8 @@ namespace CryptoNote
       logger(INFO) << "Loaded " << m_extra_messages.size() << " extra messages, current index " << m_config.current_extra_message_index;
     }
 
+    m_pin_threads = config.pinMiningThreads;
+
     if(!config.startMining.empty()) {
       if (!m_currency.parseAccountAddressString(config.startMining, m_mine_address)) {
         logger(ERROR) << "Target account address " << config.startMining << " has wrong format, starting daemon canceled";
@@ -253,6 +258,11 @@ namespace CryptoNote
 
     unsigned nthreads = std::thread::hardware_concurrency();
 
+    BlockMiningJob job;
+    if (!job.init(bl)) {
+      return false;
+    }
+
     if (nthreads > 0 && diffic > 5) {
       std::vector<std::future<void>> threads(nthreads);
       std::atomic<uint32_t> foundNonce;
@@ -262,19 +272,27 @@ namespace CryptoNote
       for (unsigned i = 0; i < nthreads; ++i) {
         threads[i] = std::async(std::launch::async, [&, i]() {
           Crypto::cn_context localctx;
+          Crypto::cn_context otherLocalctx;
           Crypto::Hash h;
+          Crypto::Hash otherH;
 
-          Block lb(bl); // copy to local block
+          BlockMiningJob localJob(job); // copy to local job
+          BlockMiningJob otherLocalJob(job);
 
-          for (uint32_t nonce = startNonce + i; !found; nonce += nthreads) {
-            lb.nonce = nonce;
+          // two nonces at once, the second one is the next nonce of this thread
+          for (uint32_t nonce = startNonce + i; !found; nonce += 2 * nthreads) {
+            localJob.setNonce(nonce);
+            otherLocalJob.setNonce(nonce + nthreads);
+            BlockMiningJob::getLonghashes(localctx, otherLocalctx, localJob, otherLocalJob, h, otherH);
 
-            if (!get_block_longhash(localctx, lb, h)) {
+            if (check_hash(h, diffic)) {
+              foundNonce = nonce;
+              found = true;
               return;
             }
 
-            if (check_hash(h, diffic)) {
-              foundNonce = nonce;
+            if (check_hash(otherH, diffic)) {
+              foundNonce = nonce + nthreads;
               found = true;
               return;
             }
@@ -294,9 +312,8 @@ namespace CryptoNote
     } else {
       for (; bl.nonce != std::numeric_limits<uint32_t>::max(); bl.nonce++) {
         Crypto::Hash h;
-        if (!get_block_longhash(context, bl, h)) {
-          return false;
-        }
+        job.setNonce(bl.nonce);
+        job.getLonghash(context, h);
 
         if (check_hash(h, diffic)) {
           return true;
@@ -338,11 +355,27 @@ namespace CryptoNote
   bool miner::worker_thread(uint32_t th_local_index)
   {
     logger(INFO) << "Miner thread was started ["<< th_local_index << "]";
+
+    // pinned before the scratchpads are allocated, so that they are placed on the NUMA node of the thread
+    unsigned processorCount = std::thread::hardware_concurrency();
+    if (m_pin_threads && processorCount != 0 && !Tools::setCurrentThreadAffinity(th_local_index % processorCount)) {
+      logger(WARNING) << "Failed to pin miner thread [" << th_local_index << "] to a processor";
+    }
+
     uint32_t nonce = m_starter_nonce + th_local_index;
     difficulty_type local_diff = 0;
     uint32_t local_template_ver = 0;
     Crypto::cn_context context;
+    Crypto::cn_context otherContext;
+    logger(INFO) << "Miner thread [" << th_local_index << "] scratchpads use " << Crypto::cn_page_mode_name(context.page_mode()) <<
+      " and " << Crypto::cn_page_mode_name(otherContext.page_mode());
+    if (!context.is_locked() || !otherContext.is_locked()) {
+      logger(WARNING) << "Miner thread [" << th_local_index << "] scratchpads aren't locked in memory, they may be swapped out";
+    }
+
     Block b;
+    BlockMiningJob job;
+    BlockMiningJob otherJob;
 
     while(!m_stop)
     {
@@ -360,6 +393,14 @@ namespace CryptoNote
 
         local_template_ver = m_template_no;
         nonce = m_starter_nonce + th_local_index;
+
+        if (local_template_ver && !job.init(b)) {
+          logger(ERROR) << "Failed to get block hashing blob";
+          m_stop = true;
+          break;
+        }
+
+        otherJob = job;
       }
 
       if(!local_template_ver)//no any set_block_template call
@@ -369,30 +410,34 @@ namespace CryptoNote
         continue;
       }
 
-      b.nonce = nonce;
-      Crypto::Hash h;
-      if (!m_stop && !get_block_longhash(context, b, h)) {
-        logger(ERROR) << "Failed to get block long hash";
-        m_stop = true;
-      }
-
-      if (!m_stop && check_hash(h, local_diff))
-      {
-        //we lucky!
-        ++m_config.current_extra_message_index;
-
-        logger(INFO, GREEN) << "Found block for difficulty: " << local_diff;
+      // two nonces at once, the second one is the next nonce of this thread
+      job.setNonce(nonce);
+      otherJob.setNonce(nonce + m_threads_total);
+      Crypto::Hash hashes[2];
+      BlockMiningJob::getLonghashes(context, otherContext, job, otherJob, hashes[0], hashes[1]);
+
+      for (uint32_t i = 0; i < 2 && !m_stop; ++i) {
+        if (check_hash(hashes[i], local_diff))
+        {
+          b.nonce = nonce + i * m_threads_total;
+          //we lucky!
+          ++m_config.current_extra_message_index;
+
+          logger(INFO, GREEN) << "Found block for difficulty: " << local_diff;
+
+          if(!m_handler.handle_block_found(b)) {
+            --m_config.current_extra_message_index;
+          } else {
+            //success update, lets update config
+            Common::saveStringToFile(m_config_folder_path + "/" + CryptoNote::parameters::MINER_CONFIG_FILE_NAME, storeToJson(m_config));
+          }
 
-        if(!m_handler.handle_block_found(b)) {
-          --m_config.current_extra_message_index;
-        } else {
-          //success update, lets update config
-          Common::saveStringToFile(m_config_folder_path + "/" + CryptoNote::parameters::MINER_CONFIG_FILE_NAME, storeToJson(m_config));
+          break;
         }
       }
 
-      nonce += m_threads_total;
-      ++m_hashes;
+      nonce += 2 * m_threads_total;
+      m_hashes += 2;
     }
     logger(INFO) << "Miner thread stopped ["<< th_local_index << "]";
     return true;
@@ -21,6 +21,7 @@ public:
   std::string extraMessages;
   std::string startMining;
   uint32_t miningThreads;
+  bool pinMiningThreads;
 };
 
 } //namespace CryptoNote
@@ -1,9 +0,0 @@
-// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
-// Distributed under the MIT/X11 software license, see the accompanying
-// file COPYING or http://www.opensource.org/licenses/mit-license.php.
-
-#include "SwappedVector.h"
-
-namespace {
-char suppressMSVCWarningLNK4221;
-}
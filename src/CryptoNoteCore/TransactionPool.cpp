@@ -6,16 +6,22 @@
 
 #include <algorithm>
 #include <ctime>
+#include <iterator>
 #include <vector>
 #include <unordered_set>
 
 #include <boost/filesystem.hpp>
 
 #include "Common/int-util.h"
+#include "Common/MemoryInputStream.h"
+#include "Common/ParallelFor.h"
 #include "Common/Util.h"
+#include "Common/VectorOutputStream.h"
 #include "crypto/hash.h"
 
 #include "Serialization/SerializationTools.h"
+#include "Serialization/BinaryInputStreamSerializer.h"
+#include "Serialization/BinaryOutputStreamSerializer.h"
 #include "Serialization/BinarySerializationTools.h"
 
 #include "CryptoNoteFormatUtils.h"
@@ -28,6 +34,45 @@ using namespace Logging;
 
 namespace CryptoNote {
 
+  void serialize(tx_memory_pool::TransactionDetails& td, ISerializer& s);
+
+  namespace {
+
+  const uint64_t MIN_JOURNAL_SIZE_TO_COMPACT = 1024 * 1024;
+
+  enum JournalRecordType : uint8_t {
+    JOURNAL_ADD_TRANSACTION = 1,
+    JOURNAL_REMOVE_TRANSACTION = 2,
+    // transaction removed from the pool that must not be added again for a while
+    JOURNAL_DELETE_TRANSACTION = 3
+  };
+
+  BinaryArray makeJournalRecord(JournalRecordType type, const Crypto::Hash& id, uint64_t time = 0) {
+    BinaryArray record;
+    Common::VectorOutputStream stream(record);
+    BinaryOutputStreamSerializer serializer(stream);
+    uint8_t recordType = type;
+    serializer(recordType, "type");
+    serializer(const_cast<Crypto::Hash&>(id), "id");
+    if (type == JOURNAL_DELETE_TRANSACTION) {
+      serializer(time, "time");
+    }
+
+    return record;
+  }
+
+  BinaryArray makeJournalRecord(const tx_memory_pool::TransactionDetails& transaction) {
+    BinaryArray record;
+    Common::VectorOutputStream stream(record);
+    BinaryOutputStreamSerializer serializer(stream);
+    uint8_t recordType = JOURNAL_ADD_TRANSACTION;
+    serializer(recordType, "type");
+    serialize(const_cast<tx_memory_pool::TransactionDetails&>(transaction), serializer);
+    return record;
+  }
+
+  }
+
   //---------------------------------------------------------------------------------
   // BlockTemplate
   //---------------------------------------------------------------------------------
@@ -95,7 +140,12 @@ namespace CryptoNote {
     m_timeProvider(timeProvider), 
     m_txCheckInterval(60, timeProvider),
     m_fee_index(boost::get<1>(m_transactions)),
-    logger(log, "txpool") {
+    m_ready_index(boost::get<2>(m_transactions)),
+    m_transactionsSize(0),
+    m_evictedTransactionsCount(0),
+    m_evictedTransactionsSize(0),
+    logger(log, "txpool"),
+    m_journal(log) {
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::add_tx(const Transaction &tx, /*const Crypto::Hash& tx_prefix_hash,*/ const Crypto::Hash &id, size_t blobSize, tx_verification_context& tvc, bool keptByBlock) {
@@ -121,9 +171,10 @@ namespace CryptoNote {
 
     const uint64_t fee = inputs_amount - outputs_amount;
     bool isFusionTransaction = fee == 0 && m_currency.isFusionTransaction(tx, blobSize);
-    if (!keptByBlock && !isFusionTransaction && fee < m_currency.minimumFee()) {
+    uint64_t minimumFee = getMinimumFee();
+    if (!keptByBlock && !isFusionTransaction && fee < minimumFee) {
       logger(INFO) << "transaction fee is not enough: " << m_currency.formatAmount(fee) <<
-        ", minimum fee: " << m_currency.formatAmount(m_currency.minimumFee());
+        ", minimum fee: " << m_currency.formatAmount(minimumFee);
       tvc.m_verifivation_failed = true;
       tvc.m_tx_fee_too_small = true;
       return false;
@@ -164,7 +215,7 @@ namespace CryptoNote {
       }
     }
 
-    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    std::unique_lock<std::recursive_mutex> lock(m_transactions_lock);
 
     if (!keptByBlock && m_recentlyDeletedTransactions.find(id) != m_recentlyDeletedTransactions.end()) {
       logger(INFO) << "Trying to add recently deleted transaction. Ignore: " << id;
@@ -174,6 +225,20 @@ namespace CryptoNote {
       return true;
     }
 
+    if (m_transactions.count(id) != 0) {
+      logger(ERROR, BRIGHT_RED) << "transaction already exists at inserting in memory pool";
+      return false;
+    }
+
+    // transactions of blocks are kept even if the pool is full
+    size_t evictedCount = 0;
+    if (!keptByBlock && !evictTransactions(blobSize, fee, evictedCount)) {
+      logger(INFO) << "transaction pool is full, fee of transaction " << id << " is not enough: " << m_currency.formatAmount(fee);
+      tvc.m_verifivation_failed = true;
+      tvc.m_tx_fee_too_small = true;
+      return false;
+    }
+
     // add to pool
     {
       TransactionDetails txd;
@@ -187,22 +252,32 @@ namespace CryptoNote {
 
       txd.maxUsedBlock = maxUsedBlock;
       txd.lastFailedBlock.clear();
+      txd.ready = false;
 
       auto txd_p = m_transactions.insert(std::move(txd));
       if (!(txd_p.second)) {
         logger(ERROR, BRIGHT_RED) << "transaction already exists at inserting in memory pool";
         return false;
       }
-      m_paymentIdIndex.add(txd.tx);
-      m_timestampIndex.add(txd.receiveTime, txd.id);
-
+      m_paymentIdIndex.add(txd_p.first->tx);
+      m_timestampIndex.add(txd_p.first->receiveTime, id);
+      m_uncheckedTransactions.insert(id);
+      m_transactionsSize += blobSize;
+      m_journal.append(makeJournalRecord(*txd_p.first));
     }
 
     tvc.m_added_to_pool = true;
     tvc.m_should_be_relayed = inputsValid && (fee > 0 || isFusionTransaction);
     tvc.m_verifivation_failed = true;
 
-    if (!addTransactionInputs(id, tx, keptByBlock))
+    bool inputsAdded = addTransactionInputs(id, tx, keptByBlock);
+    lock.unlock();
+
+    if (evictedCount != 0) {
+      m_observerManager.notify(&ITxPoolObserver::txDeletedFromPool);
+    }
+
+    if (!inputsAdded)
       return false;
 
     tvc.m_verifivation_failed = false;
@@ -240,6 +315,28 @@ namespace CryptoNote {
     return m_transactions.size();
   }
   //---------------------------------------------------------------------------------
+  size_t tx_memory_pool::getTransactionsSize() const {
+    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    return m_transactionsSize;
+  }
+  //---------------------------------------------------------------------------------
+  uint64_t tx_memory_pool::getEvictedTransactionsCount() const {
+    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    return m_evictedTransactionsCount;
+  }
+  //---------------------------------------------------------------------------------
+  uint64_t tx_memory_pool::getMinimumFee() const {
+    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    // A pool without room has no pressure scale, its fee stays the minimum
+    size_t halfSize = m_currency.mempoolMaxSize() / 2;
+    if (m_transactionsSize <= halfSize || m_currency.mempoolMaxSize() == 0) {
+      return m_currency.minimumFee();
+    }
+
+    size_t pressure = std::min(m_transactionsSize - halfSize, m_currency.mempoolMaxSize() - halfSize);
+    return m_currency.minimumFee() + m_currency.minimumFee() * pressure / (m_currency.mempoolMaxSize() - halfSize);
+  }
+  //---------------------------------------------------------------------------------
   void tx_memory_pool::get_transactions(std::list<Transaction>& txs) const {
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
     for (const auto& tx_vt : m_transactions) {
@@ -247,14 +344,14 @@ namespace CryptoNote {
     }
   }
   //---------------------------------------------------------------------------------
-  void tx_memory_pool::get_difference(const std::vector<Crypto::Hash>& known_tx_ids, std::vector<Crypto::Hash>& new_tx_ids, std::vector<Crypto::Hash>& deleted_tx_ids) const {
+  void tx_memory_pool::get_difference(const std::vector<Crypto::Hash>& known_tx_ids, std::vector<Crypto::Hash>& new_tx_ids, std::vector<Crypto::Hash>& deleted_tx_ids) {
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    checkTransactions();
+
     std::unordered_set<Crypto::Hash> ready_tx_ids;
-    for (const auto& tx : m_transactions) {
-      TransactionCheckInfo checkInfo(tx);
-      if (is_transaction_ready_to_go(tx.tx, checkInfo)) {
-        ready_tx_ids.insert(tx.id);
-      }
+    auto readyTransactions = m_ready_index.equal_range(boost::make_tuple(true));
+    for (auto it = readyTransactions.first; it != readyTransactions.second; ++it) {
+      ready_tx_ids.insert(it->id);
     }
 
     std::unordered_set<Crypto::Hash> known_set(known_tx_ids.begin(), known_tx_ids.end());
@@ -273,11 +370,43 @@ namespace CryptoNote {
     deleted_tx_ids.assign(known_set.begin(), known_set.end());
   }
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::on_blockchain_inc(uint64_t new_block_height, const Crypto::Hash& top_block_id) {
+  bool tx_memory_pool::on_blockchain_inc(uint64_t new_block_height, const Crypto::Hash& top_block_id, const std::vector<Crypto::KeyImage>& spentKeyImages) {
+    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+
+    // the new block may provide the outputs the waiting transactions use
+    auto waitingTransactions = m_ready_index.equal_range(boost::make_tuple(false));
+    for (auto it = waitingTransactions.first; it != waitingTransactions.second; ++it) {
+      m_uncheckedTransactions.insert(it->id);
+    }
+
+    for (const auto& keyImage : spentKeyImages) {
+      auto it = m_spent_key_images.find(keyImage);
+      if (it == m_spent_key_images.end()) {
+        continue;
+      }
+
+      for (const auto& id : it->second) {
+        auto txIt = m_transactions.find(id);
+        if (txIt != m_transactions.end()) {
+          uncheckTransaction(txIt);
+        }
+      }
+    }
+
     return true;
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::on_blockchain_dec(uint64_t new_block_height, const Crypto::Hash& top_block_id) {
+    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+
+    // ready transactions using outputs of the removed block have to be checked again, the ones spending
+    // key images spent in it may become ready
+    for (auto it = m_transactions.begin(); it != m_transactions.end(); ++it) {
+      if (!it->ready || it->maxUsedBlock.height >= new_block_height) {
+        uncheckTransaction(it);
+      }
+    }
+
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -315,6 +444,34 @@ namespace CryptoNote {
     return true;
   }
   //---------------------------------------------------------------------------------
+  void tx_memory_pool::uncheckTransaction(tx_container_t::iterator i) {
+    if (i->ready) {
+      m_transactions.modify(i, [](TransactionDetails& item) {
+        item.ready = false;
+      });
+    }
+
+    m_uncheckedTransactions.insert(i->id);
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::checkTransactions() {
+    for (const auto& id : m_uncheckedTransactions) {
+      auto it = m_transactions.find(id);
+      assert(it != m_transactions.end());
+
+      TransactionCheckInfo checkInfo(*it);
+      bool ready = is_transaction_ready_to_go(it->tx, checkInfo);
+
+      // update item state
+      m_transactions.modify(it, [&checkInfo, ready](TransactionDetails& item) {
+        static_cast<TransactionCheckInfo&>(item) = checkInfo;
+        item.ready = ready;
+      });
+    }
+
+    m_uncheckedTransactions.clear();
+  }
+  //---------------------------------------------------------------------------------
   std::string tx_memory_pool::print_pool(bool short_format) const {
     std::stringstream ss;
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
@@ -350,36 +507,31 @@ namespace CryptoNote {
 
     BlockTemplate blockTemplate;
 
-    for (auto it = m_fee_index.rbegin(); it != m_fee_index.rend() && it->fee == 0; ++it) {
-      const auto& txd = *it;
+    // only the transactions affected by the chain changes since the last call are checked
+    checkTransactions();
+    auto readyTransactions = m_ready_index.equal_range(boost::make_tuple(true));
+
+    for (auto it = readyTransactions.second; it != readyTransactions.first && std::prev(it)->fee == 0;) {
+      const auto& txd = *--it;
 
       if (m_currency.fusionTxMaxSize() < total_size + txd.blobSize) {
         continue;
       }
 
-      TransactionCheckInfo checkInfo(txd);
-      if (is_transaction_ready_to_go(txd.tx, checkInfo) && blockTemplate.addTransaction(txd.id, txd.tx)) {
+      if (blockTemplate.addTransaction(txd.id, txd.tx)) {
         total_size += txd.blobSize;
       }
     }
 
-    for (auto i = m_fee_index.begin(); i != m_fee_index.end(); ++i) {
-      const auto& txd = *i;
+    for (auto it = readyTransactions.first; it != readyTransactions.second; ++it) {
+      const auto& txd = *it;
 
       size_t blockSizeLimit = (txd.fee == 0) ? median_size : max_total_size;
       if (blockSizeLimit < total_size + txd.blobSize) {
         continue;
       }
 
-      TransactionCheckInfo checkInfo(txd);
-      bool ready = is_transaction_ready_to_go(txd.tx, checkInfo);
-
-      // update item state
-      m_fee_index.modify(i, [&checkInfo](TransactionCheckInfo& item) {
-        item = checkInfo;
-      });
-
-      if (ready && blockTemplate.addTransaction(txd.id, txd.tx)) {
+      if (blockTemplate.addTransaction(txd.id, txd.tx)) {
         total_size += txd.blobSize;
         fee += txd.fee;
       }
@@ -393,18 +545,34 @@ namespace CryptoNote {
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
 
     m_config_folder = config_folder;
-    std::string state_file_path = config_folder + "/" + m_currency.txPoolFileName();
-    boost::system::error_code ec;
-    if (!boost::filesystem::exists(state_file_path, ec)) {
+    if (m_config_folder.empty()) {
+      // the pool is not persisted
       return true;
     }
 
-    if (!loadFromBinaryFile(*this, state_file_path)) {
+    if (!Tools::create_directories_if_necessary(m_config_folder)) {
+      logger(ERROR, BRIGHT_RED) << "Failed to create data directory: " << m_config_folder;
+      return false;
+    }
+
+    std::vector<BinaryArray> records;
+    if (!m_journal.open(m_config_folder + "/" + m_currency.txPoolJournalFileName(), records)) {
+      return false;
+    }
+
+    // the pool of an older version is stored at once in the state file
+    std::string state_file_path = config_folder + "/" + m_currency.txPoolFileName();
+    boost::system::error_code ec;
+    if (!records.empty() || !boost::filesystem::exists(state_file_path, ec)) {
+      replayJournal(records);
+    } else if (!loadFromBinaryFile(*this, state_file_path)) {
       logger(ERROR) << "Failed to load memory pool from file " << state_file_path;
 
       m_transactions.clear();
       m_spent_key_images.clear();
       m_spentOutputs.clear();
+      m_uncheckedTransactions.clear();
+      m_transactionsSize = 0;
 
       m_paymentIdIndex.clear();
       m_timestampIndex.clear();
@@ -413,23 +581,18 @@ namespace CryptoNote {
     }
 
     removeExpiredTransactions();
+    compactJournal();
+    boost::filesystem::remove(state_file_path, ec);
 
     // Ignore deserialization error
     return true;
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::deinit() {
-    if (!Tools::create_directories_if_necessary(m_config_folder)) {
-      logger(INFO) << "Failed to create data directory: " << m_config_folder;
-      return false;
-    }
-
-    std::string state_file_path = m_config_folder + "/" + m_currency.txPoolFileName();
-
-    if (!storeToBinaryFile(*this, state_file_path)) {
-      logger(INFO) << "Failed to serialize memory pool to file " << state_file_path;
-    }
+    // the journal is kept up to date, closing waits for a running compaction
+    m_journal.close();
 
+    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
     m_paymentIdIndex.clear();
     m_timestampIndex.clear();
     
@@ -449,6 +612,10 @@ namespace CryptoNote {
     s(td.lastFailedBlock.id, "lastFailedBlock.id");
     s(td.keptByBlock, "keptByBlock");
     s(reinterpret_cast<uint64_t&>(td.receiveTime), "receiveTime");
+
+    if (s.type() == ISerializer::INPUT) {
+      td.ready = false;
+    }
   }
 
   //---------------------------------------------------------------------------------
@@ -466,6 +633,8 @@ namespace CryptoNote {
 
     if (s.type() == ISerializer::INPUT) {
       m_transactions.clear();
+      m_uncheckedTransactions.clear();
+      m_transactionsSize = 0;
       readSequence<TransactionDetails>(std::inserter(m_transactions, m_transactions.end()), "transactions", s);
     } else {
       writeSequence<TransactionDetails>(m_transactions.begin(), m_transactions.end(), "transactions", s);
@@ -474,11 +643,20 @@ namespace CryptoNote {
     KV_MEMBER(m_spent_key_images);
     KV_MEMBER(m_spentOutputs);
     KV_MEMBER(m_recentlyDeletedTransactions);
+    if (s.type() == ISerializer::INPUT) {
+      forgetOldestDeletedTransactions();
+    }
   }
 
   //---------------------------------------------------------------------------------
   void tx_memory_pool::on_idle() {
     m_txCheckInterval.call([this](){ return removeExpiredTransactions(); });
+
+    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    uint64_t journalSize = m_journal.size();
+    if (journalSize > MIN_JOURNAL_SIZE_TO_COMPACT && journalSize > 2 * m_transactionsSize && !m_journal.isCompacting()) {
+      compactJournal();
+    }
   }
 
   //---------------------------------------------------------------------------------
@@ -504,7 +682,8 @@ namespace CryptoNote {
 
         if (remove) {
           logger(TRACE) << "Tx " << it->id << " removed from tx pool due to outdated, age: " << txAge;
-          m_recentlyDeletedTransactions.emplace(it->id, now);
+          addRecentlyDeletedTransaction(it->id, now);
+          m_journal.append(makeJournalRecord(JOURNAL_DELETE_TRANSACTION, it->id, now));
           it = removeTransaction(it);
           somethingRemoved = true;
         } else {
@@ -519,11 +698,87 @@ namespace CryptoNote {
 
     return true;
   }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::addRecentlyDeletedTransaction(const Crypto::Hash& id, uint64_t time) {
+    m_recentlyDeletedTransactions[id] = time;
+    forgetOldestDeletedTransactions();
+  }
+
+  // The older half of the deleted transactions is forgotten once there are too many of them, they may be added again
+  void tx_memory_pool::forgetOldestDeletedTransactions() {
+    if (m_recentlyDeletedTransactions.size() <= parameters::CRYPTONOTE_MEMPOOL_RECENTLY_DELETED_MAX_COUNT) {
+      return;
+    }
+
+    std::vector<uint64_t> times;
+    times.reserve(m_recentlyDeletedTransactions.size());
+    for (const auto& deletedTransaction : m_recentlyDeletedTransactions) {
+      times.push_back(deletedTransaction.second);
+    }
+
+    auto median = times.begin() + times.size() / 2;
+    std::nth_element(times.begin(), median, times.end());
+    for (auto it = m_recentlyDeletedTransactions.begin(); it != m_recentlyDeletedTransactions.end();) {
+      if (it->second <= *median) {
+        it = m_recentlyDeletedTransactions.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  // Makes room for a transaction of blobSize bytes paying fee by evicting the transactions with the lowest fee per byte,
+  // nothing is evicted unless all of them pay less than the new transaction
+  bool tx_memory_pool::evictTransactions(size_t blobSize, uint64_t fee, size_t& evictedCount) {
+    size_t maxSize = m_currency.mempoolMaxSize();
+    if (m_transactionsSize + blobSize <= maxSize) {
+      return true;
+    }
+
+    TransactionDetails transaction;
+    transaction.fee = fee;
+    transaction.blobSize = blobSize;
+    transaction.receiveTime = m_timeProvider.now();
+
+    std::vector<tx_container_t::iterator> evictedTransactions;
+    size_t evictedSize = 0;
+    for (auto it = m_fee_index.rbegin(); it != m_fee_index.rend() && m_transactionsSize - evictedSize + blobSize > maxSize; ++it) {
+      if (it->keptByBlock) {
+        continue;
+      }
+
+      if (!TransactionPriorityComparator()(transaction, *it)) {
+        return false;
+      }
+
+      evictedTransactions.push_back(m_transactions.project<0>(std::prev(it.base())));
+      evictedSize += it->blobSize;
+    }
+
+    if (m_transactionsSize - evictedSize + blobSize > maxSize) {
+      return false;
+    }
+
+    for (auto it : evictedTransactions) {
+      logger(DEBUGGING) << "Tx " << it->id << " evicted from tx pool, fee: " << m_currency.formatAmount(it->fee) << ", size: " << it->blobSize;
+      m_evictedTransactionsSize += it->blobSize;
+      removeTransaction(it);
+    }
+
+    m_evictedTransactionsCount += evictedTransactions.size();
+    evictedCount = evictedTransactions.size();
+    logger(INFO) << "Transaction pool is full, " << evictedCount << " transactions evicted, " << m_evictedTransactionsCount <<
+      " transactions of " << m_evictedTransactionsSize << " bytes evicted since start";
+    return true;
+  }
 
   tx_memory_pool::tx_container_t::iterator tx_memory_pool::removeTransaction(tx_memory_pool::tx_container_t::iterator i) {
     removeTransactionInputs(i->id, i->tx, i->keptByBlock);
+    m_uncheckedTransactions.erase(i->id);
+    m_transactionsSize -= i->blobSize;
     m_paymentIdIndex.remove(i->tx);
     m_timestampIndex.remove(i->receiveTime, i->id);
+    m_journal.append(makeJournalRecord(JOURNAL_REMOVE_TRANSACTION, i->id));
     return m_transactions.erase(i);
   }
 
@@ -622,7 +877,109 @@ namespace CryptoNote {
     for (auto it = m_transactions.begin(); it != m_transactions.end(); it++) {
       m_paymentIdIndex.add(it->tx);
       m_timestampIndex.add(it->receiveTime, it->id);
+      m_uncheckedTransactions.insert(it->id);
+      m_transactionsSize += it->blobSize;
+    }
+  }
+
+  // Restores the pool from the journal records, the inputs of the transactions are checked against the current chain
+  // on all cores first, the transactions that are no longer valid are dropped
+  void tx_memory_pool::replayJournal(const std::vector<BinaryArray>& records) {
+    std::vector<TransactionDetails> transactions;
+    std::unordered_map<Crypto::Hash, size_t> transactionIndexes;
+    std::vector<bool> removed;
+
+    for (const auto& record : records) {
+      try {
+        Common::MemoryInputStream stream(record.data(), record.size());
+        BinaryInputStreamSerializer serializer(stream);
+        uint8_t recordType;
+        serializer(recordType, "type");
+        if (recordType == JOURNAL_ADD_TRANSACTION) {
+          TransactionDetails transaction;
+          CryptoNote::serialize(transaction, serializer);
+          auto result = transactionIndexes.emplace(transaction.id, transactions.size());
+          if (result.second) {
+            transactions.push_back(std::move(transaction));
+            removed.push_back(false);
+          }
+        } else if (recordType == JOURNAL_REMOVE_TRANSACTION || recordType == JOURNAL_DELETE_TRANSACTION) {
+          Crypto::Hash id;
+          serializer(id, "id");
+          if (recordType == JOURNAL_DELETE_TRANSACTION) {
+            uint64_t time;
+            serializer(time, "time");
+            addRecentlyDeletedTransaction(id, time);
+          }
+
+          auto it = transactionIndexes.find(id);
+          if (it != transactionIndexes.end()) {
+            removed[it->second] = true;
+            transactionIndexes.erase(it);
+          }
+        } else {
+          logger(WARNING) << "Unknown transaction pool journal record type " << static_cast<unsigned>(recordType);
+        }
+      } catch (std::exception& e) {
+        logger(WARNING) << "Failed to read transaction pool journal record: " << e.what();
+      }
+    }
+
+    std::vector<TransactionDetails*> loadedTransactions;
+    for (size_t i = 0; i < transactions.size(); ++i) {
+      if (!removed[i]) {
+        loadedTransactions.push_back(&transactions[i]);
+      }
+    }
+
+    std::vector<uint8_t> inputsValid(loadedTransactions.size());
+    Tools::parallelFor(loadedTransactions.size(), std::max(std::thread::hardware_concurrency(), 1u), [&](size_t i) {
+      TransactionDetails& transaction = *loadedTransactions[i];
+      transaction.maxUsedBlock.clear();
+      transaction.lastFailedBlock.clear();
+      inputsValid[i] = m_validator.checkTransactionInputs(transaction.tx, transaction.maxUsedBlock);
+    });
+
+    size_t droppedCount = 0;
+    for (size_t i = 0; i < loadedTransactions.size(); ++i) {
+      TransactionDetails& transaction = *loadedTransactions[i];
+      if (!transaction.keptByBlock && (!inputsValid[i] || haveSpentInputs(transaction.tx))) {
+        logger(DEBUGGING) << "Tx " << transaction.id << " from the transaction pool journal is no longer valid";
+        ++droppedCount;
+        continue;
+      }
+
+      Crypto::Hash id = transaction.id;
+      auto result = m_transactions.insert(std::move(transaction));
+      if (!result.second) {
+        continue;
+      }
+
+      m_paymentIdIndex.add(result.first->tx);
+      m_timestampIndex.add(result.first->receiveTime, id);
+      m_uncheckedTransactions.insert(id);
+      m_transactionsSize += result.first->blobSize;
+      addTransactionInputs(id, result.first->tx, result.first->keptByBlock);
+    }
+
+    if (!loadedTransactions.empty()) {
+      logger(INFO) << "Transaction pool restored from journal: " << m_transactions.size() << " transactions loaded, " <<
+        droppedCount << " dropped";
+    }
+  }
+
+  void tx_memory_pool::compactJournal() {
+    std::vector<BinaryArray> snapshot;
+    snapshot.reserve(m_transactions.size() + m_recentlyDeletedTransactions.size());
+    for (const auto& transaction : m_transactions) {
+      snapshot.push_back(makeJournalRecord(transaction));
     }
+
+    for (const auto& deletedTransaction : m_recentlyDeletedTransactions) {
+      snapshot.push_back(makeJournalRecord(JOURNAL_DELETE_TRANSACTION, deletedTransaction.first, deletedTransaction.second));
+    }
+
+    m_journal.compact(std::move(snapshot));
   }
 
   bool tx_memory_pool::getTransactionIdsByPaymentId(const Crypto::Hash& paymentId, std::vector<Crypto::Hash>& transactionIds) {
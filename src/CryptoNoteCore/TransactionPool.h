@@ -12,6 +12,7 @@
 
 // multi index
 #include <boost/multi_index_container.hpp>
+#include <boost/multi_index/composite_key.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/member.hpp>
@@ -27,6 +28,7 @@
 #include "CryptoNoteCore/ITimeProvider.h"
 #include "CryptoNoteCore/ITransactionValidator.h"
 #include "CryptoNoteCore/ITxPoolObserver.h"
+#include "CryptoNoteCore/TransactionPoolJournal.h"
 #include "CryptoNoteCore/VerificationContext.h"
 #include "CryptoNoteCore/BlockchainIndices.h"
 
@@ -79,7 +81,7 @@ namespace CryptoNote {
     bool addObserver(ITxPoolObserver* observer);
     bool removeObserver(ITxPoolObserver* observer);
 
-    // load/store operations
+    // load/store operations, the blockchain has to be initialized before the pool to verify the loaded transactions
     bool init(const std::string& config_folder);
     bool deinit();
 
@@ -89,7 +91,8 @@ namespace CryptoNote {
     //gets tx and remove it from pool
     bool take_tx(const Crypto::Hash &id, Transaction &tx, size_t& blobSize, uint64_t& fee);
 
-    bool on_blockchain_inc(uint64_t new_block_height, const Crypto::Hash& top_block_id);
+    // Transactions spending spentKeyImages and the ones waiting for the chain are checked again when they are next needed
+    bool on_blockchain_inc(uint64_t new_block_height, const Crypto::Hash& top_block_id, const std::vector<Crypto::KeyImage>& spentKeyImages);
     bool on_blockchain_dec(uint64_t new_block_height, const Crypto::Hash& top_block_id);
 
     void lock() const;
@@ -99,8 +102,13 @@ namespace CryptoNote {
     bool fill_block_template(Block &bl, size_t median_size, size_t maxCumulativeSize, uint64_t already_generated_coins, size_t &total_size, uint64_t &fee);
 
     void get_transactions(std::list<Transaction>& txs) const;
-    void get_difference(const std::vector<Crypto::Hash>& known_tx_ids, std::vector<Crypto::Hash>& new_tx_ids, std::vector<Crypto::Hash>& deleted_tx_ids) const;
+    void get_difference(const std::vector<Crypto::Hash>& known_tx_ids, std::vector<Crypto::Hash>& new_tx_ids, std::vector<Crypto::Hash>& deleted_tx_ids);
     size_t get_transactions_count() const;
+    size_t getTransactionsSize() const;
+    uint64_t getEvictedTransactionsCount() const;
+    // Minimum fee of a relayed transaction, it rises from the currency minimum to twice that while the pool fills up
+    // from the half of its size limit
+    uint64_t getMinimumFee() const;
     std::string print_pool(bool short_format) const;
     void on_idle();
 
@@ -135,6 +143,8 @@ namespace CryptoNote {
       uint64_t fee;
       bool keptByBlock;
       time_t receiveTime;
+      // Inputs were valid and unspent when the transaction was last checked against the chain
+      bool ready;
     };
 
   private:
@@ -162,9 +172,14 @@ namespace CryptoNote {
 
     typedef hashed_unique<BOOST_MULTI_INDEX_MEMBER(TransactionDetails, Crypto::Hash, id)> main_index_t;
     typedef ordered_non_unique<identity<TransactionDetails>, TransactionPriorityComparator> fee_index_t;
+    // Ready transactions first, each part ordered by priority
+    typedef ordered_non_unique<
+      composite_key<TransactionDetails, BOOST_MULTI_INDEX_MEMBER(TransactionDetails, bool, ready), identity<TransactionDetails>>,
+      composite_key_compare<std::greater<bool>, TransactionPriorityComparator>
+    > ready_index_t;
 
     typedef multi_index_container<TransactionDetails,
-      indexed_by<main_index_t, fee_index_t>
+      indexed_by<main_index_t, fee_index_t, ready_index_t>
     > tx_container_t;
 
     typedef std::pair<uint64_t, uint64_t> GlobalOutput;
@@ -179,10 +194,18 @@ namespace CryptoNote {
 
     tx_container_t::iterator removeTransaction(tx_container_t::iterator i);
     bool removeExpiredTransactions();
+    bool evictTransactions(size_t blobSize, uint64_t fee, size_t& evictedCount);
+    void addRecentlyDeletedTransaction(const Crypto::Hash& id, uint64_t time);
+    void forgetOldestDeletedTransactions();
     bool is_transaction_ready_to_go(const Transaction& tx, TransactionCheckInfo& txd) const;
+    void uncheckTransaction(tx_container_t::iterator i);
+    void checkTransactions();
 
     void buildIndices();
 
+    void replayJournal(const std::vector<BinaryArray>& records);
+    void compactJournal();
+
     Tools::ObserverManager<ITxPoolObserver> m_observerManager;
     const CryptoNote::Currency& m_currency;
     OnceInTimeInterval m_txCheckInterval;
@@ -196,12 +219,20 @@ namespace CryptoNote {
 
     tx_container_t m_transactions;  
     tx_container_t::nth_index<1>::type& m_fee_index;
+    tx_container_t::nth_index<2>::type& m_ready_index;
+    // Transactions whose readiness has to be checked again
+    std::unordered_set<Crypto::Hash> m_uncheckedTransactions;
     std::unordered_map<Crypto::Hash, uint64_t> m_recentlyDeletedTransactions;
+    size_t m_transactionsSize;
+    uint64_t m_evictedTransactionsCount;
+    uint64_t m_evictedTransactionsSize;
 
     Logging::LoggerRef logger;
 
     PaymentIdIndex m_paymentIdIndex;
     TimestampTransactionsIndex m_timestampIndex;
+
+    TransactionPoolJournal m_journal;
   };
 }
 
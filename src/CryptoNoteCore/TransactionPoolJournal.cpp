@@ -0,0 +1,216 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "TransactionPoolJournal.h"
+
+#include <cstring>
+#include <functional>
+
+#include <boost/filesystem.hpp>
+
+#include "crypto/hash.h"
+
+using namespace Logging;
+
+#undef ERROR
+
+namespace CryptoNote {
+
+namespace {
+
+const uint32_t MAX_RECORD_SIZE = 64 * 1024 * 1024;
+
+uint32_t getChecksum(const uint8_t* data, size_t size) {
+  Crypto::Hash hash;
+  Crypto::cn_fast_hash(data, size, hash);
+  uint32_t checksum;
+  memcpy(&checksum, &hash, sizeof(checksum));
+  return checksum;
+}
+
+uint64_t writeRecord(std::ostream& stream, const BinaryArray& record) {
+  uint32_t size = static_cast<uint32_t>(record.size());
+  uint32_t checksum = getChecksum(record.data(), record.size());
+  stream.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  stream.write(reinterpret_cast<const char*>(record.data()), record.size());
+  stream.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+  return sizeof(size) + record.size() + sizeof(checksum);
+}
+
+// Returns the size of the valid part of the file
+uint64_t readRecords(std::istream& stream, uint64_t fileSize, std::vector<BinaryArray>& records) {
+  uint64_t validSize = 0;
+  for (;;) {
+    uint32_t size;
+    if (!stream.read(reinterpret_cast<char*>(&size), sizeof(size)) || size > MAX_RECORD_SIZE ||
+      validSize + sizeof(size) + size + sizeof(uint32_t) > fileSize) {
+      break;
+    }
+
+    BinaryArray record(size);
+    uint32_t checksum;
+    if (!stream.read(reinterpret_cast<char*>(record.data()), size) || !stream.read(reinterpret_cast<char*>(&checksum), sizeof(checksum)) ||
+      checksum != getChecksum(record.data(), record.size())) {
+      break;
+    }
+
+    records.push_back(std::move(record));
+    validSize += sizeof(size) + size + sizeof(checksum);
+  }
+
+  return validSize;
+}
+
+}
+
+TransactionPoolJournal::TransactionPoolJournal(Logging::ILogger& log) : logger(log, "txpool"), m_size(0), m_compacting(false) {
+}
+
+TransactionPoolJournal::~TransactionPoolJournal() {
+  close();
+}
+
+bool TransactionPoolJournal::open(const std::string& fileName, std::vector<BinaryArray>& records) {
+  close();
+
+  boost::system::error_code ec;
+  boost::filesystem::remove(fileName + ".new", ec);
+
+  uint64_t validSize = 0;
+  if (boost::filesystem::exists(fileName, ec)) {
+    uint64_t fileSize = boost::filesystem::file_size(fileName, ec);
+    std::ifstream file(fileName, std::ios::in | std::ios::binary);
+    if (ec || !file) {
+      logger(ERROR, BRIGHT_RED) << "Failed to read transaction pool journal " << fileName;
+      return false;
+    }
+
+    validSize = readRecords(file, fileSize, records);
+    file.close();
+    if (validSize != fileSize) {
+      logger(WARNING) << "Transaction pool journal " << fileName << " is truncated to " << validSize << " of " << fileSize << " bytes";
+      boost::filesystem::resize_file(fileName, validSize, ec);
+      if (ec) {
+        logger(ERROR, BRIGHT_RED) << "Failed to truncate transaction pool journal " << fileName << ": " << ec.message();
+        return false;
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_file.open(fileName, std::ios::out | std::ios::binary | std::ios::app);
+  if (!m_file) {
+    logger(ERROR, BRIGHT_RED) << "Failed to open transaction pool journal " << fileName;
+    return false;
+  }
+
+  m_fileName = fileName;
+  m_size = validSize;
+  return true;
+}
+
+void TransactionPoolJournal::close() {
+  if (m_compactionThread.joinable()) {
+    m_compactionThread.join();
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_file.is_open()) {
+    m_file.close();
+  }
+
+  m_size = 0;
+}
+
+bool TransactionPoolJournal::isOpen() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_file.is_open();
+}
+
+void TransactionPoolJournal::append(const BinaryArray& record) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_file.is_open()) {
+    return;
+  }
+
+  m_size += writeRecord(m_file, record);
+  m_file.flush();
+  if (m_compacting) {
+    m_compactionRecords.push_back(record);
+  }
+}
+
+uint64_t TransactionPoolJournal::size() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_size;
+}
+
+bool TransactionPoolJournal::isCompacting() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_compacting;
+}
+
+void TransactionPoolJournal::compact(std::vector<BinaryArray>&& snapshot) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.is_open() || m_compacting) {
+      return;
+    }
+
+    m_compacting = true;
+  }
+
+  if (m_compactionThread.joinable()) {
+    m_compactionThread.join();
+  }
+
+  m_compactionThread = std::thread(std::bind(&TransactionPoolJournal::writeSnapshot, this, std::move(snapshot)));
+}
+
+void TransactionPoolJournal::writeSnapshot(const std::vector<BinaryArray>& snapshot) {
+  std::string compactedFileName = m_fileName + ".new";
+  std::ofstream compactedFile(compactedFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+  for (const auto& record : snapshot) {
+    writeRecord(compactedFile, record);
+  }
+
+  finishCompaction(compactedFileName, compactedFile);
+}
+
+void TransactionPoolJournal::finishCompaction(const std::string& compactedFileName, std::ofstream& compactedFile) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_compacting = false;
+
+  for (const auto& record : m_compactionRecords) {
+    writeRecord(compactedFile, record);
+  }
+
+  m_compactionRecords.clear();
+  compactedFile.close();
+
+  boost::system::error_code ec;
+  if (!compactedFile) {
+    logger(ERROR, BRIGHT_RED) << "Failed to write transaction pool journal " << compactedFileName;
+    boost::filesystem::remove(compactedFileName, ec);
+    return;
+  }
+
+  uint64_t compactedSize = boost::filesystem::file_size(compactedFileName, ec);
+  m_file.close();
+  boost::filesystem::rename(compactedFileName, m_fileName, ec);
+  if (ec) {
+    logger(ERROR, BRIGHT_RED) << "Failed to replace transaction pool journal " << m_fileName << ": " << ec.message();
+    boost::filesystem::remove(compactedFileName, ec);
+  } else {
+    logger(DEBUGGING) << "Transaction pool journal compacted from " << m_size << " to " << compactedSize << " bytes";
+    m_size = compactedSize;
+  }
+
+  m_file.open(m_fileName, std::ios::out | std::ios::binary | std::ios::app);
+  if (!m_file) {
+    logger(ERROR, BRIGHT_RED) << "Failed to open transaction pool journal " << m_fileName;
+  }
+}
+
+}
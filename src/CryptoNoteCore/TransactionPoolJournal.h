@@ -0,0 +1,56 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CryptoNote.h"
+
+#include <Logging/LoggerRef.h>
+
+namespace CryptoNote {
+
+// Append only file of the changes of the transaction pool. Each record is stored with its size and checksum, so a
+// record torn by a crash is dropped when the journal is opened. Compaction rewrites the journal from a snapshot on a
+// background thread, the records appended meanwhile go to the old file as well as to the new one.
+class TransactionPoolJournal {
+public:
+  explicit TransactionPoolJournal(Logging::ILogger& log);
+  ~TransactionPoolJournal();
+
+  TransactionPoolJournal(const TransactionPoolJournal&) = delete;
+  TransactionPoolJournal& operator=(const TransactionPoolJournal&) = delete;
+
+  // Reads the valid records of the journal and opens it for appending
+  bool open(const std::string& fileName, std::vector<BinaryArray>& records);
+  void close();
+  bool isOpen() const;
+
+  void append(const BinaryArray& record);
+  uint64_t size() const;
+
+  bool isCompacting() const;
+  // Replaces the journal with the snapshot records, followed by the ones appended until the snapshot is written
+  void compact(std::vector<BinaryArray>&& snapshot);
+
+private:
+  void writeSnapshot(const std::vector<BinaryArray>& snapshot);
+  void finishCompaction(const std::string& compactedFileName, std::ofstream& compactedFile);
+
+  Logging::LoggerRef logger;
+  mutable std::mutex m_mutex;
+  std::string m_fileName;
+  std::ofstream m_file;
+  uint64_t m_size;
+  bool m_compacting;
+  std::vector<BinaryArray> m_compactionRecords;
+  std::thread m_compactionThread;
+};
+
+}
@@ -196,4 +196,78 @@ namespace CryptoNote
     const static int ID = BC_COMMANDS_POOL_BASE + 8;
     typedef NOTIFY_REQUEST_TX_POOL_request request;
   };
+
+  /************************************************************************/
+  /*                                                                      */
+  /************************************************************************/
+  // The block blob carries the header, the coinbase transaction and the hashes of the other transactions, the receiver
+  // finds them in its pool
+  struct NOTIFY_NEW_COMPACT_BLOCK_request
+  {
+    std::string block;
+    uint32_t current_blockchain_height;
+    uint32_t hop;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(block)
+      KV_MEMBER(current_blockchain_height)
+      KV_MEMBER(hop)
+    }
+  };
+
+  struct NOTIFY_NEW_COMPACT_BLOCK
+  {
+    const static int ID = BC_COMMANDS_POOL_BASE + 9;
+    typedef NOTIFY_NEW_COMPACT_BLOCK_request request;
+  };
+
+  struct NOTIFY_REQUEST_BLOCK_TRANSACTIONS_request
+  {
+    Crypto::Hash block_id;
+    std::vector<Crypto::Hash> txs;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(block_id)
+      serializeAsBinary(txs, "txs", s);
+    }
+  };
+
+  struct NOTIFY_REQUEST_BLOCK_TRANSACTIONS
+  {
+    const static int ID = BC_COMMANDS_POOL_BASE + 10;
+    typedef NOTIFY_REQUEST_BLOCK_TRANSACTIONS_request request;
+  };
+
+  // The block with the requested transactions only
+  struct NOTIFY_RESPONSE_BLOCK_TRANSACTIONS
+  {
+    const static int ID = BC_COMMANDS_POOL_BASE + 11;
+    typedef NOTIFY_NEW_BLOCK_request request;
+  };
+
+  /************************************************************************/
+  /*                                                                      */
+  /************************************************************************/
+  struct NOTIFY_TRANSACTION_IDS_request
+  {
+    std::vector<Crypto::Hash> txs;
+
+    void serialize(ISerializer& s) {
+      serializeAsBinary(txs, "txs", s);
+    }
+  };
+
+  // New transactions are announced by id, the receiver requests those it doesn't have
+  struct NOTIFY_ANNOUNCE_TRANSACTIONS
+  {
+    const static int ID = BC_COMMANDS_POOL_BASE + 12;
+    typedef NOTIFY_TRANSACTION_IDS_request request;
+  };
+
+  // Answered with NOTIFY_NEW_TRANSACTIONS carrying the requested transactions the peer has
+  struct NOTIFY_REQUEST_TRANSACTIONS
+  {
+    const static int ID = BC_COMMANDS_POOL_BASE + 13;
+    typedef NOTIFY_TRANSACTION_IDS_request request;
+  };
 }
@@ -8,6 +8,7 @@
 #include <boost/scope_exit.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <System/Dispatcher.h>
+#include <System/RemoteContext.h>
 
 #include "CryptoNoteCore/CryptoNoteBasicImpl.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
@@ -25,12 +26,7 @@ namespace {
 
 template<class t_parametr>
 bool post_notify(IP2pEndpoint& p2p, typename t_parametr::request& arg, const CryptoNoteConnectionContext& context) {
-  return p2p.invoke_notify_to_peer(t_parametr::ID, LevinProtocol::encode(arg), context);
-}
-
-template<class t_parametr>
-void relay_post_notify(IP2pEndpoint& p2p, typename t_parametr::request& arg, const net_connection_id* excludeConnection = nullptr) {
-  p2p.relay_notify_to_all(t_parametr::ID, LevinProtocol::encode(arg), excludeConnection);
+  return p2p.invoke_notify_to_peer(t_parametr::ID, std::make_shared<const BinaryArray>(LevinProtocol::encode(arg)), context);
 }
 
 }
@@ -43,7 +39,14 @@ CryptoNoteProtocolHandler::CryptoNoteProtocolHandler(const Currency& currency, S
   m_synchronized(false),
   m_stop(false),
   m_observedHeight(0),
+  m_syncScheduler(BLOCKS_SYNCHRONIZING_DEFAULT_COUNT, BLOCKS_SYNCHRONIZING_MIN_COUNT, BLOCKS_SYNCHRONIZING_PENDING_MAX_COUNT,
+    std::chrono::seconds(BLOCKS_SYNCHRONIZING_RANGE_SECONDS), std::chrono::seconds(BLOCKS_SYNCHRONIZING_TIMEOUT)),
+  m_addingBlocks(false),
+  m_addingContextGroup(dispatcher),
+  m_transactionInventory(TRANSACTIONS_RELAY_KNOWN_MAX_COUNT, TRANSACTIONS_RELAY_ANNOUNCED_MAX_COUNT,
+    TRANSACTIONS_RELAY_CONNECTION_ANNOUNCED_MAX_COUNT, std::chrono::seconds(TRANSACTIONS_RELAY_REQUEST_TIMEOUT)),
   m_peersCount(0),
+  m_copiedBytes(0),
   logger(log, "protocol") {
   
   if (!m_p2p) {
@@ -66,6 +69,9 @@ void CryptoNoteProtocolHandler::onConnectionOpened(CryptoNoteConnectionContext&
 }
 
 void CryptoNoteProtocolHandler::onConnectionClosed(CryptoNoteConnectionContext& context) {
+  m_syncScheduler.removeConnection(context.m_connection_id);
+  m_transactionInventory.removeConnection(context.m_connection_id);
+
   bool updated = false;
   {
     std::lock_guard<std::mutex> lock(m_observedHeightMutex);
@@ -89,6 +95,8 @@ void CryptoNoteProtocolHandler::onConnectionClosed(CryptoNoteConnectionContext&
 
 void CryptoNoteProtocolHandler::stop() {
   m_stop = true;
+  // The blocks are added in a context of their own, it stops once the block being added is added
+  m_addingContextGroup.wait();
 }
 
 bool CryptoNoteProtocolHandler::start_sync(CryptoNoteConnectionContext& context) {
@@ -212,6 +220,11 @@ int CryptoNoteProtocolHandler::handleCommand(bool is_notify, int command, const
     HANDLE_NOTIFY(NOTIFY_REQUEST_CHAIN, &CryptoNoteProtocolHandler::handle_request_chain)
     HANDLE_NOTIFY(NOTIFY_RESPONSE_CHAIN_ENTRY, &CryptoNoteProtocolHandler::handle_response_chain_entry)
     HANDLE_NOTIFY(NOTIFY_REQUEST_TX_POOL, &CryptoNoteProtocolHandler::handleRequestTxPool)
+    HANDLE_NOTIFY(NOTIFY_NEW_COMPACT_BLOCK, &CryptoNoteProtocolHandler::handle_notify_new_compact_block)
+    HANDLE_NOTIFY(NOTIFY_REQUEST_BLOCK_TRANSACTIONS, &CryptoNoteProtocolHandler::handle_request_block_transactions)
+    HANDLE_NOTIFY(NOTIFY_RESPONSE_BLOCK_TRANSACTIONS, &CryptoNoteProtocolHandler::handle_response_block_transactions)
+    HANDLE_NOTIFY(NOTIFY_ANNOUNCE_TRANSACTIONS, &CryptoNoteProtocolHandler::handle_notify_announce_transactions)
+    HANDLE_NOTIFY(NOTIFY_REQUEST_TRANSACTIONS, &CryptoNoteProtocolHandler::handle_request_transactions)
 
   default:
     handled = false;
@@ -252,9 +265,7 @@ int CryptoNoteProtocolHandler::handle_notify_new_block(int command, NOTIFY_NEW_B
   }
   if (bvc.m_added_to_main_chain) {
     ++arg.hop;
-    //TODO: Add here announce protocol usage
-    relay_post_notify<NOTIFY_NEW_BLOCK>(*m_p2p, arg, &context.m_connection_id);
-    // relay_block(arg, context);
+    relayBlock(arg, &context.m_connection_id);
 
     if (bvc.m_switched_to_alt_chain) {
       requestMissingPoolTransactions(context);
@@ -270,32 +281,231 @@ int CryptoNoteProtocolHandler::handle_notify_new_block(int command, NOTIFY_NEW_B
   return 1;
 }
 
+int CryptoNoteProtocolHandler::handle_notify_new_compact_block(int command, NOTIFY_NEW_COMPACT_BLOCK::request& arg, CryptoNoteConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_NEW_COMPACT_BLOCK (hop " << arg.hop << ")";
+
+  NOTIFY_NEW_BLOCK::request blockArg;
+  blockArg.b.block = std::move(arg.block);
+  blockArg.current_blockchain_height = arg.current_blockchain_height;
+  blockArg.hop = arg.hop;
+  return addCompactBlock(blockArg, context);
+}
+
+// For the messages made of blobs that could be shared, but are encoded again for one peer
+template<class Command>
+bool CryptoNoteProtocolHandler::notifyPeerCopy(typename Command::request& arg, const CryptoNoteConnectionContext& context) {
+  auto buffer = std::make_shared<const BinaryArray>(LevinProtocol::encode(arg));
+  m_copiedBytes += buffer->size();
+  return m_p2p->invoke_notify_to_peer(Command::ID, buffer, context);
+}
+
+int CryptoNoteProtocolHandler::handle_request_block_transactions(int command, NOTIFY_REQUEST_BLOCK_TRANSACTIONS::request& arg,
+  CryptoNoteConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_REQUEST_BLOCK_TRANSACTIONS: txs.size()=" << arg.txs.size();
+
+  Block block;
+  if (!m_core.getBlockByHash(arg.block_id, block)) {
+    logger(Logging::DEBUGGING) << context << "Transactions of unknown block " << arg.block_id << " requested";
+    return 1;
+  }
+
+  std::unordered_set<Crypto::Hash> blockTransactions(block.transactionHashes.begin(), block.transactionHashes.end());
+  std::vector<Crypto::Hash> requestedTransactions;
+  for (const auto& transactionHash : arg.txs) {
+    if (blockTransactions.count(transactionHash) != 0) {
+      requestedTransactions.push_back(transactionHash);
+    }
+  }
+
+  std::list<Transaction> transactions;
+  std::list<Crypto::Hash> missedTransactions;
+  m_core.getTransactions(requestedTransactions, transactions, missedTransactions, true);
+  if (!missedTransactions.empty()) {
+    // The peer gets the block by synchronizing then
+    logger(Logging::DEBUGGING) << context << "Transactions of block " << arg.block_id << " are missing, the block isn't sent";
+    return 1;
+  }
+
+  NOTIFY_RESPONSE_BLOCK_TRANSACTIONS::request response;
+  response.b.block = asString(toBinaryArray(block));
+  for (const auto& transaction : transactions) {
+    response.b.txs.push_back(asString(toBinaryArray(transaction)));
+  }
+
+  response.current_blockchain_height = get_current_blockchain_height() + 1;
+  response.hop = 0;
+  logger(Logging::TRACE) << context << "-->>NOTIFY_RESPONSE_BLOCK_TRANSACTIONS: txs.size()=" << response.b.txs.size();
+  notifyPeerCopy<NOTIFY_RESPONSE_BLOCK_TRANSACTIONS>(response, context);
+  return 1;
+}
+
+int CryptoNoteProtocolHandler::handle_response_block_transactions(int command, NOTIFY_RESPONSE_BLOCK_TRANSACTIONS::request& arg,
+  CryptoNoteConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_RESPONSE_BLOCK_TRANSACTIONS: txs.size()=" << arg.b.txs.size();
+  return addCompactBlock(arg, context);
+}
+
+// Completes the block with the transactions found in the pool and adds it as if it was received in full. The missing
+// ones are requested from the peer, which answers with the block and them. Should the block be still incomplete, a
+// transaction left the pool meanwhile and all of its transactions are requested. A peer sending transactions which
+// aren't in the block is dropped.
+int CryptoNoteProtocolHandler::addCompactBlock(NOTIFY_NEW_BLOCK::request& arg, CryptoNoteConnectionContext& context) {
+  updateObservedHeight(arg.current_blockchain_height, context);
+  context.m_remote_blockchain_height = arg.current_blockchain_height;
+
+  if (context.m_state != CryptoNoteConnectionContext::state_normal) {
+    return 1;
+  }
+
+  Block block;
+  if (!fromBinaryArray(block, asBinaryArray(arg.b.block))) {
+    logger(Logging::INFO) << context << "Failed to parse the compact block, dropping connection";
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  Crypto::Hash blockId = get_block_hash(block);
+  if (m_core.have_block(blockId)) {
+    return 1;
+  }
+
+  std::unordered_set<Crypto::Hash> blockTransactions(block.transactionHashes.begin(), block.transactionHashes.end());
+  std::unordered_set<Crypto::Hash> receivedTransactions;
+  for (const auto& transactionBlob : arg.b.txs) {
+    Crypto::Hash transactionHash = getBinaryArrayHash(asBinaryArray(transactionBlob));
+    if (blockTransactions.count(transactionHash) == 0) {
+      logger(Logging::INFO) << context << "Sent transaction " << transactionHash << " isn't in block " << blockId << ", dropping connection";
+      context.m_state = CryptoNoteConnectionContext::state_shutdown;
+      return 1;
+    }
+
+    receivedTransactions.insert(transactionHash);
+  }
+
+  std::vector<Crypto::Hash> neededTransactions;
+  for (const auto& transactionHash : block.transactionHashes) {
+    if (receivedTransactions.count(transactionHash) == 0) {
+      neededTransactions.push_back(transactionHash);
+    }
+  }
+
+  std::list<Transaction> transactions;
+  std::list<Crypto::Hash> missedTransactions;
+  m_core.getTransactions(neededTransactions, transactions, missedTransactions, true);
+  if (!missedTransactions.empty()) {
+    NOTIFY_REQUEST_BLOCK_TRANSACTIONS::request request;
+    request.block_id = blockId;
+    if (arg.b.txs.empty()) {
+      request.txs.assign(missedTransactions.begin(), missedTransactions.end());
+    } else if (arg.b.txs.size() < block.transactionHashes.size()) {
+      request.txs = block.transactionHashes;
+    } else {
+      logger(Logging::INFO) << context << "Sent transactions don't match block " << blockId << ", dropping connection";
+      context.m_state = CryptoNoteConnectionContext::state_shutdown;
+      return 1;
+    }
+
+    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_BLOCK_TRANSACTIONS: txs.size()=" << request.txs.size();
+    post_notify<NOTIFY_REQUEST_BLOCK_TRANSACTIONS>(*m_p2p, request, context);
+    return 1;
+  }
+
+  for (const auto& transaction : transactions) {
+    arg.b.txs.push_back(asString(toBinaryArray(transaction)));
+  }
+
+  return handle_notify_new_block(NOTIFY_NEW_BLOCK::ID, arg, context);
+}
+
 int CryptoNoteProtocolHandler::handle_notify_new_transactions(int command, NOTIFY_NEW_TRANSACTIONS::request& arg, CryptoNoteConnectionContext& context) {
   logger(Logging::TRACE) << context << "NOTIFY_NEW_TRANSACTIONS";
   if (context.m_state != CryptoNoteConnectionContext::state_normal)
     return 1;
 
-  for (auto tx_blob_it = arg.txs.begin(); tx_blob_it != arg.txs.end();) {
-    CryptoNote::tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
-    m_core.handle_incoming_tx(asBinaryArray(*tx_blob_it), tvc, false);
-    if (tvc.m_verifivation_failed) {
+  std::vector<BinaryArray> transactionBlobs;
+  std::vector<Crypto::Hash> transactionIds;
+  transactionBlobs.reserve(arg.txs.size());
+  transactionIds.reserve(arg.txs.size());
+  for (const auto& transactionBlob : arg.txs) {
+    transactionBlobs.push_back(asBinaryArray(transactionBlob));
+    transactionIds.push_back(getBinaryArrayHash(transactionBlobs.back()));
+    // The peer has the transaction, and it is not awaited from the peers which announced it any longer
+    m_transactionInventory.addKnown(context.m_connection_id, transactionIds.back());
+    m_transactionInventory.removeAnnounced(transactionIds.back());
+  }
+
+  // Checking the transactions off the dispatcher thread keeps blocks relayed meanwhile
+  std::vector<tx_verification_context> results;
+  System::RemoteContext<void> checks(m_dispatcher, [this, &transactionBlobs, &results] {
+    m_core.handleIncomingTransactions(transactionBlobs, results);
+  });
+  checks.get();
+
+  std::vector<std::string> relayedBlobs;
+  std::vector<Crypto::Hash> relayedIds;
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (results[i].m_verifivation_failed) {
       logger(Logging::INFO) << context << "Tx verification failed";
     }
-    if (!tvc.m_verifivation_failed && tvc.m_should_be_relayed) {
-      ++tx_blob_it;
-    } else {
-      tx_blob_it = arg.txs.erase(tx_blob_it);
+    if (!results[i].m_verifivation_failed && results[i].m_should_be_relayed) {
+      relayedBlobs.push_back(std::move(arg.txs[i]));
+      relayedIds.push_back(transactionIds[i]);
     }
   }
 
-  if (arg.txs.size()) {
-    //TODO: add announce usage here
-    relay_post_notify<NOTIFY_NEW_TRANSACTIONS>(*m_p2p, arg, &context.m_connection_id);
+  if (!relayedIds.empty()) {
+    relayTransactions(relayedBlobs, relayedIds);
   }
 
   return true;
 }
 
+int CryptoNoteProtocolHandler::handle_notify_announce_transactions(int command, NOTIFY_ANNOUNCE_TRANSACTIONS::request& arg, CryptoNoteConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_ANNOUNCE_TRANSACTIONS: txs.size() = " << arg.txs.size();
+  if (context.m_state != CryptoNoteConnectionContext::state_normal) {
+    return 1;
+  }
+
+  for (const auto& transactionId : arg.txs) {
+    if (m_core.haveTransaction(transactionId)) {
+      m_transactionInventory.addKnown(context.m_connection_id, transactionId);
+    } else if (!m_transactionInventory.addAnnounced(context.m_connection_id, transactionId)) {
+      logger(Logging::DEBUGGING) << context << "Too many announced transactions are awaited, the others are ignored";
+      break;
+    }
+  }
+
+  return 1;
+}
+
+int CryptoNoteProtocolHandler::handle_request_transactions(int command, NOTIFY_REQUEST_TRANSACTIONS::request& arg, CryptoNoteConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_REQUEST_TRANSACTIONS: txs.size() = " << arg.txs.size();
+  if (arg.txs.size() > TRANSACTIONS_RELAY_REQUEST_MAX_COUNT) {
+    logger(Logging::INFO) << context << "Too many transactions requested: " << arg.txs.size() << ", dropping connection";
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  // Only the announced transactions are requested, those of the pool, so the chain isn't looked up
+  std::vector<Transaction> transactions;
+  std::vector<Crypto::Hash> missedIds;
+  m_core.getPoolTransactions(arg.txs, transactions, missedIds);
+  if (transactions.empty()) {
+    return 1;
+  }
+
+  // The missed transactions are requested from other peers once the request times out
+  NOTIFY_NEW_TRANSACTIONS::request notification;
+  for (const auto& transaction : transactions) {
+    BinaryArray transactionBlob = toBinaryArray(transaction);
+    m_transactionInventory.addKnown(context.m_connection_id, getBinaryArrayHash(transactionBlob));
+    notification.txs.push_back(asString(transactionBlob));
+  }
+
+  post_notify<NOTIFY_NEW_TRANSACTIONS>(*m_p2p, notification, context);
+  return 1;
+}
+
 int CryptoNoteProtocolHandler::handle_request_get_objects(int command, NOTIFY_REQUEST_GET_OBJECTS::request& arg, CryptoNoteConnectionContext& context) {
   logger(Logging::TRACE) << context << "NOTIFY_REQUEST_GET_OBJECTS";
   NOTIFY_RESPONSE_GET_OBJECTS::request rsp;
@@ -323,9 +533,10 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
 
   context.m_remote_blockchain_height = arg.current_blockchain_height;
 
-  size_t count = 0;
+  SyncScheduler::BlockRange range;
+  range.connectionId = context.m_connection_id;
+  range.blocks.reserve(arg.blocks.size());
   for (const block_complete_entry& block_entry : arg.blocks) {
-    ++count;
     Block b;
     if (!fromBinaryArray(b, asBinaryArray(block_entry.block))) {
       logger(Logging::ERROR) << context << "sent wrong block: failed to parse and validate block: \r\n"
@@ -334,17 +545,6 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
       return 1;
     }
 
-    //to avoid concurrency in core between connections, suspend connections which delivered block later then first one
-    if (count == 2) {
-      if (m_core.have_block(get_block_hash(b))) {
-        context.m_state = CryptoNoteConnectionContext::state_idle;
-        context.m_needed_objects.clear();
-        context.m_requested_objects.clear();
-        logger(Logging::DEBUGGING) << context << "Connection set to idle state.";
-        return 1;
-      }
-    }
-
     auto blockHash = get_block_hash(b);
     auto req_it = context.m_requested_objects.find(blockHash);
     if (req_it == context.m_requested_objects.end()) {
@@ -361,6 +561,8 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
     }
 
     context.m_requested_objects.erase(req_it);
+    range.blockIds.push_back(blockHash);
+    range.blocks.push_back(std::move(b));
   }
 
   if (context.m_requested_objects.size()) {
@@ -371,32 +573,118 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
     return 1;
   }
 
-  {
-    m_core.pause_mining();
+  m_syncScheduler.rangeReceived(context.m_connection_id, SyncScheduler::Clock::now());
 
-    BOOST_SCOPE_EXIT_ALL(this) { m_core.update_block_template_and_resume_mining(); };
+  // The first blocks may have been added meanwhile from a range another connection was asked for after a timeout
+  range.entries = std::move(arg.blocks);
+  size_t knownCount = 0;
+  while (knownCount < range.blockIds.size() && m_core.have_block(range.blockIds[knownCount])) {
+    ++knownCount;
+  }
 
-    int result = processObjects(context, arg.blocks);
-    if (result != 0) {
-      return result;
+  range.blockIds.erase(range.blockIds.begin(), range.blockIds.begin() + knownCount);
+  range.entries.erase(range.entries.begin(), range.entries.begin() + knownCount);
+  range.blocks.erase(range.blocks.begin(), range.blocks.begin() + knownCount);
+
+  SyncScheduler::BlockRangePtr pendingRange;
+  if (!range.blocks.empty()) {
+    Crypto::Hash parentId = range.blocks.front().previousBlockHash;
+    pendingRange = std::make_shared<SyncScheduler::BlockRange>(std::move(range));
+    if (!m_syncScheduler.addPendingRange(parentId, pendingRange)) {
+      logger(Logging::DEBUGGING) << context << "Blocks with the same parent are kept already, skipping the received ones";
+      pendingRange.reset();
     }
   }
 
-  uint32_t height;
-  Crypto::Hash top;
-  m_core.get_blockchain_top(height, top);
-  logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new height = " << height;
-
+  // The next range downloads while this one is verified, the connection reads it once the verification is done
   if (!m_stop && context.m_state == CryptoNoteConnectionContext::state_synchronizing) {
     request_missing_objects(context, true);
   }
 
+  if (pendingRange) {
+    verifyBlockRange(pendingRange);
+  }
+
   return 1;
 }
 
-int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& context, const std::vector<block_complete_entry>& blocks) {
+// Proofs of work and ring signatures dominate the sync time, they are checked on the worker threads while the dispatcher
+// goes on receiving the next ranges and adding the verified ones. The core remembers the results, the blocks are
+// checked once more as they are added.
+void CryptoNoteProtocolHandler::verifyBlockRange(const SyncScheduler::BlockRangePtr& range) {
+  System::RemoteContext<void> verification(m_dispatcher, [this, range] {
+    m_core.computeProofsOfWork(range->blocks);
+
+    std::vector<BinaryArray> transactionBlobs;
+    for (const block_complete_entry& entry : range->entries) {
+      for (const auto& transactionBlob : entry.txs) {
+        transactionBlobs.push_back(asBinaryArray(transactionBlob));
+      }
+    }
+
+    m_core.precheckTransactions(transactionBlobs);
+  });
+  verification.get();
+
+  range->verified = true;
+  if (!m_addingBlocks && !m_stop) {
+    m_addingBlocks = true;
+    m_addingContextGroup.spawn([this] { addVerifiedBlockRanges(); });
+  }
+}
+
+// Adds the verified ranges in chain order until none follows, the connections go on receiving and verifying meanwhile
+void CryptoNoteProtocolHandler::addVerifiedBlockRanges() {
+  m_core.pause_mining();
+
+  BOOST_SCOPE_EXIT_ALL(this) {
+    m_addingBlocks = false;
+    m_core.update_block_template_and_resume_mining();
+  };
+
+  for (;;) {
+    uint32_t height;
+    Crypto::Hash top;
+    m_core.get_blockchain_top(height, top);
+    SyncScheduler::BlockRangePtr range = m_syncScheduler.takeVerifiedRange(top, [this](const Crypto::Hash& blockId) {
+      return m_core.have_block(blockId);
+    });
+
+    if (m_stop || range == nullptr) {
+      break;
+    }
+
+    // The connection which downloaded the range may be closed while its blocks are added
+    CryptoNoteConnectionContext rangeContext;
+    rangeContext.m_connection_id = range->connectionId;
+    m_p2p->for_each_connection([&rangeContext](const CryptoNoteConnectionContext& ctx, PeerIdType peerId) {
+      if (ctx.m_connection_id == rangeContext.m_connection_id) {
+        rangeContext.m_remote_ip = ctx.m_remote_ip;
+        rangeContext.m_remote_port = ctx.m_remote_port;
+        rangeContext.m_is_income = ctx.m_is_income;
+      }
+    });
 
-  for (const block_complete_entry& block_entry : blocks) {
+    if (processObjects(rangeContext, range->entries) != 0) {
+      m_p2p->for_each_connection([&rangeContext](CryptoNoteConnectionContext& ctx, PeerIdType peerId) {
+        if (ctx.m_connection_id == rangeContext.m_connection_id) {
+          ctx.m_state = CryptoNoteConnectionContext::state_shutdown;
+        }
+      });
+
+      continue;
+    }
+
+    m_core.get_blockchain_top(height, top);
+    logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new height = " << height;
+  }
+
+  // The connections waiting for the added blocks go on
+  resumeSynchronization();
+}
+
+int CryptoNoteProtocolHandler::processObjects(const CryptoNoteConnectionContext& context, const std::vector<block_complete_entry>& entries) {
+  for (const block_complete_entry& block_entry : entries) {
     if (m_stop) {
       break;
     }
@@ -408,7 +696,6 @@ int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& conte
       if (tvc.m_verifivation_failed) {
         logger(Logging::ERROR) << context << "transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
           << Common::podToHex(getBinaryArrayHash(asBinaryArray(tx_blob))) << ", dropping connection";
-        context.m_state = CryptoNoteConnectionContext::state_shutdown;
         return 1;
       }
     }
@@ -419,18 +706,13 @@ int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& conte
 
     if (bvc.m_verifivation_failed) {
       logger(Logging::DEBUGGING) << context << "Block verification failed, dropping connection";
-      context.m_state = CryptoNoteConnectionContext::state_shutdown;
       return 1;
     } else if (bvc.m_marked_as_orphaned) {
       logger(Logging::INFO) << context << "Block received at sync phase was marked as orphaned, dropping connection";
-      context.m_state = CryptoNoteConnectionContext::state_shutdown;
       return 1;
     } else if (bvc.m_already_exists) {
-      logger(Logging::DEBUGGING) << context << "Block already exists, switching to idle state";
-      context.m_state = CryptoNoteConnectionContext::state_idle;
-      context.m_needed_objects.clear();
-      context.m_requested_objects.clear();
-      return 1;
+      // Another connection was asked for the block after a timeout
+      logger(Logging::DEBUGGING) << context << "Block already exists, skipping it";
     }
 
     m_dispatcher.yield();
@@ -442,9 +724,31 @@ int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& conte
 
 
 bool CryptoNoteProtocolHandler::on_idle() {
+  resumeSynchronization();
+  sendTransactionInventory();
   return m_core.on_idle();
 }
 
+void CryptoNoteProtocolHandler::resumeSynchronization() {
+  bool synchronizing = false;
+  m_p2p->for_each_connection([this, &synchronizing](CryptoNoteConnectionContext& context, PeerIdType peerId) {
+    if (context.m_state != CryptoNoteConnectionContext::state_synchronizing) {
+      return;
+    }
+
+    // A connection waiting for the blocks other connections download takes over the ranges which timed out, or goes on
+    // once they are added
+    synchronizing = true;
+    if (!m_stop && m_syncScheduler.isWaiting(context.m_connection_id)) {
+      request_missing_objects(context, true);
+    }
+  });
+
+  if (!synchronizing) {
+    m_syncScheduler.clearPendingRanges();
+  }
+}
+
 int CryptoNoteProtocolHandler::handle_request_chain(int command, NOTIFY_REQUEST_CHAIN::request& arg, CryptoNoteConnectionContext& context) {
   logger(Logging::TRACE) << context << "NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << arg.block_ids.size();
 
@@ -470,22 +774,26 @@ int CryptoNoteProtocolHandler::handle_request_chain(int command, NOTIFY_REQUEST_
 
 bool CryptoNoteProtocolHandler::request_missing_objects(CryptoNoteConnectionContext& context, bool check_having_blocks) {
   if (context.m_needed_objects.size()) {
-    //we know objects that we need, request this objects
+    //we know objects that we need, request the next range nobody else downloads
     NOTIFY_REQUEST_GET_OBJECTS::request req;
-    size_t count = 0;
-    auto it = context.m_needed_objects.begin();
-
-    while (it != context.m_needed_objects.end() && count < BLOCKS_SYNCHRONIZING_DEFAULT_COUNT) {
-      if (!(check_having_blocks && m_core.have_block(*it))) {
-        req.blocks.push_back(*it);
-        ++count;
-        context.m_requested_objects.insert(*it);
-      }
-      it = context.m_needed_objects.erase(it);
+    req.blocks = m_syncScheduler.takeRange(context.m_connection_id, context.m_needed_objects, [this, check_having_blocks](const Crypto::Hash& blockId) {
+      return check_having_blocks && m_core.have_block(blockId);
+    }, SyncScheduler::Clock::now());
+
+    if (!req.blocks.empty()) {
+      context.m_requested_objects.insert(req.blocks.begin(), req.blocks.end());
+      logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << req.blocks.size() << ", txs.size()=" << req.txs.size();
+      post_notify<NOTIFY_REQUEST_GET_OBJECTS>(*m_p2p, req, context);
+      return true;
+    }
+
+    if (context.m_needed_objects.size()) {
+      logger(Logging::TRACE) << context << "Waiting for the blocks downloaded by other connections";
+      return true;
     }
-    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << req.blocks.size() << ", txs.size()=" << req.txs.size();
-    post_notify<NOTIFY_REQUEST_GET_OBJECTS>(*m_p2p, req, context);
-  } else if (context.m_last_response_height < context.m_remote_blockchain_height - 1) {//we have to fetch more objects ids, request blockchain entry
+  }
+
+  if (context.m_last_response_height < context.m_remote_blockchain_height - 1) {//we have to fetch more objects ids, request blockchain entry
 
     NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
     r.block_ids = m_core.buildSparseChain();
@@ -580,6 +888,10 @@ int CryptoNoteProtocolHandler::handleRequestTxPool(int command, NOTIFY_REQUEST_T
                                                      CryptoNoteConnectionContext& context) {
   logger(Logging::TRACE) << context << "NOTIFY_REQUEST_TX_POOL: txs.size() = " << arg.txs.size();
 
+  for (const auto& transactionId : arg.txs) {
+    m_transactionInventory.addKnown(context.m_connection_id, transactionId);
+  }
+
   std::vector<Transaction> addedTransactions;
   std::vector<Crypto::Hash> deletedTransactions;
   m_core.getPoolChanges(arg.txs, addedTransactions, deletedTransactions);
@@ -587,7 +899,9 @@ int CryptoNoteProtocolHandler::handleRequestTxPool(int command, NOTIFY_REQUEST_T
   if (!addedTransactions.empty()) {
     NOTIFY_NEW_TRANSACTIONS::request notification;
     for (auto& tx : addedTransactions) {
-      notification.txs.push_back(asString(toBinaryArray(tx)));
+      BinaryArray transactionBlob = toBinaryArray(tx);
+      m_transactionInventory.addKnown(context.m_connection_id, getBinaryArrayHash(transactionBlob));
+      notification.txs.push_back(asString(transactionBlob));
     }
 
     bool ok = post_notify<NOTIFY_NEW_TRANSACTIONS>(*m_p2p, notification, context);
@@ -601,13 +915,138 @@ int CryptoNoteProtocolHandler::handleRequestTxPool(int command, NOTIFY_REQUEST_T
 
 
 void CryptoNoteProtocolHandler::relay_block(NOTIFY_NEW_BLOCK::request& arg) {
-  auto buf = LevinProtocol::encode(arg);
-  m_p2p->externalRelayNotifyToAll(NOTIFY_NEW_BLOCK::ID, buf);
+  // Can be called from the miner threads, the block is copied once to the dispatcher thread
+  uint64_t copiedBytes = arg.b.block.size();
+  for (const auto& transactionBlob : arg.b.txs) {
+    copiedBytes += transactionBlob.size();
+  }
+
+  m_copiedBytes += copiedBytes;
+  m_dispatcher.remoteSpawn([this, arg] {
+    relayBlock(arg, nullptr);
+  });
+}
+
+// The peers which know compact blocks get the block without the transactions they have in the pool
+void CryptoNoteProtocolHandler::relayBlock(const NOTIFY_NEW_BLOCK::request& arg, const net_connection_id* excludeConnection) {
+  NOTIFY_NEW_COMPACT_BLOCK::request compactArg;
+  compactArg.block = arg.b.block;
+  compactArg.current_blockchain_height = arg.current_blockchain_height;
+  compactArg.hop = arg.hop;
+
+  auto compactBlock = std::make_shared<const BinaryArray>(LevinProtocol::encode(compactArg));
+  auto fullBlock = std::make_shared<const BinaryArray>(LevinProtocol::encode(arg));
+  m_p2p->for_each_connection([&](CryptoNoteConnectionContext& context, PeerIdType peerId) {
+    if (peerId == 0 || (excludeConnection != nullptr && context.m_connection_id == *excludeConnection) ||
+      (context.m_state != CryptoNoteConnectionContext::state_normal && context.m_state != CryptoNoteConnectionContext::state_synchronizing)) {
+      return;
+    }
+
+    if (context.version >= P2PProtocolVersion::V2) {
+      m_p2p->invoke_notify_to_peer(NOTIFY_NEW_COMPACT_BLOCK::ID, compactBlock, context);
+    } else {
+      m_p2p->invoke_notify_to_peer(NOTIFY_NEW_BLOCK::ID, fullBlock, context);
+    }
+  });
 }
 
 void CryptoNoteProtocolHandler::relay_transactions(NOTIFY_NEW_TRANSACTIONS::request& arg) {
-  auto buf = LevinProtocol::encode(arg);
-  m_p2p->externalRelayNotifyToAll(NOTIFY_NEW_TRANSACTIONS::ID, buf);
+  // Can be called from the RPC server threads, the transactions are copied once to the dispatcher thread
+  uint64_t copiedBytes = 0;
+  for (const auto& transactionBlob : arg.txs) {
+    copiedBytes += transactionBlob.size();
+  }
+
+  m_copiedBytes += copiedBytes;
+  m_dispatcher.remoteSpawn([this, arg] {
+    std::vector<Crypto::Hash> transactionIds;
+    transactionIds.reserve(arg.txs.size());
+    for (const auto& transactionBlob : arg.txs) {
+      transactionIds.push_back(getBinaryArrayHash(asBinaryArray(transactionBlob)));
+    }
+
+    relayTransactions(arg.txs, transactionIds);
+  });
+}
+
+// The peers which know transaction announcements are announced the ids of the transactions they don't know with the
+// next inventory, the others get the transactions they don't know right away
+void CryptoNoteProtocolHandler::relayTransactions(const std::vector<std::string>& transactionBlobs, const std::vector<Crypto::Hash>& transactionIds) {
+  SharedBinaryArray allTransactions;
+  m_p2p->for_each_connection([&](CryptoNoteConnectionContext& context, PeerIdType peerId) {
+    if (peerId == 0 ||
+      (context.m_state != CryptoNoteConnectionContext::state_normal && context.m_state != CryptoNoteConnectionContext::state_synchronizing)) {
+      return;
+    }
+
+    if (context.version >= P2PProtocolVersion::V3) {
+      for (const auto& transactionId : transactionIds) {
+        m_transactionInventory.queueAnnouncement(context.m_connection_id, transactionId);
+      }
+
+      return;
+    }
+
+    std::vector<size_t> unknownTransactions;
+    for (size_t i = 0; i < transactionIds.size(); ++i) {
+      if (!m_transactionInventory.isKnown(context.m_connection_id, transactionIds[i])) {
+        unknownTransactions.push_back(i);
+        m_transactionInventory.addKnown(context.m_connection_id, transactionIds[i]);
+      }
+    }
+
+    if (unknownTransactions.size() == transactionIds.size()) {
+      if (!allTransactions) {
+        NOTIFY_NEW_TRANSACTIONS::request notification;
+        notification.txs = transactionBlobs;
+        allTransactions = std::make_shared<const BinaryArray>(LevinProtocol::encode(notification));
+      }
+
+      m_p2p->invoke_notify_to_peer(NOTIFY_NEW_TRANSACTIONS::ID, allTransactions, context);
+    } else if (!unknownTransactions.empty()) {
+      NOTIFY_NEW_TRANSACTIONS::request notification;
+      for (size_t i : unknownTransactions) {
+        notification.txs.push_back(transactionBlobs[i]);
+      }
+
+      notifyPeerCopy<NOTIFY_NEW_TRANSACTIONS>(notification, context);
+    }
+  });
+}
+
+// The announcements and the requests of the transactions are batched until the next idle call
+void CryptoNoteProtocolHandler::sendTransactionInventory() {
+  auto announcements = m_transactionInventory.takeAnnouncements();
+  auto requests = m_transactionInventory.takeRequests(TransactionInventory::Clock::now());
+  if (announcements.empty() && requests.empty()) {
+    return;
+  }
+
+  m_p2p->for_each_connection([&](CryptoNoteConnectionContext& context, PeerIdType peerId) {
+    auto announcementsIt = announcements.find(context.m_connection_id);
+    if (announcementsIt != announcements.end()) {
+      NOTIFY_ANNOUNCE_TRANSACTIONS::request notification;
+      notification.txs = std::move(announcementsIt->second);
+      post_notify<NOTIFY_ANNOUNCE_TRANSACTIONS>(*m_p2p, notification, context);
+    }
+
+    auto requestsIt = requests.find(context.m_connection_id);
+    if (requestsIt != requests.end()) {
+      // The transactions may have been added with a block meanwhile
+      NOTIFY_REQUEST_TRANSACTIONS::request request;
+      for (const auto& transactionId : requestsIt->second) {
+        if (m_core.haveTransaction(transactionId)) {
+          m_transactionInventory.removeAnnounced(transactionId);
+        } else {
+          request.txs.push_back(transactionId);
+        }
+      }
+
+      if (!request.txs.empty()) {
+        post_notify<NOTIFY_REQUEST_TRANSACTIONS>(*m_p2p, request, context);
+      }
+    }
+  });
 }
 
 void CryptoNoteProtocolHandler::requestMissingPoolTransactions(const CryptoNoteConnectionContext& context) {
@@ -7,6 +7,7 @@
 #include <atomic>
 
 #include <Common/ObserverManager.h>
+#include <System/ContextGroup.h>
 
 #include "CryptoNoteCore/ICore.h"
 
@@ -14,6 +15,8 @@
 #include "CryptoNoteProtocol/CryptoNoteProtocolHandlerCommon.h"
 #include "CryptoNoteProtocol/ICryptoNoteProtocolObserver.h"
 #include "CryptoNoteProtocol/ICryptoNoteProtocolQuery.h"
+#include "CryptoNoteProtocol/SyncScheduler.h"
+#include "CryptoNoteProtocol/TransactionInventory.h"
 
 #include "P2p/P2pProtocolDefinitions.h"
 #include "P2p/NetNodeCommon.h"
@@ -58,6 +61,9 @@ namespace CryptoNote
     virtual size_t getPeerCount() const override;
     virtual uint32_t getObservedHeight() const override;
     void requestMissingPoolTransactions(const CryptoNoteConnectionContext& context);
+    // Bytes copied to send messages rather than shared: the relayed messages handed over by other threads and the
+    // messages encoded for a single peer
+    uint64_t getCopiedBytes() const { return m_copiedBytes; }
 
   private:
     //----------------- commands handlers ----------------------------------------------
@@ -68,6 +74,11 @@ namespace CryptoNote
     int handle_request_chain(int command, NOTIFY_REQUEST_CHAIN::request& arg, CryptoNoteConnectionContext& context);
     int handle_response_chain_entry(int command, NOTIFY_RESPONSE_CHAIN_ENTRY::request& arg, CryptoNoteConnectionContext& context);
     int handleRequestTxPool(int command, NOTIFY_REQUEST_TX_POOL::request& arg, CryptoNoteConnectionContext& context);
+    int handle_notify_new_compact_block(int command, NOTIFY_NEW_COMPACT_BLOCK::request& arg, CryptoNoteConnectionContext& context);
+    int handle_request_block_transactions(int command, NOTIFY_REQUEST_BLOCK_TRANSACTIONS::request& arg, CryptoNoteConnectionContext& context);
+    int handle_response_block_transactions(int command, NOTIFY_RESPONSE_BLOCK_TRANSACTIONS::request& arg, CryptoNoteConnectionContext& context);
+    int handle_notify_announce_transactions(int command, NOTIFY_ANNOUNCE_TRANSACTIONS::request& arg, CryptoNoteConnectionContext& context);
+    int handle_request_transactions(int command, NOTIFY_REQUEST_TRANSACTIONS::request& arg, CryptoNoteConnectionContext& context);
 
     //----------------- i_cryptonote_protocol ----------------------------------
     virtual void relay_block(NOTIFY_NEW_BLOCK::request& arg) override;
@@ -79,7 +90,15 @@ namespace CryptoNote
     bool on_connection_synchronized();
     void updateObservedHeight(uint32_t peerHeight, const CryptoNoteConnectionContext& context);
     void recalculateMaxObservedHeight(const CryptoNoteConnectionContext& context);
-    int processObjects(CryptoNoteConnectionContext& context, const std::vector<block_complete_entry>& blocks);
+    int processObjects(const CryptoNoteConnectionContext& context, const std::vector<block_complete_entry>& entries);
+    void verifyBlockRange(const SyncScheduler::BlockRangePtr& range);
+    void addVerifiedBlockRanges();
+    void resumeSynchronization();
+    int addCompactBlock(NOTIFY_NEW_BLOCK::request& arg, CryptoNoteConnectionContext& context);
+    void relayBlock(const NOTIFY_NEW_BLOCK::request& arg, const net_connection_id* excludeConnection);
+    void relayTransactions(const std::vector<std::string>& transactionBlobs, const std::vector<Crypto::Hash>& transactionIds);
+    void sendTransactionInventory();
+    template<class Command> bool notifyPeerCopy(typename Command::request& arg, const CryptoNoteConnectionContext& context);
     Logging::LoggerRef logger;
 
   private:
@@ -96,7 +115,13 @@ namespace CryptoNote
     mutable std::mutex m_observedHeightMutex;
     uint32_t m_observedHeight;
 
+    SyncScheduler m_syncScheduler;
+    bool m_addingBlocks;
+    System::ContextGroup m_addingContextGroup;
+    TransactionInventory m_transactionInventory;
+
     std::atomic<size_t> m_peersCount;
+    std::atomic<uint64_t> m_copiedBytes;
     Tools::ObserverManager<ICryptoNoteProtocolObserver> m_observerManager;
   };
 }
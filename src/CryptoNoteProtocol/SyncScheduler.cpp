@@ -0,0 +1,147 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "SyncScheduler.h"
+
+#include <algorithm>
+
+namespace CryptoNote {
+
+SyncScheduler::SyncScheduler(size_t maxRangeSize, size_t minRangeSize, size_t maxPendingBlockCount, std::chrono::seconds rangeTime,
+  std::chrono::seconds requestTimeout) :
+  m_maxRangeSize(maxRangeSize),
+  m_minRangeSize(minRangeSize),
+  m_maxPendingBlockCount(maxPendingBlockCount),
+  m_rangeTime(rangeTime),
+  m_requestTimeout(requestTimeout) {
+}
+
+std::vector<Crypto::Hash> SyncScheduler::takeRange(const boost::uuids::uuid& connectionId, std::list<Crypto::Hash>& neededBlocks,
+  const std::function<bool(const Crypto::Hash&)>& isBlockKnown, Clock::time_point now) {
+  size_t rangeSize = getRangeSize(connectionId);
+  // Once enough blocks wait for their parent, only the blocks the chain needs next are downloaded
+  bool downloadAhead = m_pendingBlocks.size() < m_maxPendingBlockCount;
+  std::vector<Crypto::Hash> range;
+
+  auto it = neededBlocks.begin();
+  while (it != neededBlocks.end() && range.size() < rangeSize) {
+    if (isBlockKnown(*it)) {
+      it = neededBlocks.erase(it);
+      continue;
+    }
+
+    // The blocks of a range have to follow each other, as it is added to the chain at once
+    auto download = m_downloads.find(*it);
+    bool downloading = download != m_downloads.end() && download->second.connectionId != connectionId && now < download->second.deadline;
+    if (downloading || m_pendingBlocks.count(*it) != 0) {
+      if (!range.empty() || !downloadAhead) {
+        break;
+      }
+
+      ++it;
+      continue;
+    }
+
+    range.push_back(*it);
+    m_downloads[*it] = Download{connectionId, now + m_requestTimeout};
+    ++it;
+  }
+
+  Peer& peer = m_peers[connectionId];
+  peer.waiting = range.empty() && !neededBlocks.empty();
+  if (!range.empty()) {
+    peer.requestTime = now;
+    peer.requestedBlockCount = range.size();
+  }
+
+  return range;
+}
+
+void SyncScheduler::rangeReceived(const boost::uuids::uuid& connectionId, Clock::time_point now) {
+  for (auto it = m_downloads.begin(); it != m_downloads.end();) {
+    if (it->second.connectionId == connectionId) {
+      it = m_downloads.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  auto peerIt = m_peers.find(connectionId);
+  if (peerIt == m_peers.end() || peerIt->second.requestedBlockCount == 0) {
+    return;
+  }
+
+  Peer& peer = peerIt->second;
+  double seconds = std::max(std::chrono::duration<double>(now - peer.requestTime).count(), 0.001);
+  double blocksPerSecond = static_cast<double>(peer.requestedBlockCount) / seconds;
+  peer.blocksPerSecond = peer.blocksPerSecond == 0 ? blocksPerSecond : (peer.blocksPerSecond * 3 + blocksPerSecond) / 4;
+  peer.requestedBlockCount = 0;
+}
+
+void SyncScheduler::removeConnection(const boost::uuids::uuid& connectionId) {
+  rangeReceived(connectionId, Clock::now());
+  m_peers.erase(connectionId);
+}
+
+size_t SyncScheduler::getRangeSize(const boost::uuids::uuid& connectionId) const {
+  auto it = m_peers.find(connectionId);
+  if (it == m_peers.end() || it->second.blocksPerSecond == 0) {
+    return m_maxRangeSize;
+  }
+
+  double rangeSize = it->second.blocksPerSecond * static_cast<double>(m_rangeTime.count());
+  return std::max(m_minRangeSize, std::min(m_maxRangeSize, static_cast<size_t>(rangeSize)));
+}
+
+bool SyncScheduler::isWaiting(const boost::uuids::uuid& connectionId) const {
+  auto it = m_peers.find(connectionId);
+  return it != m_peers.end() && it->second.waiting;
+}
+
+bool SyncScheduler::addPendingRange(const Crypto::Hash& parentId, const BlockRangePtr& range) {
+  if (m_pendingRanges.count(parentId) != 0) {
+    return false;
+  }
+
+  m_pendingBlocks.insert(range->blockIds.begin(), range->blockIds.end());
+  m_pendingRanges.emplace(parentId, range);
+  return true;
+}
+
+SyncScheduler::BlockRangePtr SyncScheduler::takeVerifiedRange(const Crypto::Hash& topId,
+  const std::function<bool(const Crypto::Hash&)>& isBlockKnown) {
+  auto it = m_pendingRanges.find(topId);
+  if (it == m_pendingRanges.end() || !it->second->verified) {
+    it = std::find_if(m_pendingRanges.begin(), m_pendingRanges.end(), [&isBlockKnown](const std::pair<const Crypto::Hash, BlockRangePtr>& range) {
+      return range.second->verified && isBlockKnown(range.first);
+    });
+
+    if (it == m_pendingRanges.end()) {
+      return nullptr;
+    }
+  }
+
+  BlockRangePtr range = std::move(it->second);
+  m_pendingRanges.erase(it);
+  for (const auto& blockId : range->blockIds) {
+    m_pendingBlocks.erase(blockId);
+  }
+
+  return range;
+}
+
+bool SyncScheduler::isBlockPending(const Crypto::Hash& blockId) const {
+  return m_pendingBlocks.count(blockId) != 0;
+}
+
+size_t SyncScheduler::getPendingBlockCount() const {
+  return m_pendingBlocks.size();
+}
+
+void SyncScheduler::clearPendingRanges() {
+  m_pendingRanges.clear();
+  m_pendingBlocks.clear();
+}
+
+}
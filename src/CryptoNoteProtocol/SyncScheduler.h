@@ -0,0 +1,93 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+#include <boost/uuid/uuid.hpp>
+
+#include "CryptoNoteProtocolDefinitions.h"
+
+namespace CryptoNote {
+
+// Spreads the blocks needed during synchronization over the synchronizing connections. Each connection downloads the
+// next range of its needed blocks nobody else is downloading, sized by the throughput of the connection, and a range
+// not delivered in time may be taken over by another connection. Received ranges are kept while they are verified and
+// until the chain reaches their parent block, so that blocks are still added in order. The kept blocks are not
+// downloaded again, and once too many are kept only the blocks the chain needs next are downloaded, which bounds the
+// memory held by the ranges between the stages of the synchronization. Used from the dispatcher thread only.
+class SyncScheduler {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  struct BlockRange {
+    boost::uuids::uuid connectionId;
+    std::vector<Crypto::Hash> blockIds;
+    std::vector<block_complete_entry> entries;
+    std::vector<Block> blocks;
+    bool verified = false;
+  };
+
+  typedef std::shared_ptr<BlockRange> BlockRangePtr;
+
+  SyncScheduler(size_t maxRangeSize, size_t minRangeSize, size_t maxPendingBlockCount, std::chrono::seconds rangeTime,
+    std::chrono::seconds requestTimeout);
+
+  // Takes the next range of needed blocks for the connection. The blocks stay in the list until they are known, so that
+  // they are requested again if the range is lost, the known ones are removed.
+  std::vector<Crypto::Hash> takeRange(const boost::uuids::uuid& connectionId, std::list<Crypto::Hash>& neededBlocks,
+    const std::function<bool(const Crypto::Hash&)>& isBlockKnown, Clock::time_point now);
+  // Called when the connection delivered its range, the blocks are not downloading any longer
+  void rangeReceived(const boost::uuids::uuid& connectionId, Clock::time_point now);
+  void removeConnection(const boost::uuids::uuid& connectionId);
+  size_t getRangeSize(const boost::uuids::uuid& connectionId) const;
+  // The connection has needed blocks left, but all of them are downloaded by other connections or pending
+  bool isWaiting(const boost::uuids::uuid& connectionId) const;
+
+  // Keeps the range until it is verified and its parent block is added, returns false if a range with the same parent
+  // is kept already
+  bool addPendingRange(const Crypto::Hash& parentId, const BlockRangePtr& range);
+  // Takes a verified range to add, the one following the chain top if there is one, otherwise one of another branch
+  // whose parent is known. Returns nullptr if no range can be added.
+  BlockRangePtr takeVerifiedRange(const Crypto::Hash& topId, const std::function<bool(const Crypto::Hash&)>& isBlockKnown);
+  bool isBlockPending(const Crypto::Hash& blockId) const;
+  size_t getPendingBlockCount() const;
+  void clearPendingRanges();
+
+private:
+  struct Download {
+    boost::uuids::uuid connectionId;
+    Clock::time_point deadline;
+  };
+
+  struct Peer {
+    double blocksPerSecond = 0;
+    size_t requestedBlockCount = 0;
+    Clock::time_point requestTime;
+    bool waiting = false;
+  };
+
+  typedef std::unordered_map<boost::uuids::uuid, Peer, boost::hash<boost::uuids::uuid>> PeerMap;
+
+  const size_t m_maxRangeSize;
+  const size_t m_minRangeSize;
+  const size_t m_maxPendingBlockCount;
+  const std::chrono::seconds m_rangeTime;
+  const std::chrono::seconds m_requestTimeout;
+
+  PeerMap m_peers;
+  std::unordered_map<Crypto::Hash, Download> m_downloads;
+  std::unordered_map<Crypto::Hash, BlockRangePtr> m_pendingRanges;
+  std::unordered_set<Crypto::Hash> m_pendingBlocks;
+};
+
+}
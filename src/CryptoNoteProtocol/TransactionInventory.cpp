@@ -0,0 +1,159 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "TransactionInventory.h"
+
+#include <algorithm>
+
+namespace CryptoNote {
+
+TransactionInventory::TransactionInventory(size_t maxKnownCount, size_t maxAnnouncedCount, size_t maxConnectionAnnouncedCount,
+  std::chrono::seconds requestTimeout) :
+  m_maxKnownCount(maxKnownCount),
+  m_maxAnnouncedCount(maxAnnouncedCount),
+  m_maxConnectionAnnouncedCount(maxConnectionAnnouncedCount),
+  m_requestTimeout(requestTimeout) {
+}
+
+void TransactionInventory::addKnown(const boost::uuids::uuid& connectionId, const Crypto::Hash& transactionId) {
+  auto& knownTransactions = m_peers[connectionId].knownTransactions;
+  if (knownTransactions.size() >= m_maxKnownCount) {
+    knownTransactions.clear();
+  }
+
+  knownTransactions.insert(transactionId);
+}
+
+bool TransactionInventory::isKnown(const boost::uuids::uuid& connectionId, const Crypto::Hash& transactionId) const {
+  auto it = m_peers.find(connectionId);
+  return it != m_peers.end() && it->second.knownTransactions.count(transactionId) != 0;
+}
+
+void TransactionInventory::queueAnnouncement(const boost::uuids::uuid& connectionId, const Crypto::Hash& transactionId) {
+  if (isKnown(connectionId, transactionId)) {
+    return;
+  }
+
+  addKnown(connectionId, transactionId);
+  m_peers[connectionId].announcements.push_back(transactionId);
+}
+
+TransactionInventory::ConnectionTransactions TransactionInventory::takeAnnouncements() {
+  ConnectionTransactions announcements;
+  for (auto& peer : m_peers) {
+    if (!peer.second.announcements.empty()) {
+      announcements.emplace(peer.first, std::move(peer.second.announcements));
+      peer.second.announcements.clear();
+    }
+  }
+
+  return announcements;
+}
+
+bool TransactionInventory::addAnnounced(const boost::uuids::uuid& connectionId, const Crypto::Hash& transactionId) {
+  addKnown(connectionId, transactionId);
+
+  auto it = m_announced.find(transactionId);
+  if (it != m_announced.end()) {
+    auto& connectionIds = it->second.connectionIds;
+    if (std::find(connectionIds.begin(), connectionIds.end(), connectionId) != connectionIds.end()) {
+      return true;
+    }
+  }
+
+  Peer& peer = m_peers[connectionId];
+  if (peer.announcedCount >= m_maxConnectionAnnouncedCount) {
+    return false;
+  }
+
+  if (it == m_announced.end()) {
+    if (m_announced.size() >= m_maxAnnouncedCount) {
+      return false;
+    }
+
+    it = m_announced.emplace(transactionId, Announced()).first;
+  }
+
+  it->second.connectionIds.push_back(connectionId);
+  ++peer.announcedCount;
+  return true;
+}
+
+TransactionInventory::ConnectionTransactions TransactionInventory::takeRequests(Clock::time_point now) {
+  ConnectionTransactions requests;
+  for (auto it = m_announced.begin(); it != m_announced.end();) {
+    Announced& announced = it->second;
+    if (announced.requested) {
+      if (now < announced.deadline) {
+        ++it;
+        continue;
+      }
+
+      releaseAnnounced(announced.connectionIds.front());
+      announced.connectionIds.pop_front();
+      announced.requested = false;
+    }
+
+    if (announced.connectionIds.empty()) {
+      it = m_announced.erase(it);
+      continue;
+    }
+
+    requests[announced.connectionIds.front()].push_back(it->first);
+    announced.deadline = now + m_requestTimeout;
+    announced.requested = true;
+    ++it;
+  }
+
+  return requests;
+}
+
+void TransactionInventory::removeAnnounced(const Crypto::Hash& transactionId) {
+  auto it = m_announced.find(transactionId);
+  if (it == m_announced.end()) {
+    return;
+  }
+
+  for (const auto& connectionId : it->second.connectionIds) {
+    releaseAnnounced(connectionId);
+  }
+
+  m_announced.erase(it);
+}
+
+size_t TransactionInventory::getAnnouncedCount() const {
+  return m_announced.size();
+}
+
+void TransactionInventory::removeConnection(const boost::uuids::uuid& connectionId) {
+  m_peers.erase(connectionId);
+
+  for (auto it = m_announced.begin(); it != m_announced.end();) {
+    Announced& announced = it->second;
+    auto connectionIt = std::find(announced.connectionIds.begin(), announced.connectionIds.end(), connectionId);
+    if (connectionIt != announced.connectionIds.end()) {
+      // The next connection is asked once the requests are taken again
+      if (connectionIt == announced.connectionIds.begin()) {
+        announced.requested = false;
+      }
+
+      announced.connectionIds.erase(connectionIt);
+    }
+
+    if (announced.connectionIds.empty()) {
+      it = m_announced.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void TransactionInventory::releaseAnnounced(const boost::uuids::uuid& connectionId) {
+  auto it = m_peers.find(connectionId);
+  if (it != m_peers.end()) {
+    --it->second.announcedCount;
+  }
+}
+
+}
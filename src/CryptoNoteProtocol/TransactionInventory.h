@@ -0,0 +1,80 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+#include <boost/uuid/uuid.hpp>
+
+#include "crypto/hash.h"
+
+namespace CryptoNote {
+
+// Tracks the transactions the connections know, so that new transactions are announced by id to the connections which
+// don't know them, and the announced ones this node doesn't have are requested from a single connection. The requests
+// are batched, and a transaction not delivered in time is requested from the next connection which announced it. The
+// known transactions of a connection are forgotten once there are too many of them. The announced transactions awaited
+// are limited in total and per connection, so that a single connection can't take all of the room. Used from the
+// dispatcher thread only.
+class TransactionInventory {
+public:
+  typedef std::chrono::steady_clock Clock;
+  typedef std::unordered_map<boost::uuids::uuid, std::vector<Crypto::Hash>, boost::hash<boost::uuids::uuid>> ConnectionTransactions;
+
+  TransactionInventory(size_t maxKnownCount, size_t maxAnnouncedCount, size_t maxConnectionAnnouncedCount,
+    std::chrono::seconds requestTimeout);
+
+  // The connection has the transaction, it is not announced to the connection
+  void addKnown(const boost::uuids::uuid& connectionId, const Crypto::Hash& transactionId);
+  bool isKnown(const boost::uuids::uuid& connectionId, const Crypto::Hash& transactionId) const;
+  // Queues the announcement of the transaction to the connection, unless the connection knows it
+  void queueAnnouncement(const boost::uuids::uuid& connectionId, const Crypto::Hash& transactionId);
+  // Takes the transactions queued for announcement, by connection
+  ConnectionTransactions takeAnnouncements();
+
+  // The connection announced a transaction this node doesn't have. Returns false if too many announced transactions
+  // are awaited already, in total or from the connection.
+  bool addAnnounced(const boost::uuids::uuid& connectionId, const Crypto::Hash& transactionId);
+  // Takes the announced transactions to request, by connection: those nobody is asked for yet and those not delivered
+  // in time, which are requested from the next connection that announced them
+  ConnectionTransactions takeRequests(Clock::time_point now);
+  // The transaction is received or not needed any longer
+  void removeAnnounced(const Crypto::Hash& transactionId);
+  size_t getAnnouncedCount() const;
+
+  void removeConnection(const boost::uuids::uuid& connectionId);
+
+private:
+  struct Peer {
+    std::unordered_set<Crypto::Hash> knownTransactions;
+    std::vector<Crypto::Hash> announcements;
+    // Awaited transactions the connection announced
+    size_t announcedCount = 0;
+  };
+
+  struct Announced {
+    // The transaction is requested from the first connection
+    std::deque<boost::uuids::uuid> connectionIds;
+    Clock::time_point deadline;
+    bool requested = false;
+  };
+
+  void releaseAnnounced(const boost::uuids::uuid& connectionId);
+
+  const size_t m_maxKnownCount;
+  const size_t m_maxAnnouncedCount;
+  const size_t m_maxConnectionAnnouncedCount;
+  const std::chrono::seconds m_requestTimeout;
+
+  std::unordered_map<boost::uuids::uuid, Peer, boost::hash<boost::uuids::uuid>> m_peers;
+  std::unordered_map<Crypto::Hash, Announced> m_announced;
+};
+
+}
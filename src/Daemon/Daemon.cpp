@@ -4,6 +4,7 @@
 
 #include "version.h"
 
+#include <limits>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 
@@ -23,6 +24,8 @@
 #include "P2p/NetNodeConfig.h"
 #include "Rpc/RpcServer.h"
 #include "Rpc/RpcServerConfig.h"
+#include "Rpc/StratumServer.h"
+#include "Rpc/StratumServerConfig.h"
 #include "version.h"
 
 #include "Logging/ConsoleLogger.h"
@@ -50,6 +53,8 @@ namespace
   const command_line::arg_descriptor<bool>        arg_print_genesis_tx = { "print-genesis-tx", "Prints genesis' block tx hex to insert it to config and exits" };
   const command_line::arg_descriptor<std::vector<std::string>>        arg_enable_cors = { "enable-cors", "Adds header 'Access-Control-Allow-Origin' to the daemon's RPC responses. Uses the value as domain. Use * for all" };
   const command_line::arg_descriptor<bool>        arg_api_xmr = { "api-xmr", "Enable Monero-compatible RPC API" };
+  const command_line::arg_descriptor<size_t>      arg_pool_max_size = { "pool-max-size", "Maximum size of the transactions in the pool in megabytes, transactions with the lowest fees are evicted above it",
+    CryptoNote::parameters::CRYPTONOTE_MEMPOOL_MAX_SIZE / (1024 * 1024) };
 }
 
 bool command_line_preprocessor(const boost::program_options::variables_map& vm, LoggerRef& logger);
@@ -115,8 +120,10 @@ int main(int argc, char* argv[])
     command_line::add_arg(desc_cmd_sett, arg_print_genesis_tx);
 	command_line::add_arg(desc_cmd_sett, arg_enable_cors);
 	command_line::add_arg(desc_cmd_sett, arg_api_xmr);
+    command_line::add_arg(desc_cmd_sett, arg_pool_max_size);
 
     RpcServerConfig::initOptions(desc_cmd_sett);
+    StratumServerConfig::initOptions(desc_cmd_sett);
     CoreConfig::initOptions(desc_cmd_sett);
     NetNodeConfig::initOptions(desc_cmd_sett);
     MinerConfig::initOptions(desc_cmd_sett);
@@ -190,9 +197,17 @@ int main(int argc, char* argv[])
       logger(INFO) << "Starting in testnet mode!";
     }
 
+    size_t poolMaxSize = command_line::get_arg(vm, arg_pool_max_size);
+    if (poolMaxSize == 0 || poolMaxSize > std::numeric_limits<size_t>::max() / (1024 * 1024)) {
+      logger(ERROR, BRIGHT_RED) << "Wrong --" << arg_pool_max_size.name << " value, it must be from 1 to " <<
+        std::numeric_limits<size_t>::max() / (1024 * 1024) << " megabytes";
+      return 1;
+    }
+
     //create objects and link them
     CryptoNote::CurrencyBuilder currencyBuilder(logManager);
     currencyBuilder.testnet(testnet_mode);
+    currencyBuilder.mempoolMaxSize(poolMaxSize * 1024 * 1024);
 
     try {
       currencyBuilder.currency();
@@ -222,6 +237,8 @@ int main(int argc, char* argv[])
     minerConfig.init(vm);
     RpcServerConfig rpcConfig;
     rpcConfig.init(vm);
+    StratumServerConfig stratumConfig;
+    stratumConfig.init(vm);
 
     if (!coreConfig.configFolderDefaulted) {
       if (!Tools::directoryExists(coreConfig.configFolder)) {
@@ -239,6 +256,8 @@ int main(int argc, char* argv[])
     CryptoNote::NodeServer p2psrv(dispatcher, cprotocol, logManager);
 	BlockchainExplorerDataBuilder blkExplorer(ccore, cprotocol);
     CryptoNote::RpcServer rpcServer(dispatcher, logManager, ccore, p2psrv, cprotocol, blkExplorer);
+    CryptoNote::StratumServer stratumServer(dispatcher, logManager, currency, ccore, ccore, cprotocol, stratumConfig.shareDifficulty,
+      stratumConfig.shareTargetTime, stratumConfig.maxClients);
 
     cprotocol.set_p2p_endpoint(&p2psrv);
     ccore.set_cryptonote_protocol(&cprotocol);
@@ -278,6 +297,11 @@ int main(int argc, char* argv[])
 	
     logger(INFO) << "Core rpc server started ok";
 
+    if (stratumConfig.isEnabled()) {
+      logger(INFO) << "Starting mining job server on address " << stratumConfig.getBindAddress();
+      stratumServer.start(stratumConfig.bindIp, stratumConfig.bindPort);
+    }
+
     Tools::SignalHandler::install([&dch, &p2psrv] {
       dch.stop_handling();
       p2psrv.sendStopSignal();
@@ -292,6 +316,10 @@ int main(int argc, char* argv[])
     //stop components
     logger(INFO) << "Stopping core rpc server...";
     rpcServer.stop();
+    if (stratumConfig.isEnabled()) {
+      logger(INFO) << "Stopping mining job server...";
+      stratumServer.stop();
+    }
 
     //deinitialize components
     logger(INFO) << "Deinitializing core...";
@@ -37,6 +37,7 @@ DaemonCommandsHandler::DaemonCommandsHandler(CryptoNote::core& core, CryptoNote:
   m_consoleHandler.setHandler("print_pool_sh", boost::bind(&DaemonCommandsHandler::print_pool_sh, this, _1), "Print transaction pool (short format)");
   m_consoleHandler.setHandler("show_hr", boost::bind(&DaemonCommandsHandler::show_hr, this, _1), "Start showing hash rate");
   m_consoleHandler.setHandler("hide_hr", boost::bind(&DaemonCommandsHandler::hide_hr, this, _1), "Stop showing hash rate");
+  m_consoleHandler.setHandler("export_snapshot", boost::bind(&DaemonCommandsHandler::export_snapshot, this, _1), "Export blockchain up to the last checkpoint for --load-snapshot, export_snapshot <file>");
   m_consoleHandler.setHandler("set_log", boost::bind(&DaemonCommandsHandler::set_log, this, _1), "set_log <level> - Change current log level, <level> is a number 0-4");
 }
 
@@ -100,6 +101,23 @@ bool DaemonCommandsHandler::print_bc_outs(const std::vector<std::string>& args)
   return true;
 }
 //--------------------------------------------------------------------------------
+bool DaemonCommandsHandler::export_snapshot(const std::vector<std::string>& args)
+{
+  if (args.size() != 1)
+  {
+    std::cout << "need file path as parameter" << ENDL;
+    return true;
+  }
+
+  if (m_core.export_snapshot(args[0])) {
+    std::cout << "Snapshot saved to " << args[0] << ENDL;
+  } else {
+    std::cout << "Failed to export snapshot, see log for details" << ENDL;
+  }
+
+  return true;
+}
+//--------------------------------------------------------------------------------
 bool DaemonCommandsHandler::print_cn(const std::vector<std::string>& args)
 {
   m_srv.get_payload_object().log_connections();
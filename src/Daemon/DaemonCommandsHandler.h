@@ -46,6 +46,7 @@ private:
   bool show_hr(const std::vector<std::string>& args);
   bool hide_hr(const std::vector<std::string>& args);
   bool print_bc_outs(const std::vector<std::string>& args);
+  bool export_snapshot(const std::vector<std::string>& args);
   bool print_cn(const std::vector<std::string>& args);
   bool print_bc(const std::vector<std::string>& args);
   bool print_bci(const std::vector<std::string>& args);
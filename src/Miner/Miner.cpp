@@ -5,8 +5,11 @@
 #include "Miner.h"
 
 #include <functional>
+#include <thread>
 
 #include "crypto/crypto.h"
+#include "Common/Util.h"
+#include "CryptoNoteCore/BlockMiningJob.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 
 #include <System/InterruptedException.h>
@@ -24,7 +27,7 @@ Miner::~Miner() {
   assert(m_state != MiningState::MINING_IN_PROGRESS);
 }
 
-Block Miner::mine(const BlockMiningParameters& blockMiningParameters, size_t threadCount) {
+Block Miner::mine(const BlockMiningParameters& blockMiningParameters, size_t threadCount, bool pinThreads) {
   if (threadCount == 0) {
     throw std::runtime_error("Miner requires at least one thread");
   }
@@ -36,7 +39,7 @@ Block Miner::mine(const BlockMiningParameters& blockMiningParameters, size_t thr
   m_state = MiningState::MINING_IN_PROGRESS;
   m_miningStopped.clear();
 
-  runWorkers(blockMiningParameters, threadCount);
+  runWorkers(blockMiningParameters, threadCount, pinThreads);
 
   assert(m_state != MiningState::MINING_IN_PROGRESS);
   if (m_state == MiningState::MINING_STOPPED) {
@@ -57,7 +60,7 @@ void Miner::stop() {
   }
 }
 
-void Miner::runWorkers(BlockMiningParameters blockMiningParameters, size_t threadCount) {
+void Miner::runWorkers(BlockMiningParameters blockMiningParameters, size_t threadCount, bool pinThreads) {
   assert(threadCount > 0);
 
   m_logger(Logging::INFO) << "Starting mining for difficulty " << blockMiningParameters.difficulty;
@@ -67,7 +70,7 @@ void Miner::runWorkers(BlockMiningParameters blockMiningParameters, size_t threa
 
     for (size_t i = 0; i < threadCount; ++i) {
       m_workers.emplace_back(std::unique_ptr<System::RemoteContext<void>> (
-        new System::RemoteContext<void>(m_dispatcher, std::bind(&Miner::workerFunc, this, blockMiningParameters.blockTemplate, blockMiningParameters.difficulty, threadCount)))
+        new System::RemoteContext<void>(m_dispatcher, std::bind(&Miner::workerFunc, this, blockMiningParameters.blockTemplate, blockMiningParameters.difficulty, threadCount, static_cast<uint32_t>(i), pinThreads)))
       );
 
       blockMiningParameters.blockTemplate.nonce++;
@@ -83,33 +86,56 @@ void Miner::runWorkers(BlockMiningParameters blockMiningParameters, size_t threa
   m_miningStopped.set();
 }
 
-void Miner::workerFunc(const Block& blockTemplate, difficulty_type difficulty, uint32_t nonceStep) {
+void Miner::workerFunc(const Block& blockTemplate, difficulty_type difficulty, uint32_t nonceStep, uint32_t workerIndex, bool pinThread) {
   try {
+    // pinned before the scratchpads are allocated, so that they are placed on the NUMA node of the thread
+    unsigned processorCount = std::thread::hardware_concurrency();
+    if (pinThread && processorCount != 0 && !Tools::setCurrentThreadAffinity(workerIndex % processorCount)) {
+      m_logger(Logging::WARNING) << "Failed to pin mining thread " << workerIndex << " to a processor";
+    }
+
     Block block = blockTemplate;
     Crypto::cn_context cryptoContext;
+    Crypto::cn_context otherCryptoContext;
+    m_logger(Logging::DEBUGGING) << "Mining thread " << workerIndex << " scratchpads use " << Crypto::cn_page_mode_name(cryptoContext.page_mode()) <<
+      " and " << Crypto::cn_page_mode_name(otherCryptoContext.page_mode());
+    if (!cryptoContext.is_locked() || !otherCryptoContext.is_locked()) {
+      m_logger(Logging::WARNING) << "Mining thread " << workerIndex << " scratchpads aren't locked in memory, they may be swapped out";
+    }
 
-    while (m_state == MiningState::MINING_IN_PROGRESS) {
-      Crypto::Hash hash;
-      if (!get_block_longhash(cryptoContext, block, hash)) {
-        //error occured
-        m_logger(Logging::DEBUGGING) << "calculating long hash error occured";
-        m_state = MiningState::MINING_STOPPED;
-        return;
-      }
+    BlockMiningJob job;
+    if (!job.init(block)) {
+      //error occured
+      m_logger(Logging::DEBUGGING) << "calculating hashing blob error occured";
+      m_state = MiningState::MINING_STOPPED;
+      return;
+    }
 
-      if (check_hash(hash, difficulty)) {
-        m_logger(Logging::INFO) << "Found block for difficulty " << difficulty;
+    BlockMiningJob otherJob(job);
 
-        if (!setStateBlockFound()) {
-          m_logger(Logging::DEBUGGING) << "block is already found or mining stopped";
+    // two nonces at once, the second one is the next nonce of this worker
+    while (m_state == MiningState::MINING_IN_PROGRESS) {
+      Crypto::Hash hashes[2];
+      job.setNonce(block.nonce);
+      otherJob.setNonce(block.nonce + nonceStep);
+      BlockMiningJob::getLonghashes(cryptoContext, otherCryptoContext, job, otherJob, hashes[0], hashes[1]);
+
+      for (uint32_t i = 0; i < 2; ++i) {
+        if (check_hash(hashes[i], difficulty)) {
+          m_logger(Logging::INFO) << "Found block for difficulty " << difficulty;
+
+          if (!setStateBlockFound()) {
+            m_logger(Logging::DEBUGGING) << "block is already found or mining stopped";
+            return;
+          }
+
+          block.nonce += i * nonceStep;
+          m_block = block;
           return;
         }
-
-        m_block = block;
-        return;
       }
 
-      block.nonce += nonceStep;
+      block.nonce += 2 * nonceStep;
     }
   } catch (std::exception& e) {
     m_logger(Logging::ERROR) << "Miner got error: " << e.what();
@@ -28,7 +28,7 @@ public:
   Miner(System::Dispatcher& dispatcher, Logging::ILogger& logger);
   ~Miner();
 
-  Block mine(const BlockMiningParameters& blockMiningParameters, size_t threadCount);
+  Block mine(const BlockMiningParameters& blockMiningParameters, size_t threadCount, bool pinThreads);
 
   //NOTE! this is blocking method
   void stop();
@@ -46,8 +46,8 @@ private:
 
   Logging::LoggerRef m_logger;
 
-  void runWorkers(BlockMiningParameters blockMiningParameters, size_t threadCount);
-  void workerFunc(const Block& blockTemplate, difficulty_type difficulty, uint32_t nonceStep);
+  void runWorkers(BlockMiningParameters blockMiningParameters, size_t threadCount, bool pinThreads);
+  void workerFunc(const Block& blockTemplate, difficulty_type difficulty, uint32_t nonceStep, uint32_t workerIndex, bool pinThread);
   bool setStateBlockFound();
 };
 
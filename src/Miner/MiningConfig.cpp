@@ -50,7 +50,7 @@ void parseDaemonAddress(const std::string& daemonAddress, std::string& daemonHos
 
 }
 
-MiningConfig::MiningConfig(): help(false) {
+MiningConfig::MiningConfig(): pinThreads(false), help(false) {
   cmdOptions.add_options()
       ("help,h", "produce this help message and exit")
       ("address", po::value<std::string>(), "Valid cryptonote miner's address")
@@ -58,6 +58,7 @@ MiningConfig::MiningConfig(): help(false) {
       ("daemon-rpc-port", po::value<uint16_t>()->default_value(static_cast<uint16_t>(RPC_DEFAULT_PORT)), "Daemon's RPC port")
       ("daemon-address", po::value<std::string>(), "Daemon host:port. If you use this option you must not use --daemon-host and --daemon-port options")
       ("threads", po::value<size_t>()->default_value(CONCURRENCY_LEVEL), "Mining threads count. Must not be greater than you concurrency level. Default value is your hardware concurrency level")
+      ("pin-threads", po::bool_switch(), "Pin each mining thread to a processor, its scratchpads are then kept on the local NUMA node")
       ("scan-time", po::value<size_t>()->default_value(DEFAULT_SCANT_PERIOD), "Blockchain polling interval (seconds). How often miner will check blockchain for updates")
       ("log-level", po::value<int>()->default_value(1), "Log level. Must be 0..5")
       ("limit", po::value<size_t>()->default_value(0), "Mine exact quantity of blocks. 0 means no limit")
@@ -98,6 +99,8 @@ void MiningConfig::parse(int argc, char** argv) {
     throw std::runtime_error("--threads option must be 1.." + std::to_string(CONCURRENCY_LEVEL));
   }
 
+  pinThreads = options["pin-threads"].as<bool>();
+
   scanPeriod = options["scan-time"].as<size_t>();
   if (scanPeriod == 0) {
     throw std::runtime_error("--scan-time must not be zero");
@@ -19,6 +19,7 @@ struct MiningConfig {
   std::string daemonHost;
   uint16_t daemonPort;
   size_t threadCount;
+  bool pinThreads;
   size_t scanPeriod;
   uint8_t logLevel;
   size_t blocksLimit;
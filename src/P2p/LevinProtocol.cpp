@@ -47,15 +47,8 @@ void LevinProtocol::sendMessage(uint32_t command, const BinaryArray& out, bool n
   head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
   head.m_flags = LEVIN_PACKET_REQUEST;
 
-  // write header and body in one operation
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
-
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
-
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  // write header and body in one operation, the body is not copied as it may be shared by many connections
+  writeStrict(reinterpret_cast<const uint8_t*>(&head), sizeof(head), out.data(), out.size());
 }
 
 bool LevinProtocol::readCommand(Command& cmd) {
@@ -100,18 +93,16 @@ void LevinProtocol::sendReply(uint32_t command, const BinaryArray& out, int32_t
   head.m_flags = LEVIN_PACKET_RESPONSE;
   head.m_return_code = returnCode;
 
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
-
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
-
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  writeStrict(reinterpret_cast<const uint8_t*>(&head), sizeof(head), out.data(), out.size());
 }
 
-void LevinProtocol::writeStrict(const uint8_t* ptr, size_t size) {
+void LevinProtocol::writeStrict(const uint8_t* header, size_t headerSize, const uint8_t* ptr, size_t size) {
   size_t offset = 0;
+  while (offset < headerSize) {
+    offset += m_conn.write(header + offset, headerSize - offset, ptr, size);
+  }
+
+  offset -= headerSize;
   while (offset < size) {
     offset += m_conn.write(ptr + offset, size - offset);
   }
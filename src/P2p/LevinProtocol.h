@@ -93,7 +93,7 @@ public:
 private:
 
   bool readStrict(uint8_t* ptr, size_t size);
-  void writeStrict(const uint8_t* ptr, size_t size);
+  void writeStrict(const uint8_t* header, size_t headerSize, const uint8_t* ptr, size_t size);
   System::TcpConnection& m_conn;
 };
 
@@ -199,6 +199,7 @@ namespace CryptoNote
     m_timedSyncTimer(m_dispatcher),
     m_timeoutTimer(m_dispatcher),
     m_stop(false),
+    m_queuedBytes(0),
     // intervals
     // m_peer_handshake_idle_maker_interval(CryptoNote::P2P_DEFAULT_HANDSHAKE_INTERVAL),
     m_connections_maker_interval(1),
@@ -314,13 +315,6 @@ namespace CryptoNote
     }
   }
 
-  //----------------------------------------------------------------------------------- 
-  void NodeServer::externalRelayNotifyToAll(int command, const BinaryArray& data_buff) {
-    m_dispatcher.remoteSpawn([this, command, data_buff] {
-      relay_notify_to_all(command, data_buff, nullptr);
-    });
-  }
-
   //-----------------------------------------------------------------------------------
   bool NodeServer::make_default_config()
   {
@@ -545,8 +539,8 @@ namespace CryptoNote
     m_stop = true;
 
     m_dispatcher.remoteSpawn([this] {
-      m_stopEvent.set();
       m_payload_handler.stop();
+      m_stopEvent.set();
     });
 
     logger(INFO, BRIGHT_YELLOW) << "Stop signal sent";
@@ -602,13 +596,13 @@ namespace CryptoNote
   bool NodeServer::timedSync() {
     COMMAND_TIMED_SYNC::request arg = boost::value_initialized<COMMAND_TIMED_SYNC::request>();
     m_payload_handler.get_payload_sync_data(arg.payload_data);
-    auto cmdBuf = LevinProtocol::encode<COMMAND_TIMED_SYNC::request>(arg);
+    auto cmdBuf = std::make_shared<const BinaryArray>(LevinProtocol::encode<COMMAND_TIMED_SYNC::request>(arg));
 
     forEachConnection([&](P2pConnectionContext& conn) {
       if (conn.peerId && 
           (conn.m_state == CryptoNoteConnectionContext::state_normal || 
            conn.m_state == CryptoNoteConnectionContext::state_idle)) {
-        conn.pushMessage(P2pMessage(P2pMessage::COMMAND, COMMAND_TIMED_SYNC::ID, cmdBuf));
+        pushMessage(conn, P2pMessage(P2pMessage::COMMAND, COMMAND_TIMED_SYNC::ID, cmdBuf));
       }
     });
 
@@ -1035,28 +1029,25 @@ namespace CryptoNote
 #endif
   
   //-----------------------------------------------------------------------------------
-  
-  void NodeServer::relay_notify_to_all(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) {
-    net_connection_id excludeId = excludeConnection ? *excludeConnection : boost::value_initialized<net_connection_id>();
-
-    forEachConnection([&](P2pConnectionContext& conn) {
-      if (conn.peerId && conn.m_connection_id != excludeId &&
-          (conn.m_state == CryptoNoteConnectionContext::state_normal ||
-           conn.m_state == CryptoNoteConnectionContext::state_synchronizing)) {
-        conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, data_buff));
-      }
-    });
-  }
- 
-  //-----------------------------------------------------------------------------------
-  bool NodeServer::invoke_notify_to_peer(int command, const BinaryArray& buffer, const CryptoNoteConnectionContext& context) {
+  bool NodeServer::invoke_notify_to_peer(int command, const SharedBinaryArray& buffer, const CryptoNoteConnectionContext& context) {
     auto it = m_connections.find(context.m_connection_id);
     if (it == m_connections.end()) {
       return false;
     }
 
-    it->second.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, buffer));
+    pushMessage(it->second, P2pMessage(P2pMessage::NOTIFY, command, buffer));
+
+    return true;
+  }
+
+  //-----------------------------------------------------------------------------------
+  bool NodeServer::pushMessage(P2pConnectionContext& context, P2pMessage&& message) {
+    size_t size = message.size();
+    if (!context.pushMessage(std::move(message))) {
+      return false;
+    }
 
+    m_queuedBytes += size;
     return true;
   }
 
@@ -1200,7 +1191,8 @@ namespace CryptoNote
   //-----------------------------------------------------------------------------------
   
   bool NodeServer::log_connections() {
-    logger(INFO) << "Connections: \r\n" << print_connections_container() ;
+    logger(INFO) << "Connections: \r\n" << print_connections_container() <<
+      "Message bytes queued: " << m_queuedBytes << ", copied: " << m_payload_handler.getCopiedBytes();
     return true;
   }
   //-----------------------------------------------------------------------------------
@@ -1385,7 +1377,7 @@ namespace CryptoNote
               response.clear();
             }
 
-            ctx.pushMessage(P2pMessage(P2pMessage::REPLY, cmd.command, std::move(response), retcode));
+            pushMessage(ctx, P2pMessage(P2pMessage::REPLY, cmd.command, std::move(response), retcode));
           }
 
           if (ctx.m_state == CryptoNoteConnectionContext::state_shutdown) {
@@ -1431,13 +1423,13 @@ namespace CryptoNote
           logger(DEBUGGING) << ctx << "msg " << msg.type << ':' << msg.command;
           switch (msg.type) {
           case P2pMessage::COMMAND:
-            proto.sendMessage(msg.command, msg.buffer, true);
+            proto.sendMessage(msg.command, *msg.buffer, true);
             break;
           case P2pMessage::NOTIFY:
-            proto.sendMessage(msg.command, msg.buffer, false);
+            proto.sendMessage(msg.command, *msg.buffer, false);
             break;
           case P2pMessage::REPLY:
-            proto.sendReply(msg.command, msg.buffer, msg.returnCode);
+            proto.sendReply(msg.command, *msg.buffer, msg.returnCode);
             break;
           default:
             assert(false);
@@ -46,21 +46,25 @@ namespace CryptoNote
       NOTIFY
     };
 
-    P2pMessage(Type type, uint32_t command, const BinaryArray& buffer, int32_t returnCode = 0) :
+    P2pMessage(Type type, uint32_t command, const SharedBinaryArray& buffer, int32_t returnCode = 0) :
       type(type), command(command), buffer(buffer), returnCode(returnCode) {
     }
 
+    P2pMessage(Type type, uint32_t command, BinaryArray&& buffer, int32_t returnCode = 0) :
+      type(type), command(command), buffer(std::make_shared<const BinaryArray>(std::move(buffer))), returnCode(returnCode) {
+    }
+
     P2pMessage(P2pMessage&& msg) :
       type(msg.type), command(msg.command), buffer(std::move(msg.buffer)), returnCode(msg.returnCode) {
     }
 
     size_t size() {
-      return buffer.size();
+      return buffer->size();
     }
 
     Type type;
     uint32_t command;
-    const BinaryArray buffer;
+    SharedBinaryArray buffer;
     int32_t returnCode;
   };
 
@@ -161,10 +165,8 @@ namespace CryptoNote
     void on_connection_close(P2pConnectionContext& context);
 
     //----------------- i_p2p_endpoint -------------------------------------------------------------
-    virtual void relay_notify_to_all(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) override;
-    virtual bool invoke_notify_to_peer(int command, const BinaryArray& req_buff, const CryptoNoteConnectionContext& context) override;
+    virtual bool invoke_notify_to_peer(int command, const SharedBinaryArray& req_buff, const CryptoNoteConnectionContext& context) override;
     virtual void for_each_connection(std::function<void(CryptoNote::CryptoNoteConnectionContext&, PeerIdType)> f) override;
-    virtual void externalRelayNotifyToAll(int command, const BinaryArray& data_buff) override;
 
     //-----------------------------------------------------------------------------------------------
     bool handle_command_line(const boost::program_options::variables_map& vm);
@@ -193,6 +195,7 @@ namespace CryptoNote
 
     //debug functions
     std::string print_connections_container();
+    bool pushMessage(P2pConnectionContext& context, P2pMessage&& message);
 
     typedef std::unordered_map<boost::uuids::uuid, P2pConnectionContext, boost::hash<boost::uuids::uuid>> ConnectionContainer;
     typedef ConnectionContainer::iterator ConnectionIterator;
@@ -236,6 +239,8 @@ namespace CryptoNote
     System::TcpListener m_listener;
     Logging::LoggerRef logger;
     std::atomic<bool> m_stop;
+    // Bytes of the messages queued to the connections, the protocol handler counts those it had to copy
+    uint64_t m_queuedBytes;
 
     CryptoNoteProtocolHandler& m_payload_handler;
     PeerlistManager m_peerlist;
@@ -7,6 +7,8 @@
 #include <arpa/inet.h>
 #include <cassert>
 #include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <System/ErrorMessage.h>
@@ -147,14 +149,12 @@ size_t TcpConnection::read(uint8_t* data, size_t size) {
 }
 
 std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
-  assert(dispatcher != nullptr);
-  assert(contextPair.writeContext == nullptr);
-  if (dispatcher->interrupted()) {
-    throw InterruptedException();
-  }
-
-  std::string message;
   if(size == 0) {
+    assert(dispatcher != nullptr);
+    if (dispatcher->interrupted()) {
+      throw InterruptedException();
+    }
+
     if(shutdown(connection, SHUT_WR) == -1) {
       throw std::runtime_error("TcpConnection::write, shutdown failed, " + lastErrorMessage());
     }
@@ -162,7 +162,27 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  ssize_t transferred = ::send(connection, (void *)data, size, MSG_NOSIGNAL);
+  return write(nullptr, 0, data, size);
+}
+
+std::size_t TcpConnection::write(const uint8_t* header, size_t headerSize, const uint8_t* data, size_t size) {
+  assert(dispatcher != nullptr);
+  assert(contextPair.writeContext == nullptr);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  iovec buffers[2];
+  buffers[0].iov_base = const_cast<uint8_t*>(header);
+  buffers[0].iov_len = headerSize;
+  buffers[1].iov_base = const_cast<uint8_t*>(data);
+  buffers[1].iov_len = size;
+  msghdr messageHeader = {};
+  messageHeader.msg_iov = headerSize == 0 ? buffers + 1 : buffers;
+  messageHeader.msg_iovlen = headerSize == 0 ? 1 : 2;
+
+  std::string message;
+  ssize_t transferred = ::sendmsg(connection, &messageHeader, MSG_NOSIGNAL);
   if (transferred == -1) {
     if (errno != EAGAIN  && errno != EWOULDBLOCK) {
       message = "send failed, " + lastErrorMessage();
@@ -225,11 +245,11 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
           throw std::runtime_error("TcpConnection::write, events & (EPOLLERR | EPOLLHUP) != 0");
         }
 
-        ssize_t transferred = ::send(connection, (void *)data, size, 0);
+        ssize_t transferred = ::sendmsg(connection, &messageHeader, MSG_NOSIGNAL);
         if (transferred == -1) {
           message = "send failed, "  + lastErrorMessage();
         } else {
-          assert(transferred <= static_cast<ssize_t>(size));
+          assert(transferred <= static_cast<ssize_t>(headerSize + size));
           return transferred;
         }
       }
@@ -238,7 +258,7 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
     throw std::runtime_error("TcpConnection::write, " + message);
   }
 
-  assert(transferred <= static_cast<ssize_t>(size));
+  assert(transferred <= static_cast<ssize_t>(headerSize + size));
   return transferred;
 }
 
@@ -23,6 +23,8 @@ public:
   TcpConnection& operator=(TcpConnection&& other);
   std::size_t read(uint8_t* data, std::size_t size);
   std::size_t write(const uint8_t* data, std::size_t size);
+  // Writes the header and the data with one send, so that they are not copied into one buffer first
+  std::size_t write(const uint8_t* header, std::size_t headerSize, const uint8_t* data, std::size_t size);
   std::pair<Ipv4Address, uint16_t> getPeerAddressAndPort() const;
 
 private:
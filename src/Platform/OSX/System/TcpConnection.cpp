@@ -9,6 +9,7 @@
 #include <sys/event.h>
 #include <sys/errno.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "Dispatcher.h"
@@ -131,14 +132,12 @@ size_t TcpConnection::read(uint8_t* data, size_t size) {
 }
 
 size_t TcpConnection::write(const uint8_t* data, size_t size) {
-  assert(dispatcher != nullptr);
-  assert(writeContext == nullptr);
-  if (dispatcher->interrupted()) {
-    throw InterruptedException();
-  }
-
-  std::string message;
   if (size == 0) {
+    assert(dispatcher != nullptr);
+    if (dispatcher->interrupted()) {
+      throw InterruptedException();
+    }
+
     if (shutdown(connection, SHUT_WR) == -1) {
       throw std::runtime_error("TcpConnection::write, shutdown failed, " + lastErrorMessage());
     }
@@ -146,7 +145,27 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  ssize_t transferred = ::send(connection, (void *)data, size, 0);
+  return write(nullptr, 0, data, size);
+}
+
+size_t TcpConnection::write(const uint8_t* header, size_t headerSize, const uint8_t* data, size_t size) {
+  assert(dispatcher != nullptr);
+  assert(writeContext == nullptr);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  iovec buffers[2];
+  buffers[0].iov_base = const_cast<uint8_t*>(header);
+  buffers[0].iov_len = headerSize;
+  buffers[1].iov_base = const_cast<uint8_t*>(data);
+  buffers[1].iov_len = size;
+  msghdr messageHeader = {};
+  messageHeader.msg_iov = headerSize == 0 ? buffers + 1 : buffers;
+  messageHeader.msg_iovlen = headerSize == 0 ? 1 : 2;
+
+  std::string message;
+  ssize_t transferred = ::sendmsg(connection, &messageHeader, 0);
   if (transferred == -1) {
     if (errno != EAGAIN  && errno != EWOULDBLOCK) {
       message = "send failed, " + lastErrorMessage();
@@ -188,11 +207,11 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
           throw InterruptedException();
         }
 
-        ssize_t transferred = ::send(connection, (void *)data, size, 0);
+        ssize_t transferred = ::sendmsg(connection, &messageHeader, 0);
         if (transferred == -1) {
           message = "send failed, " + lastErrorMessage();
         } else {
-          assert(transferred <= static_cast<ssize_t>(size));
+          assert(transferred <= static_cast<ssize_t>(headerSize + size));
           return transferred;
         }
       }
@@ -201,7 +220,7 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     throw std::runtime_error("TcpConnection::write, " + message);
   }
 
-  assert(transferred <= static_cast<ssize_t>(size));
+  assert(transferred <= static_cast<ssize_t>(headerSize + size));
   return transferred;
 }
 
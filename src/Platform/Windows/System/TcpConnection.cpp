@@ -133,13 +133,12 @@ size_t TcpConnection::read(uint8_t* data, size_t size) {
 }
 
 size_t TcpConnection::write(const uint8_t* data, size_t size) {
-  assert(dispatcher != nullptr);
-  assert(writeContext == nullptr);
-  if (dispatcher->interrupted()) {
-    throw InterruptedException();
-  }
-
   if (size == 0) {
+    assert(dispatcher != nullptr);
+    if (dispatcher->interrupted()) {
+      throw InterruptedException();
+    }
+
     if (shutdown(connection, SD_SEND) != 0) {
       throw std::runtime_error("TcpConnection::write, shutdown failed, " + errorMessage(WSAGetLastError()));
     }
@@ -147,10 +146,24 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  WSABUF buf{static_cast<ULONG>(size), reinterpret_cast<char*>(const_cast<uint8_t*>(data))};
+  return write(nullptr, 0, data, size);
+}
+
+size_t TcpConnection::write(const uint8_t* header, size_t headerSize, const uint8_t* data, size_t size) {
+  assert(dispatcher != nullptr);
+  assert(writeContext == nullptr);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  WSABUF buffers[2] = {
+    {static_cast<ULONG>(headerSize), reinterpret_cast<char*>(const_cast<uint8_t*>(header))},
+    {static_cast<ULONG>(size), reinterpret_cast<char*>(const_cast<uint8_t*>(data))}
+  };
+
   TcpConnectionContext context;
   context.hEvent = NULL;
-  if (WSASend(connection, &buf, 1, NULL, 0, &context, NULL) != 0) {
+  if (WSASend(connection, headerSize == 0 ? buffers + 1 : buffers, headerSize == 0 ? 1 : 2, NULL, 0, &context, NULL) != 0) {
     int lastError = WSAGetLastError();
     if (lastError != WSA_IO_PENDING) {
       throw std::runtime_error("TcpConnection::write, WSASend failed, " + errorMessage(lastError));
@@ -196,7 +209,7 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     throw InterruptedException();
   }
 
-  assert(transferred == size);
+  assert(transferred == headerSize + size);
   assert(flags == 0);
   return transferred;
 }
@@ -13,3 +13,7 @@
 #define CORE_RPC_ERROR_CODE_WRONG_BLOCKBLOB       -6
 #define CORE_RPC_ERROR_CODE_BLOCK_NOT_ACCEPTED    -7
 #define CORE_RPC_ERROR_CODE_CORE_BUSY             -9
+#define CORE_RPC_ERROR_CODE_UNAUTHORIZED          -10
+#define CORE_RPC_ERROR_CODE_STALE_SHARE           -11
+#define CORE_RPC_ERROR_CODE_DUPLICATE_SHARE       -12
+#define CORE_RPC_ERROR_CODE_LOW_DIFFICULTY_SHARE  -13
@@ -324,6 +324,9 @@ bool RpcServer::on_get_info(const COMMAND_RPC_GET_INFO::request& req, COMMAND_RP
   res.difficulty = m_core.getNextBlockDifficulty();
   res.tx_count = m_core.get_blockchain_total_transactions() - res.height; //without coinbase
   res.tx_pool_size = m_core.get_pool_transactions_count();
+  res.tx_pool_bytes = m_core.get_pool_transactions_size();
+  res.tx_pool_evicted_count = m_core.get_pool_evicted_transactions_count();
+  res.min_tx_fee = m_core.get_pool_minimum_fee();
   res.alt_blocks_count = m_core.get_alternative_blocks_count();
   uint64_t total_conn = m_p2p.get_connections_count();
   res.outgoing_connections_count = m_p2p.get_outgoing_connections_count();
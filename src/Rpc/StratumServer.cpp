@@ -0,0 +1,426 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "StratumServer.h"
+
+#include <boost/scope_exit.hpp>
+
+#include <Common/StringTools.h>
+#include <Common/WorkerPool.h>
+#include <System/Context.h>
+#include <System/EventLock.h>
+#include <System/InterruptedException.h>
+#include <System/Ipv4Address.h>
+#include <System/TcpStream.h>
+
+#include "CryptoNoteCore/CryptoNoteBasicImpl.h"
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+#include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteProtocol/ICryptoNoteProtocolQuery.h"
+#include "CoreRpcServerErrorCodes.h"
+
+using namespace Logging;
+using namespace Common;
+
+namespace CryptoNote {
+
+namespace {
+
+const size_t MAX_LINE_SIZE = 4096;
+// Shares of jobs older than that are stale
+const size_t MAX_CLIENT_JOBS = 4;
+// The share difficulty is adjusted after that many shares, or as long as it takes to find them at the target rate
+const size_t RETARGET_SHARES = 10;
+// Keeps the compact target meaningful
+const difficulty_type MAX_SHARE_DIFFICULTY = std::numeric_limits<uint32_t>::max();
+// A miner sending that many invalid shares in a row is disconnected, as each of them may cost a hash
+const size_t MAX_INVALID_SHARES = 10;
+// Connections from the address of a disconnected miner are refused for that long
+const std::chrono::minutes BAN_TIME(10);
+
+}
+
+StratumServer::Client::Client(System::Dispatcher& dispatcher, System::TcpConnection& connection, uint32_t id, difficulty_type difficulty) :
+  connection(connection), writeLock(dispatcher), jobUpdated(dispatcher), id(id), loggedIn(false), nextJobId(0),
+  difficulty(difficulty), shares(0), retargetStart(std::chrono::steady_clock::now()), invalidShares(0), banned(false) {
+  writeLock.set();
+}
+
+StratumServer::StratumServer(System::Dispatcher& dispatcher, Logging::ILogger& log, const Currency& currency, ICore& core,
+  IMinerHandler& minerHandler, const ICryptoNoteProtocolQuery& protocolQuery, difficulty_type shareDifficulty,
+  uint32_t shareTargetTime, size_t maxClients) :
+  m_dispatcher(dispatcher), logger(log, "StratumServer"), m_currency(currency), m_core(core), m_minerHandler(minerHandler),
+  m_protocolQuery(protocolQuery), m_shareDifficulty(std::min(shareDifficulty, MAX_SHARE_DIFFICULTY)),
+  m_shareTargetTime(shareTargetTime), m_maxClients(maxClients), m_workingContextGroup(dispatcher), m_nextClientId(1) {
+}
+
+template <typename Params, typename Result>
+StratumServer::HandlerFunction StratumServer::makeClientMethod(bool (StratumServer::*handler)(Client&, const Params&, Result&)) {
+  return [handler](StratumServer* server, Client& client, const JsonRpc::JsonRpcRequest& req, JsonRpc::JsonRpcResponse& res) {
+    return JsonRpc::invokeMethod<Params, Result>(
+      req, res, std::bind(handler, server, std::ref(client), std::placeholders::_1, std::placeholders::_2));
+  };
+}
+
+void StratumServer::start(const std::string& address, uint16_t port) {
+  m_listener = System::TcpListener(m_dispatcher, System::Ipv4Address(address), port);
+  m_core.addObserver(this);
+  m_workingContextGroup.spawn(std::bind(&StratumServer::acceptLoop, this));
+}
+
+void StratumServer::stop() {
+  m_core.removeObserver(this);
+  m_workingContextGroup.interrupt();
+  m_workingContextGroup.wait();
+}
+
+std::string StratumServer::difficultyToTarget(difficulty_type difficulty) {
+  uint32_t target = std::numeric_limits<uint32_t>::max() / static_cast<uint32_t>(std::max<difficulty_type>(1, std::min(difficulty, MAX_SHARE_DIFFICULTY)));
+  return podToHex(target);
+}
+
+// Called on the thread that added the block
+void StratumServer::blockchainUpdated() {
+  m_dispatcher.remoteSpawn([this] {
+    for (Client* client : m_clients) {
+      client->jobUpdated.set();
+    }
+  });
+}
+
+void StratumServer::acceptLoop() {
+  try {
+    System::TcpConnection connection;
+    bool accepted = false;
+
+    while (!accepted) {
+      try {
+        connection = m_listener.accept();
+        accepted = true;
+      } catch (System::InterruptedException&) {
+        throw;
+      } catch (std::exception&) {
+        // try again
+      }
+    }
+
+    m_workingContextGroup.spawn(std::bind(&StratumServer::acceptLoop, this));
+
+    auto addr = connection.getPeerAddressAndPort();
+    if (isBanned(addr.first.getValue())) {
+      logger(DEBUGGING) << "Connection from banned miner address " << addr.first.toDottedDecimal() << " refused";
+      return;
+    }
+
+    if (m_clients.size() >= m_maxClients) {
+      logger(DEBUGGING) << "Too many miners connected, connection from " << addr.first.toDottedDecimal() << ":" << addr.second << " refused";
+      return;
+    }
+
+    logger(DEBUGGING) << "Miner connected from " << addr.first.toDottedDecimal() << ":" << addr.second;
+
+    Client client(m_dispatcher, connection, m_nextClientId++, m_shareDifficulty);
+    m_clients.insert(&client);
+    BOOST_SCOPE_EXIT_ALL(this, &client) {
+      m_clients.erase(&client); };
+
+    System::Context<> jobContext(m_dispatcher, std::bind(&StratumServer::jobLoop, this, std::ref(client)));
+
+    System::TcpStreambuf streambuf(connection);
+    std::istream stream(&streambuf);
+    char line[MAX_LINE_SIZE];
+    while (!client.banned && stream.getline(line, sizeof(line))) {
+      send(client, processLine(client, line));
+    }
+
+    logger(DEBUGGING) << "Miner disconnected from " << addr.first.toDottedDecimal() << ":" << addr.second << ", total=" << m_clients.size() - 1;
+
+  } catch (System::InterruptedException&) {
+  } catch (std::exception& e) {
+    logger(DEBUGGING) << "Miner connection error: " << e.what();
+  }
+}
+
+void StratumServer::jobLoop(Client& client) {
+  try {
+    for (;;) {
+      while (!client.jobUpdated.get()) {
+        client.jobUpdated.wait();
+      }
+
+      client.jobUpdated.clear();
+      if (!client.loggedIn) {
+        continue;
+      }
+
+      JsonRpc::JsonRpcRequest notification;
+      STRATUM_JOB job;
+      try {
+        makeJob(client, job);
+      } catch (const JsonRpc::JsonRpcError& e) {
+        logger(DEBUGGING) << "No job for miner " << client.id << ": " << e.what();
+        continue;
+      }
+
+      notification.setMethod("job");
+      notification.setParams(job);
+      send(client, notification.getBody());
+    }
+  } catch (System::InterruptedException&) {
+  } catch (std::exception& e) {
+    logger(DEBUGGING) << "Failed to send a job to miner " << client.id << ": " << e.what();
+  }
+}
+
+std::string StratumServer::processLine(Client& client, const std::string& line) {
+  using namespace JsonRpc;
+
+  JsonRpcRequest jsonRequest;
+  JsonRpcResponse jsonResponse;
+
+  try {
+    logger(TRACE) << "Stratum request: " << line;
+    jsonRequest.parseRequest(line);
+    jsonResponse.setId(jsonRequest.getId()); // copy id
+
+    static std::unordered_map<std::string, HandlerFunction> handlers = {
+      { "login", makeClientMethod(&StratumServer::onLogin) },
+      { "getjob", makeClientMethod(&StratumServer::onGetJob) },
+      { "submit", makeClientMethod(&StratumServer::onSubmit) },
+      { "keepalived", makeClientMethod(&StratumServer::onKeepalived) }
+    };
+
+    auto it = handlers.find(jsonRequest.getMethod());
+    if (it == handlers.end()) {
+      throw JsonRpcError(JsonRpc::errMethodNotFound);
+    }
+
+    it->second(this, client, jsonRequest, jsonResponse);
+
+  } catch (const JsonRpcError& err) {
+    jsonResponse.setError(err);
+  } catch (const std::exception& e) {
+    jsonResponse.setError(JsonRpcError(JsonRpc::errInternalError, e.what()));
+  }
+
+  return jsonResponse.getBody();
+}
+
+void StratumServer::send(Client& client, const std::string& message) {
+  System::EventLock lock(client.writeLock);
+  std::string line = message + '\n';
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(line.data());
+  size_t size = line.size();
+  while (size > 0) {
+    size_t transferred = client.connection.write(data, size);
+    data += transferred;
+    size -= transferred;
+  }
+}
+
+bool StratumServer::isCoreReady() {
+  return m_currency.isTestnet() || m_protocolQuery.isSynchronized();
+}
+
+void StratumServer::checkLoggedIn(const Client& client, const std::string& id) {
+  if (!client.loggedIn || id != std::to_string(client.id)) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_UNAUTHORIZED, "Unauthenticated" };
+  }
+}
+
+void StratumServer::makeJob(Client& client, STRATUM_JOB& job) {
+  if (!isCoreReady()) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_CORE_BUSY, "Core is busy" };
+  }
+
+  Job clientJob;
+  clientJob.id = client.nextJobId++;
+  if (!m_minerHandler.get_block_template(clientJob.block, client.address, clientJob.blockDifficulty, clientJob.height, BinaryArray()) ||
+    !clientJob.miningJob.init(clientJob.block)) {
+    logger(ERROR) << "Failed to create block template";
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR, "Internal error: failed to create block template" };
+  }
+
+  adjustDifficulty(client);
+  clientJob.shareDifficulty = std::min(client.difficulty, clientJob.blockDifficulty);
+
+  job.blob = toHex(clientJob.miningJob.hashingBlob());
+  job.job_id = std::to_string(clientJob.id);
+  job.target = difficultyToTarget(clientJob.shareDifficulty);
+  job.height = clientJob.height;
+
+  client.jobs.push_back(std::move(clientJob));
+  if (client.jobs.size() > MAX_CLIENT_JOBS) {
+    client.jobs.pop_front();
+  }
+}
+
+// Scales the share difficulty by the ratio of the target share time to the measured one. Miners that find no share
+// at all get half the difficulty, each step changes it at most fourfold.
+void StratumServer::adjustDifficulty(Client& client) {
+  auto now = std::chrono::steady_clock::now();
+  uint64_t elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - client.retargetStart).count();
+  if (client.shares < RETARGET_SHARES && elapsed < m_shareTargetTime * RETARGET_SHARES) {
+    return;
+  }
+
+  difficulty_type difficulty = client.shares == 0 ? client.difficulty / 2 :
+    client.difficulty * client.shares * m_shareTargetTime / std::max<uint64_t>(elapsed, 1);
+  difficulty = std::max(difficulty, client.difficulty / 4);
+  difficulty = std::min(difficulty, client.difficulty * 4);
+  client.difficulty = std::max<difficulty_type>(1, std::min(difficulty, MAX_SHARE_DIFFICULTY));
+  client.shares = 0;
+  client.retargetStart = now;
+}
+
+bool StratumServer::onLogin(Client& client, const COMMAND_STRATUM_LOGIN::request& req, COMMAND_STRATUM_LOGIN::response& res) {
+  AccountPublicAddress address;
+  if (!m_currency.parseAccountAddressString(req.login, address)) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_WRONG_WALLET_ADDRESS, "Failed to parse wallet address" };
+  }
+
+  if (!client.hashContext) {
+    client.hashContext.reset(new Crypto::cn_context());
+  }
+
+  client.address = address;
+  client.loggedIn = true;
+  client.jobs.clear();
+  makeJob(client, res.job);
+
+  logger(INFO) << "Miner " << client.id << " logged in, agent: " << req.agent;
+  res.id = std::to_string(client.id);
+  res.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
+bool StratumServer::onGetJob(Client& client, const COMMAND_STRATUM_GETJOB::request& req, COMMAND_STRATUM_GETJOB::response& res) {
+  checkLoggedIn(client, req.id);
+  makeJob(client, res);
+  return true;
+}
+
+bool StratumServer::onSubmit(Client& client, const COMMAND_STRATUM_SUBMIT::request& req, COMMAND_STRATUM_SUBMIT::response& res) {
+  checkLoggedIn(client, req.id);
+
+  try {
+    checkShare(client, req);
+  } catch (const JsonRpc::JsonRpcError& e) {
+    // Stale shares are sent by honest miners too, after a block is found
+    if (e.code != CORE_RPC_ERROR_CODE_STALE_SHARE && ++client.invalidShares >= MAX_INVALID_SHARES) {
+      auto addr = client.connection.getPeerAddressAndPort();
+      logger(INFO) << "Miner " << client.id << " from " << addr.first.toDottedDecimal() << " sent too many invalid shares, disconnecting";
+      m_bannedAddresses[addr.first.getValue()] = std::chrono::steady_clock::now() + BAN_TIME;
+      client.banned = true;
+    }
+
+    throw;
+  }
+
+  client.invalidShares = 0;
+  res.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
+void StratumServer::checkShare(Client& client, const COMMAND_STRATUM_SUBMIT::request& req) {
+  uint32_t nonce;
+  if (!podFromHex(req.nonce, nonce)) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_WRONG_PARAM, "Wrong nonce" };
+  }
+
+  auto findJob = [&client, &req] {
+    return std::find_if(client.jobs.begin(), client.jobs.end(), [&req](const Job& job) { return std::to_string(job.id) == req.job_id; });
+  };
+
+  auto job = findJob();
+  if (job == client.jobs.end()) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_STALE_SHARE, "Block expired" };
+  }
+
+  if (job->nonces.count(nonce) != 0) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_DUPLICATE_SHARE, "Duplicate share" };
+  }
+
+  // A claimed result that misses the target saves hashing the share
+  Crypto::Hash claimedHash;
+  if (podFromHex(req.result, claimedHash) && !check_hash(claimedHash, job->shareDifficulty)) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_LOW_DIFFICULTY_SHARE, "Low difficulty share" };
+  }
+
+  // The job may be dropped by a new one while the share is hashed
+  BlockMiningJob miningJob = job->miningJob;
+  miningJob.setNonce(nonce);
+  Crypto::Hash hash;
+  hashShare(client, miningJob, hash);
+
+  job = findJob();
+  if (job == client.jobs.end()) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_STALE_SHARE, "Block expired" };
+  }
+
+  // Only the nonces of valid shares are recorded, an invalid share doesn't prevent sending the right one
+  if (!check_hash(hash, job->shareDifficulty)) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_LOW_DIFFICULTY_SHARE, "Low difficulty share" };
+  }
+
+  job->nonces.insert(nonce);
+  if (++client.shares == RETARGET_SHARES) {
+    client.jobUpdated.set();
+  }
+
+  if (check_hash(hash, job->blockDifficulty)) {
+    Block block = job->block;
+    block.nonce = nonce;
+    if (m_minerHandler.handle_block_found(block)) {
+      logger(INFO, BRIGHT_GREEN) << "Miner " << client.id << " found block " << get_block_hash(block) << " at height " << job->height;
+    } else {
+      logger(WARNING) << "Block found by miner " << client.id << " at height " << job->height << " was not accepted";
+    }
+  }
+}
+
+// Hashes on a thread of the shared worker pool, the other connections are served meanwhile
+void StratumServer::hashShare(Client& client, const BlockMiningJob& miningJob, Crypto::Hash& hash) {
+  System::Event hashed(m_dispatcher);
+  Tools::WorkerPool::instance().post([this, &client, &miningJob, &hash, &hashed] {
+    miningJob.getLonghash(*client.hashContext, hash);
+    m_dispatcher.remoteSpawn([&hashed] { hashed.set(); });
+  });
+
+  // The task refers to the locals, an interruption is passed on once it is done, as System::RemoteContext does
+  bool interrupted = false;
+  while (!hashed.get()) {
+    try {
+      hashed.wait();
+    } catch (System::InterruptedException&) {
+      interrupted = true;
+    }
+  }
+
+  if (interrupted) {
+    m_dispatcher.interrupt();
+  }
+}
+
+bool StratumServer::isBanned(uint32_t address) {
+  auto it = m_bannedAddresses.find(address);
+  if (it == m_bannedAddresses.end()) {
+    return false;
+  }
+
+  if (std::chrono::steady_clock::now() < it->second) {
+    return true;
+  }
+
+  m_bannedAddresses.erase(it);
+  return false;
+}
+
+bool StratumServer::onKeepalived(Client& client, const COMMAND_STRATUM_KEEPALIVED::request& req, COMMAND_STRATUM_KEEPALIVED::response& res) {
+  checkLoggedIn(client, req.id);
+  res.status = "KEEPALIVED";
+  return true;
+}
+
+}
@@ -0,0 +1,123 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <System/ContextGroup.h>
+#include <System/Dispatcher.h>
+#include <System/Event.h>
+#include <System/TcpConnection.h>
+#include <System/TcpListener.h>
+
+#include <Logging/LoggerRef.h>
+
+#include "CryptoNoteCore/BlockMiningJob.h"
+#include "CryptoNoteCore/Difficulty.h"
+#include "CryptoNoteCore/ICore.h"
+#include "CryptoNoteCore/ICoreObserver.h"
+#include "CryptoNoteCore/IMinerHandler.h"
+#include "JsonRpc.h"
+#include "StratumServerCommandsDefinitions.h"
+
+namespace CryptoNote {
+
+class Currency;
+class ICryptoNoteProtocolQuery;
+
+// Mining job server speaking the line based JSON-RPC protocol of pool miners. Jobs are pushed to the connected
+// miners when the chain tail changes, shares are checked against a difficulty adjusted per connection. The shares
+// are hashed by the shared worker pool. A miner sending too many invalid shares in a row is disconnected and its
+// address is refused for a while.
+class StratumServer : public ICoreObserver {
+public:
+  StratumServer(System::Dispatcher& dispatcher, Logging::ILogger& log, const Currency& currency, ICore& core,
+    IMinerHandler& minerHandler, const ICryptoNoteProtocolQuery& protocolQuery, difficulty_type shareDifficulty,
+    uint32_t shareTargetTime, size_t maxClients);
+
+  void start(const std::string& address, uint16_t port);
+  void stop();
+
+  // Compact share target of the protocol, miners compare it with the most significant 32 bits of a long hash
+  static std::string difficultyToTarget(difficulty_type difficulty);
+
+private:
+  struct Job {
+    uint32_t id;
+    Block block;
+    BlockMiningJob miningJob;
+    difficulty_type blockDifficulty;
+    difficulty_type shareDifficulty;
+    uint32_t height;
+    std::unordered_set<uint32_t> nonces;
+  };
+
+  struct Client {
+    Client(System::Dispatcher& dispatcher, System::TcpConnection& connection, uint32_t id, difficulty_type difficulty);
+
+    System::TcpConnection& connection;
+    // Set while nobody writes to the connection
+    System::Event writeLock;
+    System::Event jobUpdated;
+    uint32_t id;
+    bool loggedIn;
+    AccountPublicAddress address;
+    std::unique_ptr<Crypto::cn_context> hashContext;
+    std::deque<Job> jobs;
+    uint32_t nextJobId;
+    difficulty_type difficulty;
+    size_t shares;
+    std::chrono::steady_clock::time_point retargetStart;
+    // Invalid shares since the last valid one
+    size_t invalidShares;
+    bool banned;
+  };
+
+  typedef std::function<bool(StratumServer*, Client&, const JsonRpc::JsonRpcRequest&, JsonRpc::JsonRpcResponse&)> HandlerFunction;
+
+  virtual void blockchainUpdated() override;
+
+  void acceptLoop();
+  void jobLoop(Client& client);
+  std::string processLine(Client& client, const std::string& line);
+  void send(Client& client, const std::string& message);
+  bool isCoreReady();
+  void checkLoggedIn(const Client& client, const std::string& id);
+  void makeJob(Client& client, STRATUM_JOB& job);
+  void adjustDifficulty(Client& client);
+  bool isBanned(uint32_t address);
+  void hashShare(Client& client, const BlockMiningJob& miningJob, Crypto::Hash& hash);
+  void checkShare(Client& client, const COMMAND_STRATUM_SUBMIT::request& req);
+
+  bool onLogin(Client& client, const COMMAND_STRATUM_LOGIN::request& req, COMMAND_STRATUM_LOGIN::response& res);
+  bool onGetJob(Client& client, const COMMAND_STRATUM_GETJOB::request& req, COMMAND_STRATUM_GETJOB::response& res);
+  bool onSubmit(Client& client, const COMMAND_STRATUM_SUBMIT::request& req, COMMAND_STRATUM_SUBMIT::response& res);
+  bool onKeepalived(Client& client, const COMMAND_STRATUM_KEEPALIVED::request& req, COMMAND_STRATUM_KEEPALIVED::response& res);
+
+  template <typename Params, typename Result>
+  static HandlerFunction makeClientMethod(bool (StratumServer::*handler)(Client&, const Params&, Result&));
+
+  System::Dispatcher& m_dispatcher;
+  Logging::LoggerRef logger;
+  const Currency& m_currency;
+  ICore& m_core;
+  IMinerHandler& m_minerHandler;
+  const ICryptoNoteProtocolQuery& m_protocolQuery;
+  const difficulty_type m_shareDifficulty;
+  const uint32_t m_shareTargetTime;
+  const size_t m_maxClients;
+  System::ContextGroup m_workingContextGroup;
+  System::TcpListener m_listener;
+  std::unordered_set<Client*> m_clients;
+  uint32_t m_nextClientId;
+  std::unordered_map<uint32_t, std::chrono::steady_clock::time_point> m_bannedAddresses;
+};
+
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include "CoreRpcServerCommandsDefinitions.h"
+
+namespace CryptoNote {
+
+// The hashing blob has the nonce at the same offset as block headers do, the target is the share difficulty
+// in the compact form of StratumServer::difficultyToTarget
+struct STRATUM_JOB {
+  std::string blob;
+  std::string job_id;
+  std::string target;
+  uint32_t height;
+
+  void serialize(ISerializer &s) {
+    KV_MEMBER(blob)
+    KV_MEMBER(job_id)
+    KV_MEMBER(target)
+    KV_MEMBER(height)
+  }
+};
+
+struct COMMAND_STRATUM_LOGIN {
+  struct request {
+    std::string login;
+    std::string pass;
+    std::string agent;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(login)
+      KV_MEMBER(pass)
+      KV_MEMBER(agent)
+    }
+  };
+
+  struct response {
+    std::string id;
+    STRATUM_JOB job;
+    std::string status;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(id)
+      KV_MEMBER(job)
+      KV_MEMBER(status)
+    }
+  };
+};
+
+struct COMMAND_STRATUM_GETJOB {
+  struct request {
+    std::string id;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(id)
+    }
+  };
+
+  typedef STRATUM_JOB response;
+};
+
+struct COMMAND_STRATUM_SUBMIT {
+  struct request {
+    std::string id;
+    std::string job_id;
+    std::string nonce;
+    std::string result;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(id)
+      KV_MEMBER(job_id)
+      KV_MEMBER(nonce)
+      KV_MEMBER(result)
+    }
+  };
+
+  typedef STATUS_STRUCT response;
+};
+
+struct COMMAND_STRATUM_KEEPALIVED {
+  struct request {
+    std::string id;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(id)
+    }
+  };
+
+  typedef STATUS_STRUCT response;
+};
+
+}
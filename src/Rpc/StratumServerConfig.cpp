@@ -0,0 +1,54 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "StratumServerConfig.h"
+#include "Common/CommandLine.h"
+
+namespace CryptoNote {
+
+  namespace {
+
+    const std::string DEFAULT_STRATUM_IP = "127.0.0.1";
+    const uint16_t DEFAULT_STRATUM_PORT = 0;
+    const uint64_t DEFAULT_SHARE_DIFFICULTY = 1000;
+    const uint32_t DEFAULT_SHARE_TARGET_TIME = 30;
+    const uint32_t DEFAULT_MAX_CLIENTS = 100;
+
+    const command_line::arg_descriptor<std::string> arg_stratum_bind_ip = { "stratum-bind-ip", "Interface of the mining job server", DEFAULT_STRATUM_IP };
+    const command_line::arg_descriptor<uint16_t> arg_stratum_bind_port = { "stratum-bind-port", "Port of the mining job server, 0 disables it", DEFAULT_STRATUM_PORT };
+    const command_line::arg_descriptor<uint64_t> arg_stratum_difficulty = { "stratum-difficulty", "Initial share difficulty of a miner connection", DEFAULT_SHARE_DIFFICULTY };
+    const command_line::arg_descriptor<uint32_t> arg_stratum_share_time = { "stratum-share-time", "Seconds between shares the share difficulty is adjusted to", DEFAULT_SHARE_TARGET_TIME };
+    const command_line::arg_descriptor<uint32_t> arg_stratum_max_clients = { "stratum-max-clients", "Miner connections accepted at once", DEFAULT_MAX_CLIENTS };
+  }
+
+
+  StratumServerConfig::StratumServerConfig() : bindIp(DEFAULT_STRATUM_IP), bindPort(DEFAULT_STRATUM_PORT),
+    shareDifficulty(DEFAULT_SHARE_DIFFICULTY), shareTargetTime(DEFAULT_SHARE_TARGET_TIME), maxClients(DEFAULT_MAX_CLIENTS) {
+  }
+
+  bool StratumServerConfig::isEnabled() const {
+    return bindPort != 0;
+  }
+
+  std::string StratumServerConfig::getBindAddress() const {
+    return bindIp + ":" + std::to_string(bindPort);
+  }
+  
+  void StratumServerConfig::initOptions(boost::program_options::options_description& desc) {
+    command_line::add_arg(desc, arg_stratum_bind_ip);
+    command_line::add_arg(desc, arg_stratum_bind_port);
+    command_line::add_arg(desc, arg_stratum_difficulty);
+    command_line::add_arg(desc, arg_stratum_share_time);
+    command_line::add_arg(desc, arg_stratum_max_clients);
+  }
+
+  void StratumServerConfig::init(const boost::program_options::variables_map& vm)  {
+    bindIp = command_line::get_arg(vm, arg_stratum_bind_ip);
+    bindPort = command_line::get_arg(vm, arg_stratum_bind_port);
+    shareDifficulty = std::max<uint64_t>(command_line::get_arg(vm, arg_stratum_difficulty), 1);
+    shareTargetTime = std::max<uint32_t>(command_line::get_arg(vm, arg_stratum_share_time), 1);
+    maxClients = std::max<uint32_t>(command_line::get_arg(vm, arg_stratum_max_clients), 1);
+  }
+
+}
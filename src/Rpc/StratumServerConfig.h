@@ -0,0 +1,29 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <boost/program_options.hpp>
+
+namespace CryptoNote {
+
+class StratumServerConfig {
+public:
+
+  StratumServerConfig();
+
+  static void initOptions(boost::program_options::options_description& desc);
+  void init(const boost::program_options::variables_map& options);
+
+  bool isEnabled() const;
+  std::string getBindAddress() const;
+
+  std::string bindIp;
+  uint16_t bindPort;
+  uint64_t shareDifficulty;
+  uint32_t shareTargetTime;
+  uint32_t maxClients;
+};
+
+}
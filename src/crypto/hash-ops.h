@@ -47,12 +47,17 @@ void hash_process(union hash_state *state, const uint8_t *buf, size_t count);
 enum {
   HASH_SIZE = 32,
   HASH_DATA_AREA = 136,
-  SLOW_HASH_CONTEXT_SIZE = 2097552
+  SLOW_HASH_SCRATCHPAD_SIZE = 2097152,
+  SLOW_HASH_STATE_SIZE = 400
 };
 
 void cn_fast_hash(const void *data, size_t length, char *hash);
 
 void cn_slow_hash_f(void *, const void *, size_t, void *);
+void cn_slow_hash_2way_f(void *, void *, const void *, size_t, const void *, size_t, void *, void *);
+// The slow hash state of SLOW_HASH_STATE_SIZE bytes is passed to the functions above, it refers to a scratchpad of
+// SLOW_HASH_SCRATCHPAD_SIZE bytes allocated apart
+void cn_slow_hash_set_scratchpad(void *context, void *scratchpad);
 
 void hash_extra_blake(const void *data, size_t length, char *hash);
 void hash_extra_groestl(const void *data, size_t length, char *hash);
@@ -29,6 +29,16 @@ namespace Crypto {
     return h;
   }
 
+  // The pages backing a slow hash context, huge pages avoid TLB misses over the scratchpad.
+  // Transparent huge pages are requested only, the kernel may still use small pages.
+  enum class cn_page_mode {
+    small_pages,
+    transparent_huge_pages,
+    huge_pages
+  };
+
+  const char *cn_page_mode_name(cn_page_mode mode);
+
   class cn_context {
   public:
 
@@ -39,16 +49,32 @@ namespace Crypto {
     void operator=(const cn_context &) = delete;
 #endif
 
+    cn_page_mode page_mode() const;
+    // False if the scratchpad pages couldn't be locked in memory and may be swapped out
+    bool is_locked() const;
+
   private:
 
     void *data;
+    void *scratchpad;
+    size_t size;
+    cn_page_mode mode;
+    bool locked;
     friend inline void cn_slow_hash(cn_context &, const void *, size_t, Hash &);
+    friend inline void cn_slow_hash(cn_context &, cn_context &, const void *, size_t, const void *, size_t, Hash &, Hash &);
   };
 
   inline void cn_slow_hash(cn_context &context, const void *data, size_t length, Hash &hash) {
     (*cn_slow_hash_f)(context.data, data, length, reinterpret_cast<void *>(&hash));
   }
 
+  // Two independent hashes at once, faster than two calls with AES-NI as their memory hard loops are interleaved
+  inline void cn_slow_hash(cn_context &context0, cn_context &context1, const void *data0, size_t length0,
+    const void *data1, size_t length1, Hash &hash0, Hash &hash1) {
+    (*cn_slow_hash_2way_f)(context0.data, context1.data, data0, length0, data1, length1,
+      reinterpret_cast<void *>(&hash0), reinterpret_cast<void *>(&hash1));
+  }
+
   inline void tree_hash(const Hash *hashes, size_t count, Hash &root_hash) {
     tree_hash(reinterpret_cast<const char (*)[HASH_SIZE]>(hashes), count, reinterpret_cast<char *>(&root_hash));
   }
@@ -23,10 +23,16 @@
 
 void (*cn_slow_hash_fp)(void *, const void *, size_t, void *);
 
+void (*cn_slow_hash_2way_fp)(void *, void *, const void *, size_t, const void *, size_t, void *, void *);
+
 void cn_slow_hash_f(void * a, const void * b, size_t c, void * d){
 (*cn_slow_hash_fp)(a, b, c, d);
 }
 
+void cn_slow_hash_2way_f(void * a0, void * a1, const void * b0, size_t c0, const void * b1, size_t c1, void * d0, void * d1){
+(*cn_slow_hash_2way_fp)(a0, a1, b0, c0, b1, c1, d0, d1);
+}
+
 #if defined(__GNUC__)
 #define likely(x) (__builtin_expect(!!(x), 1))
 #define unlikely(x) (__builtin_expect(!!(x), 0))
@@ -65,17 +71,23 @@ union cn_slow_hash_state {
 #define ALIGNED_DECL(t, x) t ALIGNED_DATA(x)
 #endif
 
+// The scratchpad is allocated apart from the rest of the state, so that it fits a single huge page
 struct cn_ctx {
-  ALIGNED_DECL(uint8_t long_state[MEMORY], 16);
   ALIGNED_DECL(union cn_slow_hash_state state, 16);
   ALIGNED_DECL(uint8_t text[INIT_SIZE_BYTE], 16);
   ALIGNED_DECL(uint64_t a[AES_BLOCK_SIZE >> 3], 16);
   ALIGNED_DECL(uint64_t b[AES_BLOCK_SIZE >> 3], 16);
   ALIGNED_DECL(uint8_t c[AES_BLOCK_SIZE], 16);
   oaes_ctx* aes_ctx;
+  uint8_t *long_state;
 };
 
-static_assert(sizeof(struct cn_ctx) == SLOW_HASH_CONTEXT_SIZE, "Invalid structure size");
+static_assert(sizeof(struct cn_ctx) <= SLOW_HASH_STATE_SIZE, "Invalid structure size");
+static_assert(MEMORY == SLOW_HASH_SCRATCHPAD_SIZE, "Invalid scratchpad size");
+
+void cn_slow_hash_set_scratchpad(void *context, void *scratchpad) {
+  ((struct cn_ctx *) context)->long_state = (uint8_t *) scratchpad;
+}
 
 static inline void ExpandAESKey256_sub1(__m128i *tmp1, __m128i *tmp2)
 {
@@ -166,6 +178,186 @@ static void (*const extra_hashes[4])(const void *, size_t, char *) =
 #define AESNI
 #include "slow-hash.inl"
 
+static void cn_slow_hash_2way_noaesni(void *restrict context0, void *restrict context1, const void *restrict data0, size_t length0,
+  const void *restrict data1, size_t length1, void *restrict hash0, void *restrict hash1)
+{
+  cn_slow_hash_noaesni(context0, data0, length0, hash0);
+  cn_slow_hash_noaesni(context1, data1, length1, hash1);
+}
+
+static inline uint64_t cn_mul128(uint64_t multiplier, uint64_t multiplicand, uint64_t *product_hi)
+{
+#if defined(__GNUC__) && defined(__x86_64__)
+  uint64_t lo;
+  __asm__("mulq %3\n\t"
+    : "=d" (*product_hi),
+    "=a" (lo)
+    : "%a" (multiplier),
+    "rm" (multiplicand)
+    : "cc" );
+  return lo;
+#else
+  return mul128(multiplier, multiplicand, product_hi);
+#endif
+}
+
+// Fills the scratchpad from the keccak state, as the first loop of cn_slow_hash_aesni
+static inline void cn_explode_scratchpad_aesni(struct cn_ctx *ctx, uint8_t *ExpandedKey)
+{
+  __m128i *longoutput = (__m128i *) ctx->long_state;
+  __m128i *expkey = (__m128i *) ExpandedKey;
+  __m128i *xmminput = (__m128i *) ctx->text;
+  size_t i, j;
+
+  memcpy(ctx->text, ctx->state.init, INIT_SIZE_BYTE);
+  memcpy(ExpandedKey, ctx->state.hs.b, AES_KEY_SIZE);
+  ExpandAESKey256(ExpandedKey);
+
+  for (i = 0; likely(i < MEMORY); i += INIT_SIZE_BYTE)
+  {
+    for (j = 0; j < 10; j++)
+    {
+      xmminput[0] = _mm_aesenc_si128(xmminput[0], expkey[j]);
+      xmminput[1] = _mm_aesenc_si128(xmminput[1], expkey[j]);
+      xmminput[2] = _mm_aesenc_si128(xmminput[2], expkey[j]);
+      xmminput[3] = _mm_aesenc_si128(xmminput[3], expkey[j]);
+      xmminput[4] = _mm_aesenc_si128(xmminput[4], expkey[j]);
+      xmminput[5] = _mm_aesenc_si128(xmminput[5], expkey[j]);
+      xmminput[6] = _mm_aesenc_si128(xmminput[6], expkey[j]);
+      xmminput[7] = _mm_aesenc_si128(xmminput[7], expkey[j]);
+    }
+
+    _mm_store_si128(&(longoutput[(i >> 4)]), xmminput[0]);
+    _mm_store_si128(&(longoutput[(i >> 4) + 1]), xmminput[1]);
+    _mm_store_si128(&(longoutput[(i >> 4) + 2]), xmminput[2]);
+    _mm_store_si128(&(longoutput[(i >> 4) + 3]), xmminput[3]);
+    _mm_store_si128(&(longoutput[(i >> 4) + 4]), xmminput[4]);
+    _mm_store_si128(&(longoutput[(i >> 4) + 5]), xmminput[5]);
+    _mm_store_si128(&(longoutput[(i >> 4) + 6]), xmminput[6]);
+    _mm_store_si128(&(longoutput[(i >> 4) + 7]), xmminput[7]);
+  }
+}
+
+// Folds the scratchpad back into the keccak state and finishes the hash, as the last loop of cn_slow_hash_aesni
+static inline void cn_implode_scratchpad_aesni(struct cn_ctx *ctx, uint8_t *ExpandedKey, void *hash)
+{
+  __m128i *longoutput = (__m128i *) ctx->long_state;
+  __m128i *expkey = (__m128i *) ExpandedKey;
+  __m128i *xmminput = (__m128i *) ctx->text;
+  size_t i, j;
+
+  memcpy(ctx->text, ctx->state.init, INIT_SIZE_BYTE);
+  memcpy(ExpandedKey, &ctx->state.hs.b[32], AES_KEY_SIZE);
+  ExpandAESKey256(ExpandedKey);
+
+  for (i = 0; likely(i < MEMORY); i += INIT_SIZE_BYTE)
+  {
+    xmminput[0] = _mm_xor_si128(longoutput[(i >> 4)], xmminput[0]);
+    xmminput[1] = _mm_xor_si128(longoutput[(i >> 4) + 1], xmminput[1]);
+    xmminput[2] = _mm_xor_si128(longoutput[(i >> 4) + 2], xmminput[2]);
+    xmminput[3] = _mm_xor_si128(longoutput[(i >> 4) + 3], xmminput[3]);
+    xmminput[4] = _mm_xor_si128(longoutput[(i >> 4) + 4], xmminput[4]);
+    xmminput[5] = _mm_xor_si128(longoutput[(i >> 4) + 5], xmminput[5]);
+    xmminput[6] = _mm_xor_si128(longoutput[(i >> 4) + 6], xmminput[6]);
+    xmminput[7] = _mm_xor_si128(longoutput[(i >> 4) + 7], xmminput[7]);
+
+    for (j = 0; j < 10; j++)
+    {
+      xmminput[0] = _mm_aesenc_si128(xmminput[0], expkey[j]);
+      xmminput[1] = _mm_aesenc_si128(xmminput[1], expkey[j]);
+      xmminput[2] = _mm_aesenc_si128(xmminput[2], expkey[j]);
+      xmminput[3] = _mm_aesenc_si128(xmminput[3], expkey[j]);
+      xmminput[4] = _mm_aesenc_si128(xmminput[4], expkey[j]);
+      xmminput[5] = _mm_aesenc_si128(xmminput[5], expkey[j]);
+      xmminput[6] = _mm_aesenc_si128(xmminput[6], expkey[j]);
+      xmminput[7] = _mm_aesenc_si128(xmminput[7], expkey[j]);
+    }
+  }
+
+  memcpy(ctx->state.init, ctx->text, INIT_SIZE_BYTE);
+  hash_permutation(&ctx->state.hs);
+  extra_hashes[ctx->state.hs.b[0] & 3](&ctx->state, 200, hash);
+}
+
+// Two independent hashes with their memory hard loops interleaved, so the random scratchpad accesses and the
+// multiplications of one hash overlap the latencies of the other. Each hash is the same as cn_slow_hash_aesni gives.
+static void cn_slow_hash_2way_aesni(void *restrict context0, void *restrict context1, const void *restrict data0, size_t length0,
+  const void *restrict data1, size_t length1, void *restrict hash0, void *restrict hash1)
+{
+  struct cn_ctx *ctx0 = (struct cn_ctx *) context0;
+  struct cn_ctx *ctx1 = (struct cn_ctx *) context1;
+  ALIGNED_DECL(uint8_t ExpandedKey[256], 16);
+  ALIGNED_DECL(uint64_t a0[2], 16);
+  ALIGNED_DECL(uint64_t a1[2], 16);
+  uint8_t *long_state0 = ctx0->long_state;
+  uint8_t *long_state1 = ctx1->long_state;
+  __m128i b0_x, b1_x;
+  size_t i;
+
+  hash_process(&ctx0->state.hs, (const uint8_t*) data0, length0);
+  hash_process(&ctx1->state.hs, (const uint8_t*) data1, length1);
+
+  cn_explode_scratchpad_aesni(ctx0, ExpandedKey);
+  cn_explode_scratchpad_aesni(ctx1, ExpandedKey);
+
+  for (i = 0; i < 2; i++)
+  {
+    a0[i] = ((uint64_t *)ctx0->state.k)[i] ^ ((uint64_t *)ctx0->state.k)[i+4];
+    ctx0->b[i] = ((uint64_t *)ctx0->state.k)[i+2] ^ ((uint64_t *)ctx0->state.k)[i+6];
+    a1[i] = ((uint64_t *)ctx1->state.k)[i] ^ ((uint64_t *)ctx1->state.k)[i+4];
+    ctx1->b[i] = ((uint64_t *)ctx1->state.k)[i+2] ^ ((uint64_t *)ctx1->state.k)[i+6];
+  }
+
+  b0_x = _mm_load_si128((__m128i *)ctx0->b);
+  b1_x = _mm_load_si128((__m128i *)ctx1->b);
+
+  for (i = 0; likely(i < 0x80000); i++)
+  {
+    uint64_t *slot0 = (uint64_t *)&long_state0[a0[0] & 0x1FFFF0];
+    uint64_t *slot1 = (uint64_t *)&long_state1[a1[0] & 0x1FFFF0];
+    __m128i c0_x = _mm_aesenc_si128(_mm_load_si128((__m128i *)slot0), _mm_load_si128((__m128i *)a0));
+    __m128i c1_x = _mm_aesenc_si128(_mm_load_si128((__m128i *)slot1), _mm_load_si128((__m128i *)a1));
+    ALIGNED_DECL(uint64_t c0[2], 16);
+    ALIGNED_DECL(uint64_t c1[2], 16);
+    uint64_t *next0, *next1;
+    uint64_t b0[2], b1[2], hi0, lo0, hi1, lo1;
+
+    _mm_store_si128((__m128i *)c0, c0_x);
+    _mm_store_si128((__m128i *)c1, c1_x);
+    _mm_store_si128((__m128i *)slot0, _mm_xor_si128(b0_x, c0_x));
+    _mm_store_si128((__m128i *)slot1, _mm_xor_si128(b1_x, c1_x));
+
+    next0 = (uint64_t *)&long_state0[c0[0] & 0x1FFFF0];
+    next1 = (uint64_t *)&long_state1[c1[0] & 0x1FFFF0];
+    b0[0] = next0[0];
+    b0[1] = next0[1];
+    b1[0] = next1[0];
+    b1[1] = next1[1];
+
+    lo0 = cn_mul128(c0[0], b0[0], &hi0);
+    lo1 = cn_mul128(c1[0], b1[0], &hi1);
+
+    a0[0] += hi0;
+    a0[1] += lo0;
+    a1[0] += hi1;
+    a1[1] += lo1;
+    next0[0] = a0[0];
+    next0[1] = a0[1];
+    next1[0] = a1[0];
+    next1[1] = a1[1];
+
+    a0[0] ^= b0[0];
+    a0[1] ^= b0[1];
+    a1[0] ^= b1[0];
+    a1[1] ^= b1[1];
+    b0_x = c0_x;
+    b1_x = c1_x;
+  }
+
+  cn_implode_scratchpad_aesni(ctx0, ExpandedKey, hash0);
+  cn_implode_scratchpad_aesni(ctx1, ExpandedKey, hash1);
+}
+
 INITIALIZER(detect_aes) {
   int ecx;
 #if defined(_MSC_VER)
@@ -177,4 +369,5 @@ INITIALIZER(detect_aes) {
   __cpuid(1, a, b, ecx, d);
 #endif
   cn_slow_hash_fp = (ecx & (1 << 25)) ? &cn_slow_hash_aesni : &cn_slow_hash_noaesni;
+  cn_slow_hash_2way_fp = (ecx & (1 << 25)) ? &cn_slow_hash_2way_aesni : &cn_slow_hash_2way_noaesni;
 }
@@ -2,7 +2,10 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <cstdint>
+#include <cstring>
 #include <new>
+#include <type_traits>
 
 #include "hash.h"
 
@@ -17,44 +20,138 @@ using std::bad_alloc;
 namespace Crypto {
 
   enum {
-    MAP_SIZE = SLOW_HASH_CONTEXT_SIZE + ((-SLOW_HASH_CONTEXT_SIZE) & 0xfff)
+    HUGE_PAGE_SIZE = 1 << 21
   };
 
+  // The scratchpad fills a single huge page, the rest of the state is a small allocation of its own
+  static_assert(SLOW_HASH_SCRATCHPAD_SIZE % HUGE_PAGE_SIZE == 0, "Invalid scratchpad size");
+  typedef std::aligned_storage<SLOW_HASH_STATE_SIZE, 16>::type cn_state;
+
+  const char *cn_page_mode_name(cn_page_mode mode) {
+    switch (mode) {
+    case cn_page_mode::huge_pages:
+      return "huge pages";
+    case cn_page_mode::transparent_huge_pages:
+      return "transparent huge pages (advised)";
+    default:
+      return "small pages";
+    }
+  }
+
 #if defined(WIN32)
 
-  cn_context::cn_context() {
-    data = VirtualAlloc(nullptr, MAP_SIZE, MEM_COMMIT, PAGE_READWRITE);
-    if (data == nullptr) {
+  // Large pages need the "Lock pages in memory" privilege, without it the allocation fails. They are never paged out.
+  static void *map_scratchpad(size_t &size, cn_page_mode &mode, bool &locked) {
+    SIZE_T largePageSize = GetLargePageMinimum();
+    if (largePageSize != 0) {
+      size = SLOW_HASH_SCRATCHPAD_SIZE + ((largePageSize - SLOW_HASH_SCRATCHPAD_SIZE % largePageSize) % largePageSize);
+      void *scratchpad = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+      if (scratchpad != nullptr) {
+        mode = cn_page_mode::huge_pages;
+        locked = true;
+        return scratchpad;
+      }
+    }
+
+    size = SLOW_HASH_SCRATCHPAD_SIZE;
+    mode = cn_page_mode::small_pages;
+    void *scratchpad = VirtualAlloc(nullptr, size, MEM_COMMIT, PAGE_READWRITE);
+    if (scratchpad == nullptr) {
       throw bad_alloc();
     }
+
+    locked = VirtualLock(scratchpad, size) != 0;
+    return scratchpad;
   }
 
-  cn_context::~cn_context() {
-    if (!VirtualFree(data, 0, MEM_RELEASE)) {
+  static void unmap_scratchpad(void *scratchpad, size_t) {
+    if (!VirtualFree(scratchpad, 0, MEM_RELEASE)) {
       throw bad_alloc();
     }
   }
 
 #else
 
-  cn_context::cn_context() {
+  // Tries reserved huge pages, then transparent huge pages, then small pages. The pages are populated by the
+  // constructing thread, so under the default memory policy they come from the NUMA node it runs on.
+  static void *map_scratchpad(size_t &size, cn_page_mode &mode, bool &locked) {
+    size = SLOW_HASH_SCRATCHPAD_SIZE;
+#if defined(MAP_HUGETLB)
+    void *huge = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+    if (huge != MAP_FAILED) {
+      mode = cn_page_mode::huge_pages;
+      locked = mlock(huge, size) == 0;
+      return huge;
+    }
+#endif
+
+#if defined(MADV_HUGEPAGE)
+    // A huge page aligned mapping is cut out of a larger one
+    void *region = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region != MAP_FAILED) {
+      uint8_t *begin = static_cast<uint8_t *>(region);
+      uint8_t *aligned = begin + ((HUGE_PAGE_SIZE - reinterpret_cast<uintptr_t>(begin) % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE);
+      if (aligned != begin) {
+        munmap(begin, aligned - begin);
+      }
+
+      munmap(aligned + size, begin + HUGE_PAGE_SIZE - aligned);
+
+      if (madvise(aligned, size, MADV_HUGEPAGE) == 0) {
+        mode = cn_page_mode::transparent_huge_pages;
+        memset(aligned, 0, size);
+        locked = mlock(aligned, size) == 0;
+        return aligned;
+      }
+
+      munmap(aligned, size);
+    }
+#endif
+
+    mode = cn_page_mode::small_pages;
 #if !defined(__APPLE__)
-    data = mmap(nullptr, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    void *scratchpad = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
 #else
-    data = mmap(nullptr, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    void *scratchpad = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
 #endif
-    if (data == MAP_FAILED) {
+    if (scratchpad == MAP_FAILED) {
       throw bad_alloc();
     }
-    mlock(data, MAP_SIZE);
+
+    locked = mlock(scratchpad, size) == 0;
+    return scratchpad;
   }
 
-  cn_context::~cn_context() {
-    if (munmap(data, MAP_SIZE) != 0) {
+  static void unmap_scratchpad(void *scratchpad, size_t size) {
+    if (munmap(scratchpad, size) != 0) {
       throw bad_alloc();
     }
   }
 
 #endif
 
+  cn_context::cn_context() : data(new cn_state) {
+    try {
+      scratchpad = map_scratchpad(size, mode, locked);
+    } catch (...) {
+      delete static_cast<cn_state *>(data);
+      throw;
+    }
+
+    cn_slow_hash_set_scratchpad(data, scratchpad);
+  }
+
+  cn_context::~cn_context() {
+    delete static_cast<cn_state *>(data);
+    unmap_scratchpad(scratchpad, size);
+  }
+
+  cn_page_mode cn_context::page_mode() const {
+    return mode;
+  }
+
+  bool cn_context::is_locked() const {
+    return locked;
+  }
+
 }
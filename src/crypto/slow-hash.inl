@@ -15,6 +15,7 @@ cn_slow_hash_noaesni
   size_t i;
   __m128i *longoutput, *expkey, *xmminput, b_x;
   ALIGNED_DECL(uint64_t a[2], 16);
+  uint8_t *long_state = ctx->long_state;
   hash_process(&ctx->state.hs, (const uint8_t*) data, length);
 
   memcpy(ctx->text, ctx->state.init, INIT_SIZE_BYTE);
@@ -27,12 +28,12 @@ cn_slow_hash_noaesni
   memcpy(ExpandedKey, ctx->aes_ctx->key->exp_data, ctx->aes_ctx->key->exp_data_len);
 #endif
 
-  longoutput = (__m128i *) ctx->long_state;
+  longoutput = (__m128i *) long_state;
   expkey = (__m128i *) ExpandedKey;
   xmminput = (__m128i *) ctx->text;
 
   //for (i = 0; likely(i < MEMORY); i += INIT_SIZE_BYTE)
-  //    aesni_parallel_noxor(&ctx->long_state[i], ctx->text, ExpandedKey);
+  //    aesni_parallel_noxor(&long_state[i], ctx->text, ExpandedKey);
 
   for (i = 0; likely(i < MEMORY); i += INIT_SIZE_BYTE)
   {
@@ -80,7 +81,7 @@ cn_slow_hash_noaesni
 
   for(i = 0; likely(i < 0x80000); i++)
   {
-    __m128i c_x = _mm_load_si128((__m128i *)&ctx->long_state[a[0] & 0x1FFFF0]);
+    __m128i c_x = _mm_load_si128((__m128i *)&long_state[a[0] & 0x1FFFF0]);
     __m128i a_x = _mm_load_si128((__m128i *)a);
     ALIGNED_DECL(uint64_t c[2], 16);
     ALIGNED_DECL(uint64_t b[2], 16);
@@ -93,12 +94,12 @@ cn_slow_hash_noaesni
 #endif
 
     _mm_store_si128((__m128i *)c, c_x);
-    //__builtin_prefetch(&ctx->long_state[c[0] & 0x1FFFF0], 0, 1);
+    //__builtin_prefetch(&long_state[c[0] & 0x1FFFF0], 0, 1);
 
     b_x = _mm_xor_si128(b_x, c_x);
-    _mm_store_si128((__m128i *)&ctx->long_state[a[0] & 0x1FFFF0], b_x);
+    _mm_store_si128((__m128i *)&long_state[a[0] & 0x1FFFF0], b_x);
 
-    nextblock = (uint64_t *)&ctx->long_state[c[0] & 0x1FFFF0];
+    nextblock = (uint64_t *)&long_state[c[0] & 0x1FFFF0];
     b[0] = nextblock[0];
     b[1] = nextblock[1];
 
@@ -120,14 +121,14 @@ cn_slow_hash_noaesni
       a[0] += hi;
       a[1] += lo;
     }
-    dst = (uint64_t *) &ctx->long_state[c[0] & 0x1FFFF0];
+    dst = (uint64_t *) &long_state[c[0] & 0x1FFFF0];
     dst[0] = a[0];
     dst[1] = a[1];
 
     a[0] ^= b[0];
     a[1] ^= b[1];
     b_x = c_x;
-    //__builtin_prefetch(&ctx->long_state[a[0] & 0x1FFFF0], 0, 3);
+    //__builtin_prefetch(&long_state[a[0] & 0x1FFFF0], 0, 3);
   }
 
   memcpy(ctx->text, ctx->state.init, INIT_SIZE_BYTE);
@@ -140,7 +141,7 @@ cn_slow_hash_noaesni
 #endif
 
   //for (i = 0; likely(i < MEMORY); i += INIT_SIZE_BYTE)
-  //    aesni_parallel_xor(&ctx->text, ExpandedKey, &ctx->long_state[i]);
+  //    aesni_parallel_xor(&ctx->text, ExpandedKey, &long_state[i]);
 
   for (i = 0; likely(i < MEMORY); i += INIT_SIZE_BYTE)
   {
@@ -186,3 +187,5 @@ cn_slow_hash_noaesni
   hash_permutation(&ctx->state.hs);
   extra_hashes[ctx->state.hs.b[0] & 3](&ctx->state, 200, hash);
 }
+
+#undef ctx
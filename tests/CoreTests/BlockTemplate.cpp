@@ -0,0 +1,84 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "BlockTemplate.h"
+
+using namespace CryptoNote;
+
+gen_block_template_cache::gen_block_template_cache() : m_emptyTemplateReward(0) {
+  REGISTER_CALLBACK_METHOD(gen_block_template_cache, check_empty_template);
+  REGISTER_CALLBACK_METHOD(gen_block_template_cache, check_template_has_tx);
+  REGISTER_CALLBACK_METHOD(gen_block_template_cache, check_template_after_block);
+}
+
+bool gen_block_template_cache::generate(std::vector<test_event_entry>& events) const {
+  uint64_t ts_start = 1338224400;
+
+  GENERATE_ACCOUNT(miner_account);
+  MAKE_GENESIS_BLOCK(events, blk_0, miner_account, ts_start);
+  REWIND_BLOCKS(events, blk_0r, blk_0, miner_account);
+  DO_CALLBACK(events, "check_empty_template");
+
+  // The template built above gets the new pool transaction appended
+  MAKE_TX(events, tx_0, miner_account, miner_account, MK_COINS(1), blk_0r);
+  DO_CALLBACK(events, "check_template_has_tx");
+
+  MAKE_NEXT_BLOCK_TX1(events, blk_1, blk_0r, miner_account, tx_0);
+  DO_CALLBACK(events, "check_template_after_block");
+
+  return true;
+}
+
+bool gen_block_template_cache::getTemplate(CryptoNote::core& c, CryptoNote::Block& block, uint32_t& height) {
+  AccountBase account;
+  account.generate();
+  difficulty_type difficulty;
+  return c.get_block_template(block, account.getAccountKeys().address, difficulty, height, BinaryArray());
+}
+
+bool gen_block_template_cache::check_empty_template(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events) {
+  DEFINE_TESTS_ERROR_CONTEXT("gen_block_template_cache::check_empty_template");
+
+  Block block;
+  uint32_t height;
+  CHECK_TEST_CONDITION(getTemplate(c, block, height));
+  CHECK_EQ(c.get_current_blockchain_height(), height);
+  CHECK_TEST_CONDITION(block.previousBlockHash == c.get_tail_id());
+  CHECK_TEST_CONDITION(block.transactionHashes.empty());
+
+  m_emptyTemplateReward = get_outs_money_amount(block.baseTransaction);
+  return true;
+}
+
+bool gen_block_template_cache::check_template_has_tx(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events) {
+  DEFINE_TESTS_ERROR_CONTEXT("gen_block_template_cache::check_template_has_tx");
+
+  const Transaction& tx = boost::get<Transaction>(events[ev_index - 1]);
+  Block block;
+  uint32_t height;
+  CHECK_TEST_CONDITION(getTemplate(c, block, height));
+  CHECK_EQ(1, c.get_pool_transactions_count());
+  CHECK_EQ(1, block.transactionHashes.size());
+  CHECK_TEST_CONDITION(block.transactionHashes.front() == getObjectHash(tx));
+
+  // The base transaction collects the fee of the appended transaction
+  CHECK_EQ(m_emptyTemplateReward + m_currency.minimumFee(), get_outs_money_amount(block.baseTransaction));
+
+  return true;
+}
+
+bool gen_block_template_cache::check_template_after_block(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events) {
+  DEFINE_TESTS_ERROR_CONTEXT("gen_block_template_cache::check_template_after_block");
+
+  const Block& tail = boost::get<Block>(events[ev_index - 1]);
+  Block block;
+  uint32_t height;
+  CHECK_TEST_CONDITION(getTemplate(c, block, height));
+  CHECK_EQ(0, c.get_pool_transactions_count());
+  CHECK_EQ(c.get_current_blockchain_height(), height);
+  CHECK_TEST_CONDITION(block.previousBlockHash == get_block_hash(tail));
+  CHECK_TEST_CONDITION(block.transactionHashes.empty());
+
+  return true;
+}
@@ -0,0 +1,24 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once 
+
+#include "Chaingen.h"
+
+// Checks that the cached block template follows the transaction pool and the chain tail
+struct gen_block_template_cache : public test_chain_unit_base
+{
+  gen_block_template_cache();
+
+  bool generate(std::vector<test_event_entry>& events) const;
+
+  bool check_empty_template(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool check_template_has_tx(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool check_template_after_block(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+
+private:
+  bool getTemplate(CryptoNote::core& c, CryptoNote::Block& block, uint32_t& height);
+
+  uint64_t m_emptyTemplateReward;
+};
@@ -176,3 +176,119 @@ bool gen_chain_switch_1::check_split_switched(CryptoNote::core& c, size_t ev_ind
 
   return true;
 }
+
+
+gen_chain_switch_cache::gen_chain_switch_cache()
+{
+  REGISTER_CALLBACK_METHOD(gen_chain_switch_cache, check_not_switched);
+  REGISTER_CALLBACK_METHOD(gen_chain_switch_cache, check_switched);
+  REGISTER_CALLBACK_METHOD(gen_chain_switch_cache, check_switched_back);
+}
+
+//-----------------------------------------------------------------------------------------------------
+bool gen_chain_switch_cache::generate(std::vector<test_event_entry>& events) const
+{
+  uint64_t ts_start = 1338224400;
+  /*
+  (0 )-(1 )-(2 )-(3 )     <- main chain, until (2a) and after (3) are connected
+     \ (1a)-(2a)          <- alt chain, main between (2a) and (3)
+
+  (1): miner -[5]-> account, the transaction returns to the pool while (1a)-(2a) is the main chain
+  */
+
+  GENERATE_ACCOUNT(miner_account);
+
+  MAKE_GENESIS_BLOCK(events, blk_0, miner_account, ts_start);                                     //  0
+  MAKE_ACCOUNT(events, recipient_account);                                                        //  1
+  REWIND_BLOCKS(events, blk_0r, blk_0, miner_account);                                            // <N blocks>
+  MAKE_TX(events, tx_0, miner_account, recipient_account, MK_COINS(5), blk_0r);                   //  2 + N
+  MAKE_NEXT_BLOCK_TX1(events, blk_1, blk_0r, miner_account, tx_0);                                //  3 + N
+  MAKE_NEXT_BLOCK(events, blk_1a, blk_0r, miner_account);                                         //  4 + N
+  DO_CALLBACK(events, "check_not_switched");                                                      //  5 + N
+  MAKE_NEXT_BLOCK(events, blk_2a, blk_1a, miner_account);                                         //  6 + N
+  DO_CALLBACK(events, "check_switched");                                                          //  7 + N
+  MAKE_NEXT_BLOCK(events, blk_2, blk_1, miner_account);                                           //  8 + N
+  MAKE_NEXT_BLOCK(events, blk_3, blk_2, miner_account);                                           //  9 + N
+  DO_CALLBACK(events, "check_switched_back");                                                     // 10 + N
+
+  return true;
+}
+
+//-----------------------------------------------------------------------------------------------------
+bool gen_chain_switch_cache::check_not_switched(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_chain_switch_cache::check_not_switched");
+
+  const Block& block = boost::get<Block>(events[3 + m_currency.minedMoneyUnlockWindow()]);
+  m_txHash = getObjectHash(boost::get<Transaction>(events[2 + m_currency.minedMoneyUnlockWindow()]));
+  m_blockHash = get_block_hash(block);
+  m_minerTxHash = getObjectHash(block.baseTransaction);
+
+  CHECK_TEST_CONDITION(c.get_tail_id() == m_blockHash);
+  CHECK_EQ(1, c.get_alternative_blocks_count());
+  CHECK_EQ(0, c.get_pool_transactions_count());
+
+  Crypto::Hash txBlockHash;
+  uint32_t txBlockHeight;
+  CHECK_TEST_CONDITION(c.getBlockContainingTx(m_txHash, txBlockHash, txBlockHeight));
+  CHECK_TEST_CONDITION(txBlockHash == m_blockHash);
+  CHECK_TEST_CONDITION(c.get_tx_outputs_gindexs(m_txHash, m_txOutputIndexes));
+  CHECK_TEST_CONDITION(c.get_tx_outputs_gindexs(m_minerTxHash, m_minerTxOutputIndexes));
+
+  return true;
+}
+
+//-----------------------------------------------------------------------------------------------------
+bool gen_chain_switch_cache::check_switched(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_chain_switch_cache::check_switched");
+
+  CHECK_TEST_CONDITION(c.get_tail_id() == get_block_hash(boost::get<Block>(events[ev_index - 1])));
+  CHECK_EQ(m_currency.minedMoneyUnlockWindow() + 3, c.get_current_blockchain_height());
+
+  // The disconnected block is kept as an alternative one
+  std::list<Block> altBlocks;
+  CHECK_TEST_CONDITION(c.get_alternative_blocks(altBlocks));
+  CHECK_EQ(1, altBlocks.size());
+  CHECK_TEST_CONDITION(get_block_hash(altBlocks.front()) == m_blockHash);
+
+  // Its transactions and outputs are gone from the indexes, the transaction is back in the pool
+  Crypto::Hash txBlockHash;
+  uint32_t txBlockHeight;
+  std::vector<uint32_t> outputIndexes;
+  CHECK_TEST_CONDITION(!c.getBlockContainingTx(m_txHash, txBlockHash, txBlockHeight));
+  CHECK_TEST_CONDITION(!c.get_tx_outputs_gindexs(m_txHash, outputIndexes));
+  CHECK_TEST_CONDITION(!c.get_tx_outputs_gindexs(m_minerTxHash, outputIndexes));
+
+  std::vector<Transaction> pool = c.getPoolTransactions();
+  CHECK_EQ(1, pool.size());
+  CHECK_TEST_CONDITION(getObjectHash(pool.front()) == m_txHash);
+
+  return true;
+}
+
+//-----------------------------------------------------------------------------------------------------
+bool gen_chain_switch_cache::check_switched_back(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_chain_switch_cache::check_switched_back");
+
+  CHECK_TEST_CONDITION(c.get_tail_id() == get_block_hash(boost::get<Block>(events[ev_index - 1])));
+  CHECK_EQ(m_currency.minedMoneyUnlockWindow() + 4, c.get_current_blockchain_height());
+  CHECK_TEST_CONDITION(c.getBlockIdByHeight(m_currency.minedMoneyUnlockWindow() + 1) == m_blockHash);
+  CHECK_EQ(2, c.get_alternative_blocks_count());
+  CHECK_EQ(0, c.get_pool_transactions_count());
+
+  // The block connected again gets the same places in the indexes
+  Crypto::Hash txBlockHash;
+  uint32_t txBlockHeight;
+  CHECK_TEST_CONDITION(c.getBlockContainingTx(m_txHash, txBlockHash, txBlockHeight));
+  CHECK_TEST_CONDITION(txBlockHash == m_blockHash);
+
+  std::vector<uint32_t> outputIndexes;
+  CHECK_TEST_CONDITION(c.get_tx_outputs_gindexs(m_txHash, outputIndexes));
+  CHECK_TEST_CONDITION(outputIndexes == m_txOutputIndexes);
+  CHECK_TEST_CONDITION(c.get_tx_outputs_gindexs(m_minerTxHash, outputIndexes));
+  CHECK_TEST_CONDITION(outputIndexes == m_minerTxOutputIndexes);
+
+  return true;
+}
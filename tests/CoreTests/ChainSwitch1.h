@@ -28,3 +28,24 @@ private:
 
   std::vector<CryptoNote::Transaction> m_tx_pool;
 };
+
+// Switches to a longer alternative chain and back, checking the transaction and output indexes and the pool
+// after each switch
+class gen_chain_switch_cache : public test_chain_unit_base
+{
+public:
+  gen_chain_switch_cache();
+
+  bool generate(std::vector<test_event_entry>& events) const;
+
+  bool check_not_switched(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool check_switched(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool check_switched_back(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+
+private:
+  Crypto::Hash m_txHash;
+  Crypto::Hash m_blockHash;
+  Crypto::Hash m_minerTxHash;
+  std::vector<uint32_t> m_txOutputIndexes;
+  std::vector<uint32_t> m_minerTxOutputIndexes;
+};
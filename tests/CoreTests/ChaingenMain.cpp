@@ -7,6 +7,7 @@
 #include "Common/CommandLine.h"
 
 #include "BlockReward.h"
+#include "BlockTemplate.h"
 #include "BlockValidation.h"
 #include "ChainSplit1.h"
 #include "ChainSwitch1.h"
@@ -14,6 +15,8 @@
 #include "DoubleSpend.h"
 #include "IntegerOverflow.h"
 #include "RingSignature.h"
+#include "Snapshot.h"
+#include "TransactionAdmission.h"
 #include "TransactionTests.h"
 #include "TransactionValidation.h"
 #include "RandomOuts.h"
@@ -74,6 +77,7 @@ int main(int argc, char* argv[])
     GENERATE_AND_PLAY(gen_simple_chain_split_1);
     GENERATE_AND_PLAY(one_block);
     GENERATE_AND_PLAY(gen_chain_switch_1);
+    GENERATE_AND_PLAY(gen_chain_switch_cache);
     GENERATE_AND_PLAY(gen_ring_signature_1);
     GENERATE_AND_PLAY(gen_ring_signature_2);
     //GENERATE_AND_PLAY(gen_ring_signature_big); // Takes up to XXX hours (if CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW == 10)
@@ -176,6 +180,10 @@ int main(int argc, char* argv[])
 
     GENERATE_AND_PLAY(gen_block_reward);
     GENERATE_AND_PLAY(GetRandomOutputs);
+    GENERATE_AND_PLAY(OutputIndexEntries);
+    GENERATE_AND_PLAY(gen_block_template_cache);
+    GENERATE_AND_PLAY(gen_tx_batch_admission);
+    GENERATE_AND_PLAY(gen_snapshot_round_trip);
 
     std::cout << (failed_tests.empty() ? concolor::green : concolor::magenta);
     std::cout << "\nREPORT:\n";
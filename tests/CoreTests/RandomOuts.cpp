@@ -96,3 +96,108 @@ bool GetRandomOutputs::checkFullyUnlocked(CryptoNote::core& c, size_t ev_index,
 
   return true;
 }
+
+namespace {
+const uint64_t UNLOCKED_AMOUNT = 1234567;
+const uint64_t LOCKED_AMOUNT = 1234568;
+const uint64_t LOCKED_UNTIL_HEIGHT = 1000000;
+
+struct ExpectedOutput {
+  Crypto::Hash transactionHash;
+  size_t outputIndex;
+  Crypto::PublicKey key;
+};
+}
+
+OutputIndexEntries::OutputIndexEntries() {
+  REGISTER_CALLBACK_METHOD(OutputIndexEntries, checkOutputEntries);
+}
+
+bool OutputIndexEntries::generate(std::vector<test_event_entry>& events) const {
+  TestGenerator generator(m_currency, events);
+  generator.generateBlocks();
+
+  CryptoNote::AccountBase recipient;
+  recipient.generate();
+
+  const uint64_t amounts[] = { UNLOCKED_AMOUNT, LOCKED_AMOUNT };
+  const uint64_t unlockTimes[] = { 0, LOCKED_UNTIL_HEIGHT };
+  for (size_t i = 0; i < 2; ++i) {
+    std::vector<CryptoNote::TransactionSourceEntry> sources;
+    std::vector<CryptoNote::TransactionDestinationEntry> destinations;
+    generator.fillTxSourcesAndDestinations(sources, destinations, generator.minerAccount, recipient, amounts[i], m_currency.minimumFee());
+
+    TransactionBuilder builder(m_currency, unlockTimes[i]);
+    builder.setInput(sources, generator.minerAccount.getAccountKeys());
+    builder.setOutput(destinations);
+
+    auto tx = builder.build();
+    generator.addEvent(tx);
+    generator.makeNextBlock(tx);
+  }
+
+  generator.generateBlocks();
+  generator.addCallback("checkOutputEntries");
+
+  return true;
+}
+
+bool OutputIndexEntries::checkOutputEntries(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events) {
+  // The global indexes of an amount follow the order of the outputs in the chain
+  std::list<CryptoNote::Block> blocks;
+  CHECK(c.get_blocks(0, c.get_current_blockchain_height(), blocks));
+  std::map<uint64_t, std::vector<ExpectedOutput>> expectedOutputs;
+  for (const auto& block : blocks) {
+    std::list<CryptoNote::Transaction> transactions;
+    std::list<Crypto::Hash> missedTransactions;
+    c.getTransactions(block.transactionHashes, transactions, missedTransactions);
+    CHECK(missedTransactions.empty());
+    transactions.push_front(block.baseTransaction);
+
+    for (const auto& transaction : transactions) {
+      for (size_t i = 0; i < transaction.outputs.size(); ++i) {
+        const auto& output = transaction.outputs[i];
+        ExpectedOutput expected = { CryptoNote::getObjectHash(transaction), i, boost::get<CryptoNote::KeyOutput>(output.target).key };
+        expectedOutputs[output.amount].push_back(expected);
+      }
+    }
+  }
+
+  for (const auto& amountOutputs : expectedOutputs) {
+    CryptoNote::KeyInput input;
+    input.amount = amountOutputs.first;
+    input.outputIndexes.assign(amountOutputs.second.size(), 1);
+    input.outputIndexes.front() = 0;
+
+    std::list<std::pair<Crypto::Hash, size_t>> references;
+    CHECK(c.scanOutputkeysForIndices(input, references));
+    CHECK(references.size() == amountOutputs.second.size());
+    auto reference = references.begin();
+    for (const auto& expected : amountOutputs.second) {
+      CHECK(reference->first == expected.transactionHash);
+      CHECK(reference->second == expected.outputIndex);
+      ++reference;
+    }
+  }
+
+  // The keys handed out as ring members are those of the outputs, the output still locked by its transaction isn't
+  CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_request req;
+  req.amounts.push_back(UNLOCKED_AMOUNT);
+  req.amounts.push_back(LOCKED_AMOUNT);
+  req.outs_count = 10;
+  CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_response resp = boost::value_initialized<CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_response>();
+  CHECK(c.get_random_outs_for_amounts(req, resp));
+  CHECK(resp.outs.size() == 2);
+
+  CHECK(resp.outs[0].amount == UNLOCKED_AMOUNT);
+  CHECK(expectedOutputs[UNLOCKED_AMOUNT].size() == 1);
+  CHECK(resp.outs[0].outs.size() == 1);
+  CHECK(resp.outs[0].outs[0].global_amount_index == 0);
+  CHECK(resp.outs[0].outs[0].out_key == expectedOutputs[UNLOCKED_AMOUNT][0].key);
+
+  CHECK(resp.outs[1].amount == LOCKED_AMOUNT);
+  CHECK(expectedOutputs[LOCKED_AMOUNT].size() == 1);
+  CHECK(resp.outs[1].outs.empty());
+
+  return true;
+}
@@ -25,3 +25,14 @@ private:
   bool request(CryptoNote::core& c, uint64_t amount, size_t mixin, CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_response& resp);
 
 };
+
+// Checks the keys and unlock times kept in the output index against the transactions of the chain
+struct OutputIndexEntries : public test_chain_unit_base
+{
+  OutputIndexEntries();
+
+  bool generate(std::vector<test_event_entry>& events) const;
+
+private:
+  bool checkOutputEntries(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+};
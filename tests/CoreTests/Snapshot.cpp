@@ -0,0 +1,144 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "Snapshot.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/scope_exit.hpp>
+
+#include "Common/StringTools.h"
+#include "CryptoNoteCore/MinerConfig.h"
+
+using namespace CryptoNote;
+
+gen_snapshot_round_trip::gen_snapshot_round_trip() {
+  REGISTER_CALLBACK_METHOD(gen_snapshot_round_trip, check_snapshot_round_trip);
+}
+
+bool gen_snapshot_round_trip::generate(std::vector<test_event_entry>& events) const {
+  GENERATE_ACCOUNT(miner_account);
+
+  // A core initialized from a snapshot checks its genesis block against the currency
+  test_generator generator(m_currency);
+  const Block& blk_0 = m_currency.genesisBlock();
+  std::vector<size_t> blockSizes;
+  generator.addBlock(blk_0, 0, 0, blockSizes, 0);
+  events.push_back(blk_0);
+
+  MAKE_ACCOUNT(events, alice);
+  REWIND_BLOCKS(events, blk_0r, blk_0, miner_account);
+  MAKE_TX(events, tx_0, miner_account, alice, MK_COINS(5), blk_0r);
+  MAKE_NEXT_BLOCK_TX1(events, blk_1, blk_0r, miner_account, tx_0);
+  REWIND_BLOCKS(events, blk_1r, blk_1, miner_account);
+  DO_CALLBACK(events, "check_snapshot_round_trip");
+
+  return true;
+}
+
+CryptoNote::Checkpoints gen_snapshot_round_trip::makeCheckpoints(uint32_t height, const Crypto::Hash& hash) {
+  Checkpoints checkpoints(m_logger);
+  checkpoints.add_checkpoint(height, Common::podToHex(hash));
+  return checkpoints;
+}
+
+bool gen_snapshot_round_trip::importSnapshot(CryptoNote::core& imported, const std::string& folder, const std::string& file, uint32_t height,
+  const Crypto::Hash& hash) {
+  CoreConfig config;
+  config.configFolder = folder;
+  config.snapshotFile = file;
+  imported.set_checkpoints(makeCheckpoints(height, hash));
+  return imported.init(config, MinerConfig(), true);
+}
+
+bool gen_snapshot_round_trip::check_snapshot_round_trip(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events) {
+  DEFINE_TESTS_ERROR_CONTEXT("gen_snapshot_round_trip::check_snapshot_round_trip");
+
+  const Transaction& tx = boost::get<Transaction>(events[2 + m_currency.minedMoneyUnlockWindow()]);
+  Crypto::Hash txHash = getObjectHash(tx);
+  Crypto::Hash txBlockHash;
+  uint32_t txBlockHeight;
+  CHECK_TEST_CONDITION(c.getBlockContainingTx(txHash, txBlockHash, txBlockHeight));
+
+  // The snapshot is cut below the tail, the blocks above the checkpoint are synced afterwards
+  uint32_t height = c.get_current_blockchain_height() - 3;
+  CHECK_TEST_CONDITION(txBlockHeight < height);
+  Crypto::Hash checkpointHash = c.getBlockIdByHeight(height);
+
+  boost::filesystem::path folder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("snapshot-%%%%-%%%%-%%%%");
+  boost::filesystem::path wrongFolder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("snapshot-%%%%-%%%%-%%%%");
+  std::string file = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("snapshot-%%%%-%%%%-%%%%.bin")).string();
+  BOOST_SCOPE_EXIT_ALL(&) {
+    boost::system::error_code ignoredErrorCode;
+    boost::filesystem::remove_all(folder, ignoredErrorCode);
+    boost::filesystem::remove_all(wrongFolder, ignoredErrorCode);
+    boost::filesystem::remove(file, ignoredErrorCode);
+  };
+
+  c.set_checkpoints(makeCheckpoints(height, checkpointHash));
+  CHECK_TEST_CONDITION(c.export_snapshot(file));
+
+  // A snapshot which doesn't end at a known checkpoint is rejected
+  {
+    CryptoNote::cryptonote_protocol_stub protocol;
+    core wrongCheckpoint(m_currency, &protocol, m_logger);
+    CHECK_TEST_CONDITION(!importSnapshot(wrongCheckpoint, wrongFolder.string(), file, height, c.getBlockIdByHeight(height - 1)));
+  }
+
+  CryptoNote::cryptonote_protocol_stub protocol;
+  core imported(m_currency, &protocol, m_logger);
+  CHECK_TEST_CONDITION(importSnapshot(imported, folder.string(), file, height, checkpointHash));
+  BOOST_SCOPE_EXIT_ALL(&) {
+    imported.deinit();
+  };
+
+  CHECK_EQ(height + 1, imported.get_current_blockchain_height());
+  CHECK_TEST_CONDITION(imported.get_tail_id() == checkpointHash);
+  for (uint32_t i = 0; i <= height; ++i) {
+    CHECK_TEST_CONDITION(imported.getBlockIdByHeight(i) == c.getBlockIdByHeight(i));
+  }
+
+  CHECK_TEST_CONDITION(!imported.have_block(c.getBlockIdByHeight(height + 1)));
+
+  // The state derived from the blocks is the one the exporting core had at that height
+  Crypto::Hash importedTxBlockHash;
+  uint32_t importedTxBlockHeight;
+  CHECK_TEST_CONDITION(imported.getBlockContainingTx(txHash, importedTxBlockHash, importedTxBlockHeight));
+  CHECK_TEST_CONDITION(importedTxBlockHash == txBlockHash);
+  CHECK_EQ(txBlockHeight, importedTxBlockHeight);
+
+  std::vector<uint32_t> outputIndexes;
+  std::vector<uint32_t> importedOutputIndexes;
+  CHECK_TEST_CONDITION(c.get_tx_outputs_gindexs(txHash, outputIndexes));
+  CHECK_TEST_CONDITION(imported.get_tx_outputs_gindexs(txHash, importedOutputIndexes));
+  CHECK_TEST_CONDITION(outputIndexes == importedOutputIndexes);
+
+  for (const auto& input : tx.inputs) {
+    std::list<std::pair<Crypto::Hash, size_t>> outputReferences;
+    std::list<std::pair<Crypto::Hash, size_t>> importedOutputReferences;
+    CHECK_TEST_CONDITION(c.scanOutputkeysForIndices(boost::get<KeyInput>(input), outputReferences));
+    CHECK_TEST_CONDITION(imported.scanOutputkeysForIndices(boost::get<KeyInput>(input), importedOutputReferences));
+    CHECK_TEST_CONDITION(outputReferences == importedOutputReferences);
+  }
+
+  uint64_t generatedCoins;
+  uint64_t importedGeneratedCoins;
+  CHECK_TEST_CONDITION(c.getAlreadyGeneratedCoins(checkpointHash, generatedCoins));
+  CHECK_TEST_CONDITION(imported.getAlreadyGeneratedCoins(checkpointHash, importedGeneratedCoins));
+  CHECK_EQ(generatedCoins, importedGeneratedCoins);
+
+  // Only the rest of the chain is synced, and verified against the imported state
+  std::list<Block> blocks;
+  CHECK_TEST_CONDITION(c.get_blocks(height + 1, c.get_current_blockchain_height() - height - 1, blocks));
+  for (const Block& block : blocks) {
+    block_verification_context bvc = boost::value_initialized<block_verification_context>();
+    CHECK_TEST_CONDITION(imported.handle_incoming_block_blob(toBinaryArray(block), bvc, false, false));
+    CHECK_TEST_CONDITION(bvc.m_added_to_main_chain);
+  }
+
+  CHECK_EQ(c.get_current_blockchain_height(), imported.get_current_blockchain_height());
+  CHECK_TEST_CONDITION(imported.get_tail_id() == c.get_tail_id());
+  CHECK_EQ(c.getTotalGeneratedAmount(), imported.getTotalGeneratedAmount());
+
+  return true;
+}
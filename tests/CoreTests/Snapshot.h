@@ -0,0 +1,22 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include "Chaingen.h"
+
+// Exports a snapshot cut at a checkpoint, imports it into another core and checks that the state rebuilt from it
+// matches the chain at that height, then syncs the remaining blocks
+struct gen_snapshot_round_trip : public test_chain_unit_base
+{
+  gen_snapshot_round_trip();
+
+  bool generate(std::vector<test_event_entry>& events) const;
+
+  bool check_snapshot_round_trip(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+
+private:
+  CryptoNote::Checkpoints makeCheckpoints(uint32_t height, const Crypto::Hash& hash);
+  bool importSnapshot(CryptoNote::core& imported, const std::string& folder, const std::string& file, uint32_t height, const Crypto::Hash& hash);
+};
@@ -0,0 +1,65 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "TransactionAdmission.h"
+
+using namespace CryptoNote;
+
+gen_tx_batch_admission::gen_tx_batch_admission() {
+  REGISTER_CALLBACK_METHOD(gen_tx_batch_admission, check_batch_admission);
+  REGISTER_CALLBACK_METHOD(gen_tx_batch_admission, check_pool_is_empty);
+}
+
+bool gen_tx_batch_admission::generate(std::vector<test_event_entry>& events) const {
+  uint64_t ts_start = 1338224400;
+
+  GENERATE_ACCOUNT(miner_account);
+  GENERATE_ACCOUNT(alice_account);
+  MAKE_GENESIS_BLOCK(events, blk_0, miner_account, ts_start);
+  REWIND_BLOCKS(events, blk_0r, blk_0, miner_account);
+
+  // The callback hands the two transactions that follow it to the core at once, they are already in the pool when
+  // they are played
+  DO_CALLBACK(events, "check_batch_admission");
+  MAKE_TX_LIST_START(events, txs, miner_account, alice_account, MK_COINS(1), blk_0r);
+  MAKE_TX_LIST(events, txs, miner_account, alice_account, MK_COINS(2), blk_0r);
+
+  // Ring signatures of the block transactions were checked on admission
+  MAKE_NEXT_BLOCK_TX_LIST(events, blk_1, blk_0r, miner_account, txs);
+  DO_CALLBACK(events, "check_pool_is_empty");
+
+  return true;
+}
+
+bool gen_tx_batch_admission::check_batch_admission(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events) {
+  DEFINE_TESTS_ERROR_CONTEXT("gen_tx_batch_admission::check_batch_admission");
+
+  const Transaction& tx1 = boost::get<Transaction>(events[ev_index + 1]);
+  const Transaction& tx2 = boost::get<Transaction>(events[ev_index + 2]);
+  Transaction badTx = tx2;
+  reinterpret_cast<uint8_t*>(&badTx.signatures[0][0])[0] ^= 1;
+
+  std::vector<BinaryArray> transactionBlobs = { toBinaryArray(tx1), toBinaryArray(badTx), toBinaryArray(tx1), toBinaryArray(tx2), BinaryArray(3, 0) };
+  std::vector<tx_verification_context> results;
+  c.handleIncomingTransactions(transactionBlobs, results);
+
+  CHECK_EQ(transactionBlobs.size(), results.size());
+  CHECK_TEST_CONDITION(results[0].m_added_to_pool && results[0].m_should_be_relayed && !results[0].m_verifivation_failed);
+  CHECK_TEST_CONDITION(!results[1].m_added_to_pool && results[1].m_verifivation_failed);
+  // a transaction that got in the pool in the same batch is ignored
+  CHECK_TEST_CONDITION(!results[2].m_added_to_pool && !results[2].m_verifivation_failed);
+  CHECK_TEST_CONDITION(results[3].m_added_to_pool && results[3].m_should_be_relayed && !results[3].m_verifivation_failed);
+  CHECK_TEST_CONDITION(!results[4].m_added_to_pool && results[4].m_verifivation_failed);
+
+  CHECK_EQ(2, c.get_pool_transactions_count());
+  return true;
+}
+
+bool gen_tx_batch_admission::check_pool_is_empty(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events) {
+  DEFINE_TESTS_ERROR_CONTEXT("gen_tx_batch_admission::check_pool_is_empty");
+
+  CHECK_EQ(0, c.get_pool_transactions_count());
+  CHECK_TEST_CONDITION(c.get_tail_id() == get_block_hash(boost::get<Block>(events[ev_index - 1])));
+  return true;
+}
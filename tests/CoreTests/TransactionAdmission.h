@@ -0,0 +1,18 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once 
+
+#include "Chaingen.h"
+
+// Checks that relayed transactions handled together get the same verdicts as one by one
+struct gen_tx_batch_admission : public test_chain_unit_base
+{
+  gen_tx_batch_admission();
+
+  bool generate(std::vector<test_event_entry>& events) const;
+
+  bool check_batch_admission(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool check_pool_is_empty(CryptoNote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+};
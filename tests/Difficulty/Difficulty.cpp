@@ -12,6 +12,7 @@
 #include "CryptoNoteConfig.h"
 #include "CryptoNoteCore/Difficulty.h"
 #include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/DifficultyWindow.h"
 #include "Logging/ConsoleLogger.h"
 
 using namespace std;
@@ -33,6 +34,8 @@ int main(int argc, char *argv[]) {
     data.exceptions(fstream::badbit);
     data.clear(data.rdstate());
     uint64_t timestamp, difficulty, cumulative_difficulty = 0;
+    vector<uint64_t> difficulties;
+    CryptoNote::DifficultyWindow window(currency);
     size_t n = 0;
     while (data >> timestamp >> difficulty) {
         size_t begin, end;
@@ -52,8 +55,33 @@ int main(int argc, char *argv[]) {
                 << "Found: " << res << endl;
             return 1;
         }
+        if (window.nextDifficulty() != difficulty) {
+            cerr << "Wrong difficulty window for block " << n << endl
+                << "Expected: " << difficulty << endl
+                << "Found: " << window.nextDifficulty() << endl;
+            return 1;
+        }
+        // Rolls the window back over a few blocks, as a chain switch does, and forward again
+        if (n % 97 == 96) {
+            for (size_t i = 0; i < 30; ++i) {
+                window.pop_back();
+                size_t front = n - 1 - i - window.size();
+                if (window.size() < currency.difficultyBlocksCount() && front > 0) {
+                    window.push_front(timestamps[front - 1], cumulative_difficulties[front - 1]);
+                }
+                if (window.nextDifficulty() != difficulties[n - 1 - i]) {
+                    cerr << "Wrong difficulty window for block " << n - 1 - i << " after rollback" << endl;
+                    return 1;
+                }
+            }
+            for (size_t i = n - 30; i < n; ++i) {
+                window.push_back(timestamps[i], cumulative_difficulties[i]);
+            }
+        }
         timestamps.push_back(timestamp);
         cumulative_difficulties.push_back(cumulative_difficulty += difficulty);
+        difficulties.push_back(difficulty);
+        window.push_back(timestamp, cumulative_difficulty);
         ++n;
     }
     if (!data.eof()) {
@@ -2,6 +2,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <algorithm>
 #include <cstddef>
 #include <fstream>
 #include <iomanip>
@@ -15,6 +16,7 @@ using namespace std;
 typedef Crypto::Hash chash;
 
 Crypto::cn_context *context;
+Crypto::cn_context *otherContext;
 
 extern "C" {
 #ifdef _MSC_VER
@@ -31,13 +33,25 @@ extern "C" {
   static void slow_hash(const void *data, size_t length, char *hash) {
     cn_slow_hash(*context, data, length, *reinterpret_cast<chash *>(hash));
   }
+
+  // The other lane hashes the input reversed and has to match the single hash of it
+  static void slow_hash_2way(const void *data, size_t length, char *hash) {
+    vector<char> reversed(static_cast<const char *>(data), static_cast<const char *>(data) + length);
+    reverse(reversed.begin(), reversed.end());
+    chash reversedHash, expectedReversedHash;
+    cn_slow_hash(*otherContext, *context, reversed.data(), length, data, length, reversedHash, *reinterpret_cast<chash *>(hash));
+    cn_slow_hash(*context, reversed.data(), length, expectedReversedHash);
+    if (reversedHash != expectedReversedHash) {
+      throw ios_base::failure("Hash mismatch in the other lane of slow-2way");
+    }
+  }
 }
 
 extern "C" typedef void hash_f(const void *, size_t, char *);
 struct hash_func {
   const string name;
   hash_f &f;
-} hashes[] = {{"fast", Crypto::cn_fast_hash}, {"slow", slow_hash}, {"tree", hash_tree},
+} hashes[] = {{"fast", Crypto::cn_fast_hash}, {"slow", slow_hash}, {"slow-2way", slow_hash_2way}, {"tree", hash_tree},
   {"extra-blake", Crypto::hash_extra_blake}, {"extra-groestl", Crypto::hash_extra_groestl},
   {"extra-jh", Crypto::hash_extra_jh}, {"extra-skein", Crypto::hash_extra_skein}};
 
@@ -63,9 +77,12 @@ int main(int argc, char *argv[]) {
       break;
     }
   }
-  if (f == slow_hash) {
+  if (f == slow_hash || f == slow_hash_2way) {
     context = new Crypto::cn_context();
   }
+  if (f == slow_hash_2way) {
+    otherContext = new Crypto::cn_context();
+  }
   input.open(argv[2], ios_base::in);
   for (;;) {
     ++test;
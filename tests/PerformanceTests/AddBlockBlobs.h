@@ -0,0 +1,66 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <list>
+#include <vector>
+
+#include "BlockchainTestBase.h"
+
+#include "CryptoNoteCore/CryptoNoteTools.h"
+
+// Adds the blocks of the generated chain, as received from peers, to an empty blockchain
+class test_add_block_blobs : public blockchain_test_base {
+public:
+  static const size_t loop_count = 5;
+
+  bool init() {
+    if (!blockchain_test_base::init()) {
+      return false;
+    }
+
+    Storage storage(m_currency, m_timeProvider, m_logger);
+    storage.blockchain.setCheckpoints(checkpoints());
+    if (!storage.blockchain.init(m_dir.string(), true) || !storage.blockchain.getBlocks(1, block_count - 1, m_blocks)) {
+      return false;
+    }
+
+    for (const auto& block : m_blocks) {
+      m_blockBlobs.push_back(CryptoNote::toBinaryArray(block));
+    }
+
+    return storage.blockchain.deinit();
+  }
+
+  bool test() {
+    boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("blockchain_test_%%%%%%%%%%%%");
+    bool result = addBlocks(dir);
+    boost::system::error_code ignoredErrorCode;
+    boost::filesystem::remove_all(dir, ignoredErrorCode);
+    return result;
+  }
+
+private:
+  std::list<CryptoNote::Block> m_blocks;
+  std::vector<CryptoNote::BinaryArray> m_blockBlobs;
+
+  bool addBlocks(const boost::filesystem::path& dir) {
+    Storage storage(m_currency, m_timeProvider, m_logger);
+    storage.blockchain.setCheckpoints(checkpoints());
+    if (!storage.blockchain.init(dir.string(), false)) {
+      return false;
+    }
+
+    auto blockBlob = m_blockBlobs.begin();
+    for (const auto& block : m_blocks) {
+      CryptoNote::block_verification_context bvc = boost::value_initialized<CryptoNote::block_verification_context>();
+      if (!storage.blockchain.addNewBlock(block, *blockBlob++, bvc) || !bvc.m_added_to_main_chain) {
+        return false;
+      }
+    }
+
+    return storage.blockchain.deinit();
+  }
+};
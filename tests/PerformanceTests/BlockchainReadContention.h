@@ -0,0 +1,76 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <list>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "BlockchainTestBase.h"
+
+// Measures block queries issued from several threads, while another thread keeps taking the exclusive lock
+// the way block import does
+template<size_t reader_count>
+class test_blockchain_read_contention : public blockchain_test_base {
+public:
+  static const size_t loop_count = 10;
+  static const size_t queries_per_reader = 500;
+
+  bool init() {
+    if (!blockchain_test_base::init()) {
+      return false;
+    }
+
+    m_storage.reset(new Storage(m_currency, m_timeProvider, m_logger));
+    m_storage->blockchain.setCheckpoints(checkpoints());
+    return m_storage->blockchain.init(m_dir.string(), true);
+  }
+
+  bool test() {
+    CryptoNote::Blockchain& blockchain = m_storage->blockchain;
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> failures(0);
+
+    std::future<void> writer = std::async(std::launch::async, [&blockchain, &stop] {
+      while (!stop) {
+        {
+          CryptoNote::LockedBlockchainStorage lbs(blockchain);
+          lbs->getDifficultyForNextBlock();
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+
+    std::vector<std::future<void>> readers;
+    for (size_t reader = 0; reader < reader_count; ++reader) {
+      readers.push_back(std::async(std::launch::async, [&blockchain, &failures, reader] {
+        for (size_t query = 0; query < queries_per_reader; ++query) {
+          uint32_t height = static_cast<uint32_t>((reader * queries_per_reader + query) * 37 % (block_count - 10));
+          std::list<CryptoNote::Block> blocks;
+          CryptoNote::Block block;
+          if (!blockchain.getBlocks(height, 10, blocks) || !blockchain.getBlockByHash(blockchain.getBlockIdByHeight(height), block)) {
+            ++failures;
+          }
+        }
+      }));
+    }
+
+    for (auto& reader : readers) {
+      reader.get();
+    }
+
+    stop = true;
+    writer.get();
+    return failures == 0;
+  }
+
+private:
+  std::unique_ptr<Storage> m_storage;
+};
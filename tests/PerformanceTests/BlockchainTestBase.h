@@ -0,0 +1,88 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <boost/filesystem.hpp>
+
+#include "CryptoNoteCore/Account.h"
+#include "CryptoNoteCore/Blockchain.h"
+#include "CryptoNoteCore/Checkpoints.h"
+#include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/ITimeProvider.h"
+#include "CryptoNoteCore/TransactionPool.h"
+
+#include "Logging/LoggerGroup.h"
+
+// Stores a chain of coinbase-only blocks in a temporary data directory, rewards are split into outputs as the core does
+class blockchain_test_base {
+public:
+  static const uint32_t block_count = 10000;
+
+  blockchain_test_base() : m_currency(CryptoNote::CurrencyBuilder(m_logger).currency()) {
+  }
+
+  ~blockchain_test_base() {
+    boost::system::error_code ignoredErrorCode;
+    boost::filesystem::remove_all(m_dir, ignoredErrorCode);
+  }
+
+  bool init() {
+    using namespace CryptoNote;
+
+    m_dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("blockchain_test_%%%%%%%%%%%%");
+    m_miner.generate();
+
+    Storage storage(m_currency, m_timeProvider, m_logger);
+    storage.blockchain.setCheckpoints(checkpoints());
+    if (!storage.blockchain.init(m_dir.string(), false)) {
+      return false;
+    }
+
+    for (uint32_t height = 1; height < block_count; ++height) {
+      Block block = boost::value_initialized<Block>();
+      block.majorVersion = BLOCK_MAJOR_VERSION_1;
+      block.minorVersion = BLOCK_MINOR_VERSION_0;
+      block.previousBlockHash = storage.blockchain.getTailId();
+      block.timestamp = m_currency.genesisBlock().timestamp + height * m_currency.difficultyTarget();
+
+      size_t medianSize = storage.blockchain.getCurrentCumulativeBlocksizeLimit() / 2;
+      if (!m_currency.constructMinerTx(height, medianSize, storage.blockchain.getCoinsInCirculation(), 0, 0,
+        m_miner.getAccountKeys().address, block.baseTransaction, CryptoNote::BinaryArray(), 11)) {
+        return false;
+      }
+
+      block_verification_context bvc = boost::value_initialized<block_verification_context>();
+      if (!storage.blockchain.addNewBlock(block, bvc) || !bvc.m_added_to_main_chain) {
+        return false;
+      }
+    }
+
+    return storage.blockchain.deinit();
+  }
+
+protected:
+  struct Storage {
+    Storage(const CryptoNote::Currency& currency, CryptoNote::ITimeProvider& timeProvider, Logging::ILogger& logger) :
+      pool(currency, blockchain, timeProvider, logger),
+      blockchain(currency, pool, logger) {
+    }
+
+    CryptoNote::tx_memory_pool pool;
+    CryptoNote::Blockchain blockchain;
+  };
+
+  // A checkpoint above the generated chain keeps all of it in the checkpoint zone, so no proof of work is needed
+  CryptoNote::Checkpoints checkpoints() {
+    CryptoNote::Checkpoints checkpoints(m_logger);
+    checkpoints.add_checkpoint(block_count, "0000000000000000000000000000000000000000000000000000000000000001");
+    return checkpoints;
+  }
+
+  Logging::LoggerGroup m_logger;
+  CryptoNote::Currency m_currency;
+  CryptoNote::RealTimeProvider m_timeProvider;
+  CryptoNote::AccountBase m_miner;
+  boost::filesystem::path m_dir;
+};
@@ -39,8 +39,22 @@ public:
     return hash == m_expected_hash;
   }
 
-private:
+protected:
   data_t m_data;
   Crypto::Hash m_expected_hash;
   Crypto::cn_context m_context;
 };
+
+// Two hashes per call, compare with two calls of test_cn_slow_hash
+class test_cn_slow_hash_2way : public test_cn_slow_hash {
+public:
+  bool test() {
+    Crypto::Hash hash0;
+    Crypto::Hash hash1;
+    Crypto::cn_slow_hash(m_context, m_otherContext, &m_data, sizeof(m_data), &m_data, sizeof(m_data), hash0, hash1);
+    return hash0 == m_expected_hash && hash1 == m_expected_hash;
+  }
+
+private:
+  Crypto::cn_context m_otherContext;
+};
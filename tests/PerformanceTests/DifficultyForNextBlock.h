@@ -0,0 +1,32 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <memory>
+
+#include "BlockchainTestBase.h"
+
+// Measures Blockchain::getDifficultyForNextBlock, needed for every block added and every block template
+class test_difficulty_for_next_block : public blockchain_test_base {
+public:
+  static const size_t loop_count = 1000;
+
+  bool init() {
+    if (!blockchain_test_base::init()) {
+      return false;
+    }
+
+    m_storage.reset(new Storage(m_currency, m_timeProvider, m_logger));
+    m_storage->blockchain.setCheckpoints(checkpoints());
+    return m_storage->blockchain.init(m_dir.string(), true);
+  }
+
+  bool test() {
+    return m_storage->blockchain.getDifficultyForNextBlock() != 0;
+  }
+
+private:
+  std::unique_ptr<Storage> m_storage;
+};
@@ -0,0 +1,75 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <memory>
+
+#include "BlockchainTestBase.h"
+
+#include "Rpc/CoreRpcServerCommandsDefinitions.h"
+
+// Measures Blockchain::getRandomOutsByAmount, as requested by wallets to pick ring members
+template<size_t outs_count>
+class test_get_random_outs : public blockchain_test_base {
+public:
+  static const size_t loop_count = 100;
+
+  bool init() {
+    if (!blockchain_test_base::init()) {
+      return false;
+    }
+
+    m_storage.reset(new Storage(m_currency, m_timeProvider, m_logger));
+    m_storage->blockchain.setCheckpoints(checkpoints());
+    if (!m_storage->blockchain.init(m_dir.string(), true)) {
+      return false;
+    }
+
+    std::list<CryptoNote::Block> blocks;
+    if (!m_storage->blockchain.getBlocks(block_count / 2, 1, blocks) || blocks.empty()) {
+      return false;
+    }
+
+    CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request request;
+    for (const auto& output : blocks.front().baseTransaction.outputs) {
+      request.amounts.push_back(output.amount);
+    }
+
+    // Only the leading digits of the reward repeat often enough to fill a ring
+    request.outs_count = outs_count;
+    CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response response;
+    if (!m_storage->blockchain.getRandomOutsByAmount(request, response)) {
+      return false;
+    }
+
+    for (const auto& amountOuts : response.outs) {
+      if (amountOuts.outs.size() == outs_count) {
+        m_request.amounts.push_back(amountOuts.amount);
+      }
+    }
+
+    m_request.outs_count = outs_count;
+    return !m_request.amounts.empty();
+  }
+
+  bool test() {
+    CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response response;
+    if (!m_storage->blockchain.getRandomOutsByAmount(m_request, response) || response.outs.size() != m_request.amounts.size()) {
+      return false;
+    }
+
+    for (const auto& amountOuts : response.outs) {
+      if (amountOuts.outs.size() != outs_count) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+private:
+  std::unique_ptr<Storage> m_storage;
+  CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request m_request;
+};
@@ -0,0 +1,54 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include "BlockchainTestBase.h"
+
+#include "Common/StringTools.h"
+
+// Measures Blockchain::importSnapshot, as done on start with --load-snapshot
+template<size_t thread_count>
+class test_import_snapshot : public blockchain_test_base {
+public:
+  static const size_t loop_count = 3;
+  static const uint32_t snapshot_height = block_count / 2;
+
+  bool init() {
+    if (!blockchain_test_base::init()) {
+      return false;
+    }
+
+    Storage storage(m_currency, m_timeProvider, m_logger);
+    storage.blockchain.setCheckpoints(checkpoints());
+    if (!storage.blockchain.init(m_dir.string(), true)) {
+      return false;
+    }
+
+    m_snapshotTail = storage.blockchain.getBlockIdByHeight(snapshot_height);
+    m_snapshotFile = (m_dir / "snapshot.dat").string();
+    storage.blockchain.setCheckpoints(snapshotCheckpoints());
+    return storage.blockchain.exportSnapshot(m_snapshotFile) && storage.blockchain.deinit();
+  }
+
+  bool test() {
+    boost::filesystem::path dir = m_dir / "replica";
+    boost::filesystem::remove_all(dir);
+
+    Storage storage(m_currency, m_timeProvider, m_logger);
+    storage.blockchain.setCheckpoints(snapshotCheckpoints());
+    storage.blockchain.setWorkerThreadCount(thread_count);
+    return storage.blockchain.init(dir.string(), true, m_snapshotFile) && storage.blockchain.getTailId() == m_snapshotTail;
+  }
+
+private:
+  CryptoNote::Checkpoints snapshotCheckpoints() {
+    CryptoNote::Checkpoints checkpoints = blockchain_test_base::checkpoints();
+    checkpoints.add_checkpoint(snapshot_height, Common::podToHex(m_snapshotTail));
+    return checkpoints;
+  }
+
+  Crypto::Hash m_snapshotTail;
+  std::string m_snapshotFile;
+};
@@ -0,0 +1,66 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstring>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include "google/sparse_hash_set"
+
+#include "crypto/crypto.h"
+#include "CryptoNoteCore/KeyImageSet.h"
+
+typedef google::sparse_hash_set<Crypto::KeyImage> sparse_key_image_set;
+typedef std::unordered_set<Crypto::KeyImage> unordered_key_image_set;
+
+// Double spend checks of a relayed transaction against a large set of spent key images, most images are unspent
+template<typename Set>
+class test_key_image_lookup {
+public:
+  static const size_t loop_count = 20;
+  static const size_t spent_count = 2000000;
+  static const size_t lookup_count = 100000;
+  static const size_t spent_lookup_count = 10000;
+
+  bool init() {
+    std::mt19937_64 generator(0);
+    for (size_t i = 0; i < spent_count; ++i) {
+      m_spent.insert(randomKeyImage(generator));
+    }
+
+    for (size_t i = 0; i < lookup_count; ++i) {
+      m_lookups.push_back(randomKeyImage(generator));
+    }
+
+    auto spent = m_spent.begin();
+    for (size_t i = 0; i < spent_lookup_count; ++i, ++spent) {
+      m_lookups[i * (lookup_count / spent_lookup_count)] = *spent;
+    }
+
+    return true;
+  }
+
+  bool test() {
+    size_t found = 0;
+    for (const auto& keyImage : m_lookups) {
+      found += m_spent.count(keyImage);
+    }
+
+    return found == spent_lookup_count;
+  }
+
+private:
+  Set m_spent;
+  std::vector<Crypto::KeyImage> m_lookups;
+
+  static Crypto::KeyImage randomKeyImage(std::mt19937_64& generator) {
+    uint64_t words[4] = { generator(), generator(), generator(), generator() };
+    Crypto::KeyImage keyImage;
+    memcpy(&keyImage, words, sizeof keyImage);
+    return keyImage;
+  }
+};
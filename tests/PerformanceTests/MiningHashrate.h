@@ -0,0 +1,63 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include "crypto/crypto.h"
+#include "CryptoNoteCore/Account.h"
+#include "CryptoNoteCore/BlockMiningJob.h"
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+#include "CryptoNoteCore/Currency.h"
+
+#include "Logging/LoggerGroup.h"
+
+// One nonce of a template with many transactions, hashed either from the block or from the prepared mining job
+template<bool use_mining_job>
+class test_mining_hashrate {
+public:
+  static const size_t loop_count = 100;
+  static const size_t transaction_count = 200;
+
+  test_mining_hashrate() : m_currency(CryptoNote::CurrencyBuilder(m_logger).currency()) {
+  }
+
+  bool init() {
+    CryptoNote::AccountBase miner;
+    miner.generate();
+
+    m_block = boost::value_initialized<CryptoNote::Block>();
+    m_block.majorVersion = CryptoNote::BLOCK_MAJOR_VERSION_1;
+    m_block.previousBlockHash = Crypto::rand<Crypto::Hash>();
+    m_block.timestamp = m_currency.genesisBlock().timestamp;
+    if (!m_currency.constructMinerTx(1, 0, 0, 0, 0, miner.getAccountKeys().address, m_block.baseTransaction, CryptoNote::BinaryArray(), 11)) {
+      return false;
+    }
+
+    for (size_t i = 0; i < transaction_count; ++i) {
+      m_block.transactionHashes.push_back(Crypto::rand<Crypto::Hash>());
+    }
+
+    return m_job.init(m_block);
+  }
+
+  bool test() {
+    ++m_block.nonce;
+
+    Crypto::Hash hash;
+    if (use_mining_job) {
+      m_job.setNonce(m_block.nonce);
+      m_job.getLonghash(m_context, hash);
+      return true;
+    }
+
+    return CryptoNote::get_block_longhash(m_context, m_block, hash);
+  }
+
+private:
+  Logging::LoggerGroup m_logger;
+  CryptoNote::Currency m_currency;
+  CryptoNote::Block m_block;
+  CryptoNote::BlockMiningJob m_job;
+  Crypto::cn_context m_context;
+};
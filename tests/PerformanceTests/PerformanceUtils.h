@@ -34,6 +34,23 @@ void set_process_affinity(int core)
 #endif
 }
 
+// Lets threads started afterwards run on every core, for tests of multi-threaded code
+void reset_process_affinity()
+{
+#if defined(BOOST_HAS_PTHREADS) && !defined(__APPLE__) && !defined(BOOST_WINDOWS)
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (int i = 0; i < CPU_SETSIZE; ++i)
+  {
+    CPU_SET(i, &cpuset);
+  }
+  if (0 != ::pthread_setaffinity_np(::pthread_self(), sizeof(cpuset), &cpuset))
+  {
+    std::cout << "pthread_setaffinity_np - ERROR" << std::endl;
+  }
+#endif
+}
+
 void set_thread_high_priority()
 {
 #if defined(__APPLE__)
@@ -0,0 +1,29 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include "BlockchainTestBase.h"
+
+// Measures Blockchain::rebuildCache, as done on start without blockscache.dat
+template<size_t thread_count>
+class test_rebuild_cache : public blockchain_test_base {
+public:
+  static const size_t loop_count = 3;
+
+  bool init() {
+    if (!blockchain_test_base::init()) {
+      return false;
+    }
+
+    return boost::filesystem::remove(m_dir / m_currency.blocksCacheFileName());
+  }
+
+  bool test() {
+    Storage storage(m_currency, m_timeProvider, m_logger);
+    storage.blockchain.setCheckpoints(checkpoints());
+    storage.blockchain.setWorkerThreadCount(thread_count);
+    return storage.blockchain.init(m_dir.string(), true) && storage.blockchain.getCurrentBlockchainHeight() == block_count;
+  }
+};
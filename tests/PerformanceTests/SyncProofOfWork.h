@@ -0,0 +1,66 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <list>
+#include <vector>
+
+#include "BlockchainTestBase.h"
+
+// Adds the first blocks of the generated chain to an empty blockchain outside of the checkpoint zone, so that each
+// block has its proof of work checked, optionally computing the long hashes of the whole batch in advance
+template<bool precompute>
+class test_sync_proof_of_work : public blockchain_test_base {
+public:
+  static const size_t loop_count = 3;
+  static const size_t synced_block_count = 32;
+
+  bool init() {
+    if (!blockchain_test_base::init()) {
+      return false;
+    }
+
+    Storage storage(m_currency, m_timeProvider, m_logger);
+    storage.blockchain.setCheckpoints(checkpoints());
+    std::list<CryptoNote::Block> blocks;
+    if (!storage.blockchain.init(m_dir.string(), true) || !storage.blockchain.getBlocks(1, static_cast<uint32_t>(synced_block_count), blocks)) {
+      return false;
+    }
+
+    m_blocks.assign(blocks.begin(), blocks.end());
+    return storage.blockchain.deinit();
+  }
+
+  bool test() {
+    boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("blockchain_test_%%%%%%%%%%%%");
+    bool result = addBlocks(dir);
+    boost::system::error_code ignoredErrorCode;
+    boost::filesystem::remove_all(dir, ignoredErrorCode);
+    return result;
+  }
+
+private:
+  std::vector<CryptoNote::Block> m_blocks;
+
+  bool addBlocks(const boost::filesystem::path& dir) {
+    Storage storage(m_currency, m_timeProvider, m_logger);
+    if (!storage.blockchain.init(dir.string(), false)) {
+      return false;
+    }
+
+    if (precompute) {
+      storage.blockchain.computeProofsOfWork(m_blocks);
+    }
+
+    for (const auto& block : m_blocks) {
+      CryptoNote::block_verification_context bvc = boost::value_initialized<CryptoNote::block_verification_context>();
+      if (!storage.blockchain.addNewBlock(block, bvc) || !bvc.m_added_to_main_chain) {
+        return false;
+      }
+    }
+
+    return storage.blockchain.deinit();
+  }
+};
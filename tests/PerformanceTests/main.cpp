@@ -6,15 +6,24 @@
 #include "PerformanceUtils.h"
 
 // tests
+#include "AddBlockBlobs.h"
 #include "ConstructTransaction.h"
+#include "BlockchainReadContention.h"
 #include "CheckRingSignature.h"
 #include "CryptoNoteSlowHash.h"
 #include "DerivePublicKey.h"
+#include "DifficultyForNextBlock.h"
 #include "DeriveSecretKey.h"
 #include "GenerateKeyDerivation.h"
 #include "GenerateKeyImage.h"
 #include "GenerateKeyImageHelper.h"
+#include "GetRandomOuts.h"
+#include "ImportSnapshot.h"
 #include "IsOutToAccount.h"
+#include "KeyImageLookup.h"
+#include "MiningHashrate.h"
+#include "RebuildCache.h"
+#include "SyncProofOfWork.h"
 
 int main(int argc, char** argv)
 {
@@ -58,6 +67,27 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE0(test_derive_secret_key);
 
   TEST_PERFORMANCE0(test_cn_slow_hash);
+  TEST_PERFORMANCE0(test_cn_slow_hash_2way);
+  TEST_PERFORMANCE1(test_mining_hashrate, false);
+  TEST_PERFORMANCE1(test_mining_hashrate, true);
+
+  TEST_PERFORMANCE1(test_key_image_lookup, sparse_key_image_set);
+  TEST_PERFORMANCE1(test_key_image_lookup, unordered_key_image_set);
+  TEST_PERFORMANCE1(test_key_image_lookup, CryptoNote::KeyImageSet);
+
+  reset_process_affinity();
+  TEST_PERFORMANCE1(test_rebuild_cache, 1);
+  TEST_PERFORMANCE1(test_rebuild_cache, 4);
+  TEST_PERFORMANCE1(test_import_snapshot, 1);
+  TEST_PERFORMANCE1(test_import_snapshot, 4);
+  TEST_PERFORMANCE1(test_blockchain_read_contention, 1);
+  TEST_PERFORMANCE1(test_blockchain_read_contention, 4);
+  TEST_PERFORMANCE1(test_get_random_outs, 10);
+  TEST_PERFORMANCE1(test_get_random_outs, 100);
+  TEST_PERFORMANCE0(test_difficulty_for_next_block);
+  TEST_PERFORMANCE0(test_add_block_blobs);
+  TEST_PERFORMANCE1(test_sync_proof_of_work, false);
+  TEST_PERFORMANCE1(test_sync_proof_of_work, true);
 
   std::cout << "Tests finished. Elapsed time: " << timer.elapsed_ms() / 1000 << " sec" << std::endl;
 
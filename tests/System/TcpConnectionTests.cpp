@@ -351,3 +351,54 @@ TEST_F(TcpConnectionTests, sendBigChunkThruTcpStream) {
     ASSERT_EQ(buf[i], incoming[i]); //for better output.
   }
 }
+
+TEST_F(TcpConnectionTests, sendBigChunkWithHeader) {
+  connect();
+
+  // Neither part fits into the socket buffers, so the writes end inside the header as well as inside the data
+  const size_t headerSize = 8 * 1024 * 1024;
+  const size_t bufsize = 8 * 1024 * 1024;
+  std::vector<uint8_t> header(headerSize);
+  std::vector<uint8_t> buf(bufsize);
+  fillRandomBuf(header);
+  fillRandomBuf(buf);
+
+  std::vector<uint8_t> incoming;
+  Event readComplete(dispatcher);
+
+  contextGroup.spawn([&]{
+    uint8_t readBuf[1024];
+    size_t readSize;
+    while ((readSize = connection2.read(readBuf, sizeof(readBuf))) > 0) {
+      incoming.insert(incoming.end(), readBuf, readBuf + readSize);
+    }
+
+    readComplete.set();
+  });
+
+  size_t headerWrites = 0;
+  size_t writes = 0;
+  contextGroup.spawn([&]{
+    size_t offset = 0;
+    while (offset < headerSize) {
+      offset += connection1.write(&header[offset], headerSize - offset, &buf[0], bufsize);
+      ++headerWrites;
+    }
+
+    offset -= headerSize;
+    while (offset < bufsize) {
+      offset += connection1.write(&buf[offset], bufsize - offset);
+      ++writes;
+    }
+
+    connection1 = TcpConnection(); // close connection
+  });
+
+  readComplete.wait();
+
+  ASSERT_LT(1, headerWrites);
+  ASSERT_LT(0, writes);
+  ASSERT_EQ(headerSize + bufsize, incoming.size());
+  ASSERT_TRUE(std::equal(header.begin(), header.end(), incoming.begin()));
+  ASSERT_TRUE(std::equal(buf.begin(), buf.end(), incoming.begin() + headerSize));
+}
@@ -74,6 +74,10 @@ bool ICoreStub::handle_incoming_tx(CryptoNote::BinaryArray const& tx_blob, Crypt
   return true;
 }
 
+void ICoreStub::handleIncomingTransactions(const std::vector<CryptoNote::BinaryArray>& transactionBlobs, std::vector<CryptoNote::tx_verification_context>& results) {
+  results.assign(transactionBlobs.size(), boost::value_initialized<CryptoNote::tx_verification_context>());
+}
+
 void ICoreStub::set_blockchain_top(uint32_t height, const Crypto::Hash& top_id) {
   topHeight = height;
   topId = top_id;
@@ -94,6 +98,17 @@ std::vector<CryptoNote::Transaction> ICoreStub::getPoolTransactions() {
   return std::vector<CryptoNote::Transaction>();
 }
 
+void ICoreStub::getPoolTransactions(const std::vector<Crypto::Hash>& txs_ids, std::vector<CryptoNote::Transaction>& txs, std::vector<Crypto::Hash>& missed_txs) {
+  for (const auto& id : txs_ids) {
+    auto it = transactionPool.find(id);
+    if (it != transactionPool.end()) {
+      txs.push_back(it->second);
+    } else {
+      missed_txs.push_back(id);
+    }
+  }
+}
+
 bool ICoreStub::getPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
                                std::vector<CryptoNote::Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) {
   std::unordered_set<Crypto::Hash> knownSet;
@@ -336,6 +351,10 @@ bool ICoreStub::have_block(const Crypto::Hash& id) {
   return blocks.count(id) > 0;
 }
 
+bool ICoreStub::haveTransaction(const Crypto::Hash& id) {
+  return transactions.count(id) > 0 || transactionPool.count(id) > 0;
+}
+
 void ICoreStub::setPoolTxVerificationResult(bool result) {
   poolTxVerificationResult = result;
 }
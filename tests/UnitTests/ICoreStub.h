@@ -28,7 +28,9 @@ public:
   virtual bool get_tx_outputs_gindexs(const Crypto::Hash& tx_id, std::vector<uint32_t>& indexs) override;
   virtual CryptoNote::i_cryptonote_protocol* get_protocol() override;
   virtual bool handle_incoming_tx(CryptoNote::BinaryArray const& tx_blob, CryptoNote::tx_verification_context& tvc, bool keeped_by_block) override;
+  virtual void handleIncomingTransactions(const std::vector<CryptoNote::BinaryArray>& transactionBlobs, std::vector<CryptoNote::tx_verification_context>& results) override;
   virtual std::vector<CryptoNote::Transaction> getPoolTransactions() override;
+  virtual void getPoolTransactions(const std::vector<Crypto::Hash>& txs_ids, std::vector<CryptoNote::Transaction>& txs, std::vector<Crypto::Hash>& missed_txs) override;
   virtual bool getPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
                               std::vector<CryptoNote::Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) override;
   virtual bool getPoolChangesLite(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
@@ -41,6 +43,7 @@ public:
     uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<CryptoNote::BlockShortInfo>& entries) override;
 
   virtual bool have_block(const Crypto::Hash& id) override;
+  virtual bool haveTransaction(const Crypto::Hash& id) override;
   std::vector<Crypto::Hash> buildSparseChain() override;
   std::vector<Crypto::Hash> buildSparseChain(const Crypto::Hash& startBlockId) override;
   virtual bool get_stat_info(CryptoNote::core_stat_info& st_inf) override { return false; }
@@ -52,6 +55,8 @@ public:
   virtual void on_synchronized() override {}
   virtual bool getOutByMSigGIndex(uint64_t amount, uint64_t gindex, CryptoNote::MultisignatureOutput& out) override { return true; }
   virtual size_t addChain(const std::vector<const CryptoNote::IBlock*>& chain) override;
+  virtual void computeProofsOfWork(const std::vector<CryptoNote::Block>& blocks) override {}
+  virtual void precheckTransactions(const std::vector<CryptoNote::BinaryArray>& transactionBlobs) override {}
 
   virtual Crypto::Hash getBlockIdByHeight(uint32_t height) override;
   virtual bool getBlockByHash(const Crypto::Hash &h, CryptoNote::Block &blk) override;
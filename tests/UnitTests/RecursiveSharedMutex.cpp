@@ -0,0 +1,90 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+#include "Common/RecursiveSharedMutex.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+
+using namespace Tools;
+
+TEST(RecursiveSharedMutex, readersShareLock) {
+  RecursiveSharedMutex mutex;
+  SharedLockGuard lock(mutex);
+
+  auto reader = std::async(std::launch::async, [&mutex] {
+    SharedLockGuard lock(mutex);
+    return true;
+  });
+
+  ASSERT_EQ(std::future_status::ready, reader.wait_for(std::chrono::seconds(10)));
+  ASSERT_TRUE(reader.get());
+}
+
+TEST(RecursiveSharedMutex, writerExcludesReaders) {
+  RecursiveSharedMutex mutex;
+  std::atomic<bool> readerEntered(false);
+  std::future<void> reader;
+
+  {
+    std::lock_guard<RecursiveSharedMutex> lock(mutex);
+    reader = std::async(std::launch::async, [&mutex, &readerEntered] {
+      SharedLockGuard lock(mutex);
+      readerEntered = true;
+    });
+
+    ASSERT_EQ(std::future_status::timeout, reader.wait_for(std::chrono::milliseconds(100)));
+    ASSERT_FALSE(readerEntered);
+  }
+
+  reader.get();
+  ASSERT_TRUE(readerEntered);
+}
+
+TEST(RecursiveSharedMutex, ownerLocksRecursively) {
+  RecursiveSharedMutex mutex;
+  std::lock_guard<RecursiveSharedMutex> lock(mutex);
+  {
+    std::lock_guard<RecursiveSharedMutex> innerLock(mutex);
+    SharedLockGuard sharedLock(mutex);
+  }
+
+  auto reader = std::async(std::launch::async, [&mutex] {
+    SharedLockGuard lock(mutex);
+  });
+
+  ASSERT_EQ(std::future_status::timeout, reader.wait_for(std::chrono::milliseconds(100)));
+  mutex.unlock();
+  ASSERT_EQ(std::future_status::ready, reader.wait_for(std::chrono::seconds(10)));
+  mutex.lock();
+}
+
+TEST(RecursiveSharedMutex, readerReentersWhileWriterWaits) {
+  RecursiveSharedMutex mutex;
+  SharedLockGuard lock(mutex);
+
+  auto writer = std::async(std::launch::async, [&mutex] {
+    std::lock_guard<RecursiveSharedMutex> lock(mutex);
+  });
+
+  ASSERT_EQ(std::future_status::timeout, writer.wait_for(std::chrono::milliseconds(100)));
+  {
+    SharedLockGuard innerLock(mutex);
+  }
+
+  ASSERT_EQ(std::future_status::timeout, writer.wait_for(std::chrono::milliseconds(10)));
+  mutex.unlock_shared();
+  ASSERT_EQ(std::future_status::ready, writer.wait_for(std::chrono::seconds(10)));
+  mutex.lock_shared();
+}
+
+TEST(RecursiveSharedMutex, upgradeIsRejected) {
+  RecursiveSharedMutex mutex;
+  SharedLockGuard lock(mutex);
+  ASSERT_THROW(mutex.lock(), std::logic_error);
+}
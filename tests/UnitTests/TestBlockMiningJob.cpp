@@ -0,0 +1,76 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include "crypto/crypto.h"
+#include "CryptoNoteCore/BlockMiningJob.h"
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+#include "CryptoNoteCore/Currency.h"
+#include "Logging/ConsoleLogger.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+class BlockMiningJobTest : public ::testing::Test {
+public:
+  BlockMiningJobTest() : m_currency(CurrencyBuilder(m_logger).currency()), m_block(m_currency.genesisBlock()) {
+    m_block.timestamp = 1500000000;
+    m_block.previousBlockHash = Crypto::rand<Crypto::Hash>();
+    for (size_t i = 0; i < 10; ++i) {
+      m_block.transactionHashes.push_back(Crypto::rand<Crypto::Hash>());
+    }
+  }
+
+protected:
+  Logging::ConsoleLogger m_logger;
+  Currency m_currency;
+  Block m_block;
+};
+
+}
+
+TEST_F(BlockMiningJobTest, hashingBlobFollowsNonce) {
+  BlockMiningJob job;
+  ASSERT_TRUE(job.init(m_block));
+  ASSERT_EQ(m_block.nonce, job.nonce());
+
+  for (uint32_t nonce : { 1u, 0x12345678u, 0xffffffffu }) {
+    job.setNonce(nonce);
+    m_block.nonce = nonce;
+
+    BinaryArray expected;
+    ASSERT_TRUE(get_block_hashing_blob(m_block, expected));
+    ASSERT_EQ(expected, job.hashingBlob());
+    ASSERT_EQ(nonce, job.nonce());
+  }
+}
+
+TEST_F(BlockMiningJobTest, longhashMatchesBlockLonghash) {
+  m_block.nonce = 0x01020304;
+  BlockMiningJob job;
+  ASSERT_TRUE(job.init(m_block));
+
+  Crypto::cn_context context;
+  Crypto::Hash expected;
+  ASSERT_TRUE(get_block_longhash(context, m_block, expected));
+
+  Crypto::Hash hash;
+  job.getLonghash(context, hash);
+  ASSERT_EQ(expected, hash);
+}
+
+TEST_F(BlockMiningJobTest, initReplacesHashingBlob) {
+  BlockMiningJob job;
+  ASSERT_TRUE(job.init(m_currency.genesisBlock()));
+
+  m_block.nonce = 0x01020304;
+  ASSERT_TRUE(job.init(m_block));
+
+  BinaryArray expected;
+  ASSERT_TRUE(get_block_hashing_blob(m_block, expected));
+  ASSERT_EQ(expected, job.hashingBlob());
+  ASSERT_EQ(m_block.nonce, job.nonce());
+}
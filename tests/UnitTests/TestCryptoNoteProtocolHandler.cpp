@@ -0,0 +1,304 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <unordered_set>
+
+#include <boost/uuid/random_generator.hpp>
+
+#include "Common/StringTools.h"
+#include "crypto/crypto.h"
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/VerificationContext.h"
+#include "CryptoNoteProtocol/CryptoNoteProtocolHandler.h"
+#include "Logging/ConsoleLogger.h"
+#include "P2p/LevinProtocol.h"
+#include "System/Dispatcher.h"
+
+#include "ICoreStub.h"
+
+using namespace Common;
+using namespace CryptoNote;
+
+namespace {
+
+class ProtocolCoreStub : public ICoreStub {
+public:
+  virtual bool handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_context& tvc, bool keeped_by_block) override {
+    addedTransactions.push_back(tx_blob);
+    return true;
+  }
+
+  virtual bool handle_incoming_block_blob(const BinaryArray& block_blob, block_verification_context& bvc, bool control_miner, bool relay_block) override {
+    addedBlocks.push_back(block_blob);
+    return true;
+  }
+
+  virtual void getTransactions(const std::vector<Crypto::Hash>& txs_ids, std::list<Transaction>& txs, std::list<Crypto::Hash>& missed_txs, bool checkTxPool) override {
+    for (const auto& id : txs_ids) {
+      auto it = pool.find(id);
+      if (checkTxPool && it != pool.end()) {
+        txs.push_back(it->second);
+      } else {
+        missed_txs.push_back(id);
+      }
+    }
+  }
+
+  std::unordered_map<Crypto::Hash, Transaction> pool;
+  std::vector<BinaryArray> addedTransactions;
+  std::vector<BinaryArray> addedBlocks;
+};
+
+class P2pEndpointStub : public p2p_endpoint_stub {
+public:
+  virtual bool invoke_notify_to_peer(int command, const SharedBinaryArray& req_buff, const CryptoNoteConnectionContext& context) override {
+    messages.emplace_back(command, *req_buff);
+    buffers.push_back(req_buff);
+    return true;
+  }
+
+  virtual void for_each_connection(std::function<void(CryptoNoteConnectionContext&, PeerIdType)> f) override {
+    for (auto& connection : connections) {
+      f(connection, 1);
+    }
+  }
+
+  template<typename Command>
+  typename Command::request takeMessage() {
+    typename Command::request request;
+    EXPECT_EQ(1, messages.size());
+    if (messages.size() == 1) {
+      int command = Command::ID;
+      EXPECT_EQ(command, messages.front().first);
+      EXPECT_TRUE(LevinProtocol::decode(messages.front().second, request));
+    }
+
+    messages.clear();
+    buffers.clear();
+    return request;
+  }
+
+  std::vector<std::pair<int, BinaryArray>> messages;
+  std::vector<SharedBinaryArray> buffers;
+  std::vector<CryptoNoteConnectionContext> connections;
+};
+
+class CryptoNoteProtocolHandlerTest : public ::testing::Test {
+public:
+  CryptoNoteProtocolHandlerTest() :
+    m_currency(CurrencyBuilder(m_logger).currency()),
+    m_handler(m_currency, m_dispatcher, m_core, &m_p2p, m_logger),
+    m_block(m_currency.genesisBlock()) {
+    m_context.version = P2PProtocolVersion::CURRENT;
+    m_context.m_connection_id = boost::uuids::random_generator()();
+    m_context.m_state = CryptoNoteConnectionContext::state_normal;
+
+    m_block.previousBlockHash = Crypto::rand<Crypto::Hash>();
+    for (uint64_t i = 0; i < 3; ++i) {
+      Transaction transaction;
+      transaction.version = CURRENT_TRANSACTION_VERSION;
+      transaction.unlockTime = i;
+      m_transactions.push_back(transaction);
+      m_block.transactionHashes.push_back(getObjectHash(transaction));
+    }
+  }
+
+protected:
+  template<typename Command>
+  void notify(const typename Command::request& request) {
+    BinaryArray response;
+    bool handled;
+    m_handler.handleCommand(true, Command::ID, LevinProtocol::encode(request), response, m_context, handled);
+    ASSERT_TRUE(handled);
+  }
+
+  void addConnections(uint8_t version, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      CryptoNoteConnectionContext context;
+      context.version = version;
+      context.m_connection_id = boost::uuids::random_generator()();
+      context.m_state = CryptoNoteConnectionContext::state_normal;
+      m_p2p.connections.push_back(context);
+    }
+  }
+
+  // The relays are handed over to the dispatcher thread, which runs them on the next yield
+  i_cryptonote_protocol& protocol() {
+    return m_handler;
+  }
+
+  void addToPool(size_t index) {
+    m_core.pool.emplace(m_block.transactionHashes[index], m_transactions[index]);
+  }
+
+  NOTIFY_NEW_COMPACT_BLOCK::request compactBlock() const {
+    NOTIFY_NEW_COMPACT_BLOCK::request request;
+    request.block = asString(toBinaryArray(m_block));
+    request.current_blockchain_height = 2;
+    request.hop = 0;
+    return request;
+  }
+
+  NOTIFY_RESPONSE_BLOCK_TRANSACTIONS::request blockTransactions(std::initializer_list<size_t> indexes) const {
+    NOTIFY_RESPONSE_BLOCK_TRANSACTIONS::request request;
+    request.b.block = asString(toBinaryArray(m_block));
+    for (size_t index : indexes) {
+      request.b.txs.push_back(asString(toBinaryArray(m_transactions[index])));
+    }
+
+    request.current_blockchain_height = 2;
+    request.hop = 0;
+    return request;
+  }
+
+  void assertBlockAdded() {
+    ASSERT_EQ(1, m_core.addedBlocks.size());
+    ASSERT_EQ(toBinaryArray(m_block), m_core.addedBlocks.front());
+
+    std::unordered_set<Crypto::Hash> addedTransactions;
+    for (const auto& transactionBlob : m_core.addedTransactions) {
+      addedTransactions.insert(getBinaryArrayHash(transactionBlob));
+    }
+
+    ASSERT_EQ(m_block.transactionHashes.size(), m_core.addedTransactions.size());
+    ASSERT_EQ(std::unordered_set<Crypto::Hash>(m_block.transactionHashes.begin(), m_block.transactionHashes.end()), addedTransactions);
+  }
+
+  Logging::ConsoleLogger m_logger;
+  System::Dispatcher m_dispatcher;
+  Currency m_currency;
+  ProtocolCoreStub m_core;
+  P2pEndpointStub m_p2p;
+  CryptoNoteProtocolHandler m_handler;
+  CryptoNoteConnectionContext m_context;
+  Block m_block;
+  std::vector<Transaction> m_transactions;
+};
+
+}
+
+TEST_F(CryptoNoteProtocolHandlerTest, compactBlockIsCompletedFromPool) {
+  for (size_t i = 0; i < m_transactions.size(); ++i) {
+    addToPool(i);
+  }
+
+  notify<NOTIFY_NEW_COMPACT_BLOCK>(compactBlock());
+  ASSERT_TRUE(m_p2p.messages.empty());
+  assertBlockAdded();
+}
+
+TEST_F(CryptoNoteProtocolHandlerTest, missingTransactionsAreRequestedFromPeer) {
+  addToPool(0);
+  addToPool(2);
+
+  notify<NOTIFY_NEW_COMPACT_BLOCK>(compactBlock());
+  ASSERT_TRUE(m_core.addedBlocks.empty());
+  auto request = m_p2p.takeMessage<NOTIFY_REQUEST_BLOCK_TRANSACTIONS>();
+  ASSERT_EQ(get_block_hash(m_block), request.block_id);
+  ASSERT_EQ(std::vector<Crypto::Hash>{ m_block.transactionHashes[1] }, request.txs);
+
+  notify<NOTIFY_RESPONSE_BLOCK_TRANSACTIONS>(blockTransactions({ 1 }));
+  ASSERT_TRUE(m_p2p.messages.empty());
+  assertBlockAdded();
+}
+
+TEST_F(CryptoNoteProtocolHandlerTest, allTransactionsAreRequestedWhenPoolChanged) {
+  addToPool(0);
+  addToPool(2);
+
+  notify<NOTIFY_NEW_COMPACT_BLOCK>(compactBlock());
+  m_p2p.takeMessage<NOTIFY_REQUEST_BLOCK_TRANSACTIONS>();
+  m_core.pool.clear();
+
+  notify<NOTIFY_RESPONSE_BLOCK_TRANSACTIONS>(blockTransactions({ 1 }));
+  ASSERT_TRUE(m_core.addedBlocks.empty());
+  auto request = m_p2p.takeMessage<NOTIFY_REQUEST_BLOCK_TRANSACTIONS>();
+  ASSERT_EQ(m_block.transactionHashes, request.txs);
+
+  notify<NOTIFY_RESPONSE_BLOCK_TRANSACTIONS>(blockTransactions({ 0, 1, 2 }));
+  assertBlockAdded();
+}
+
+TEST_F(CryptoNoteProtocolHandlerTest, transactionsOutsideBlockDropConnection) {
+  addToPool(0);
+  addToPool(2);
+
+  auto response = blockTransactions({ 1 });
+  Transaction foreignTransaction;
+  foreignTransaction.version = CURRENT_TRANSACTION_VERSION;
+  foreignTransaction.unlockTime = 100;
+  response.b.txs.push_back(asString(toBinaryArray(foreignTransaction)));
+
+  notify<NOTIFY_RESPONSE_BLOCK_TRANSACTIONS>(response);
+  ASSERT_EQ(CryptoNoteConnectionContext::state_shutdown, m_context.m_state);
+  ASSERT_TRUE(m_core.addedBlocks.empty());
+  ASSERT_TRUE(m_core.addedTransactions.empty());
+  ASSERT_TRUE(m_p2p.messages.empty());
+}
+
+TEST_F(CryptoNoteProtocolHandlerTest, relayedBlockIsEncodedOnceForAllPeers) {
+  addConnections(P2PProtocolVersion::V2, 2);
+  addConnections(P2PProtocolVersion::V1, 2);
+
+  NOTIFY_NEW_BLOCK::request arg;
+  arg.b.block = asString(toBinaryArray(m_block));
+  arg.b.txs.push_back(asString(toBinaryArray(m_transactions[0])));
+  arg.current_blockchain_height = 2;
+  arg.hop = 0;
+  protocol().relay_block(arg);
+  m_dispatcher.yield();
+
+  ASSERT_EQ(4, m_p2p.buffers.size());
+  ASSERT_EQ(m_p2p.buffers[0], m_p2p.buffers[1]);
+  ASSERT_EQ(m_p2p.buffers[2], m_p2p.buffers[3]);
+  ASSERT_NE(m_p2p.buffers[0], m_p2p.buffers[2]);
+
+  int compactBlockCommand = NOTIFY_NEW_COMPACT_BLOCK::ID;
+  int blockCommand = NOTIFY_NEW_BLOCK::ID;
+  ASSERT_EQ(compactBlockCommand, m_p2p.messages[0].first);
+  ASSERT_EQ(blockCommand, m_p2p.messages[2].first);
+
+  NOTIFY_NEW_COMPACT_BLOCK::request compactArg;
+  ASSERT_TRUE(LevinProtocol::decode(*m_p2p.buffers[0], compactArg));
+  ASSERT_EQ(arg.b.block, compactArg.block);
+
+  NOTIFY_NEW_BLOCK::request blockArg;
+  ASSERT_TRUE(LevinProtocol::decode(*m_p2p.buffers[2], blockArg));
+  ASSERT_EQ(arg.b.block, blockArg.b.block);
+  ASSERT_EQ(arg.b.txs, blockArg.b.txs);
+
+  // Only the block handed over to the dispatcher thread is copied
+  ASSERT_EQ(arg.b.block.size() + arg.b.txs[0].size(), m_handler.getCopiedBytes());
+}
+
+TEST_F(CryptoNoteProtocolHandlerTest, relayedTransactionsAreEncodedOnceForAllPeers) {
+  addConnections(P2PProtocolVersion::V2, 3);
+
+  NOTIFY_NEW_TRANSACTIONS::request arg;
+  for (const auto& transaction : m_transactions) {
+    arg.txs.push_back(asString(toBinaryArray(transaction)));
+  }
+
+  protocol().relay_transactions(arg);
+  m_dispatcher.yield();
+
+  ASSERT_EQ(3, m_p2p.buffers.size());
+  ASSERT_EQ(m_p2p.buffers[0], m_p2p.buffers[1]);
+  ASSERT_EQ(m_p2p.buffers[0], m_p2p.buffers[2]);
+
+  NOTIFY_NEW_TRANSACTIONS::request notification;
+  ASSERT_TRUE(LevinProtocol::decode(*m_p2p.buffers[0], notification));
+  ASSERT_EQ(arg.txs, notification.txs);
+
+  uint64_t transactionsSize = 0;
+  for (const auto& transactionBlob : arg.txs) {
+    transactionsSize += transactionBlob.size();
+  }
+
+  ASSERT_EQ(transactionsSize, m_handler.getCopiedBytes());
+}
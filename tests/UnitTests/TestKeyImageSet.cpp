@@ -0,0 +1,192 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+#include "Common/MemoryInputStream.h"
+#include "Common/VectorOutputStream.h"
+#include "CryptoNoteCore/KeyImageSet.h"
+#include "Serialization/BinaryInputStreamSerializer.h"
+#include "Serialization/BinaryOutputStreamSerializer.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+struct KeyImageLess {
+  bool operator()(const Crypto::KeyImage& keyImage1, const Crypto::KeyImage& keyImage2) const {
+    return memcmp(&keyImage1, &keyImage2, sizeof(Crypto::KeyImage)) < 0;
+  }
+};
+
+typedef std::set<Crypto::KeyImage, KeyImageLess> KeyImages;
+
+// Images sharing the first word share the home slot, a small homeRange makes long probe runs
+Crypto::KeyImage makeKeyImage(std::mt19937_64& generator, uint64_t homeRange) {
+  uint64_t words[4];
+  for (auto& word : words) {
+    word = generator();
+  }
+
+  words[0] %= homeRange;
+  Crypto::KeyImage keyImage;
+  memcpy(&keyImage, words, sizeof keyImage);
+  return keyImage;
+}
+
+void checkSameContents(const KeyImages& expected, const KeyImageSet& keyImages) {
+  ASSERT_EQ(expected.size(), keyImages.size());
+  for (const auto& keyImage : expected) {
+    ASSERT_EQ(1, keyImages.count(keyImage));
+  }
+
+  KeyImages iterated(keyImages.begin(), keyImages.end());
+  ASSERT_EQ(expected, iterated);
+}
+
+// Serializes a table as KeyImageSet stores it
+std::vector<uint8_t> makeTable(uint64_t size, const std::vector<Crypto::KeyImage>& slots) {
+  std::vector<uint8_t> blob;
+  Common::VectorOutputStream stream(blob);
+  BinaryOutputStreamSerializer serializer(stream);
+  uint64_t capacity = slots.size();
+  bool hasNullImage = false;
+  serializer(capacity, "capacity");
+  serializer(size, "size");
+  serializer(hasNullImage, "has_null_image");
+  serializer.binary(const_cast<Crypto::KeyImage*>(slots.data()), slots.size() * sizeof(Crypto::KeyImage), "slots");
+  return blob;
+}
+
+void loadTable(KeyImageSet& keyImages, const std::vector<uint8_t>& blob) {
+  Common::MemoryInputStream stream(blob.data(), blob.size());
+  BinaryInputStreamSerializer serializer(stream);
+  keyImages.serialize(serializer);
+}
+
+}
+
+TEST(KeyImageSet, insertCountErase) {
+  std::mt19937_64 generator(1);
+  KeyImageSet keyImages;
+  Crypto::KeyImage keyImage = makeKeyImage(generator, UINT64_MAX);
+
+  ASSERT_TRUE(keyImages.empty());
+  ASSERT_EQ(0, keyImages.count(keyImage));
+  ASSERT_TRUE(keyImages.insert(keyImage));
+  ASSERT_FALSE(keyImages.insert(keyImage));
+  ASSERT_EQ(1, keyImages.size());
+  ASSERT_EQ(1, keyImages.count(keyImage));
+  ASSERT_EQ(1, keyImages.erase(keyImage));
+  ASSERT_EQ(0, keyImages.erase(keyImage));
+  ASSERT_EQ(0, keyImages.count(keyImage));
+  ASSERT_TRUE(keyImages.begin() == keyImages.end());
+}
+
+TEST(KeyImageSet, nullImageIsStored) {
+  KeyImageSet keyImages;
+  Crypto::KeyImage nullImage = {};
+
+  ASSERT_TRUE(keyImages.insert(nullImage));
+  ASSERT_FALSE(keyImages.insert(nullImage));
+  ASSERT_EQ(1, keyImages.count(nullImage));
+  ASSERT_EQ(1, std::distance(keyImages.begin(), keyImages.end()));
+  ASSERT_EQ(1, keyImages.erase(nullImage));
+  ASSERT_EQ(0, keyImages.count(nullImage));
+}
+
+TEST(KeyImageSet, matchesStdSetWithCollidingImages) {
+  std::mt19937_64 generator(2);
+  std::vector<Crypto::KeyImage> inserted;
+  KeyImages expected;
+  KeyImageSet keyImages;
+
+  for (size_t i = 0; i < 20000; ++i) {
+    if (!inserted.empty() && generator() % 3 == 0) {
+      size_t index = static_cast<size_t>(generator() % inserted.size());
+      ASSERT_EQ(expected.erase(inserted[index]), keyImages.erase(inserted[index]));
+    } else {
+      Crypto::KeyImage keyImage = makeKeyImage(generator, 4096);
+      inserted.push_back(keyImage);
+      ASSERT_EQ(expected.insert(keyImage).second, keyImages.insert(keyImage));
+    }
+  }
+
+  checkSameContents(expected, keyImages);
+  for (size_t i = 0; i < 1000; ++i) {
+    ASSERT_EQ(0, keyImages.count(makeKeyImage(generator, 4096)));
+  }
+}
+
+TEST(KeyImageSet, serializationRoundTrip) {
+  std::mt19937_64 generator(3);
+  KeyImages expected;
+  KeyImageSet keyImages;
+  for (size_t i = 0; i < 1000; ++i) {
+    Crypto::KeyImage keyImage = makeKeyImage(generator, UINT64_MAX);
+    expected.insert(keyImage);
+    keyImages.insert(keyImage);
+  }
+
+  Crypto::KeyImage nullImage = {};
+  expected.insert(nullImage);
+  keyImages.insert(nullImage);
+
+  std::vector<uint8_t> blob;
+  {
+    Common::VectorOutputStream stream(blob);
+    BinaryOutputStreamSerializer serializer(stream);
+    keyImages.serialize(serializer);
+  }
+
+  KeyImageSet loaded;
+  Common::MemoryInputStream stream(blob.data(), blob.size());
+  BinaryInputStreamSerializer serializer(stream);
+  loaded.serialize(serializer);
+
+  checkSameContents(expected, loaded);
+}
+
+TEST(KeyImageSet, loadingChecksSize) {
+  std::mt19937_64 generator(4);
+  std::vector<Crypto::KeyImage> slots(32);
+  Crypto::KeyImage keyImage = makeKeyImage(generator, 1);
+  slots[0] = keyImage;
+
+  KeyImageSet keyImages;
+  ASSERT_THROW(loadTable(keyImages, makeTable(2, slots)), std::runtime_error);
+  ASSERT_TRUE(keyImages.empty());
+
+  ASSERT_NO_THROW(loadTable(keyImages, makeTable(1, slots)));
+  ASSERT_EQ(1, keyImages.count(keyImage));
+}
+
+TEST(KeyImageSet, loadingRejectsFullTable) {
+  std::mt19937_64 generator(5);
+  std::vector<Crypto::KeyImage> slots(32);
+  for (size_t i = 0; i < slots.size(); ++i) {
+    slots[i] = makeKeyImage(generator, 1);
+    reinterpret_cast<uint64_t*>(&slots[i])[0] = i;
+  }
+
+  KeyImageSet keyImages;
+  ASSERT_THROW(loadTable(keyImages, makeTable(slots.size(), slots)), std::runtime_error);
+  ASSERT_EQ(0, keyImages.count(makeKeyImage(generator, UINT64_MAX)));
+}
+
+TEST(KeyImageSet, loadingRejectsUnreachableImage) {
+  std::mt19937_64 generator(6);
+  std::vector<Crypto::KeyImage> slots(32);
+  // the home slot of the image is 0, an empty slot ends the probe run before slot 2
+  slots[2] = makeKeyImage(generator, 1);
+
+  KeyImageSet keyImages;
+  ASSERT_THROW(loadTable(keyImages, makeTable(1, slots)), std::runtime_error);
+}
@@ -0,0 +1,123 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+#include <memory>
+
+#include <System/ContextGroup.h>
+#include <System/Dispatcher.h>
+#include <System/Event.h>
+#include <System/Ipv4Address.h>
+#include <System/TcpConnection.h>
+#include <System/TcpConnector.h>
+#include <System/TcpListener.h>
+
+#include "P2p/LevinProtocol.h"
+#include "P2p/NetNodeCommon.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+const System::Ipv4Address LISTEN_ADDRESS("127.0.0.1");
+const uint16_t LISTEN_PORT = 6680;
+const uint32_t COMMAND = 1001;
+// Too big for the socket buffers, so the messages are written in parts
+const size_t MESSAGE_SIZE = 16 * 1024 * 1024;
+
+BinaryArray randomMessage() {
+  BinaryArray message(MESSAGE_SIZE);
+  for (auto& byte : message) {
+    byte = static_cast<uint8_t>(rand() & 0xff);
+  }
+
+  return message;
+}
+
+class LevinProtocolTest : public ::testing::Test {
+public:
+  LevinProtocolTest() : m_listener(m_dispatcher, LISTEN_ADDRESS, LISTEN_PORT), m_contextGroup(m_dispatcher) {
+  }
+
+protected:
+  void connect(System::TcpConnection& sender, System::TcpConnection& receiver) {
+    sender = System::TcpConnector(m_dispatcher).connect(LISTEN_ADDRESS, LISTEN_PORT);
+    receiver = m_listener.accept();
+  }
+
+  void receive(System::TcpConnection& connection, LevinProtocol::Command& command, System::Event& received) {
+    m_contextGroup.spawn([&] {
+      LevinProtocol protocol(connection);
+      EXPECT_TRUE(protocol.readCommand(command));
+      received.set();
+    });
+  }
+
+  System::Dispatcher m_dispatcher;
+  System::TcpListener m_listener;
+  System::ContextGroup m_contextGroup;
+};
+
+}
+
+TEST_F(LevinProtocolTest, bigMessageIsWrittenInParts) {
+  System::TcpConnection sender;
+  System::TcpConnection receiver;
+  connect(sender, receiver);
+
+  BinaryArray message = randomMessage();
+  LevinProtocol::Command command;
+  System::Event received(m_dispatcher);
+  receive(receiver, command, received);
+
+  m_contextGroup.spawn([&] {
+    LevinProtocol(sender).sendMessage(COMMAND, message, false);
+  });
+
+  received.wait();
+  m_contextGroup.wait();
+
+  ASSERT_EQ(COMMAND, command.command);
+  ASSERT_TRUE(command.isNotify);
+  ASSERT_FALSE(command.isResponse);
+  ASSERT_EQ(message, command.buf);
+}
+
+TEST_F(LevinProtocolTest, sharedMessageIsWrittenToAllConnections) {
+  const size_t connectionCount = 3;
+  System::TcpConnection senders[connectionCount];
+  System::TcpConnection receivers[connectionCount];
+  LevinProtocol::Command commands[connectionCount];
+  std::vector<std::unique_ptr<System::Event>> received;
+
+  BinaryArray message = randomMessage();
+  SharedBinaryArray buffer = std::make_shared<const BinaryArray>(message);
+  for (size_t i = 0; i < connectionCount; ++i) {
+    connect(senders[i], receivers[i]);
+    received.emplace_back(new System::Event(m_dispatcher));
+    receive(receivers[i], commands[i], *received[i]);
+  }
+
+  // The writes of the connections are interleaved, each one reads the same buffer from its own offset
+  for (size_t i = 0; i < connectionCount; ++i) {
+    m_contextGroup.spawn([&, i] {
+      LevinProtocol(senders[i]).sendReply(COMMAND, *buffer, LEVIN_PROTOCOL_RETCODE_SUCCESS);
+    });
+  }
+
+  for (auto& event : received) {
+    event->wait();
+  }
+
+  m_contextGroup.wait();
+
+  ASSERT_EQ(message, *buffer);
+  for (const auto& command : commands) {
+    ASSERT_EQ(COMMAND, command.command);
+    ASSERT_TRUE(command.isResponse);
+    ASSERT_EQ(message, command.buf);
+  }
+}
@@ -0,0 +1,213 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "CryptoNoteCore/MappedVector.h"
+#include "Serialization/SerializationOverloads.h"
+
+namespace {
+
+struct TestItem {
+  uint32_t number;
+  std::string text;
+
+  void serialize(CryptoNote::ISerializer& s) {
+    s(number, "number");
+    s(text, "text");
+  }
+};
+
+TestItem makeItem(uint32_t number) {
+  TestItem item;
+  item.number = number;
+  item.text = std::string(number % 100, 'a' + number % 26);
+  return item;
+}
+
+class MappedVectorTest : public ::testing::Test {
+protected:
+  virtual void SetUp() override {
+    m_dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("test_data_%%%%%%%%%%%%");
+    boost::filesystem::create_directories(m_dir);
+    m_itemsFile = (m_dir / "items.dat").string();
+    m_indexesFile = (m_dir / "indexes.dat").string();
+  }
+
+  virtual void TearDown() override {
+    boost::system::error_code ignoredErrorCode;
+    boost::filesystem::remove_all(m_dir, ignoredErrorCode);
+  }
+
+  boost::filesystem::path m_dir;
+  std::string m_itemsFile;
+  std::string m_indexesFile;
+};
+
+}
+
+TEST_F(MappedVectorTest, pushBackAndReadAfterReopen) {
+  {
+    MappedVector<TestItem> items;
+    ASSERT_TRUE(items.open(m_itemsFile, m_indexesFile, 4));
+    ASSERT_TRUE(items.empty());
+
+    for (uint32_t i = 0; i < 1000; ++i) {
+      items.push_back(makeItem(i));
+    }
+
+    ASSERT_EQ(1000, items.size());
+    ASSERT_EQ(7, items[7].number);
+    ASSERT_EQ(makeItem(999).text, items.back().text);
+  }
+
+  MappedVector<TestItem> items;
+  ASSERT_TRUE(items.open(m_itemsFile, m_indexesFile, 4));
+  ASSERT_EQ(1000, items.size());
+  for (uint32_t i = 0; i < 1000; ++i) {
+    ASSERT_EQ(i, items[i].number);
+    ASSERT_EQ(makeItem(i).text, items[i].text);
+  }
+}
+
+TEST_F(MappedVectorTest, popBackTruncatesItemsFile) {
+  {
+    MappedVector<TestItem> items;
+    ASSERT_TRUE(items.open(m_itemsFile, m_indexesFile, 4));
+    for (uint32_t i = 0; i < 10; ++i) {
+      items.push_back(makeItem(i));
+    }
+
+    items.pop_back();
+    items.pop_back();
+    items.push_back(makeItem(42));
+    ASSERT_EQ(9, items.size());
+    ASSERT_EQ(42, items.back().number);
+  }
+
+  size_t expectedSize = 0;
+  for (uint32_t number : { 0, 1, 2, 3, 4, 5, 6, 7, 42 }) {
+    TestItem item = makeItem(number);
+    // varint number, varint length and the text itself
+    expectedSize += 1 + 1 + item.text.size();
+  }
+
+  ASSERT_EQ(expectedSize, boost::filesystem::file_size(m_itemsFile));
+
+  MappedVector<TestItem> items;
+  ASSERT_TRUE(items.open(m_itemsFile, m_indexesFile, 4));
+  ASSERT_EQ(9, items.size());
+  ASSERT_EQ(42, items[8].number);
+}
+
+TEST_F(MappedVectorTest, rawReturnsSerializedItem) {
+  MappedVector<TestItem> items;
+  ASSERT_TRUE(items.open(m_itemsFile, m_indexesFile, 4));
+  items.push_back(makeItem(5));
+  items.push_back(makeItem(6));
+
+  Common::ArrayView<uint8_t> data = items.raw(1);
+  ASSERT_EQ(1 + 1 + 6, data.getSize());
+  ASSERT_EQ(6, data[0]);
+}
+
+TEST_F(MappedVectorTest, convertsSwappedVectorIndex) {
+  std::vector<uint32_t> sizes;
+  {
+    std::ofstream itemsFile(m_itemsFile, std::ios::binary);
+    for (uint32_t i = 0; i < 3; ++i) {
+      std::vector<uint8_t> blob;
+      Common::VectorOutputStream stream(blob);
+      CryptoNote::BinaryOutputStreamSerializer archive(stream);
+      TestItem item = makeItem(i + 10);
+      serialize(item, archive);
+      itemsFile.write(reinterpret_cast<const char*>(blob.data()), blob.size());
+      sizes.push_back(static_cast<uint32_t>(blob.size()));
+    }
+
+    std::ofstream indexesFile(m_indexesFile, std::ios::binary);
+    uint64_t count = sizes.size();
+    indexesFile.write(reinterpret_cast<const char*>(&count), sizeof count);
+    indexesFile.write(reinterpret_cast<const char*>(sizes.data()), sizes.size() * sizeof(uint32_t));
+  }
+
+  MappedVector<TestItem> items;
+  ASSERT_TRUE(items.open(m_itemsFile, m_indexesFile, 4));
+  ASSERT_EQ(3, items.size());
+  for (uint32_t i = 0; i < 3; ++i) {
+    ASSERT_EQ(i + 10, items[i].number);
+    ASSERT_EQ(sizes[i], items.raw(i).getSize());
+  }
+}
+
+TEST_F(MappedVectorTest, concurrentReadersSeeAllItems) {
+  MappedVector<TestItem> items;
+  ASSERT_TRUE(items.open(m_itemsFile, m_indexesFile, 4));
+  for (uint32_t i = 0; i < 200; ++i) {
+    items.push_back(makeItem(i));
+  }
+
+  std::vector<std::future<bool>> readers;
+  for (uint32_t reader = 0; reader < 4; ++reader) {
+    readers.push_back(std::async(std::launch::async, [&items, reader] {
+      for (uint32_t i = 0; i < 2000; ++i) {
+        uint32_t index = (i * 7 + reader) % 200;
+        const TestItem& item = items[index];
+        if (item.number != index || item.text != makeItem(index).text) {
+          return false;
+        }
+      }
+
+      return true;
+    }));
+  }
+
+  for (auto& reader : readers) {
+    ASSERT_TRUE(reader.get());
+  }
+}
+
+TEST_F(MappedVectorTest, cachesOfPastThreadsAreDropped) {
+  MappedVector<TestItem> items;
+  ASSERT_TRUE(items.open(m_itemsFile, m_indexesFile, 4));
+  items.push_back(makeItem(0));
+  items.push_back(makeItem(1));
+
+  // The pushed items are cached by this thread
+  ASSERT_EQ(0, items[0].number);
+  ASSERT_EQ(0, items.getCacheMisses());
+
+  // The threads are alive together so that none of them reuses the id of another
+  std::mutex mutex;
+  std::condition_variable allRead;
+  size_t readCount = 0;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < 100; ++i) {
+    threads.emplace_back([&] {
+      items[0];
+      std::unique_lock<std::mutex> lock(mutex);
+      if (++readCount == 100) {
+        allRead.notify_all();
+      } else {
+        allRead.wait(lock, [&] { return readCount == 100; });
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_EQ(100, items.getCacheMisses());
+  ASSERT_EQ(0, items[0].number);
+  ASSERT_EQ(101, items.getCacheMisses());
+}
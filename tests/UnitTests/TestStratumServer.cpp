@@ -0,0 +1,376 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <deque>
+
+#include <Common/StringTools.h>
+#include <System/Dispatcher.h>
+#include <System/Ipv4Address.h>
+#include <System/TcpConnection.h>
+#include <System/TcpConnector.h>
+#include <System/TcpStream.h>
+
+#include "CryptoNoteCore/Account.h"
+#include "CryptoNoteCore/Currency.h"
+#include "CryptoNoteCore/Difficulty.h"
+#include "Logging/ConsoleLogger.h"
+#include "Rpc/CoreRpcServerErrorCodes.h"
+#include "Rpc/StratumServer.h"
+
+#include "ICoreStub.h"
+#include "ICryptoNoteProtocolQueryStub.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+const uint16_t STRATUM_PORT = 18801;
+const difficulty_type SHARE_DIFFICULTY = 2;
+const size_t MAX_CLIENTS = 2;
+
+class StratumCoreStub : public ICoreStub, public IMinerHandler {
+public:
+  StratumCoreStub(const Block& block) : block(block), blockDifficulty(1000000000) {
+  }
+
+  virtual bool addObserver(ICoreObserver* observer) override {
+    observers.push_back(observer);
+    return true;
+  }
+
+  virtual bool removeObserver(ICoreObserver* observer) override {
+    observers.erase(std::remove(observers.begin(), observers.end(), observer), observers.end());
+    return true;
+  }
+
+  virtual bool handle_block_found(Block& b) override {
+    foundBlocks.push_back(b);
+    return true;
+  }
+
+  virtual bool get_block_template(Block& b, const AccountPublicAddress& adr, difficulty_type& diffic, uint32_t& height, const BinaryArray& ex_nonce) override {
+    b = block;
+    diffic = blockDifficulty;
+    height = 1;
+    return true;
+  }
+
+  Block block;
+  difficulty_type blockDifficulty;
+  std::vector<ICoreObserver*> observers;
+  std::vector<Block> foundBlocks;
+};
+
+class StratumClient {
+public:
+  StratumClient(System::Dispatcher& dispatcher) :
+    m_connection(System::TcpConnector(dispatcher).connect(System::Ipv4Address("127.0.0.1"), STRATUM_PORT)),
+    m_streambuf(m_connection),
+    m_stream(&m_streambuf) {
+  }
+
+  template <typename Params>
+  void send(const std::string& method, const Params& params) {
+    JsonRpc::JsonRpcRequest request;
+    request.setMethod(method);
+    request.setParams(params);
+    std::string line = request.getBody() + '\n';
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(line.data());
+    size_t size = line.size();
+    while (size > 0) {
+      size_t transferred = m_connection.write(data, size);
+      data += transferred;
+      size -= transferred;
+    }
+  }
+
+  // Returns the error code of the response, 0 if it succeeded. The jobs pushed meanwhile are kept for takeJob().
+  template <typename Params, typename Result>
+  int call(const std::string& method, const Params& params, Result& result) {
+    send(method, params);
+    std::string line;
+    while (std::getline(m_stream, line)) {
+      if (Common::JsonValue::fromString(line).contains("method")) {
+        JsonRpc::JsonRpcRequest notification;
+        notification.parseRequest(line);
+        STRATUM_JOB job;
+        notification.loadParams(job);
+        m_jobs.push_back(job);
+        continue;
+      }
+
+      JsonRpc::JsonRpcResponse response;
+      response.parse(line);
+      JsonRpc::JsonRpcError error;
+      if (response.getError(error)) {
+        return error.code;
+      }
+
+      EXPECT_TRUE(response.getResult(result));
+      return 0;
+    }
+
+    ADD_FAILURE() << "Connection closed";
+    return JsonRpc::errInternalError;
+  }
+
+  int login(const std::string& address, STRATUM_JOB& job) {
+    COMMAND_STRATUM_LOGIN::request request;
+    request.login = address;
+    request.pass = "x";
+    request.agent = "test";
+    COMMAND_STRATUM_LOGIN::response response;
+    int code = call("login", request, response);
+    m_id = response.id;
+    job = response.job;
+    return code;
+  }
+
+  int submit(const STRATUM_JOB& job, uint32_t nonce, const Crypto::Hash& result) {
+    COMMAND_STRATUM_SUBMIT::request request;
+    request.id = m_id;
+    request.job_id = job.job_id;
+    request.nonce = Common::podToHex(nonce);
+    request.result = Common::podToHex(result);
+    COMMAND_STRATUM_SUBMIT::response response;
+    int code = call("submit", request, response);
+    if (code == 0) {
+      EXPECT_EQ(CORE_RPC_STATUS_OK, response.status);
+    }
+
+    return code;
+  }
+
+  STRATUM_JOB takeJob() {
+    if (m_jobs.empty()) {
+      std::string line;
+      EXPECT_TRUE(static_cast<bool>(std::getline(m_stream, line)));
+      JsonRpc::JsonRpcRequest notification;
+      notification.parseRequest(line);
+      EXPECT_EQ("job", notification.getMethod());
+      STRATUM_JOB job;
+      notification.loadParams(job);
+      return job;
+    }
+
+    STRATUM_JOB job = m_jobs.front();
+    m_jobs.pop_front();
+    return job;
+  }
+
+  // The server closes the connection without sending anything more
+  bool waitClosed() {
+    std::string line;
+    return !std::getline(m_stream, line);
+  }
+
+private:
+  System::TcpConnection m_connection;
+  System::TcpStreambuf m_streambuf;
+  std::istream m_stream;
+  std::string m_id;
+  std::deque<STRATUM_JOB> m_jobs;
+};
+
+class StratumServerTest : public ::testing::Test {
+public:
+  StratumServerTest() :
+    m_currency(CurrencyBuilder(m_logger).testnet(true).currency()),
+    m_core(makeTemplate(m_currency)),
+    m_server(m_dispatcher, m_logger, m_currency, m_core, m_core, m_protocolQuery, SHARE_DIFFICULTY, 30, MAX_CLIENTS) {
+    AccountBase account;
+    account.generate();
+    m_address = m_currency.accountAddressAsString(account);
+
+    BlockMiningJob miningJob;
+    miningJob.init(m_core.block);
+    Crypto::cn_context context;
+    for (uint32_t nonce = 0; m_validNonces.size() < 12 || m_invalidNonces.empty(); ++nonce) {
+      miningJob.setNonce(nonce);
+      Crypto::Hash hash;
+      miningJob.getLonghash(context, hash);
+      if (check_hash(hash, SHARE_DIFFICULTY)) {
+        m_validNonces.push_back(nonce);
+        m_validHashes.push_back(hash);
+      } else {
+        m_invalidNonces.push_back(nonce);
+      }
+    }
+
+    m_server.start("127.0.0.1", STRATUM_PORT);
+  }
+
+  ~StratumServerTest() {
+    m_server.stop();
+  }
+
+protected:
+  static Block makeTemplate(const Currency& currency) {
+    Block block = currency.genesisBlock();
+    block.previousBlockHash = Crypto::rand<Crypto::Hash>();
+    return block;
+  }
+
+  Logging::ConsoleLogger m_logger;
+  System::Dispatcher m_dispatcher;
+  Currency m_currency;
+  StratumCoreStub m_core;
+  ICryptoNoteProtocolQueryStub m_protocolQuery;
+  StratumServer m_server;
+  std::string m_address;
+  std::vector<uint32_t> m_validNonces;
+  std::vector<Crypto::Hash> m_validHashes;
+  std::vector<uint32_t> m_invalidNonces;
+};
+
+Crypto::Hash hashFromTarget(const std::string& target, uint32_t delta) {
+  uint32_t value;
+  EXPECT_TRUE(Common::podFromHex(target, value));
+  value += delta;
+
+  Crypto::Hash hash = Crypto::Hash();
+  memcpy(hash.data + sizeof(hash.data) - sizeof(value), &value, sizeof(value));
+  return hash;
+}
+
+}
+
+TEST(StratumServer, difficultyToTargetOfOneAcceptsEveryHash) {
+  ASSERT_EQ("ffffffff", StratumServer::difficultyToTarget(1));
+  ASSERT_EQ("ffffffff", StratumServer::difficultyToTarget(0));
+}
+
+TEST(StratumServer, difficultyToTargetMatchesCheckHash) {
+  for (difficulty_type difficulty : {2, 1000, 123457, 1000000}) {
+    std::string target = StratumServer::difficultyToTarget(difficulty);
+    EXPECT_TRUE(check_hash(hashFromTarget(target, 0), difficulty)) << difficulty;
+    EXPECT_FALSE(check_hash(hashFromTarget(target, 1), difficulty)) << difficulty;
+  }
+}
+
+TEST_F(StratumServerTest, loginReturnsJobOfTemplate) {
+  StratumClient client(m_dispatcher);
+  STRATUM_JOB job;
+  ASSERT_EQ(0, client.login(m_address, job));
+
+  BlockMiningJob miningJob;
+  ASSERT_TRUE(miningJob.init(m_core.block));
+  ASSERT_EQ(Common::toHex(miningJob.hashingBlob()), job.blob);
+  ASSERT_EQ(StratumServer::difficultyToTarget(SHARE_DIFFICULTY), job.target);
+  ASSERT_EQ(1, job.height);
+}
+
+TEST_F(StratumServerTest, loginRejectsWrongAddress) {
+  StratumClient client(m_dispatcher);
+  STRATUM_JOB job;
+  ASSERT_EQ(CORE_RPC_ERROR_CODE_WRONG_WALLET_ADDRESS, client.login("wrong", job));
+}
+
+TEST_F(StratumServerTest, jobIsPushedWhenChainChanges) {
+  StratumClient client(m_dispatcher);
+  STRATUM_JOB job;
+  ASSERT_EQ(0, client.login(m_address, job));
+
+  for (auto observer : m_core.observers) {
+    observer->blockchainUpdated();
+  }
+
+  STRATUM_JOB pushedJob = client.takeJob();
+  ASSERT_NE(job.job_id, pushedJob.job_id);
+  ASSERT_EQ(job.blob, pushedJob.blob);
+}
+
+TEST_F(StratumServerTest, validShareIsAccepted) {
+  StratumClient client(m_dispatcher);
+  STRATUM_JOB job;
+  ASSERT_EQ(0, client.login(m_address, job));
+  ASSERT_EQ(0, client.submit(job, m_validNonces[0], m_validHashes[0]));
+  ASSERT_TRUE(m_core.foundBlocks.empty());
+}
+
+TEST_F(StratumServerTest, shareOfUnknownJobIsStale) {
+  StratumClient client(m_dispatcher);
+  STRATUM_JOB job;
+  ASSERT_EQ(0, client.login(m_address, job));
+  job.job_id = "100";
+  ASSERT_EQ(CORE_RPC_ERROR_CODE_STALE_SHARE, client.submit(job, m_validNonces[0], m_validHashes[0]));
+}
+
+TEST_F(StratumServerTest, duplicateShareIsRejected) {
+  StratumClient client(m_dispatcher);
+  STRATUM_JOB job;
+  ASSERT_EQ(0, client.login(m_address, job));
+  ASSERT_EQ(0, client.submit(job, m_validNonces[0], m_validHashes[0]));
+  ASSERT_EQ(CORE_RPC_ERROR_CODE_DUPLICATE_SHARE, client.submit(job, m_validNonces[0], m_validHashes[0]));
+}
+
+TEST_F(StratumServerTest, lowDifficultyShareIsRejectedAndNotRecorded) {
+  StratumClient client(m_dispatcher);
+  STRATUM_JOB job;
+  ASSERT_EQ(0, client.login(m_address, job));
+
+  // The claimed result meets the target, the share is hashed
+  ASSERT_EQ(CORE_RPC_ERROR_CODE_LOW_DIFFICULTY_SHARE, client.submit(job, m_invalidNonces[0], Crypto::Hash()));
+  ASSERT_EQ(CORE_RPC_ERROR_CODE_LOW_DIFFICULTY_SHARE, client.submit(job, m_invalidNonces[0], Crypto::Hash()));
+}
+
+TEST_F(StratumServerTest, shareOfBlockDifficultySubmitsBlock) {
+  m_core.blockDifficulty = 1;
+  StratumClient client(m_dispatcher);
+  STRATUM_JOB job;
+  ASSERT_EQ(0, client.login(m_address, job));
+  ASSERT_EQ(0, client.submit(job, m_invalidNonces[0], Crypto::Hash()));
+
+  ASSERT_EQ(1, m_core.foundBlocks.size());
+  ASSERT_EQ(m_invalidNonces[0], m_core.foundBlocks.front().nonce);
+}
+
+TEST_F(StratumServerTest, difficultyIsRaisedWhenSharesComeFast) {
+  StratumClient client(m_dispatcher);
+  STRATUM_JOB job;
+  ASSERT_EQ(0, client.login(m_address, job));
+  for (size_t i = 0; i < 10; ++i) {
+    ASSERT_EQ(0, client.submit(job, m_validNonces[i], m_validHashes[i]));
+  }
+
+  // At most fourfold at a time
+  STRATUM_JOB pushedJob = client.takeJob();
+  ASSERT_EQ(StratumServer::difficultyToTarget(SHARE_DIFFICULTY * 4), pushedJob.target);
+}
+
+TEST_F(StratumServerTest, minerSendingInvalidSharesIsBanned) {
+  {
+    StratumClient client(m_dispatcher);
+    STRATUM_JOB job;
+    ASSERT_EQ(0, client.login(m_address, job));
+    for (size_t i = 0; i < 9; ++i) {
+      ASSERT_EQ(CORE_RPC_ERROR_CODE_LOW_DIFFICULTY_SHARE, client.submit(job, m_invalidNonces[0], Crypto::Hash()));
+    }
+
+    // A valid share resets the count
+    ASSERT_EQ(0, client.submit(job, m_validNonces[0], m_validHashes[0]));
+    for (size_t i = 0; i < 9; ++i) {
+      ASSERT_EQ(CORE_RPC_ERROR_CODE_DUPLICATE_SHARE, client.submit(job, m_validNonces[0], m_validHashes[0]));
+    }
+
+    ASSERT_EQ(CORE_RPC_ERROR_CODE_DUPLICATE_SHARE, client.submit(job, m_validNonces[0], m_validHashes[0]));
+    ASSERT_TRUE(client.waitClosed());
+  }
+
+  StratumClient client(m_dispatcher);
+  ASSERT_TRUE(client.waitClosed());
+}
+
+TEST_F(StratumServerTest, connectionsAreLimited) {
+  StratumClient firstClient(m_dispatcher);
+  StratumClient secondClient(m_dispatcher);
+  STRATUM_JOB job;
+  ASSERT_EQ(0, firstClient.login(m_address, job));
+  ASSERT_EQ(0, secondClient.login(m_address, job));
+
+  StratumClient thirdClient(m_dispatcher);
+  ASSERT_TRUE(thirdClient.waitClosed());
+}
@@ -0,0 +1,197 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <boost/uuid/random_generator.hpp>
+
+#include "crypto/crypto.h"
+#include "CryptoNoteProtocol/SyncScheduler.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+const size_t MAX_RANGE_SIZE = 10;
+const size_t MIN_RANGE_SIZE = 2;
+const size_t MAX_PENDING_BLOCK_COUNT = 20;
+
+class SyncSchedulerTest : public ::testing::Test {
+public:
+  SyncSchedulerTest() :
+    m_scheduler(MAX_RANGE_SIZE, MIN_RANGE_SIZE, MAX_PENDING_BLOCK_COUNT, std::chrono::seconds(10), std::chrono::seconds(60)),
+    m_now(SyncScheduler::Clock::now()) {
+    boost::uuids::random_generator generator;
+    m_firstConnection = generator();
+    m_secondConnection = generator();
+
+    for (size_t i = 0; i < 50; ++i) {
+      m_blockIds.push_back(Crypto::rand<Crypto::Hash>());
+    }
+  }
+
+protected:
+  std::vector<Crypto::Hash> takeRange(const boost::uuids::uuid& connectionId, std::list<Crypto::Hash>& neededBlocks) {
+    return m_scheduler.takeRange(connectionId, neededBlocks, [this](const Crypto::Hash& blockId) {
+      return m_knownBlocks.count(blockId) != 0;
+    }, m_now);
+  }
+
+  std::list<Crypto::Hash> neededBlocks() const {
+    return std::list<Crypto::Hash>(m_blockIds.begin(), m_blockIds.end());
+  }
+
+  std::vector<Crypto::Hash> blockIds(size_t begin, size_t end) const {
+    return std::vector<Crypto::Hash>(m_blockIds.begin() + begin, m_blockIds.begin() + end);
+  }
+
+  SyncScheduler::BlockRangePtr makeRange(const boost::uuids::uuid& connectionId, size_t begin, size_t end, bool verified = true) const {
+    auto range = std::make_shared<SyncScheduler::BlockRange>();
+    range->connectionId = connectionId;
+    range->blockIds = blockIds(begin, end);
+    range->verified = verified;
+    return range;
+  }
+
+  SyncScheduler::BlockRangePtr takeVerifiedRange(const Crypto::Hash& topId) {
+    return m_scheduler.takeVerifiedRange(topId, [this](const Crypto::Hash& blockId) {
+      return m_knownBlocks.count(blockId) != 0;
+    });
+  }
+
+  SyncScheduler m_scheduler;
+  SyncScheduler::Clock::time_point m_now;
+  boost::uuids::uuid m_firstConnection;
+  boost::uuids::uuid m_secondConnection;
+  std::vector<Crypto::Hash> m_blockIds;
+  std::unordered_set<Crypto::Hash> m_knownBlocks;
+};
+
+}
+
+TEST_F(SyncSchedulerTest, connectionsDownloadDifferentRanges) {
+  auto firstNeeded = neededBlocks();
+  auto secondNeeded = neededBlocks();
+
+  ASSERT_EQ(blockIds(0, 10), takeRange(m_firstConnection, firstNeeded));
+  ASSERT_EQ(blockIds(10, 20), takeRange(m_secondConnection, secondNeeded));
+  ASSERT_EQ(m_blockIds.size(), firstNeeded.size());
+  ASSERT_EQ(m_blockIds.size(), secondNeeded.size());
+}
+
+TEST_F(SyncSchedulerTest, knownBlocksAreRemovedFromNeededBlocks) {
+  m_knownBlocks.insert(m_blockIds.begin(), m_blockIds.begin() + 5);
+  auto needed = neededBlocks();
+
+  ASSERT_EQ(blockIds(5, 15), takeRange(m_firstConnection, needed));
+  ASSERT_EQ(m_blockIds.size() - 5, needed.size());
+}
+
+TEST_F(SyncSchedulerTest, rangeIsTakenOverAfterTimeout) {
+  auto firstNeeded = neededBlocks();
+  auto secondNeeded = neededBlocks();
+  ASSERT_EQ(blockIds(0, 10), takeRange(m_firstConnection, firstNeeded));
+
+  m_now += std::chrono::seconds(61);
+  ASSERT_EQ(blockIds(0, 10), takeRange(m_secondConnection, secondNeeded));
+}
+
+TEST_F(SyncSchedulerTest, receivedRangeIsRequestedAgainIfNotAdded) {
+  auto firstNeeded = neededBlocks();
+  auto secondNeeded = neededBlocks();
+  ASSERT_EQ(blockIds(0, 10), takeRange(m_firstConnection, firstNeeded));
+
+  m_scheduler.rangeReceived(m_firstConnection, m_now);
+  ASSERT_EQ(blockIds(0, 10), takeRange(m_secondConnection, secondNeeded));
+}
+
+TEST_F(SyncSchedulerTest, connectionWaitsWhileOthersDownloadItsBlocks) {
+  std::list<Crypto::Hash> firstNeeded(m_blockIds.begin(), m_blockIds.begin() + 10);
+  std::list<Crypto::Hash> secondNeeded(firstNeeded);
+  ASSERT_EQ(blockIds(0, 10), takeRange(m_firstConnection, firstNeeded));
+
+  ASSERT_TRUE(takeRange(m_secondConnection, secondNeeded).empty());
+  ASSERT_TRUE(m_scheduler.isWaiting(m_secondConnection));
+
+  m_knownBlocks.insert(m_blockIds.begin(), m_blockIds.begin() + 10);
+  ASSERT_TRUE(takeRange(m_secondConnection, secondNeeded).empty());
+  ASSERT_FALSE(m_scheduler.isWaiting(m_secondConnection));
+  ASSERT_TRUE(secondNeeded.empty());
+}
+
+TEST_F(SyncSchedulerTest, rangeSizeFollowsThroughput) {
+  auto needed = neededBlocks();
+  ASSERT_EQ(MAX_RANGE_SIZE, takeRange(m_firstConnection, needed).size());
+
+  // 10 blocks in 50 seconds are 0.2 blocks per second, 2 blocks in 10 seconds
+  m_now += std::chrono::seconds(50);
+  m_scheduler.rangeReceived(m_firstConnection, m_now);
+  ASSERT_EQ(MIN_RANGE_SIZE, m_scheduler.getRangeSize(m_firstConnection));
+  ASSERT_EQ(MAX_RANGE_SIZE, m_scheduler.getRangeSize(m_secondConnection));
+}
+
+TEST_F(SyncSchedulerTest, pendingRangeIsTakenByParent) {
+  Crypto::Hash parentId = Crypto::rand<Crypto::Hash>();
+  ASSERT_TRUE(m_scheduler.addPendingRange(parentId, makeRange(m_firstConnection, 10, 20)));
+  ASSERT_FALSE(m_scheduler.addPendingRange(parentId, makeRange(m_secondConnection, 10, 20)));
+  ASSERT_TRUE(m_scheduler.isBlockPending(m_blockIds[15]));
+  ASSERT_EQ(10, m_scheduler.getPendingBlockCount());
+
+  ASSERT_EQ(nullptr, takeVerifiedRange(m_blockIds[0]));
+  auto range = takeVerifiedRange(parentId);
+  ASSERT_NE(nullptr, range);
+  ASSERT_EQ(m_firstConnection, range->connectionId);
+  ASSERT_EQ(blockIds(10, 20), range->blockIds);
+  ASSERT_FALSE(m_scheduler.isBlockPending(m_blockIds[15]));
+  ASSERT_EQ(0, m_scheduler.getPendingBlockCount());
+}
+
+TEST_F(SyncSchedulerTest, rangeIsNotTakenUntilVerified) {
+  auto range = makeRange(m_firstConnection, 10, 20, false);
+  ASSERT_TRUE(m_scheduler.addPendingRange(m_blockIds[9], range));
+  ASSERT_EQ(nullptr, takeVerifiedRange(m_blockIds[9]));
+  ASSERT_TRUE(m_scheduler.isBlockPending(m_blockIds[15]));
+
+  range->verified = true;
+  ASSERT_EQ(range, takeVerifiedRange(m_blockIds[9]));
+}
+
+TEST_F(SyncSchedulerTest, rangeOfAnotherBranchIsTakenOnceItsParentIsKnown) {
+  ASSERT_TRUE(m_scheduler.addPendingRange(m_blockIds[4], makeRange(m_firstConnection, 10, 20)));
+  ASSERT_EQ(nullptr, takeVerifiedRange(m_blockIds[9]));
+
+  m_knownBlocks.insert(m_blockIds[4]);
+  auto range = takeVerifiedRange(m_blockIds[9]);
+  ASSERT_NE(nullptr, range);
+  ASSERT_EQ(blockIds(10, 20), range->blockIds);
+}
+
+TEST_F(SyncSchedulerTest, pendingBlocksAreNotDownloaded) {
+  ASSERT_TRUE(m_scheduler.addPendingRange(m_blockIds[9], makeRange(m_secondConnection, 10, 20)));
+
+  auto needed = neededBlocks();
+  ASSERT_EQ(blockIds(0, 10), takeRange(m_firstConnection, needed));
+  m_scheduler.rangeReceived(m_firstConnection, m_now);
+  m_knownBlocks.insert(m_blockIds.begin(), m_blockIds.begin() + 10);
+  ASSERT_EQ(blockIds(20, 30), takeRange(m_firstConnection, needed));
+}
+
+TEST_F(SyncSchedulerTest, onlyNextBlocksAreDownloadedWhenTooManyArePending) {
+  ASSERT_TRUE(m_scheduler.addPendingRange(m_blockIds[9], makeRange(m_secondConnection, 10, 30)));
+
+  auto firstNeeded = neededBlocks();
+  std::list<Crypto::Hash> secondNeeded(m_blockIds.begin() + 10, m_blockIds.end());
+  ASSERT_EQ(blockIds(0, 10), takeRange(m_firstConnection, firstNeeded));
+  ASSERT_TRUE(takeRange(m_secondConnection, secondNeeded).empty());
+  ASSERT_TRUE(m_scheduler.isWaiting(m_secondConnection));
+}
+
+TEST_F(SyncSchedulerTest, closedConnectionReleasesItsRange) {
+  auto firstNeeded = neededBlocks();
+  auto secondNeeded = neededBlocks();
+  ASSERT_EQ(blockIds(0, 10), takeRange(m_firstConnection, firstNeeded));
+
+  m_scheduler.removeConnection(m_firstConnection);
+  ASSERT_EQ(blockIds(0, 10), takeRange(m_secondConnection, secondNeeded));
+}
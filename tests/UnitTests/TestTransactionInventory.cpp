@@ -0,0 +1,153 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <boost/uuid/random_generator.hpp>
+
+#include "crypto/crypto.h"
+#include "CryptoNoteProtocol/TransactionInventory.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+const size_t MAX_KNOWN_COUNT = 10;
+const size_t MAX_ANNOUNCED_COUNT = 5;
+const size_t MAX_CONNECTION_ANNOUNCED_COUNT = 3;
+
+class TransactionInventoryTest : public ::testing::Test {
+public:
+  TransactionInventoryTest() :
+    m_inventory(MAX_KNOWN_COUNT, MAX_ANNOUNCED_COUNT, MAX_CONNECTION_ANNOUNCED_COUNT, std::chrono::seconds(10)),
+    m_now(TransactionInventory::Clock::now()) {
+    boost::uuids::random_generator generator;
+    m_firstConnection = generator();
+    m_secondConnection = generator();
+    m_thirdConnection = generator();
+
+    for (size_t i = 0; i < 20; ++i) {
+      m_transactionIds.push_back(Crypto::rand<Crypto::Hash>());
+    }
+  }
+
+protected:
+  std::vector<Crypto::Hash> transactionIds(size_t begin, size_t end) const {
+    return std::vector<Crypto::Hash>(m_transactionIds.begin() + begin, m_transactionIds.begin() + end);
+  }
+
+  TransactionInventory m_inventory;
+  TransactionInventory::Clock::time_point m_now;
+  boost::uuids::uuid m_firstConnection;
+  boost::uuids::uuid m_secondConnection;
+  boost::uuids::uuid m_thirdConnection;
+  std::vector<Crypto::Hash> m_transactionIds;
+};
+
+}
+
+TEST_F(TransactionInventoryTest, knownTransactionsAreNotAnnounced) {
+  m_inventory.addKnown(m_firstConnection, m_transactionIds[0]);
+  m_inventory.queueAnnouncement(m_firstConnection, m_transactionIds[0]);
+  m_inventory.queueAnnouncement(m_firstConnection, m_transactionIds[1]);
+  m_inventory.queueAnnouncement(m_firstConnection, m_transactionIds[1]);
+  m_inventory.queueAnnouncement(m_secondConnection, m_transactionIds[0]);
+
+  auto announcements = m_inventory.takeAnnouncements();
+  ASSERT_EQ(2, announcements.size());
+  ASSERT_EQ(transactionIds(1, 2), announcements[m_firstConnection]);
+  ASSERT_EQ(transactionIds(0, 1), announcements[m_secondConnection]);
+  ASSERT_TRUE(m_inventory.takeAnnouncements().empty());
+}
+
+TEST_F(TransactionInventoryTest, knownTransactionsAreForgottenWhenTooMany) {
+  for (size_t i = 0; i < MAX_KNOWN_COUNT; ++i) {
+    m_inventory.addKnown(m_firstConnection, m_transactionIds[i]);
+  }
+
+  ASSERT_TRUE(m_inventory.isKnown(m_firstConnection, m_transactionIds[0]));
+  m_inventory.addKnown(m_firstConnection, m_transactionIds[MAX_KNOWN_COUNT]);
+  ASSERT_FALSE(m_inventory.isKnown(m_firstConnection, m_transactionIds[0]));
+  ASSERT_TRUE(m_inventory.isKnown(m_firstConnection, m_transactionIds[MAX_KNOWN_COUNT]));
+}
+
+TEST_F(TransactionInventoryTest, announcedTransactionIsRequestedFromOneConnection) {
+  ASSERT_TRUE(m_inventory.addAnnounced(m_firstConnection, m_transactionIds[0]));
+  ASSERT_TRUE(m_inventory.addAnnounced(m_secondConnection, m_transactionIds[0]));
+  ASSERT_TRUE(m_inventory.addAnnounced(m_secondConnection, m_transactionIds[1]));
+  ASSERT_TRUE(m_inventory.isKnown(m_secondConnection, m_transactionIds[0]));
+
+  auto requests = m_inventory.takeRequests(m_now);
+  ASSERT_EQ(2, requests.size());
+  ASSERT_EQ(transactionIds(0, 1), requests[m_firstConnection]);
+  ASSERT_EQ(transactionIds(1, 2), requests[m_secondConnection]);
+  ASSERT_TRUE(m_inventory.takeRequests(m_now).empty());
+}
+
+TEST_F(TransactionInventoryTest, transactionIsRequestedFromNextConnectionAfterTimeout) {
+  m_inventory.addAnnounced(m_firstConnection, m_transactionIds[0]);
+  m_inventory.addAnnounced(m_secondConnection, m_transactionIds[0]);
+  m_inventory.takeRequests(m_now);
+
+  auto requests = m_inventory.takeRequests(m_now + std::chrono::seconds(11));
+  ASSERT_EQ(1, requests.size());
+  ASSERT_EQ(transactionIds(0, 1), requests[m_secondConnection]);
+
+  ASSERT_TRUE(m_inventory.takeRequests(m_now + std::chrono::seconds(22)).empty());
+  ASSERT_EQ(0, m_inventory.getAnnouncedCount());
+}
+
+TEST_F(TransactionInventoryTest, receivedTransactionIsNotRequested) {
+  m_inventory.addAnnounced(m_firstConnection, m_transactionIds[0]);
+  m_inventory.removeAnnounced(m_transactionIds[0]);
+  ASSERT_TRUE(m_inventory.takeRequests(m_now).empty());
+}
+
+TEST_F(TransactionInventoryTest, closedConnectionPassesRequestToNextConnection) {
+  m_inventory.addAnnounced(m_firstConnection, m_transactionIds[0]);
+  m_inventory.addAnnounced(m_secondConnection, m_transactionIds[0]);
+  m_inventory.addAnnounced(m_firstConnection, m_transactionIds[1]);
+  m_inventory.takeRequests(m_now);
+
+  m_inventory.removeConnection(m_firstConnection);
+  ASSERT_EQ(1, m_inventory.getAnnouncedCount());
+  auto requests = m_inventory.takeRequests(m_now);
+  ASSERT_EQ(1, requests.size());
+  ASSERT_EQ(transactionIds(0, 1), requests[m_secondConnection]);
+}
+
+TEST_F(TransactionInventoryTest, announcementsAreLimited) {
+  for (size_t i = 0; i < MAX_ANNOUNCED_COUNT; ++i) {
+    ASSERT_TRUE(m_inventory.addAnnounced(i < MAX_CONNECTION_ANNOUNCED_COUNT ? m_firstConnection : m_secondConnection, m_transactionIds[i]));
+  }
+
+  ASSERT_FALSE(m_inventory.addAnnounced(m_secondConnection, m_transactionIds[MAX_ANNOUNCED_COUNT]));
+  ASSERT_FALSE(m_inventory.addAnnounced(m_thirdConnection, m_transactionIds[MAX_ANNOUNCED_COUNT]));
+  ASSERT_TRUE(m_inventory.addAnnounced(m_thirdConnection, m_transactionIds[0]));
+}
+
+TEST_F(TransactionInventoryTest, connectionAnnouncementsAreLimited) {
+  for (size_t i = 0; i < MAX_CONNECTION_ANNOUNCED_COUNT; ++i) {
+    ASSERT_TRUE(m_inventory.addAnnounced(m_firstConnection, m_transactionIds[i]));
+  }
+
+  ASSERT_TRUE(m_inventory.addAnnounced(m_firstConnection, m_transactionIds[0]));
+  ASSERT_FALSE(m_inventory.addAnnounced(m_firstConnection, m_transactionIds[MAX_CONNECTION_ANNOUNCED_COUNT]));
+  ASSERT_TRUE(m_inventory.addAnnounced(m_secondConnection, m_transactionIds[MAX_CONNECTION_ANNOUNCED_COUNT]));
+}
+
+TEST_F(TransactionInventoryTest, connectionAnnouncementsAreCountedUntilReceivedOrTimedOut) {
+  for (size_t i = 0; i < MAX_CONNECTION_ANNOUNCED_COUNT; ++i) {
+    m_inventory.addAnnounced(m_firstConnection, m_transactionIds[i]);
+  }
+
+  m_inventory.removeAnnounced(m_transactionIds[0]);
+  ASSERT_TRUE(m_inventory.addAnnounced(m_firstConnection, m_transactionIds[10]));
+  ASSERT_FALSE(m_inventory.addAnnounced(m_firstConnection, m_transactionIds[11]));
+
+  m_inventory.takeRequests(m_now);
+  m_inventory.takeRequests(m_now + std::chrono::seconds(11));
+  ASSERT_EQ(0, m_inventory.getAnnouncedCount());
+  ASSERT_TRUE(m_inventory.addAnnounced(m_firstConnection, m_transactionIds[11]));
+}
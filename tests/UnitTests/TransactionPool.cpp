@@ -5,6 +5,7 @@
 #include "gtest/gtest.h"
 
 #include <algorithm>
+#include <fstream>
 
 #include <boost/filesystem/operations.hpp>
 
@@ -14,6 +15,7 @@
 #include "CryptoNoteCore/Currency.h"
 #include "CryptoNoteCore/TransactionExtra.h"
 #include "CryptoNoteCore/TransactionPool.h"
+#include "Serialization/BinarySerializationTools.h"
 
 #include <Logging/ConsoleLogger.h>
 #include <Logging/LoggerGroup.h>
@@ -681,6 +683,304 @@ TEST_F(tx_pool, TxPoolDoesNotAcceptInvalidFusionTransaction) {
   ASSERT_FALSE(tvc.m_verifivation_impossible);
 }
 
+TEST_F(tx_pool, TransactionsAreRestoredFromJournal) {
+  TransactionValidator validator;
+  FakeTimeProvider timeProvider;
+  std::unique_ptr<tx_memory_pool> pool(new tx_memory_pool(currency, validator, timeProvider, logger));
+  ASSERT_TRUE(pool->init(m_configDir.string()));
+
+  Transaction tx1;
+  Transaction tx2;
+  GenerateTransaction(currency, tx1, currency.minimumFee(), 1);
+  GenerateTransaction(currency, tx2, currency.minimumFee(), 2);
+
+  tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+  ASSERT_TRUE(pool->add_tx(tx1, tvc, false));
+  ASSERT_TRUE(pool->add_tx(tx2, tvc, false));
+
+  Transaction takenTx;
+  size_t blobSize;
+  uint64_t fee;
+  ASSERT_TRUE(pool->take_tx(getObjectHash(tx1), takenTx, blobSize, fee));
+
+  ASSERT_TRUE(pool->deinit());
+  pool.reset(new tx_memory_pool(currency, validator, timeProvider, logger));
+  ASSERT_TRUE(pool->init(m_configDir.string()));
+
+  ASSERT_EQ(1, pool->get_transactions_count());
+  ASSERT_FALSE(pool->have_tx(getObjectHash(tx1)));
+  ASSERT_TRUE(pool->have_tx(getObjectHash(tx2)));
+  ASSERT_EQ(getObjectBinarySize(tx2), pool->getTransactionsSize());
+}
+
+TEST_F(tx_pool, TornJournalRecordIsDroppedDuringTxPoolInitialization) {
+  TransactionValidator validator;
+  FakeTimeProvider timeProvider;
+  std::unique_ptr<tx_memory_pool> pool(new tx_memory_pool(currency, validator, timeProvider, logger));
+  ASSERT_TRUE(pool->init(m_configDir.string()));
+
+  Transaction tx1;
+  GenerateTransaction(currency, tx1, currency.minimumFee(), 1);
+  tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+  ASSERT_TRUE(pool->add_tx(tx1, tvc, false));
+  ASSERT_TRUE(pool->deinit());
+
+  // a record cut short by a crash
+  {
+    std::ofstream journal((m_configDir / currency.txPoolJournalFileName()).string(), std::ios::binary | std::ios::app);
+    uint32_t recordSize = 1000;
+    journal.write(reinterpret_cast<const char*>(&recordSize), sizeof(recordSize));
+    journal.write("torn", 4);
+  }
+
+  pool.reset(new tx_memory_pool(currency, validator, timeProvider, logger));
+  ASSERT_TRUE(pool->init(m_configDir.string()));
+  ASSERT_EQ(1, pool->get_transactions_count());
+
+  Transaction tx2;
+  GenerateTransaction(currency, tx2, currency.minimumFee(), 2);
+  ASSERT_TRUE(pool->add_tx(tx2, tvc, false));
+  ASSERT_TRUE(pool->deinit());
+
+  pool.reset(new tx_memory_pool(currency, validator, timeProvider, logger));
+  ASSERT_TRUE(pool->init(m_configDir.string()));
+  ASSERT_EQ(2, pool->get_transactions_count());
+}
+
+TEST_F(tx_pool, PoolStateFileIsLoadedIntoJournal) {
+  TransactionValidator validator;
+  FakeTimeProvider timeProvider;
+  std::unique_ptr<tx_memory_pool> pool(new tx_memory_pool(currency, validator, timeProvider, logger));
+  ASSERT_TRUE(pool->init(m_configDir.string()));
+
+  Transaction tx;
+  GenerateTransaction(currency, tx, currency.minimumFee(), 1);
+  tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+  ASSERT_TRUE(pool->add_tx(tx, tvc, false));
+
+  std::string stateFileName = (m_configDir / currency.txPoolFileName()).string();
+  ASSERT_TRUE(storeToBinaryFile(*pool, stateFileName));
+  ASSERT_TRUE(pool->deinit());
+  pool.reset();
+  boost::filesystem::remove(m_configDir / currency.txPoolJournalFileName());
+
+  pool.reset(new tx_memory_pool(currency, validator, timeProvider, logger));
+  ASSERT_TRUE(pool->init(m_configDir.string()));
+  ASSERT_TRUE(pool->have_tx(getObjectHash(tx)));
+  ASSERT_FALSE(boost::filesystem::exists(stateFileName));
+  ASSERT_TRUE(pool->deinit());
+
+  pool.reset(new tx_memory_pool(currency, validator, timeProvider, logger));
+  ASSERT_TRUE(pool->init(m_configDir.string()));
+  ASSERT_TRUE(pool->have_tx(getObjectHash(tx)));
+}
+
+namespace {
+
+class ChainStateTransactionValidator : public CryptoNote::ITransactionValidator {
+public:
+  ChainStateTransactionValidator() : inputsAvailable(true), keyImagesSpent(false), checkCount(0) {
+  }
+
+  virtual bool checkTransactionInputs(const CryptoNote::Transaction& tx, BlockInfo& maxUsedBlock) override {
+    return true;
+  }
+
+  virtual bool checkTransactionInputs(const CryptoNote::Transaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) override {
+    ++checkCount;
+    if (!inputsAvailable) {
+      return false;
+    }
+
+    maxUsedBlock.height = 5;
+    return true;
+  }
+
+  virtual bool haveSpentKeyImages(const CryptoNote::Transaction& tx) override {
+    return keyImagesSpent;
+  }
+
+  virtual bool checkTransactionSize(size_t blobSize) override {
+    return true;
+  }
+
+  bool inputsAvailable;
+  bool keyImagesSpent;
+  size_t checkCount;
+};
+
+std::vector<Crypto::Hash> fillTestBlockTemplate(tx_memory_pool& pool) {
+  Block block;
+  size_t totalSize;
+  uint64_t totalFee;
+  EXPECT_TRUE(pool.fill_block_template(block, 5000, textMaxCumulativeSize, 0, totalSize, totalFee));
+  return block.transactionHashes;
+}
+
+}
+
+TEST_F(tx_pool, TransactionIsCheckedOnlyOnceWhileChainDoesNotChange) {
+  TestPool<ChainStateTransactionValidator, FakeTimeProvider> pool(currency, logger);
+
+  Transaction tx;
+  GenerateTransaction(currency, tx, currency.minimumFee(), 1);
+  tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+  ASSERT_TRUE(pool.add_tx(tx, tvc, false));
+
+  ASSERT_EQ(std::vector<Crypto::Hash>{getObjectHash(tx)}, fillTestBlockTemplate(pool));
+  ASSERT_EQ(std::vector<Crypto::Hash>{getObjectHash(tx)}, fillTestBlockTemplate(pool));
+  ASSERT_EQ(1, pool.validator.checkCount);
+}
+
+TEST_F(tx_pool, WaitingTransactionIsAddedToBlockTemplateAfterChainGrows) {
+  TestPool<ChainStateTransactionValidator, FakeTimeProvider> pool(currency, logger);
+  pool.validator.inputsAvailable = false;
+
+  Transaction tx;
+  GenerateTransaction(currency, tx, currency.minimumFee(), 1);
+  tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+  ASSERT_TRUE(pool.add_tx(tx, tvc, false));
+  ASSERT_TRUE(fillTestBlockTemplate(pool).empty());
+
+  pool.validator.inputsAvailable = true;
+  ASSERT_TRUE(fillTestBlockTemplate(pool).empty());
+
+  pool.on_blockchain_inc(7, NULL_HASH, std::vector<Crypto::KeyImage>());
+  ASSERT_EQ(std::vector<Crypto::Hash>{getObjectHash(tx)}, fillTestBlockTemplate(pool));
+}
+
+TEST_F(tx_pool, TransactionSpendingKeyImageOfNewBlockIsRemovedFromBlockTemplate) {
+  TestPool<ChainStateTransactionValidator, FakeTimeProvider> pool(currency, logger);
+
+  Transaction tx;
+  GenerateTransaction(currency, tx, currency.minimumFee(), 1);
+  tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+  ASSERT_TRUE(pool.add_tx(tx, tvc, false));
+  ASSERT_EQ(1, fillTestBlockTemplate(pool).size());
+
+  pool.validator.keyImagesSpent = true;
+  Crypto::KeyImage otherKeyImage = Crypto::KeyImage();
+  pool.on_blockchain_inc(7, NULL_HASH, { otherKeyImage });
+  ASSERT_EQ(1, fillTestBlockTemplate(pool).size());
+
+  pool.on_blockchain_inc(8, NULL_HASH, { boost::get<KeyInput>(tx.inputs[0]).keyImage });
+  ASSERT_TRUE(fillTestBlockTemplate(pool).empty());
+}
+
+TEST_F(tx_pool, TransactionIsCheckedAgainWhenBlockWithItsInputsIsRemoved) {
+  TestPool<ChainStateTransactionValidator, FakeTimeProvider> pool(currency, logger);
+
+  Transaction tx;
+  GenerateTransaction(currency, tx, currency.minimumFee(), 1);
+  tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+  ASSERT_TRUE(pool.add_tx(tx, tvc, false));
+  ASSERT_EQ(1, fillTestBlockTemplate(pool).size());
+
+  pool.validator.inputsAvailable = false;
+  pool.on_blockchain_dec(6, NULL_HASH);
+  ASSERT_EQ(1, fillTestBlockTemplate(pool).size());
+
+  pool.on_blockchain_dec(5, NULL_HASH);
+  ASSERT_TRUE(fillTestBlockTemplate(pool).empty());
+}
+
+namespace {
+
+class TxPool_SizeLimit : public tx_pool {
+public:
+  void SetUp() override {
+    tx_pool::SetUp();
+
+    GenerateTransaction(currency, cheapTx, currency.minimumFee(), 1);
+    GenerateTransaction(currency, averageTx, 2 * currency.minimumFee(), 1);
+    GenerateTransaction(currency, expensiveTx, 3 * currency.minimumFee(), 1);
+
+    // two transactions fit in the pool
+    transactionSize = getObjectBinarySize(cheapTx);
+    currency = CryptoNote::CurrencyBuilder(logger).mempoolMaxSize(transactionSize * 5 / 2).currency();
+  }
+
+  bool addTransaction(tx_memory_pool& pool, const Transaction& tx, tx_verification_context& tvc) {
+    tvc = boost::value_initialized<tx_verification_context>();
+    return pool.add_tx(tx, tvc, false);
+  }
+
+  Transaction cheapTx;
+  Transaction averageTx;
+  Transaction expensiveTx;
+  size_t transactionSize;
+};
+
+}
+
+TEST_F(TxPool_SizeLimit, transactionWithLowestFeeIsEvictedWhenPoolIsFull) {
+  TestPool<TransactionValidator, FakeTimeProvider> pool(currency, logger);
+  tx_verification_context tvc;
+  ASSERT_TRUE(addTransaction(pool, cheapTx, tvc));
+  ASSERT_TRUE(addTransaction(pool, averageTx, tvc));
+  ASSERT_EQ(2 * transactionSize, pool.getTransactionsSize());
+
+  ASSERT_TRUE(addTransaction(pool, expensiveTx, tvc));
+  ASSERT_TRUE(tvc.m_added_to_pool);
+  ASSERT_EQ(2, pool.get_transactions_count());
+  ASSERT_FALSE(pool.have_tx(getObjectHash(cheapTx)));
+  ASSERT_TRUE(pool.have_tx(getObjectHash(averageTx)));
+  ASSERT_EQ(1, pool.getEvictedTransactionsCount());
+  ASSERT_EQ(2 * transactionSize, pool.getTransactionsSize());
+}
+
+TEST_F(TxPool_SizeLimit, transactionNotPayingMoreThanPoolTransactionsIsRejectedWhenPoolIsFull) {
+  TestPool<TransactionValidator, FakeTimeProvider> pool(currency, logger);
+  tx_verification_context tvc;
+  ASSERT_TRUE(addTransaction(pool, averageTx, tvc));
+  ASSERT_TRUE(addTransaction(pool, expensiveTx, tvc));
+
+  Transaction tx;
+  GenerateTransaction(currency, tx, 2 * currency.minimumFee(), 1);
+  ASSERT_FALSE(addTransaction(pool, tx, tvc));
+  ASSERT_TRUE(tvc.m_verifivation_failed);
+  ASSERT_TRUE(tvc.m_tx_fee_too_small);
+  ASSERT_EQ(2, pool.get_transactions_count());
+  ASSERT_EQ(0, pool.getEvictedTransactionsCount());
+}
+
+TEST_F(TxPool_SizeLimit, transactionsOfBlocksAreNotEvicted) {
+  TestPool<TransactionValidator, FakeTimeProvider> pool(currency, logger);
+  tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+  ASSERT_TRUE(pool.add_tx(cheapTx, tvc, true));
+  ASSERT_TRUE(addTransaction(pool, averageTx, tvc));
+
+  ASSERT_TRUE(addTransaction(pool, expensiveTx, tvc));
+  ASSERT_TRUE(pool.have_tx(getObjectHash(cheapTx)));
+  ASSERT_FALSE(pool.have_tx(getObjectHash(averageTx)));
+}
+
+TEST_F(TxPool_SizeLimit, minimumFeeRisesWhenPoolIsMoreThanHalfFull) {
+  TestPool<TransactionValidator, FakeTimeProvider> pool(currency, logger);
+  ASSERT_EQ(currency.minimumFee(), pool.getMinimumFee());
+
+  tx_verification_context tvc;
+  ASSERT_TRUE(addTransaction(pool, expensiveTx, tvc));
+  ASSERT_EQ(currency.minimumFee(), pool.getMinimumFee());
+
+  ASSERT_TRUE(addTransaction(pool, averageTx, tvc));
+  uint64_t minimumFee = pool.getMinimumFee();
+  ASSERT_GT(minimumFee, currency.minimumFee());
+  ASSERT_LE(minimumFee, 2 * currency.minimumFee());
+
+  ASSERT_FALSE(addTransaction(pool, cheapTx, tvc));
+  ASSERT_TRUE(tvc.m_tx_fee_too_small);
+}
+
+TEST_F(TxPool_SizeLimit, minimumFeeOfPoolWithoutRoomIsCurrencyMinimum) {
+  currency = CryptoNote::CurrencyBuilder(logger).mempoolMaxSize(0).currency();
+  TestPool<TransactionValidator, FakeTimeProvider> pool(currency, logger);
+  tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+  ASSERT_TRUE(pool.add_tx(cheapTx, tvc, true));
+  ASSERT_EQ(transactionSize, pool.getTransactionsSize());
+  ASSERT_EQ(currency.minimumFee(), pool.getMinimumFee());
+}
+
 namespace {
 
 const size_t TEST_FUSION_TX_COUNT_PER_BLOCK = 3;
@@ -0,0 +1,91 @@
+// Copyright (c) 2011-2017, The ManateeCoin Developers, The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+#include "Common/ParallelFor.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace Tools;
+
+TEST(WorkerPool, parallelForCallsEachJobOnce) {
+  std::vector<std::atomic<int>> calls(1000);
+  parallelFor(calls.size(), 4, [&calls](size_t i) { ++calls[i]; });
+
+  for (auto& count : calls) {
+    ASSERT_EQ(1, count.load());
+  }
+}
+
+TEST(WorkerPool, reusesPoolThreads) {
+  WorkerPool pool(2);
+  std::mutex mutex;
+  std::set<std::thread::id> threadIds;
+  for (size_t i = 0; i < 20; ++i) {
+    std::atomic<size_t> next(0);
+    pool.run(3, [&] {
+      for (size_t j = next++; j < 100; j = next++) {
+        std::lock_guard<std::mutex> lock(mutex);
+        threadIds.insert(std::this_thread::get_id());
+      }
+    });
+  }
+
+  ASSERT_LE(threadIds.size(), 3);
+}
+
+TEST(WorkerPool, nestedLoopsComplete) {
+  WorkerPool pool(1);
+  std::atomic<size_t> total(0);
+  std::atomic<size_t> next(0);
+  pool.run(2, [&] {
+    for (size_t i = next++; i < 10; i = next++) {
+      std::atomic<size_t> innerNext(0);
+      pool.run(2, [&] {
+        for (size_t j = innerNext++; j < 10; j = innerNext++) {
+          ++total;
+        }
+      });
+    }
+  });
+
+  ASSERT_EQ(100, total.load());
+}
+
+TEST(WorkerPool, rethrowsWorkerException) {
+  WorkerPool pool(1);
+  std::atomic<size_t> next(0);
+  ASSERT_THROW(pool.run(2, [&next] {
+    if (next++ == 0) {
+      throw std::runtime_error("job failed");
+    }
+  }), std::runtime_error);
+}
+
+TEST(WorkerPool, postedTasksRunOnPoolThreads) {
+  WorkerPool pool(2);
+  std::mutex mutex;
+  std::condition_variable finished;
+  std::set<std::thread::id> threadIds;
+  size_t finishedCount = 0;
+  for (size_t i = 0; i < 10; ++i) {
+    pool.post([&] {
+      std::lock_guard<std::mutex> lock(mutex);
+      threadIds.insert(std::this_thread::get_id());
+      ++finishedCount;
+      finished.notify_one();
+    });
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  finished.wait(lock, [&finishedCount] { return finishedCount == 10; });
+  ASSERT_LE(threadIds.size(), 2);
+  ASSERT_EQ(0, threadIds.count(std::this_thread::get_id()));
+}